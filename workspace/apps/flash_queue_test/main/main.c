@@ -0,0 +1,386 @@
+/**
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Checks for the flash_queue component on the ESP-IDF linux target (or
+ * QEMU), using the emulated flash behind the "fqueue" partition:
+ *
+ *  - Push, drain, and commit, with messages arriving in order
+ *  - Remounting (as after a reset) keeps committed pops and redelivers
+ *    messages that were popped but not committed
+ *  - Filling the ring drops the oldest sector of unsent messages, and the
+ *    rest survive a remount
+ *  - Writing carries on across the end of the partition after compaction
+ *  - Messages sent with an acknowledgement identifier stay in flash until
+ *    flash_queue_ack(), and flash_queue_rewind() puts the unacknowledged
+ *    ones back
+ *
+ * Build and run with:
+ *   idf.py --preview set-target linux
+ *   idf.py build monitor
+ *
+ * The process exits with status 0 if every check passed.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+
+#include "flash_queue.h"
+
+// Settings
+#define MSG_SIZE            60      // Bytes per test message (72 in flash)
+#define RECORD_SIZE         72      // Header (12) + message, padded to 4
+
+// Fail the current check (and keep going) if cond is false
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            ESP_LOGE(TAG, "Check failed (line %d): %s", __LINE__, #cond);   \
+            s_failed++;                                                     \
+        }                                                                   \
+    } while (0)
+
+// Tag for debug messages
+static const char *TAG = "flash_queue_test";
+
+// Static global variables
+static int s_failed = 0;
+static uint32_t s_expect = 0;       // Index the next drained message must have
+static uint32_t s_accept = 0;       // Messages the drain callback still accepts
+static int s_next_id = 0;           // Next acknowledgement id (0 = none)
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static void make_msg(uint8_t *msg, uint32_t index);
+static uint32_t msg_index(const uint8_t *msg, size_t len);
+static esp_err_t collect(const uint8_t *data, size_t len, int *id, void *ctx);
+static void push_range(uint32_t first, uint32_t count);
+static uint32_t peek_index(void);
+static void erase_partition(void);
+static void remount(void);
+static void test_push_drain_commit(void);
+static void test_redelivery(void);
+static void test_full_ring(void);
+static void test_wrap(void);
+static void test_ack(void);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Fill a message with its index (and a pattern derived from it)
+static void make_msg(uint8_t *msg, uint32_t index)
+{
+    memset(msg, (int)(index & 0xFF), MSG_SIZE);
+    memcpy(msg, &index, sizeof(index));
+}
+
+// Get the index back out of a message (UINT32_MAX if it is damaged)
+static uint32_t msg_index(const uint8_t *msg, size_t len)
+{
+    uint8_t expected[MSG_SIZE];
+    uint32_t index;
+
+    if (len != MSG_SIZE) {
+        return UINT32_MAX;
+    }
+    memcpy(&index, msg, sizeof(index));
+    make_msg(expected, index);
+    if (memcmp(msg, expected, MSG_SIZE) != 0) {
+        return UINT32_MAX;
+    }
+
+    return index;
+}
+
+// Drain callback: messages must arrive in order; refuse once s_accept runs out
+static esp_err_t collect(const uint8_t *data, size_t len, int *id, void *ctx)
+{
+    if (s_accept == 0) {
+        return ESP_FAIL;
+    }
+    s_accept--;
+    CHECK(msg_index(data, len) == s_expect);
+    s_expect++;
+
+    // Ask for an acknowledgement if the test hands out ids
+    if (s_next_id > 0) {
+        *id = s_next_id++;
+    }
+
+    return ESP_OK;
+}
+
+// Push messages first, first + 1, ...
+static void push_range(uint32_t first, uint32_t count)
+{
+    uint8_t msg[MSG_SIZE];
+
+    for (uint32_t i = first; i < first + count; i++) {
+        make_msg(msg, i);
+        CHECK(flash_queue_push(msg, sizeof(msg)) == ESP_OK);
+    }
+}
+
+// Index of the oldest message (UINT32_MAX if there is none)
+static uint32_t peek_index(void)
+{
+    uint8_t msg[MSG_SIZE];
+    size_t len;
+
+    if (flash_queue_peek(msg, sizeof(msg), &len) != ESP_OK) {
+        return UINT32_MAX;
+    }
+
+    return msg_index(msg, len);
+}
+
+// Start from blank flash
+static void erase_partition(void)
+{
+    const esp_partition_t *part;
+
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                    ESP_PARTITION_SUBTYPE_ANY,
+                                    CONFIG_FLASH_QUEUE_PARTITION_LABEL);
+    if (part == NULL) {
+        ESP_LOGE(TAG, "Partition '%s' not found", CONFIG_FLASH_QUEUE_PARTITION_LABEL);
+        exit(1);
+    }
+    ESP_ERROR_CHECK(esp_partition_erase_range(part, 0, part->size));
+}
+
+// Unmount and mount again, as after a reset
+static void remount(void)
+{
+    CHECK(flash_queue_deinit() == ESP_OK);
+    CHECK(flash_queue_init() == ESP_OK);
+}
+
+// Messages arrive in order, and committed pops are not sent again
+static void test_push_drain_commit(void)
+{
+    size_t sent;
+    size_t len;
+    uint8_t msg[MSG_SIZE];
+
+    ESP_LOGI(TAG, "Push, drain, and commit");
+    erase_partition();
+    CHECK(flash_queue_init() == ESP_OK);
+
+    // Empty queue
+    CHECK(flash_queue_count() == 0);
+    CHECK(flash_queue_peek(msg, sizeof(msg), &len) == ESP_ERR_NOT_FOUND);
+    CHECK(flash_queue_pop() == ESP_ERR_INVALID_STATE);
+
+    // Ten messages, four sent
+    push_range(0, 10);
+    CHECK(flash_queue_count() == 10);
+    s_expect = 0;
+    s_accept = UINT32_MAX;
+    CHECK(flash_queue_drain(4, collect, NULL, &sent) == ESP_OK);
+    CHECK(sent == 4);
+    CHECK(s_expect == 4);
+    CHECK(flash_queue_count() == 6);
+
+    // Drain commits, so the four stay consumed after a reset
+    remount();
+    CHECK(flash_queue_count() == 6);
+    CHECK(peek_index() == 4);
+}
+
+// Pops that were not committed come back after a reset
+static void test_redelivery(void)
+{
+    size_t sent;
+    flash_queue_stats_t stats;
+
+    ESP_LOGI(TAG, "Redelivery after uncommitted pops");
+
+    // Pop two without committing
+    CHECK(peek_index() == 4);
+    CHECK(flash_queue_pop() == ESP_OK);
+    CHECK(flash_queue_pop() == ESP_ERR_INVALID_STATE);
+    CHECK(peek_index() == 5);
+    CHECK(flash_queue_pop() == ESP_OK);
+    CHECK(flash_queue_count() == 4);
+    remount();
+    CHECK(flash_queue_count() == 6);
+    CHECK(peek_index() == 4);
+
+    // Commit one
+    CHECK(flash_queue_pop() == ESP_OK);
+    CHECK(flash_queue_commit() == ESP_OK);
+    remount();
+    CHECK(flash_queue_count() == 5);
+    CHECK(peek_index() == 5);
+
+    // A sender that refuses the third message stops the drain there
+    s_expect = 5;
+    s_accept = 2;
+    CHECK(flash_queue_drain(10, collect, NULL, &sent) == ESP_FAIL);
+    CHECK(sent == 2);
+    CHECK(flash_queue_count() == 3);
+    remount();
+    CHECK(flash_queue_count() == 3);
+
+    // Drain the rest (the queue is compacted once empty)
+    s_accept = UINT32_MAX;
+    CHECK(flash_queue_drain(10, collect, NULL, &sent) == ESP_OK);
+    CHECK(sent == 3);
+    CHECK(s_expect == 10);
+    flash_queue_get_stats(&stats);
+    CHECK(stats.popped == 3);
+    remount();
+    CHECK(flash_queue_count() == 0);
+    CHECK(peek_index() == UINT32_MAX);
+}
+
+// A full ring drops the oldest sector of unsent messages
+static void test_full_ring(void)
+{
+    const esp_partition_t *part;
+    flash_queue_stats_t stats;
+    uint32_t capacity;
+    uint32_t pushed;
+    uint32_t count;
+    size_t sent;
+
+    ESP_LOGI(TAG, "Full ring drops the oldest messages");
+    erase_partition();
+    remount();
+
+    // Half a sector more than fits
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                    ESP_PARTITION_SUBTYPE_ANY,
+                                    CONFIG_FLASH_QUEUE_PARTITION_LABEL);
+    capacity = (part->size / part->erase_size) * (part->erase_size / RECORD_SIZE);
+    pushed = capacity + (part->erase_size / RECORD_SIZE) / 2;
+    push_range(0, pushed);
+
+    // Whole oldest sector dropped, everything after it kept
+    flash_queue_get_stats(&stats);
+    CHECK(stats.pushed == pushed);
+    CHECK(stats.dropped == part->erase_size / RECORD_SIZE);
+    CHECK(flash_queue_count() + stats.dropped == pushed);
+    CHECK(peek_index() == stats.dropped);
+
+    // Same messages after a reset
+    count = flash_queue_count();
+    remount();
+    CHECK(flash_queue_count() == count);
+    CHECK(peek_index() == pushed - count);
+
+    // All of them, in order
+    s_expect = pushed - count;
+    s_accept = UINT32_MAX;
+    CHECK(flash_queue_drain(SIZE_MAX, collect, NULL, &sent) == ESP_OK);
+    CHECK(sent == count);
+    CHECK(s_expect == pushed);
+    CHECK(flash_queue_count() == 0);
+}
+
+// Writing carries on past the end of the partition after compaction
+static void test_wrap(void)
+{
+    size_t sent;
+
+    ESP_LOGI(TAG, "Writing wraps after compaction");
+
+    // The previous test left the head partway through the ring
+    push_range(1000, 100);
+    remount();
+    CHECK(flash_queue_count() == 100);
+    CHECK(peek_index() == 1000);
+
+    s_expect = 1000;
+    s_accept = UINT32_MAX;
+    CHECK(flash_queue_drain(SIZE_MAX, collect, NULL, &sent) == ESP_OK);
+    CHECK(sent == 100);
+    remount();
+    CHECK(flash_queue_count() == 0);
+}
+
+// Sent messages are only consumed once acknowledged, in queue order
+static void test_ack(void)
+{
+    size_t sent;
+    flash_queue_stats_t stats;
+
+    ESP_LOGI(TAG, "Acknowledgements and rewind");
+    erase_partition();
+    remount();
+
+    // Sent but not acknowledged: back after a reset
+    push_range(0, 5);
+    s_expect = 0;
+    s_accept = UINT32_MAX;
+    s_next_id = 1;
+    CHECK(flash_queue_drain(10, collect, NULL, &sent) == ESP_OK);
+    CHECK(sent == 5);
+    CHECK(flash_queue_count() == 0);
+    CHECK(flash_queue_in_flight() == 5);
+    remount();
+    CHECK(flash_queue_in_flight() == 0);
+    CHECK(flash_queue_count() == 5);
+
+    // Send again as ids 1-5; an ack ahead of an older message waits for it
+    s_expect = 0;
+    s_next_id = 1;
+    CHECK(flash_queue_drain(10, collect, NULL, &sent) == ESP_OK);
+    CHECK(flash_queue_ack(2) == ESP_OK);
+    CHECK(flash_queue_in_flight() == 5);
+    CHECK(flash_queue_ack(1) == ESP_OK);
+    CHECK(flash_queue_in_flight() == 3);
+    CHECK(flash_queue_ack(1) == ESP_ERR_NOT_FOUND);
+    CHECK(flash_queue_ack(99) == ESP_ERR_NOT_FOUND);
+
+    // Message 2 was lost: rewinding sends 2-4 again
+    CHECK(flash_queue_rewind() == ESP_OK);
+    CHECK(flash_queue_in_flight() == 0);
+    CHECK(flash_queue_count() == 3);
+    flash_queue_get_stats(&stats);
+    CHECK(stats.rewound == 3);
+    CHECK(stats.popped == 2);
+    s_expect = 2;
+    s_next_id = 10;
+    CHECK(flash_queue_drain(10, collect, NULL, &sent) == ESP_OK);
+    CHECK(sent == 3);
+    CHECK(s_expect == 5);
+
+    // Acknowledging the whole batch commits it
+    CHECK(flash_queue_ack(10) == ESP_OK);
+    CHECK(flash_queue_ack(11) == ESP_OK);
+    CHECK(flash_queue_ack(12) == ESP_OK);
+    CHECK(flash_queue_in_flight() == 0);
+    remount();
+    CHECK(flash_queue_count() == 0);
+    s_next_id = 0;
+}
+
+/*******************************************************************************
+ * Main entrypoint
+ */
+
+void app_main(void)
+{
+    test_push_drain_commit();
+    test_redelivery();
+    test_full_ring();
+    test_wrap();
+    test_ack();
+    flash_queue_deinit();
+
+    if (s_failed > 0) {
+        ESP_LOGE(TAG, "%d checks failed", s_failed);
+        exit(1);
+    }
+    ESP_LOGI(TAG, "All checks passed");
+    exit(0);
+}
@@ -0,0 +1,163 @@
+/**
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs_flash.h"
+
+#include "http_mux.h"
+#include "network_wrapper.h"
+
+// Settings
+static const uint32_t sleep_time_ms = 5000;
+#define CONNECTION_TIMEOUT_SEC  10  // Set delay to wait for connection (sec)
+#define REQUEST_TIMEOUT_MS      5000 // Deadline for each request
+#define POLL_TIMEOUT_MS         1000 // Longest wait in one select() round
+
+// Endpoints fetched together from one task
+typedef struct {
+    const char *name;
+    const char *host;
+    uint16_t port;
+    const char *path;
+} endpoint_t;
+
+static const endpoint_t s_endpoints[] = {
+    { "local", "10.0.2.2", 8000, "/" },             // python_server on the QEMU host
+    { "cloud", "example.com", 80, "/" },
+    { "time", "worldtimeapi.org", 80, "/api/timezone/Etc/UTC" },
+};
+#define NUM_ENDPOINTS   (sizeof(s_endpoints) / sizeof(s_endpoints[0]))
+
+// Tag for debug messages
+static const char *TAG = "http_mux_demo";
+
+// Client with all request buffers (too large for the stack)
+static http_mux_t s_mux;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static void on_done(void *ctx, const http_mux_result_t *result);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Print how each request ended
+static void on_done(void *ctx, const http_mux_result_t *result)
+{
+    const endpoint_t *endpoint = (const endpoint_t *)ctx;
+
+    if (result->err == ESP_OK) {
+        ESP_LOGI(TAG, "%-5s HTTP %d, %llu body bytes in %lld ms",
+                 endpoint->name,
+                 result->status_code,
+                 result->body_len,
+                 result->elapsed_us / 1000);
+    } else {
+        ESP_LOGE(TAG, "%-5s failed (%s) after %lld ms",
+                 endpoint->name,
+                 esp_err_to_name(result->err),
+                 result->elapsed_us / 1000);
+    }
+}
+
+/*******************************************************************************
+ * Main entrypoint
+ */
+
+// Main app entrypoint
+void app_main(void)
+{
+    esp_err_t esp_ret;
+    EventGroupHandle_t network_event_group;
+    http_mux_request_t req;
+    int64_t start_us;
+
+    // Welcome message
+    ESP_LOGI(TAG, "Starting multiplexed HTTP client demo");
+
+    // Initialize event group
+    network_event_group = xEventGroupCreate();
+
+    // Initialize NVS
+    esp_ret = nvs_flash_init();
+    if (esp_ret == ESP_ERR_NVS_NO_FREE_PAGES ||
+        esp_ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+      ESP_ERROR_CHECK(nvs_flash_erase());
+      esp_ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(esp_ret);
+
+    // Initialize TCP/IP network interface (only call once in application)
+    // Must be called prior to initializing the network driver!
+    esp_ret = esp_netif_init();
+    ESP_ERROR_CHECK(esp_ret);
+
+    // Create default event loop that runs in the background
+    // Must be running prior to initializing the network driver!
+    esp_ret = esp_event_loop_create_default();
+    ESP_ERROR_CHECK(esp_ret);
+
+    // Initialize network connection
+    esp_ret = network_init(network_event_group);
+    ESP_ERROR_CHECK(esp_ret);
+
+    // One client for every endpoint
+    http_mux_init(&s_mux);
+
+    // Do forever: fetch from every endpoint at once
+    while (1) {
+
+        // Make sure we have a connection and IP address
+        if (network_wait_ready(0) != ESP_OK) {
+            ESP_LOGI(TAG, "Network connection not established yet.");
+            if (!wait_for_network(network_event_group, CONNECTION_TIMEOUT_SEC)) {
+                ESP_LOGE(TAG, "Failed to connect to network. Reconnecting...");
+                esp_ret = network_reconnect();
+                if (esp_ret != ESP_OK) {
+                    ESP_LOGE(TAG, "Failed to reconnect (%d), will retry", esp_ret);
+                }
+                continue;
+            }
+        }
+
+        // Start every request before waiting on any of them
+        start_us = esp_timer_get_time();
+        for (size_t i = 0; i < NUM_ENDPOINTS; i++) {
+            memset(&req, 0, sizeof(req));
+            req.host = s_endpoints[i].host;
+            req.port = s_endpoints[i].port;
+            req.path = s_endpoints[i].path;
+            req.timeout_ms = REQUEST_TIMEOUT_MS;
+            req.on_done = on_done;
+            req.ctx = (void *)&s_endpoints[i];
+            esp_ret = http_mux_submit(&s_mux, &req, NULL);
+            if (esp_ret != ESP_OK) {
+                ESP_LOGE(TAG, "Error (%d): Failed to start request to %s",
+                         esp_ret,
+                         s_endpoints[i].name);
+            }
+        }
+
+        // Drive them all from this task until each one is done or late
+        while (http_mux_poll(&s_mux, POLL_TIMEOUT_MS) > 0) {
+            // on_done() prints each result as it completes
+        }
+        ESP_LOGI(TAG, "All requests done in %lld ms (one task, %u slots)",
+                 (esp_timer_get_time() - start_us) / 1000,
+                 (unsigned int)CONFIG_HTTP_MUX_MAX_REQUESTS);
+
+        // Wait before fetching again
+        vTaskDelay(sleep_time_ms / portTICK_PERIOD_MS);
+    }
+}
@@ -0,0 +1,280 @@
+/**
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host-side throughput benchmark for the http_parser component.
+ *
+ * Builds recorded-style HTTP/1.1 responses (Content-Length and chunked) in
+ * memory, then feeds them to the parser through an http_ring_t in
+ * TCP-segment-sized pieces, the same way the http_request app receives them.
+ * Prints parse throughput in MB/s of raw response bytes.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "http_parser.h"
+
+// Settings
+#define BODY_SIZE           (64 * 1024) // Decoded body size of each response
+#define CHUNK_SIZE          1024        // Chunk size for the chunked response
+#define SEGMENT_SIZE        1460        // Bytes delivered per recv() (TCP MSS)
+#define RING_SIZE           1536        // Same as the http_request app
+#define MIN_RUN_TIME_S      1.0         // Run each case for at least this long
+
+// Response headers captured from example.com (Content-Length variant)
+static const char *HEADERS_LENGTH =
+    "HTTP/1.1 200 OK\r\n"
+    "Accept-Ranges: bytes\r\n"
+    "Content-Type: text/html\r\n"
+    "ETag: \"84238dfc8092e5d9c0dac8ef93371a07:1736799080.121134\"\r\n"
+    "Last-Modified: Mon, 13 Jan 2025 20:11:20 GMT\r\n"
+    "Vary: Accept-Encoding\r\n"
+    "Cache-Control: max-age=2349\r\n"
+    "Date: Tue, 04 Mar 2025 17:36:08 GMT\r\n"
+    "Alt-Svc: h3=\":443\"; ma=93600,h3-29=\":443\"; ma=93600\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Length: %u\r\n"
+    "\r\n";
+
+// Response headers for the chunked variant
+static const char *HEADERS_CHUNKED =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: application/json\r\n"
+    "Date: Tue, 04 Mar 2025 17:36:08 GMT\r\n"
+    "Server: nginx/1.24.0\r\n"
+    "Cache-Control: no-store\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+// A recorded response and what the parser should produce from it
+typedef struct {
+    const char *name;
+    uint8_t *data;
+    size_t len;
+    uint32_t body_sum;
+    size_t body_len;
+} bench_case_t;
+
+// Body accounting done by the callback
+typedef struct {
+    uint32_t sum;
+    size_t len;
+} body_ctx_t;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static int on_body(void *ctx, const uint8_t *data, size_t len);
+static uint32_t checksum(uint32_t sum, const uint8_t *data, size_t len);
+static void make_body(uint8_t *body, size_t len);
+static void make_length_case(bench_case_t *bench, const uint8_t *body);
+static void make_chunked_case(bench_case_t *bench, const uint8_t *body);
+static int run_once(const bench_case_t *bench, size_t segment);
+static double now_s(void);
+
+// Parser callbacks
+static const http_parser_callbacks_t s_callbacks = {
+    .on_header = NULL,
+    .on_headers_complete = NULL,
+    .on_body = on_body,
+    .on_complete = NULL,
+};
+
+// Receive ring storage
+static uint8_t s_ring_storage[RING_SIZE];
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Fold body slices into a checksum so the work can't be optimized away
+static int on_body(void *ctx, const uint8_t *data, size_t len)
+{
+    body_ctx_t *body = (body_ctx_t *)ctx;
+
+    body->sum = checksum(body->sum, data, len);
+    body->len += len;
+
+    return 0;
+}
+
+// Simple rolling checksum over body bytes
+static uint32_t checksum(uint32_t sum, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        sum = (sum << 5) + sum + data[i];
+    }
+
+    return sum;
+}
+
+// Fill body with printable text
+static void make_body(uint8_t *body, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        body[i] = (uint8_t)(' ' + (i * 7) % 95);
+    }
+}
+
+// Build a Content-Length response
+static void make_length_case(bench_case_t *bench, const uint8_t *body)
+{
+    char headers[1024];
+    int num;
+
+    num = snprintf(headers, sizeof(headers), HEADERS_LENGTH, BODY_SIZE);
+    bench->name = "content-length";
+    bench->len = (size_t)num + BODY_SIZE;
+    bench->data = malloc(bench->len);
+    memcpy(bench->data, headers, (size_t)num);
+    memcpy(&bench->data[num], body, BODY_SIZE);
+    bench->body_len = BODY_SIZE;
+    bench->body_sum = checksum(5381, body, BODY_SIZE);
+}
+
+// Build a chunked response (fixed-size chunks plus a final short chunk)
+static void make_chunked_case(bench_case_t *bench, const uint8_t *body)
+{
+    size_t cap = strlen(HEADERS_CHUNKED) + BODY_SIZE +
+                 (BODY_SIZE / CHUNK_SIZE + 2) * 16 + 16;
+    size_t pos;
+    size_t num;
+
+    bench->name = "chunked";
+    bench->data = malloc(cap);
+    pos = (size_t)sprintf((char *)bench->data, "%s", HEADERS_CHUNKED);
+    for (size_t off = 0; off < BODY_SIZE; off += num) {
+        num = (BODY_SIZE - off < CHUNK_SIZE) ? BODY_SIZE - off : CHUNK_SIZE;
+        pos += (size_t)sprintf((char *)&bench->data[pos], "%zx\r\n", num);
+        memcpy(&bench->data[pos], &body[off], num);
+        pos += num;
+        memcpy(&bench->data[pos], "\r\n", 2);
+        pos += 2;
+    }
+    pos += (size_t)sprintf((char *)&bench->data[pos], "0\r\n\r\n");
+    bench->len = pos;
+    bench->body_len = BODY_SIZE;
+    bench->body_sum = checksum(5381, body, BODY_SIZE);
+}
+
+// Feed one response through the ring in segments and check the result
+static int run_once(const bench_case_t *bench, size_t segment)
+{
+    http_parser_t parser;
+    http_parser_result_t ret = HTTP_PARSER_NEED_MORE;
+    http_ring_t ring;
+    body_ctx_t body = { .sum = 5381, .len = 0 };
+    size_t pos = 0;
+    size_t space;
+    size_t num;
+    uint8_t *dst;
+
+    http_ring_init(&ring, s_ring_storage, sizeof(s_ring_storage));
+    http_parser_init(&parser, &s_callbacks, &body);
+
+    // Stand-in for recv(): copy at most one segment into the free region
+    while ((pos < bench->len) && (ret == HTTP_PARSER_NEED_MORE)) {
+        dst = http_ring_write_ptr(&ring, &space);
+        num = bench->len - pos;
+        if (num > segment) {
+            num = segment;
+        }
+        if (num > space) {
+            num = space;
+        }
+        memcpy(dst, &bench->data[pos], num);
+        http_ring_commit(&ring, num);
+        pos += num;
+        ret = http_parser_execute_ring(&parser, &ring);
+    }
+
+    // Verify the decoded body
+    if ((ret != HTTP_PARSER_COMPLETE) ||
+        (body.len != bench->body_len) ||
+        (body.sum != bench->body_sum) ||
+        (parser.status_code != 200) ||
+        (!parser.keep_alive)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Monotonic time in seconds
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*******************************************************************************
+ * Main entrypoint
+ */
+
+int main(void)
+{
+    static uint8_t body[BODY_SIZE];
+    bench_case_t cases[2];
+    const size_t check_segments[] = {1, 2, 3, 7, 64, SEGMENT_SIZE};
+    double start;
+    double elapsed;
+    unsigned long iterations;
+    int failed = 0;
+
+    // Build recorded responses
+    make_body(body, sizeof(body));
+    make_length_case(&cases[0], body);
+    make_chunked_case(&cases[1], body);
+
+    printf("http_parser benchmark: %u byte body, %u byte segments, "
+           "%u byte ring\n",
+           (unsigned)BODY_SIZE, (unsigned)SEGMENT_SIZE, (unsigned)RING_SIZE);
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+
+        // Check correctness with awkward segment sizes (lines split anywhere)
+        for (size_t s = 0; s < sizeof(check_segments) / sizeof(check_segments[0]); s++) {
+            if (run_once(&cases[c], check_segments[s]) != 0) {
+                printf("  %-15s FAILED with %zu byte segments\n",
+                       cases[c].name, check_segments[s]);
+                failed = 1;
+            }
+        }
+
+        // Measure throughput with MSS-sized segments
+        iterations = 0;
+        start = now_s();
+        do {
+            for (int i = 0; i < 100; i++) {
+                if (run_once(&cases[c], SEGMENT_SIZE) != 0) {
+                    failed = 1;
+                }
+            }
+            iterations += 100;
+            elapsed = now_s() - start;
+        } while (elapsed < MIN_RUN_TIME_S);
+
+        printf("  %-15s %8zu bytes/response  %8lu responses  %8.1f MB/s\n",
+               cases[c].name,
+               cases[c].len,
+               iterations,
+               ((double)cases[c].len * (double)iterations) / elapsed / 1e6);
+    }
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        free(cases[c].data);
+    }
+
+    return failed;
+}
@@ -7,59 +7,207 @@
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
-#include "lwip/netdb.h"
+#include "lwip/sockets.h"
 
+#include "dns_cache.h"
+#include "http_parser.h"
 #include "network_wrapper.h"
+#include "socket_profile.h"
+#if CONFIG_LINK_MONITOR
+# include "link_monitor.h"
+#endif
+#if CONFIG_NET_TIMELINE
+# include "net_timeline.h"
+#endif
 
 // Settings
 static const uint32_t sleep_time_ms = 5000;
 
 // Server settings and URL to fetch
 #define WEB_HOST "example.com"
-#define WEB_PORT "80"
+#define WEB_PORT 80
 #define WEB_PATH "/"
 
 // HTTP GET request
-static const char *REQUEST = "GET " WEB_PATH " HTTP/1.0\r\n"
-    "Host: "WEB_HOST":"WEB_PORT"\r\n"
+static const char *REQUEST = "GET " WEB_PATH " HTTP/1.1\r\n"
+    "Host: "WEB_HOST"\r\n"
     "User-Agent: esp-idf/1.0 esp32\r\n"
+    "Connection: close\r\n"
     "\r\n";
 
 // Set timeouts
-#define SOCKET_TIMEOUT_SEC      5   // Set socket timeout in seconds
-#define RX_BUF_SIZE             64  // Set receive buffer size (bytes)
+#define SOCKET_TIMEOUT_SEC      5   // Set connect timeout in seconds
+#define RX_BUF_SIZE             1536 // Set receive ring buffer size (bytes)
 #define CONNECTION_TIMEOUT_SEC  10  // Set delay to wait for connection (sec)
+#define NETWORK_QUEUE_LEN       8   // Network state transitions kept queued
 
 // Tag for debug messages
 static const char *TAG = "http_request";
 
+// Receive ring buffer (parsed in place)
+static uint8_t s_rx_storage[RX_BUF_SIZE];
+
+// Network state (updated from the subscription queue)
+static QueueHandle_t s_network_queue = NULL;
+static bool s_network_up = false;
+
+#if CONFIG_NET_TIMELINE
+// Binary timeline record (room for every entry)
+static uint8_t s_timeline_buf[NET_TIMELINE_HEADER_SIZE +
+                              CONFIG_NET_TIMELINE_ENTRIES *
+                              NET_TIMELINE_ENTRY_SIZE];
+#endif
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static int on_headers_complete(void *ctx, const http_parser_t *parser);
+static int on_body(void *ctx, const uint8_t *data, size_t len);
+static void process_network_events(TickType_t wait_ticks);
+static bool wait_network_state(bool up, uint32_t timeout_ms);
+#if CONFIG_NET_TIMELINE
+static void report_timeline(void);
+#endif
+
+// Parser callbacks
+static const http_parser_callbacks_t s_parser_callbacks = {
+    .on_header = NULL,
+    .on_headers_complete = on_headers_complete,
+    .on_body = on_body,
+    .on_complete = NULL,
+};
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Log the response status once all headers have arrived
+static int on_headers_complete(void *ctx, const http_parser_t *parser)
+{
+    ESP_LOGI(TAG, "HTTP/1.%u %d (%s, keep-alive: %s)",
+             parser->version_minor,
+             parser->status_code,
+             parser->chunked ? "chunked" :
+                 (parser->has_content_length ? "content-length" : "until close"),
+             parser->keep_alive ? "yes" : "no");
+
+    return 0;
+}
+
+// Print body slices straight from the receive ring
+static int on_body(void *ctx, const uint8_t *data, size_t len)
+{
+    fwrite(data, 1, len, stdout);
+
+    return 0;
+}
+
+// Apply queued network state transitions, blocking up to wait_ticks for one
+static void process_network_events(TickType_t wait_ticks)
+{
+    network_event_t event;
+
+    while (xQueueReceive(s_network_queue, &event, wait_ticks) == pdTRUE) {
+        switch (event.type) {
+            case NETWORK_EVENT_LINK_DOWN:
+                ESP_LOGW(TAG, "Network link down (reason %d)%s",
+                         event.reason,
+                         event.reconnecting ? ", driver reconnecting" : "");
+                break;
+            case NETWORK_EVENT_IP_ACQUIRED:
+                ESP_LOGI(TAG, "Network up (%s)",
+                         (event.family == AF_INET6) ? "IPv6" : "IPv4");
+                break;
+            default:
+                ESP_LOGI(TAG, "Network event: %s", network_event_name(event.type));
+                break;
+        }
+        s_network_up = network_is_up();
+
+        // Only block for the first event, then drain the rest
+        wait_ticks = 0;
+    }
+}
+
+// Block until the network is (up) or is not (!up) usable, or timeout
+static bool wait_network_state(bool up, uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    TickType_t elapsed;
+
+    while (s_network_up != up) {
+        elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            return false;
+        }
+        process_network_events(timeout - elapsed);
+    }
+
+    return true;
+}
+
+#if CONFIG_NET_TIMELINE
+// Print the time from boot to the first response and its binary export
+static void report_timeline(void)
+{
+    net_timeline_entry_t first;
+    size_t len;
+    esp_err_t esp_ret;
+
+    // Time between each phase of bringing up the network
+    net_timeline_log();
+    if (net_timeline_read(&first, 1) == 1) {
+        ESP_LOGI(TAG, "First response %lld ms after the driver started",
+                 (esp_timer_get_time() - first.timestamp_us) / 1000);
+    }
+
+    // Compact record, as it would be uploaded for fleet-wide statistics
+    esp_ret = net_timeline_export(s_timeline_buf, sizeof(s_timeline_buf), &len);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to export timeline (%d)", esp_ret);
+        return;
+    }
+    ESP_LOGI(TAG, "Timeline export (%u bytes):", (unsigned int)len);
+    ESP_LOG_BUFFER_HEX(TAG, s_timeline_buf, len);
+}
+#endif
+
+/*******************************************************************************
+ * Main entrypoint
+ */
+
 // Main app entrypoint
 void app_main(void)
 {
     esp_err_t esp_ret;
-    int ret;
-    struct addrinfo *dns_res;
+    ssize_t ret;
+    dns_cache_result_t dns_res;
     int sock;
-    char recv_buf[RX_BUF_SIZE];
+    socket_profile_conn_t conn;
+    socket_profile_stats_t sock_stats;
+    char addr_str[INET6_ADDRSTRLEN];
+    http_parser_t parser;
+    http_parser_result_t parse_ret;
+    http_ring_t rx_ring;
+    uint8_t *rx_ptr;
+    size_t rx_free;
     uint32_t recv_total;
     ssize_t recv_len;
     EventGroupHandle_t network_event_group;
-    EventBits_t network_event_bits;
-
-    // Hints for DNS lookup
-    struct addrinfo hints = {
-        .ai_family = WEB_FAMILY,
-        .ai_socktype = SOCK_STREAM
-    };
-
-    // Socket timeout
-    struct timeval sock_timeout = {
-        .tv_sec = SOCKET_TIMEOUT_SEC,
-        .tv_usec = 0
-    };
+    network_subscriber_handle_t network_sub;
+#if CONFIG_LINK_MONITOR
+    int64_t request_start_us;
+#endif
+#if CONFIG_NET_TIMELINE
+    bool timeline_reported = false;
+#endif
 
     // Welcome message (after delay to allow serial connection)
     ESP_LOGI(TAG, "Starting HTTP GET request demo");
@@ -87,94 +235,89 @@ void app_main(void)
     esp_ret = esp_event_loop_create_default();
     ESP_ERROR_CHECK(esp_ret);
 
+    // Get network state transitions on a queue instead of polling bits
+    s_network_queue = xQueueCreate(NETWORK_QUEUE_LEN, sizeof(network_event_t));
+    if (s_network_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create network event queue");
+        abort();
+    }
+    esp_ret = network_subscribe_queue(s_network_queue, &network_sub);
+    ESP_ERROR_CHECK(esp_ret);
+
     // Initialize network connection
     esp_ret = network_init(network_event_group);
     ESP_ERROR_CHECK(esp_ret);
 
+#if CONFIG_LINK_MONITOR
+    // Measure the path to the server in the background
+    ESP_ERROR_CHECK(link_monitor_set_target(WEB_HOST, WEB_PORT));
+    ESP_ERROR_CHECK(link_monitor_start());
+#endif
+
     // Do forever: perform HTTP GET request
     while (1) {
 
         // Make sure we have a connection and IP address
-        network_event_bits = xEventGroupGetBits(network_event_group);
-        if (!(network_event_bits & NETWORK_CONNECTED_BIT) ||
-            !((network_event_bits & NETWORK_IPV4_OBTAINED_BIT) ||
-            (network_event_bits & NETWORK_IPV6_OBTAINED_BIT))) {
+        process_network_events(0);
+        if (!s_network_up) {
             ESP_LOGI(TAG, "Network connection not established yet.");
-            if (!wait_for_network(network_event_group, 
-                                  CONNECTION_TIMEOUT_SEC)) {
+            if (!wait_network_state(true, CONNECTION_TIMEOUT_SEC * 1000)) {
                 ESP_LOGE(TAG, "Failed to connect to WiFi. Reconnecting...");
                 esp_ret = network_reconnect();
                 if (esp_ret != ESP_OK) {
-                    ESP_LOGE(TAG, "Failed to reconnect WiFi (%d)", esp_ret);
-                    abort();
+                    ESP_LOGE(TAG, "Failed to reconnect WiFi (%d), will retry", esp_ret);
                 }
                 continue;
             }
         }
 
-        // Perform DNS lookup
-        ret = getaddrinfo(WEB_HOST, WEB_PORT, &hints, &dns_res);
-        if (ret != 0 || dns_res== NULL) {
-            ESP_LOGE(TAG, "DNS lookup failed (%d)", ret);
+        // Resolve server address (served from memory after the first lookup)
+        esp_ret = dns_cache_lookup(WEB_HOST, WEB_PORT, WEB_FAMILY, &dns_res);
+        if (esp_ret != ESP_OK) {
+            ESP_LOGE(TAG, "DNS lookup failed (%d)", esp_ret);
             vTaskDelay(1000 / portTICK_PERIOD_MS);
             continue;
         }
 
-        // Print resolved IP addresses (we will just use the first)
-        ESP_LOGI(TAG, "DNS lookup succeeded. IP addresses:");
-        for (struct addrinfo *addr = dns_res; addr != NULL; addr = addr->ai_next) {
-            if (addr->ai_family == AF_INET) {
-                struct in_addr *ip = &((struct sockaddr_in *)addr->ai_addr)->sin_addr;
-                inet_ntop(AF_INET, ip, recv_buf, INET_ADDRSTRLEN);
-                ESP_LOGI(TAG, "  IPv4: %s", recv_buf);
-            } else if (addr->ai_family == AF_INET6) {
-                struct in6_addr *ip = &((struct sockaddr_in6 *)addr->ai_addr)->sin6_addr;
-                inet_ntop(AF_INET6, ip, recv_buf, INET6_ADDRSTRLEN);
-                ESP_LOGI(TAG, "  IPv6: %s", recv_buf);
+        // Print resolved IP addresses in the order they will be tried
+        ESP_LOGI(TAG, "DNS lookup succeeded (%s). IP addresses:",
+                 dns_res.from_cache ? "cached" : "queried");
+        for (size_t i = 0; i < dns_res.count; i++) {
+            if (dns_res.addrs[i].ss_family == AF_INET) {
+                struct in_addr *ip = &((struct sockaddr_in *)&dns_res.addrs[i])->sin_addr;
+                inet_ntop(AF_INET, ip, addr_str, INET_ADDRSTRLEN);
+                ESP_LOGI(TAG, "  IPv4: %s", addr_str);
+            } else if (dns_res.addrs[i].ss_family == AF_INET6) {
+                struct in6_addr *ip = &((struct sockaddr_in6 *)&dns_res.addrs[i])->sin6_addr;
+                inet_ntop(AF_INET6, ip, addr_str, INET6_ADDRSTRLEN);
+                ESP_LOGI(TAG, "  IPv6: %s", addr_str);
             }
         }
 
-        // Create a socket
-        sock = socket(dns_res->ai_family, dns_res->ai_socktype, dns_res->ai_protocol);
-        if (sock < 0) {
-            ESP_LOGE(TAG, "Failed to create socket (%d): %s", errno, strerror(errno));
-            vTaskDelay(1000 / portTICK_PERIOD_MS);
-            continue;
-        }
-
-        // Set socket send timeout
-        ret = setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &sock_timeout, sizeof(sock_timeout));
-        if (ret < 0) {
-            ESP_LOGE(TAG, "Failed to set socket send timeout (%d): %s", errno, strerror(errno));
-            close(sock);
-            vTaskDelay(1000 / portTICK_PERIOD_MS);
-            continue;
-        }
-
-        // Set socket receive timeout
-        ret = setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &sock_timeout, sizeof(sock_timeout));
-        if (ret < 0) {
-            ESP_LOGE(TAG, "Failed to set socket receive timeout (%d): %s", errno, strerror(errno));
-            close(sock);
+        // Connect to server (happy eyeballs across the resolved addresses)
+        esp_ret = dns_cache_connect(&dns_res, SOCKET_TIMEOUT_SEC * 1000, &sock);
+        if (esp_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to connect to server (%d)", esp_ret);
+            dns_cache_invalidate(WEB_HOST);
             vTaskDelay(1000 / portTICK_PERIOD_MS);
             continue;
         }
 
-        // Connect to server
-        ret = connect(sock, dns_res->ai_addr, dns_res->ai_addrlen);
-        if (ret < 0) {
-            ESP_LOGE(TAG, "Failed to connect to server (%d): %s", errno, strerror(errno));
+        // Small request and response: Nagle off, send/receive timeouts set
+        esp_ret = socket_profile_attach(&conn, sock, &SOCKET_PROFILE_LOW_LATENCY);
+        if (esp_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to apply socket profile (%d)", esp_ret);
             close(sock);
             vTaskDelay(1000 / portTICK_PERIOD_MS);
             continue;
         }
 
-        // Delete the address info
-        freeaddrinfo(dns_res);
-
         // Send HTTP GET request
         ESP_LOGI(TAG, "Sending HTTP GET request...");
-        ret = send(sock, REQUEST, strlen(REQUEST), 0);
+#if CONFIG_LINK_MONITOR
+        request_start_us = esp_timer_get_time();
+#endif
+        ret = socket_profile_send(&conn, REQUEST, strlen(REQUEST), false);
         if (ret < 0) {
             ESP_LOGE(TAG, "Failed to send HTTP GET request (%d): %s", errno, strerror(errno));
             close(sock);
@@ -182,35 +325,79 @@ void app_main(void)
             continue;
         }
 
-        // Print the HTTP response
+        // Parse the HTTP response as it arrives
         ESP_LOGI(TAG, "HTTP response:");
+        http_ring_init(&rx_ring, s_rx_storage, sizeof(s_rx_storage));
+        http_parser_init(&parser, &s_parser_callbacks, NULL);
+        parse_ret = HTTP_PARSER_NEED_MORE;
         recv_total = 0;
-        while (1) {
+        while (parse_ret == HTTP_PARSER_NEED_MORE) {
 
-            // Receive data from the socket
-            recv_len = recv(sock, recv_buf, sizeof(recv_buf) - 1, 0);
+            // Receive directly into the free part of the ring
+            rx_ptr = http_ring_write_ptr(&rx_ring, &rx_free);
+            recv_len = socket_profile_recv(&conn, rx_ptr, rx_free);
 
             // Check for errors
             if (recv_len < 0) {
                 ESP_LOGE(TAG, "Failed to receive data (%d): %s", errno, strerror(errno));
+                parse_ret = HTTP_PARSER_ERROR;
                 break;
             }
 
-            // Check for end of data
+            // Server closed the connection
             if (recv_len == 0) {
+                parse_ret = http_parser_finish(&parser);
                 break;
             }
 
-            // Null-terminate the received data and print it
-            recv_buf[recv_len] = '\0';
-            printf("%s", recv_buf);
+            // Parse everything received so far
+            http_ring_commit(&rx_ring, (size_t)recv_len);
             recv_total += (uint32_t)recv_len;
+            parse_ret = http_parser_execute_ring(&parser, &rx_ring);
         }
+        printf("\n");
+
+        // Report how the response ended
+        if (parse_ret == HTTP_PARSER_COMPLETE) {
+            ESP_LOGI(TAG, "Response complete: %lu body bytes, %lu bytes received",
+                     (unsigned long)parser.body_received,
+                     (unsigned long)recv_total);
+#if CONFIG_LINK_MONITOR
+            link_monitor_record_transfer(strlen(REQUEST) + recv_total,
+                                         esp_timer_get_time() - request_start_us);
+#endif
+#if CONFIG_NET_TIMELINE
+            if (!timeline_reported) {
+                report_timeline();
+                timeline_reported = true;
+            }
+#endif
+        } else {
+            ESP_LOGE(TAG, "Incomplete or malformed response (%lu bytes received)",
+                     (unsigned long)recv_total);
+        }
+
+        // Report socket traffic
+        socket_profile_get_stats(&conn, &sock_stats);
+        ESP_LOGI(TAG, "Socket (%s): %llu bytes sent in %lu calls, "
+                      "%llu bytes received in %lu calls, %ld retransmits",
+                 conn.profile->name,
+                 sock_stats.bytes_sent,
+                 sock_stats.send_calls,
+                 sock_stats.bytes_received,
+                 sock_stats.recv_calls,
+                 (sock_stats.retransmits == SOCKET_PROFILE_NO_COUNT) ?
+                     -1L : (long)sock_stats.retransmits);
 
         // Close the socket
         close(sock);
 
-        // Wait before trying again
-        vTaskDelay(sleep_time_ms / portTICK_PERIOD_MS);
+        // Wait before trying again (cut short if the network goes down),
+        // longer when the link is slow
+#if CONFIG_LINK_MONITOR
+        wait_network_state(false, link_monitor_scale_interval(sleep_time_ms));
+#else
+        wait_network_state(false, sleep_time_ms);
+#endif
     }
 }
\ No newline at end of file
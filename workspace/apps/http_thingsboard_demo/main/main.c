@@ -4,22 +4,51 @@
  */
 
 #include <string.h>
+#include <sys/time.h>
 #include "esp_event.h"
 #include "esp_http_client.h"
 #include "esp_log.h"
 #include "esp_netif.h"
+#include "esp_netif_sntp.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
 #include "lwip/netdb.h"
 
+#include "http_session.h"
 #include "network_wrapper.h"
+#if CONFIG_LINK_MONITOR
+# include "link_monitor.h"
+#endif
+#if CONFIG_STREAM_STATS
+# include "stream_stats.h"
+#endif
 
 // Settings
 #define API_KEY "z2ahr2c62b0xcfwo1l3w"
-#define POST_BUF_SIZE 100
 #define CONNECTION_TIMEOUT_SEC  10
-static const uint32_t sleep_time_ms = 5000;
+#define NETWORK_QUEUE_LEN       8       // Network state transitions kept queued
+static const uint32_t sleep_time_ms = 1000;     // Time between samples
+
+// Batching settings
+#define BATCH_CAPACITY          32      // Samples held while offline
+#define BATCH_FLUSH_SIZE        10      // Flush when this many are queued
+#define BATCH_FLUSH_MAX         30      // Largest flush on a slow link
+#define BATCH_MAX_LATENCY_MS    15000   // Flush when the oldest is this old
+#if CONFIG_STREAM_STATS
+#define SUMMARY_WINDOW_MS       10000   // Readings summarized per queued sample
+#define SAMPLE_JSON_MAX         224     // Worst-case bytes per summary in JSON
+#else
+#define SAMPLE_JSON_MAX         64      // Worst-case bytes per sample in JSON
+#endif
+#define POST_BUF_SIZE           (BATCH_FLUSH_MAX * SAMPLE_JSON_MAX + 3)
+
+// Time sync (samples are sent without "ts" until the clock is set)
+#define SNTP_SERVER             "pool.ntp.org"
+#define SNTP_TIMEOUT_MS         10000
+#define MIN_VALID_UNIX_TIME     1700000000  // Clock is not set before this
 
 // HTTP endpoint and API Key for ThingsBoard
 #define THINGSBOARD_HOST "demo.thingsboard.io"
@@ -28,6 +57,36 @@ static const uint32_t sleep_time_ms = 5000;
 // Tag for debug messages
 static const char *TAG = "http_thingsboard_demo";
 
+// One queued telemetry sample
+typedef struct {
+    int64_t ts_ms;          // Unix time (ms), 0 if clock not synced
+    int64_t queued_us;      // esp_timer time when queued
+    const char *key;        // Telemetry key
+#if CONFIG_STREAM_STATS
+    stream_stats_summary_t summary; // Readings over one window
+#else
+    int val;                // Telemetry value
+#endif
+} sample_t;
+
+// Static global variables
+static sample_t s_batch[BATCH_CAPACITY];
+static uint32_t s_batch_head = 0;
+static uint32_t s_batch_count = 0;
+static char s_post_buf[POST_BUF_SIZE];
+static http_session_t s_session;
+static int64_t s_start_us = 0;
+static uint32_t s_samples_sent = 0;
+static uint32_t s_samples_dropped = 0;
+static uint32_t s_bytes_sent = 0;
+static uint32_t s_posts_sent = 0;
+static QueueHandle_t s_network_queue = NULL;
+static bool s_network_up = false;
+#if CONFIG_STREAM_STATS
+static stream_stats_t s_temp_stats;
+static const float s_temp_quantiles[] = {0.5f, 0.9f};
+#endif
+
 // Event handler for HTTP client
 static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
     switch(evt->event_id) {
@@ -65,64 +124,283 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
     return ESP_OK;
 }
 
-// Send HTTP post to ThingsBoard
-esp_err_t http_post_to_thingsboard(const char* key, int val) {
+// Timestamp in Unix milliseconds, or 0 if the clock has not been synced yet
+static int64_t unix_time_ms(void)
+{
+    struct timeval tv;
 
-    esp_err_t esp_ret = ESP_FAIL;
-    esp_http_client_handle_t client = NULL;
-    char post_data[POST_BUF_SIZE];
+    gettimeofday(&tv, NULL);
+    if (tv.tv_sec < MIN_VALID_UNIX_TIME) {
+        return 0;
+    }
 
-    // Prepare JSON data
-    snprintf(post_data, sizeof(post_data), "{\"%s\":%d}", key, val);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
 
-    // Configure the HTTP client
-    esp_http_client_config_t config = {
-        .url = "http://" THINGSBOARD_HOST THINGSBOARD_PATH,
-        .method = HTTP_METHOD_POST,
-        .event_handler = http_event_handler,
-    };
+// Add a sample to the batch (drops the oldest sample if the ring is full),
+// return it so the caller can fill in the value
+static sample_t *batch_add(const char *key)
+{
+    sample_t *sample;
 
-    // Initialize the HTTP client
-    client = esp_http_client_init(&config);
-    if (client == NULL) {
-        ESP_LOGE(TAG, "Failed to initialize HTTP client");
-        goto cleanup;
+    // Make room by dropping the oldest sample
+    if (s_batch_count == BATCH_CAPACITY) {
+        s_batch_head = (s_batch_head + 1) % BATCH_CAPACITY;
+        s_batch_count--;
+        s_samples_dropped++;
     }
 
-    // Set headers
-    esp_ret = esp_http_client_set_header(client, "Content-Type", "application/json");
-    if (esp_ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%d): Could not set HTTP header", esp_ret);
-        goto cleanup;
+    // Store sample at the tail
+    sample = &s_batch[(s_batch_head + s_batch_count) % BATCH_CAPACITY];
+    sample->ts_ms = unix_time_ms();
+    sample->queued_us = esp_timer_get_time();
+    sample->key = key;
+    s_batch_count++;
+
+    return sample;
+}
+
+// Samples per POST (fewer, larger posts when the link is slow)
+static uint32_t batch_flush_size(void)
+{
+#if CONFIG_LINK_MONITOR
+    return (uint32_t)link_monitor_scale_batch(BATCH_FLUSH_SIZE, BATCH_FLUSH_MAX);
+#else
+    return BATCH_FLUSH_SIZE;
+#endif
+}
+
+// Longest a sample waits before a flush (stretched when the link is slow)
+static uint32_t batch_max_latency_ms(void)
+{
+#if CONFIG_LINK_MONITOR
+    return link_monitor_scale_interval(BATCH_MAX_LATENCY_MS);
+#else
+    return BATCH_MAX_LATENCY_MS;
+#endif
+}
+
+// Check if the batch is big enough or the oldest sample has waited too long
+static bool batch_should_flush(void)
+{
+    int64_t waited_us;
+
+    if (s_batch_count == 0) {
+        return false;
+    }
+    if (s_batch_count >= batch_flush_size()) {
+        return true;
     }
+    waited_us = esp_timer_get_time() - s_batch[s_batch_head].queued_us;
 
-    // Set the POST data
-    esp_ret = esp_http_client_set_post_field(client, post_data, strlen(post_data));
-    if (esp_ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%d): Could not set POST field", esp_ret);
-        goto cleanup;
+    return waited_us >= (int64_t)batch_max_latency_ms() * 1000;
+}
+
+// Serialize the values of one sample as a JSON object
+static int sample_values(const sample_t *sample, char *buf, size_t buf_size)
+{
+#if CONFIG_STREAM_STATS
+    telemetry_encoder_t enc;
+    size_t len;
+
+    // {"temp_n":10,"temp_min":24.94,...}
+    telemetry_encoder_init(&enc, TELEMETRY_FORMAT_JSON, (uint8_t *)buf, buf_size - 1);
+    stream_stats_encode(&enc, sample->key, &sample->summary);
+    if (telemetry_encoder_finish(&enc, &len) != TELEMETRY_OK) {
+        return -1;
+    }
+    buf[len] = '\0';
+
+    return (int)len;
+#else
+    int ret;
+
+    // {"temp":25}
+    ret = snprintf(buf, buf_size, "{\"%s\":%d}", sample->key, sample->val);
+    if ((ret < 0) || (ret >= (int)buf_size)) {
+        return -1;
     }
 
-    // Perform POST request
-    esp_ret = esp_http_client_perform(client);
+    return ret;
+#endif
+}
+
+// Serialize up to num samples as a ThingsBoard telemetry array
+static int batch_serialize(char *buf, size_t buf_size, uint32_t num)
+{
+    const sample_t *sample;
+    char values[SAMPLE_JSON_MAX];
+    int len = 0;
+    int ret;
+
+    // [{"ts":1700000000000,"values":{"temp":25}},...]
+    buf[len++] = '[';
+    for (uint32_t i = 0; i < num; i++) {
+        sample = &s_batch[(s_batch_head + i) % BATCH_CAPACITY];
+        if (sample_values(sample, values, sizeof(values)) < 0) {
+            return -1;
+        }
+        if (sample->ts_ms > 0) {
+            ret = snprintf(&buf[len], buf_size - len,
+                           "%s{\"ts\":%lld,\"values\":%s}",
+                           (i > 0) ? "," : "",
+                           (long long)sample->ts_ms,
+                           values);
+        } else {
+            // No wall-clock time yet: let the server timestamp the sample
+            ret = snprintf(&buf[len], buf_size - len,
+                           "%s%s",
+                           (i > 0) ? "," : "",
+                           values);
+        }
+        if ((ret < 0) || (ret >= (int)(buf_size - len - 1))) {
+            return -1;
+        }
+        len += ret;
+    }
+    buf[len++] = ']';
+    buf[len] = '\0';
+
+    return len;
+}
+
+// Send queued samples to ThingsBoard as one POST (samples kept on failure)
+static esp_err_t batch_flush(void)
+{
+    esp_err_t esp_ret;
+    uint32_t flush_size;
+    uint32_t num;
+    int len;
+    int status;
+#if CONFIG_LINK_MONITOR
+    int64_t start_us = esp_timer_get_time();
+#endif
+
+    // Serialize the oldest samples
+    flush_size = batch_flush_size();
+    num = (s_batch_count < flush_size) ? s_batch_count : flush_size;
+    len = batch_serialize(s_post_buf, sizeof(s_post_buf), num);
+    if (len < 0) {
+        ESP_LOGE(TAG, "POST buffer too small for %lu samples", num);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Send over the session's kept-alive connection
+    esp_ret = http_session_post(&s_session,
+                                "application/json",
+                                s_post_buf,
+                                len,
+                                &status);
     if (esp_ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%d): HTTP POST request failed", esp_ret);
-        goto cleanup;
+        return esp_ret;
+    }
+#if CONFIG_LINK_MONITOR
+    link_monitor_record_transfer((size_t)len, esp_timer_get_time() - start_us);
+#endif
+
+    // Only release samples the server accepted
+    if ((status < 200) || (status >= 300)) {
+        ESP_LOGE(TAG, "HTTP POST rejected with status %d", status);
+        return ESP_FAIL;
     }
+    s_batch_head = (s_batch_head + num) % BATCH_CAPACITY;
+    s_batch_count -= num;
 
-    // Log success
-    ESP_LOGI(TAG, 
-        "HTTP POST status: %d, content_length: %" PRId64,
-        esp_http_client_get_status_code(client),
-        esp_http_client_get_content_length(client));
+    // Update statistics
+    s_samples_sent += num;
+    s_bytes_sent += (uint32_t)len;
+    s_posts_sent++;
+    ESP_LOGI(TAG, "HTTP POST status: %d, samples: %lu, bytes: %d",
+             status, num, len);
 
-cleanup:
-    // Clean up resources
-    if (client) {
-        esp_http_client_cleanup(client);
+    return ESP_OK;
+}
+
+// Log upload rate, payload efficiency, and connection reuse since boot
+static void log_batch_stats(void)
+{
+    float elapsed_s = (float)(esp_timer_get_time() - s_start_us) / 1e6f;
+    http_session_stats_t session_stats;
+#if CONFIG_LINK_MONITOR
+    link_monitor_stats_t link_stats;
+#endif
+
+    if ((s_samples_sent == 0) || (elapsed_s <= 0.0f)) {
+        return;
+    }
+    ESP_LOGI(TAG, "Uploaded %lu samples in %lu posts: %.2f samples/sec, "
+                  "%.1f bytes/sample, %lu dropped",
+             s_samples_sent,
+             s_posts_sent,
+             s_samples_sent / elapsed_s,
+             (float)s_bytes_sent / s_samples_sent,
+             s_samples_dropped);
+
+    // Steady state should be one connection and no allocations per request
+    http_session_get_stats(&s_session, &session_stats);
+    ESP_LOGI(TAG, "HTTP session: %lu requests, %lu connects, %lu retries, "
+                  "%lu allocs (%lu bytes) in last request",
+             session_stats.requests,
+             session_stats.connects,
+             session_stats.retries,
+             session_stats.last_allocs,
+             session_stats.last_alloc_bytes);
+
+#if CONFIG_LINK_MONITOR
+    // Link grade the batch size and latency were scaled for
+    link_monitor_get_stats(&link_stats);
+    ESP_LOGI(TAG, "Link %s: gateway RTT %ld ms, %lu B/s, %lu samples/post",
+             link_quality_name(link_stats.quality),
+             (link_stats.gateway_rtt_ms == LINK_MONITOR_RTT_UNKNOWN) ?
+                 -1L : (long)link_stats.gateway_rtt_ms,
+             link_stats.throughput_bps,
+             batch_flush_size());
+#endif
+}
+
+// Apply queued network state transitions, blocking up to wait_ticks for one
+static void process_network_events(TickType_t wait_ticks)
+{
+    network_event_t event;
+
+    while (xQueueReceive(s_network_queue, &event, wait_ticks) == pdTRUE) {
+        switch (event.type) {
+            case NETWORK_EVENT_LINK_DOWN:
+                ESP_LOGW(TAG, "Network link down (reason %d)%s",
+                         event.reason,
+                         event.reconnecting ? ", driver reconnecting" : "");
+                break;
+            case NETWORK_EVENT_IP_ACQUIRED:
+                ESP_LOGI(TAG, "Network up (%s)",
+                         (event.family == AF_INET6) ? "IPv6" : "IPv4");
+                break;
+            default:
+                ESP_LOGI(TAG, "Network event: %s", network_event_name(event.type));
+                break;
+        }
+        s_network_up = network_is_up();
+
+        // Only block for the first event, then drain the rest
+        wait_ticks = 0;
+    }
+}
+
+// Block until the network is (up) or is not (!up) usable, or timeout
+static bool wait_network_state(bool up, uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    TickType_t elapsed;
+
+    while (s_network_up != up) {
+        elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            return false;
+        }
+        process_network_events(timeout - elapsed);
     }
 
-    return esp_ret;
+    return true;
 }
 
 // Main app entrypoint
@@ -130,7 +408,19 @@ void app_main(void)
 {
     esp_err_t esp_ret;
     EventGroupHandle_t network_event_group;
-    EventBits_t network_event_bits;
+    network_subscriber_handle_t network_sub;
+    esp_sntp_config_t sntp_config = ESP_NETIF_SNTP_DEFAULT_CONFIG(SNTP_SERVER);
+    bool sntp_waited = false;
+#if CONFIG_STREAM_STATS
+    stream_stats_summary_t summary;
+#endif
+
+    // HTTP client configuration (one session for the life of the app)
+    esp_http_client_config_t client_config = {
+        .url = "http://" THINGSBOARD_HOST THINGSBOARD_PATH,
+        .method = HTTP_METHOD_POST,
+        .event_handler = http_event_handler,
+    };
 
     // Initialize event group
     network_event_group = xEventGroupCreate();
@@ -161,6 +451,18 @@ void app_main(void)
         abort();
     }
 
+    // Get network state transitions on a queue instead of polling bits
+    s_network_queue = xQueueCreate(NETWORK_QUEUE_LEN, sizeof(network_event_t));
+    if (s_network_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create network event queue");
+        abort();
+    }
+    esp_ret = network_subscribe_queue(s_network_queue, &network_sub);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to subscribe to network events", esp_ret);
+        abort();
+    }
+
     // Initialize network connection
     esp_ret = network_init(network_event_group);
     if (esp_ret != ESP_OK) {
@@ -168,34 +470,84 @@ void app_main(void)
         abort();
     }
 
-    // Do forever: perform HTTP POST request to ThingsBoard
+#if CONFIG_LINK_MONITOR
+    // Measure the link in the background to size batches
+    esp_ret = link_monitor_start();
+    if (esp_ret != ESP_OK) {
+        ESP_LOGW(TAG, "Error (%d): Failed to start link monitor", esp_ret);
+    }
+#endif
+
+    // Set the clock so samples can carry their own timestamps
+    esp_ret = esp_netif_sntp_init(&sntp_config);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGW(TAG, "Error (%d): Failed to start SNTP", esp_ret);
+    }
+
+    // Create one HTTP session and reuse it for every flush
+    esp_ret = http_session_init(&s_session, &client_config);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to create HTTP session", esp_ret);
+        abort();
+    }
+    s_start_us = esp_timer_get_time();
+#if CONFIG_STREAM_STATS
+    stream_stats_init(&s_temp_stats,
+                      SUMMARY_WINDOW_MS * 1000,
+                      s_start_us,
+                      s_temp_quantiles,
+                      sizeof(s_temp_quantiles) / sizeof(s_temp_quantiles[0]));
+#endif
+
+    // Do forever: sample, then upload in batches to ThingsBoard
     while (1) {
 
-        // Make sure we have a connection and IP address
-        network_event_bits = xEventGroupGetBits(network_event_group);
-        if (!(network_event_bits & NETWORK_CONNECTED_BIT) ||
-            !((network_event_bits & NETWORK_IPV4_OBTAINED_BIT) ||
-            (network_event_bits & NETWORK_IPV6_OBTAINED_BIT))) {
-            ESP_LOGI(TAG, "Network connection not established yet.");
-            if (!wait_for_network(network_event_group, 
-                                  CONNECTION_TIMEOUT_SEC)) {
-                ESP_LOGE(TAG, "Failed to connect to WiFi. Reconnecting...");
-                esp_ret = network_reconnect();
-                if (esp_ret != ESP_OK) {
-                    ESP_LOGE(TAG, "Failed to reconnect WiFi (%d)", esp_ret);
-                    abort();
+#if CONFIG_STREAM_STATS
+        // Summarize readings and queue one summary per window (kept even
+        // while the network is down)
+        if (stream_stats_add(&s_temp_stats, 25.0f, esp_timer_get_time(), &summary)) {
+            batch_add("temp")->summary = summary;
+        }
+#else
+        // Queue a sample (kept even while the network is down)
+        batch_add("temp")->val = 25;
+#endif
+
+        // Upload once the batch is full or the oldest sample is too old
+        if (batch_should_flush()) {
+
+            // Make sure we have a connection and IP address
+            process_network_events(0);
+            if (!s_network_up) {
+                ESP_LOGI(TAG, "Network connection not established yet.");
+                if (!wait_network_state(true, CONNECTION_TIMEOUT_SEC * 1000)) {
+                    ESP_LOGE(TAG, "Failed to connect to WiFi. Reconnecting...");
+                    esp_ret = network_reconnect();
+                    if (esp_ret != ESP_OK) {
+                        ESP_LOGE(TAG, "Failed to reconnect WiFi (%d), will retry", esp_ret);
+                    }
+                    continue;
                 }
-                continue;
             }
-        }
 
-        // Perform HTTP POST request
-        esp_ret = http_post_to_thingsboard("temp", 25);
-        if (esp_ret != ESP_OK) {
-            ESP_LOGE(TAG, "Error: HTTP POST failed");
+            // Wait once for the first time sync so samples get timestamps
+            if (!sntp_waited && (unix_time_ms() == 0)) {
+                esp_netif_sntp_sync_wait(pdMS_TO_TICKS(SNTP_TIMEOUT_MS));
+                sntp_waited = true;
+            }
+
+            // Send everything that is due (a backlog may take several posts)
+            while (batch_should_flush()) {
+                esp_ret = batch_flush();
+                if (esp_ret != ESP_OK) {
+                    ESP_LOGE(TAG, "Error: HTTP POST failed");
+                    break;
+                }
+            }
+            log_batch_stats();
         }
 
-        // Wait before trying again
+        // Wait before taking the next sample
         vTaskDelay(sleep_time_ms / portTICK_PERIOD_MS);
     }
 }
\ No newline at end of file
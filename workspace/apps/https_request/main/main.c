@@ -3,45 +3,73 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdlib.h>
 #include <string.h>
-#include "esp_crt_bundle.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
 #include "lwip/netdb.h"
 
 #include "mbedtls/platform.h"
 #include "mbedtls/net_sockets.h"
-#include "mbedtls/esp_debug.h"
 #include "mbedtls/ssl.h"
-#include "mbedtls/entropy.h"
-#include "mbedtls/ctr_drbg.h"
 #include "mbedtls/error.h"
-#ifdef CONFIG_MBEDTLS_SSL_PROTO_TLS1_3
-# include "psa/crypto.h"
-#endif
 
+#include "http_parser.h"
 #include "network_wrapper.h"
+#include "response_sink.h"
+#include "tls_client_profile.h"
+#if CONFIG_TLS_SESSION_CACHE
+# include "tls_session_cache.h"
+#endif
+#if CONFIG_DNS_CACHE
+# include "dns_cache.h"
+#endif
 
 // Settings
+#define RX_BUF_SIZE 4096 // Receive ring size (body goes from here to the sink)
+
+#if CONFIG_HTTPS_REQUEST_BENCHMARK
+static const uint32_t sleep_time_ms = 1000;
+
+// Local benchmark server (certificate signed by the course CA)
+# define WEB_HOST "10.0.2.2"
+# define WEB_PORT "8443"
+# define WEB_PATH "/bench/262144"
+#else
 static const uint32_t sleep_time_ms = 5000;
 
 // Server settings and URL to fetch
-#define WEB_HOST "www.howsmyssl.com"
-#define WEB_PORT "443"
-#define WEB_PATH "https://www.howsmyssl.com/a/check"
+# define WEB_HOST "www.howsmyssl.com"
+# define WEB_PORT "443"
+# define WEB_PATH "https://www.howsmyssl.com/a/check"
+#endif
+
+// Data partition the flash sink writes to (see partitions.csv)
+#define FLASH_SINK_LABEL "download"
 
 // HTTP GET request
+#if CONFIG_HTTPS_REQUEST_KEEP_ALIVE
+static const char *REQUEST = "GET " WEB_PATH " HTTP/1.1\r\n"
+    "Host: "WEB_HOST":"WEB_PORT"\r\n"
+    "User-Agent: esp-idf/1.0 esp32\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+#else
 static const char *REQUEST = "GET " WEB_PATH " HTTP/1.0\r\n"
     "Host: "WEB_HOST":"WEB_PORT"\r\n"
     "User-Agent: esp-idf/1.0 esp32\r\n"
     "\r\n";
+#endif
 
 // Set timeouts
 #define CONNECTION_TIMEOUT_SEC  10  // Set delay to wait for connection (sec)
+#define NETWORK_QUEUE_LEN       8   // Network state transitions kept queued
 
 // Tag for debug messages
 static const char *TAG = "https_request";
@@ -49,10 +77,46 @@ static const char *TAG = "https_request";
 // Static globals
 static mbedtls_net_context s_net_ctx;
 static mbedtls_ssl_context s_ssl_ctx;
-static mbedtls_ssl_config s_ssl_cfg;
-static mbedtls_x509_crt s_ca_cert;
-static mbedtls_entropy_context s_entropy_ctx;
-static mbedtls_ctr_drbg_context s_ctr_drbg_ctx;
+static tls_client_profile_t s_tls_profile;
+static bool s_connected = false;
+static uint8_t s_rx_storage[RX_BUF_SIZE];
+
+// Network state (updated from the subscription queue)
+static QueueHandle_t s_network_queue = NULL;
+static bool s_network_up = false;
+
+#if CONFIG_HTTPS_REQUEST_BENCHMARK
+// Load CA certificate from binary data (trusted in addition to the bundle)
+extern const uint8_t ca_cert_start[]    asm("_binary_ca_crt_start");
+extern const uint8_t ca_cert_end[]      asm("_binary_ca_crt_end");
+#endif
+
+// Response body sinks
+static response_sink_json_t s_json_sink;
+#if CONFIG_HTTPS_REQUEST_BENCHMARK
+static response_sink_discard_t s_discard_sink;
+static response_sink_hash_t s_hash_sink;
+static response_sink_flash_t s_flash_sink;
+#endif
+
+// Sinks to use, in turn (the benchmark cycles through all of them)
+typedef struct {
+    response_sink_t *sink;
+    uint32_t runs;          // Complete responses
+    uint64_t bytes;         // Body bytes over all runs
+    int64_t elapsed_us;     // Time from headers to end of body over all runs
+} sink_entry_t;
+
+static sink_entry_t s_sinks[4];    // One per sink type
+static size_t s_num_sinks = 0;
+static size_t s_sink_idx = 0;
+
+// Where the parser's callbacks send the response
+typedef struct {
+    response_sink_t *sink;  // Receives the body
+    bool sink_open;         // Sink begun but not yet ended
+    esp_err_t sink_ret;     // First error returned by the sink
+} resp_ctx_t;
 
 /*******************************************************************************
  * Private function prototypes
@@ -60,136 +124,89 @@ static mbedtls_ctr_drbg_context s_ctr_drbg_ctx;
 
 static esp_err_t tls_init();
 static void tls_deinit();
+static esp_err_t tls_connect();
+static void tls_disconnect();
+static int on_header(void *ctx,
+                     const char *name, size_t name_len,
+                     const char *value, size_t value_len);
+static int on_headers_complete(void *ctx, const http_parser_t *parser);
+static int on_body(void *ctx, const uint8_t *data, size_t len);
+static void on_json_value(void *ctx,
+                          const char *key,
+                          const char *value,
+                          response_sink_json_type_t type,
+                          int depth);
+static void sinks_init(void);
+static void log_sink_result(sink_entry_t *entry);
+static esp_err_t https_transaction();
 static esp_err_t https_get();
+#if CONFIG_TLS_SESSION_CACHE
+static void log_handshake_stats(void);
+#endif
+static void process_network_events(TickType_t wait_ticks);
+static bool wait_network_state(bool up, uint32_t timeout_ms);
+
+// Parser callbacks
+static const http_parser_callbacks_t s_parser_callbacks = {
+    .on_header = on_header,
+    .on_headers_complete = on_headers_complete,
+    .on_body = on_body,
+    .on_complete = NULL,
+};
 
 /*******************************************************************************
  * Private function definitions
  */
 
-// Initialize Mbed TLS ()
+// Create the per-connection TLS context from the shared profile
 static esp_err_t tls_init()
 {
-    esp_err_t esp_ret = ESP_FAIL;
-    int tls_ret;
-
-#ifdef CONFIG_MBEDTLS_SSL_PROTO_TLS1_3
-    psa_status_t psa_status;
-
-    // Initialize Platform Security Architecture (PSA) Crypto for Mbed TLS
-    psa_status = psa_crypto_init();
-    if (psa_status != PSA_SUCCESS) {
-        ESP_LOGE(TAG, "Error (%d): Failed to initialize PSA crypto", (int)psa_status);
-        return ESP_FAIL;
-    }
-#endif
-
-    // Log that we are initializing Mbed TLS
-    ESP_LOGI(TAG, "Initializing MbedTLS...");
-
-    // Initialize contexts
     mbedtls_net_init(&s_net_ctx);           // Socket wrapper (like file descriptor)
-    mbedtls_ssl_init(&s_ssl_ctx);           // Holds TLS session state and data
-    mbedtls_ssl_config_init(&s_ssl_cfg);    // TLS configuration
-    mbedtls_x509_crt_init(&s_ca_cert);      // Holds root CA certificates
-    mbedtls_ctr_drbg_init(&s_ctr_drbg_ctx); // Cryptographically secure PRNG
-    mbedtls_entropy_init(&s_entropy_ctx);   // Entropy context
-    
-    // Seed pseudorandom number generator
-    tls_ret = mbedtls_ctr_drbg_seed(&s_ctr_drbg_ctx,
-                                mbedtls_entropy_func,
-                                &s_entropy_ctx,
-                                NULL,
-                                0);
-    if (tls_ret != 0) {
-        ESP_LOGE(TAG, "Error (%d): Failed to seed CTR-DRBG RNG", tls_ret);
-        goto cleanup;
-    }
-
-#ifdef CONFIG_MBEDTLS_DEBUG
-    // Enable Mbed TLS debug output
-    mbedtls_esp_enable_debug_log(&s_ssl_cfg, CONFIG_MBEDTLS_DEBUG_LEVEL);
-#endif
-
-    // Attach default ESP-IDF trust store (CA certificates) to SSL configuration
-    esp_ret = esp_crt_bundle_attach(&s_ssl_cfg);
-    if (esp_ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%d): Failed to attach CA certificates", esp_ret);
-        goto cleanup;
-    }
 
-    // Hostname should match Common Name (CN) in server certificate
-    tls_ret = mbedtls_ssl_set_hostname(&s_ssl_ctx, WEB_HOST);
-    if (tls_ret != 0) {
-        ESP_LOGE(TAG, "Error (%d): Failed to set hostname for TLS session", tls_ret);
-        goto cleanup;
-    }
-
-    // Configure TLS for client
-    tls_ret = mbedtls_ssl_config_defaults(&s_ssl_cfg,
-                                          MBEDTLS_SSL_IS_CLIENT,        // Client mode
-                                          MBEDTLS_SSL_TRANSPORT_STREAM, // TLS (not DTLS)
-                                          MBEDTLS_SSL_PRESET_DEFAULT);  // Default security settings
-    if (tls_ret != 0) {
-        ESP_LOGE(TAG, "Error (%d): Failed to set TLS configuration", tls_ret);
-        goto cleanup;
-    }
-
-    // Require authentication (server must present a certificate)
-    mbedtls_ssl_conf_authmode(&s_ssl_cfg, MBEDTLS_SSL_VERIFY_REQUIRED);
-
-    // Set up certificate aurhtority (CA) chain (with no revocation list)
-    mbedtls_ssl_conf_ca_chain(&s_ssl_cfg, &s_ca_cert, NULL);
-
-    // Set random number generator (RNG) callback function
-    mbedtls_ssl_conf_rng(&s_ssl_cfg, mbedtls_ctr_drbg_random, &s_ctr_drbg_ctx);
-
-    // Set send and receive callback functions basic I/O operations
-    mbedtls_ssl_set_bio(&s_ssl_ctx,
-                        &s_net_ctx,
-                        mbedtls_net_send,
-                        mbedtls_net_recv,
-                        NULL);
-
-    // Set up TLS context
-    tls_ret = mbedtls_ssl_setup(&s_ssl_ctx, &s_ssl_cfg);
-    if (tls_ret != 0) {
-        ESP_LOGE(TAG, "Error (%d): Failed to set up TLS context", tls_ret);
-        goto cleanup;
-    }
-
-    // Set success return value
-    esp_ret = ESP_OK;
-
-cleanup:
-    // Free all initialized resources in reverse order of initialization if not successful
-    if (esp_ret != ESP_OK) {
-        tls_deinit();
-    }
-
-    return esp_ret;
+    return tls_client_profile_ssl_setup(&s_tls_profile,
+                                        &s_ssl_ctx,
+                                        &s_net_ctx,
+                                        WEB_HOST);
 }
 
-// Free all TLS resources
+// Free the per-connection TLS resources (the profile stays loaded)
 static void tls_deinit()
 {
     mbedtls_ssl_free(&s_ssl_ctx);
-    mbedtls_ssl_config_free(&s_ssl_cfg);
-    mbedtls_x509_crt_free(&s_ca_cert);
-    mbedtls_ctr_drbg_free(&s_ctr_drbg_ctx);
-    mbedtls_entropy_free(&s_entropy_ctx);
     mbedtls_net_free(&s_net_ctx);
 }
 
-// Initialize MbedTLS (network wrapper, SSL/TLS, CA certificate, PRNG)
-static esp_err_t https_get()
+// Open TCP connection and perform TLS handshake
+static esp_err_t tls_connect()
 {
-    esp_err_t esp_ret = ESP_FAIL;
     int tls_ret;
     int flags;
-    size_t bytes_written;
-    int bytes_read;
     char buf[512];
+#if CONFIG_DNS_CACHE
+    esp_err_t esp_ret;
+    dns_cache_result_t dns_res;
+#endif
 
+#if CONFIG_DNS_CACHE
+    // Resolve hostname (from memory if cached) and connect over TCP
+    ESP_LOGI(TAG, "Connecting to %s:%s...", WEB_HOST, WEB_PORT);
+    esp_ret = dns_cache_lookup(WEB_HOST, 
+                               (uint16_t)atoi(WEB_PORT), 
+                               WEB_FAMILY, 
+                               &dns_res);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): DNS lookup failed", esp_ret);
+        goto cleanup;
+    }
+    esp_ret = dns_cache_connect(&dns_res, 
+                                CONNECTION_TIMEOUT_SEC * 1000, 
+                                &s_net_ctx.fd);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to connect to server", esp_ret);
+        dns_cache_invalidate(WEB_HOST);
+        goto cleanup;
+    }
+#else
     // Connect to server using hostname and port over TCP
     ESP_LOGI(TAG, "Connecting to %s:%s...", WEB_HOST, WEB_PORT);
     tls_ret = mbedtls_net_connect(&s_net_ctx, 
@@ -200,8 +217,17 @@ static esp_err_t https_get()
         ESP_LOGE(TAG, "Error (%d): Failed to connect to server", tls_ret);
         goto cleanup;
     }
+#endif
     ESP_LOGI(TAG, "Connected");
 
+#if CONFIG_TLS_SESSION_CACHE
+    // Offer session from previous connection (if any) to skip full handshake
+    if (tls_session_cache_load(&s_ssl_ctx, WEB_HOST) == ESP_OK) {
+        ESP_LOGI(TAG, "Attempting to resume cached TLS session");
+    }
+    tls_session_cache_handshake_start();
+#endif
+
     // Perform SSL/TLS handshake (note: blocking)
     ESP_LOGI(TAG, "Performing SSL/TLS handshake...");
     do {
@@ -212,11 +238,22 @@ static esp_err_t https_get()
             ESP_LOGE(TAG, 
                         "Error (%d): Failed to perform SSL/TLS handshake",
                         tls_ret);
+#if CONFIG_TLS_SESSION_CACHE
+            // Don't offer a session the server may have rejected
+            tls_session_cache_clear(WEB_HOST);
+#endif
             goto cleanup;
         }
     } while (tls_ret != 0);
     ESP_LOGI(TAG, "Handshake complete");
 
+#if CONFIG_TLS_SESSION_CACHE
+    // Log handshake time and save session for next connection
+    tls_session_cache_handshake_done(&s_ssl_ctx, WEB_HOST);
+    tls_session_cache_save(&s_ssl_ctx, WEB_HOST);
+    log_handshake_stats();
+#endif
+
     // Verify server certificate
     ESP_LOGI(TAG, "Verifying peer X.509 certificate...");
     flags = mbedtls_ssl_get_verify_result(&s_ssl_ctx);
@@ -232,6 +269,176 @@ static esp_err_t https_get()
     // Print cipher suite
     ESP_LOGI(TAG, "Cipher suite is %s", mbedtls_ssl_get_ciphersuite(&s_ssl_ctx));
 
+    s_connected = true;
+    return ESP_OK;
+
+cleanup:
+    tls_disconnect();
+
+    return ESP_FAIL;
+}
+
+// Close the connection and reset the TLS context for the next one
+static void tls_disconnect()
+{
+    // Notify server that we're closing the connection
+    mbedtls_ssl_close_notify(&s_ssl_ctx);
+
+    // Reset the TLS context
+    mbedtls_ssl_session_reset(&s_ssl_ctx);
+
+    // Free the network context
+    mbedtls_net_free(&s_net_ctx);
+
+    s_connected = false;
+}
+
+// Log each response header (debug only)
+static int on_header(void *ctx,
+                     const char *name, size_t name_len,
+                     const char *value, size_t value_len)
+{
+    ESP_LOGD(TAG, "%.*s: %.*s", (int)name_len, name, (int)value_len, value);
+
+    return 0;
+}
+
+// Log the status and open the sink once all headers have arrived
+static int on_headers_complete(void *ctx, const http_parser_t *parser)
+{
+    resp_ctx_t *resp = (resp_ctx_t *)ctx;
+
+    ESP_LOGI(TAG, "HTTP/1.%u %d (%s, keep-alive: %s)",
+             parser->version_minor,
+             parser->status_code,
+             parser->chunked ? "chunked" :
+                 (parser->has_content_length ? "content-length" : "until close"),
+             parser->keep_alive ? "yes" : "no");
+
+    // Body goes straight to the sink from here on
+    resp->sink_ret = response_sink_begin(resp->sink,
+                                         parser->status_code,
+                                         (parser->has_content_length && 
+                                          !parser->chunked) ?
+                                             (int64_t)parser->content_length :
+                                             RESPONSE_SINK_LENGTH_UNKNOWN);
+    if (resp->sink_ret != ESP_OK) {
+        return 1;
+    }
+    resp->sink_open = true;
+
+    return 0;
+}
+
+// Pass decoded body slices to the sink (not copied)
+static int on_body(void *ctx, const uint8_t *data, size_t len)
+{
+    resp_ctx_t *resp = (resp_ctx_t *)ctx;
+
+    resp->sink_ret = response_sink_write(resp->sink, data, len);
+
+    return (resp->sink_ret != ESP_OK) ? 1 : 0;
+}
+
+// Print the interesting fields of the howsmyssl.com report as they arrive
+static void on_json_value(void *ctx,
+                          const char *key,
+                          const char *value,
+                          response_sink_json_type_t type,
+                          int depth)
+{
+    static const char *keys[] = { "tls_version", "rating", "session_ticket_supported" };
+
+    if (depth != 1) {
+        return;
+    }
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (strcmp(key, keys[i]) == 0) {
+            ESP_LOGI(TAG, "  %s: %s", key, value);
+        }
+    }
+}
+
+// Set up the body sinks (the benchmark compares all of them)
+static void sinks_init(void)
+{
+#if CONFIG_HTTPS_REQUEST_BENCHMARK
+    response_sink_t *flash_sink;
+
+    s_sinks[s_num_sinks++].sink = response_sink_discard_init(&s_discard_sink);
+    s_sinks[s_num_sinks++].sink = response_sink_hash_init(&s_hash_sink);
+    s_sinks[s_num_sinks++].sink = response_sink_json_init(&s_json_sink,
+                                                          on_json_value,
+                                                          NULL);
+    if (response_sink_flash_init(&s_flash_sink,
+                                 FLASH_SINK_LABEL,
+                                 &flash_sink) == ESP_OK) {
+        s_sinks[s_num_sinks++].sink = flash_sink;
+    } else {
+        ESP_LOGW(TAG, "No %s partition, skipping flash sink", FLASH_SINK_LABEL);
+    }
+#else
+    s_sinks[s_num_sinks++].sink = response_sink_json_init(&s_json_sink,
+                                                          on_json_value,
+                                                          NULL);
+#endif
+}
+
+// Print one response's throughput and the running average for its sink
+static void log_sink_result(sink_entry_t *entry)
+{
+    response_sink_t *sink = entry->sink;
+#if CONFIG_HTTPS_REQUEST_BENCHMARK
+    char digest[65];
+#endif
+
+    entry->runs++;
+    entry->bytes += sink->bytes;
+    entry->elapsed_us += sink->end_us - sink->begin_us;
+    ESP_LOGI(TAG, "%s sink: %llu bytes in %lld ms (%lu KB/s, average %lu KB/s over %lu runs)",
+             sink->ops->name,
+             sink->bytes,
+             (sink->end_us - sink->begin_us) / 1000,
+             (unsigned long)(response_sink_bytes_per_sec(sink) / 1024),
+             (entry->elapsed_us > 0) ?
+                (unsigned long)((entry->bytes * 1000000ULL) / 
+                                (uint64_t)entry->elapsed_us / 1024) :
+                0UL,
+             (unsigned long)entry->runs);
+
+    // Sink-specific results
+#if CONFIG_HTTPS_REQUEST_BENCHMARK
+    if (sink == &s_hash_sink.base) {
+        response_sink_hash_hex(&s_hash_sink, digest, sizeof(digest));
+        ESP_LOGI(TAG, "  SHA-256: %s", digest);
+    }
+#endif
+    if (sink == &s_json_sink.base) {
+        ESP_LOGI(TAG, "  JSON: %lu values, depth %d",
+                 (unsigned long)s_json_sink.values,
+                 s_json_sink.max_depth);
+    }
+}
+
+// Send one request on the open connection and read the full response
+static esp_err_t https_transaction()
+{
+    esp_err_t esp_ret;
+    int tls_ret;
+    size_t bytes_written;
+    size_t request_len = strlen(REQUEST);
+    http_parser_t parser;
+    http_parser_result_t parse_ret;
+    http_ring_t rx_ring;
+    uint8_t *rx_ptr;
+    size_t rx_free;
+    sink_entry_t *entry = &s_sinks[s_sink_idx];
+    resp_ctx_t resp = {
+        .sink = entry->sink,
+        .sink_open = false,
+        .sink_ret = ESP_OK,
+    };
+
     // Write HTTP request (potential for multiple partial writes)
     ESP_LOGI(TAG, "Writing HTTP request...");
     bytes_written = 0;
@@ -239,7 +446,7 @@ static esp_err_t https_get()
         tls_ret = mbedtls_ssl_write(&s_ssl_ctx,
                                     (const unsigned char *)REQUEST + 
                                     bytes_written,
-                                    strlen(REQUEST) - bytes_written);
+                                    request_len - bytes_written);
         if (tls_ret >= 0) {
             ESP_LOGI(TAG, "%d bytes written", tls_ret);
             bytes_written += tls_ret;
@@ -248,23 +455,29 @@ static esp_err_t https_get()
             ESP_LOGE(TAG, 
                         "Error (%d): Failed to write HTTP request",
                         tls_ret);
-            goto cleanup;
+            tls_disconnect();
+            return ESP_ERR_INVALID_STATE;
         }
-    } while(bytes_written < strlen(REQUEST));
+    } while(bytes_written < request_len);
 
-    // Print HTTP response (potential for multiple partial reads)
-    ESP_LOGI(TAG, "Reading HTTP response...");
-    do {
-        bytes_read = sizeof(buf) - 1;
-        memset(buf, 0, sizeof(buf));
-        tls_ret = mbedtls_ssl_read(&s_ssl_ctx, 
-                                    (unsigned char *)buf,
-                                    bytes_read);
+    // Stream HTTP response to the sink until the parser says it is complete
+    ESP_LOGI(TAG, "Reading HTTP response into %s sink...", entry->sink->ops->name);
+    http_ring_init(&rx_ring, s_rx_storage, sizeof(s_rx_storage));
+    http_parser_init(&parser, &s_parser_callbacks, &resp);
+    parse_ret = HTTP_PARSER_NEED_MORE;
+    while (parse_ret == HTTP_PARSER_NEED_MORE) {
+
+        // Decrypt directly into the free part of the ring
+        rx_ptr = http_ring_write_ptr(&rx_ring, &rx_free);
+        tls_ret = mbedtls_ssl_read(&s_ssl_ctx, rx_ptr, rx_free);
 
 #if CONFIG_MBEDTLS_SSL_PROTO_TLS1_3 && CONFIG_MBEDTLS_CLIENT_SSL_SESSION_TICKETS
         // In TLS 1.3, session tickets are received as a separate message
         if (tls_ret == MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET) {
             ESP_LOGD(TAG, "Received session ticket in TLS 1.3, retry read");
+# if CONFIG_TLS_SESSION_CACHE
+            tls_session_cache_save(&s_ssl_ctx, WEB_HOST);
+# endif
             continue;
         }
 #endif
@@ -274,50 +487,185 @@ static esp_err_t https_get()
             continue;
         }
 
-        // If server closed connection, break loop
-        if (tls_ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
-            tls_ret = 0;
-            break;
-        }
-
-        // Connection was closed without notification, end session
-        if (tls_ret == 0) {
+        // Server closed connection: only a valid end for close-delimited body
+        if ((tls_ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) || (tls_ret == 0)) {
             ESP_LOGI(TAG, "Connection closed");
-            break;
+            tls_disconnect();
+            parse_ret = http_parser_finish(&parser);
+            if (parse_ret == HTTP_PARSER_COMPLETE) {
+                break;
+            }
+            if (resp.sink_open) {
+                response_sink_end(resp.sink, false);
+            }
+            return parser.started ? ESP_FAIL : ESP_ERR_INVALID_STATE;
         }
 
         // Other errors, end session
         if (tls_ret < 0) {
             ESP_LOGE(TAG, "Error (%d): Failed to read HTTP response", tls_ret);
-            break;
+            tls_disconnect();
+            if (resp.sink_open) {
+                response_sink_end(resp.sink, false);
+            }
+            return parser.started ? ESP_FAIL : ESP_ERR_INVALID_STATE;
         }
 
-        // Print response directly to console
-        bytes_read = tls_ret;
-        buf[bytes_read] = '\0';
-        ESP_LOGD(TAG, "%d bytes read", bytes_read);
-        printf("%s", buf);
+        // Parse the decrypted bytes (body slices go to the sink)
+        ESP_LOGD(TAG, "%d bytes read", tls_ret);
+        http_ring_commit(&rx_ring, (size_t)tls_ret);
+        parse_ret = http_parser_execute_ring(&parser, &rx_ring);
+
+        // A callback paused the parser because the sink failed
+        if (resp.sink_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error (%d): %s sink rejected the response",
+                     resp.sink_ret,
+                     resp.sink->ops->name);
+            tls_disconnect();
+            if (resp.sink_open) {
+                response_sink_end(resp.sink, false);
+            }
+            return ESP_FAIL;
+        }
+    }
 
-    } while (1);
+    // Malformed response: the connection can't be reused
+    if (parse_ret != HTTP_PARSER_COMPLETE) {
+        ESP_LOGE(TAG, "Malformed HTTP response");
+        if (s_connected) {
+            tls_disconnect();
+        }
+        if (resp.sink_open) {
+            response_sink_end(resp.sink, false);
+        }
+        return ESP_FAIL;
+    }
 
-    // Set return value
-    if (tls_ret == 0) {
-        esp_ret = ESP_OK;
-    } else {
-        esp_ret = ESP_FAIL;
+    // Let the sink finish (e.g. check the document is complete)
+    esp_ret = response_sink_end(resp.sink, true);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): %s sink failed to finish", esp_ret, resp.sink->ops->name);
+        if (s_connected) {
+            tls_disconnect();
+        }
+        return ESP_FAIL;
     }
+    log_sink_result(entry);
 
-cleanup:
-    // Notify server that we're closing the connection
-    mbedtls_ssl_close_notify(&s_ssl_ctx);
+    // Keep the connection open for the next request unless told otherwise
+#if CONFIG_HTTPS_REQUEST_KEEP_ALIVE
+    if (s_connected && !parser.keep_alive) {
+#else
+    if (s_connected) {
+#endif
+        tls_disconnect();
+    }
 
-    // Reset the TLS context
-    mbedtls_ssl_session_reset(&s_ssl_ctx);
+    return ESP_OK;
+}
 
-    // Free the network context
-    mbedtls_net_free(&s_net_ctx);
+// Perform HTTPS GET request, reusing the open connection if there is one
+static esp_err_t https_get()
+{
+    esp_err_t esp_ret = ESP_FAIL;
+    bool reused;
+
+    // Retry once on a fresh connection if the server silently dropped an idle
+    // kept-alive connection before sending any response
+    for (int attempt = 0; attempt < 2; attempt++) {
 
-    return esp_ret;
+        // Open connection if needed
+        reused = s_connected;
+        if (!s_connected) {
+            esp_ret = tls_connect();
+            if (esp_ret != ESP_OK) {
+                return esp_ret;
+            }
+        } else {
+            ESP_LOGI(TAG, "Reusing open connection to %s", WEB_HOST);
+        }
+
+        // Send request and read response
+        esp_ret = https_transaction();
+        if ((esp_ret != ESP_ERR_INVALID_STATE) || !reused) {
+            break;
+        }
+        ESP_LOGI(TAG, "Idle connection closed by server, reconnecting...");
+    }
+
+    return (esp_ret == ESP_OK) ? ESP_OK : ESP_FAIL;
+}
+
+#if CONFIG_TLS_SESSION_CACHE
+// Print full vs. resumed handshake latency
+static void log_handshake_stats(void)
+{
+    tls_session_cache_stats_t stats;
+
+    tls_session_cache_get_stats(&stats);
+    ESP_LOGI(TAG, 
+             "Handshake (%s): %lu ms",
+             stats.last_resumed ? "resumed" : "full",
+             (unsigned long)(stats.last_us / 1000));
+    ESP_LOGI(TAG,
+             "  Full: %lu handshakes, avg %lu ms",
+             (unsigned long)stats.full_count,
+             stats.full_count ? 
+                (unsigned long)(stats.full_total_us / stats.full_count / 1000) : 
+                0UL);
+    ESP_LOGI(TAG,
+             "  Resumed: %lu handshakes, avg %lu ms",
+             (unsigned long)stats.resumed_count,
+             stats.resumed_count ? 
+                (unsigned long)(stats.resumed_total_us / 
+                                stats.resumed_count / 1000) : 
+                0UL);
+}
+#endif
+
+// Apply queued network state transitions, blocking up to wait_ticks for one
+static void process_network_events(TickType_t wait_ticks)
+{
+    network_event_t event;
+
+    while (xQueueReceive(s_network_queue, &event, wait_ticks) == pdTRUE) {
+        switch (event.type) {
+            case NETWORK_EVENT_LINK_DOWN:
+                ESP_LOGW(TAG, "Network link down (reason %d)%s",
+                         event.reason,
+                         event.reconnecting ? ", driver reconnecting" : "");
+                break;
+            case NETWORK_EVENT_IP_ACQUIRED:
+                ESP_LOGI(TAG, "Network up (%s)",
+                         (event.family == AF_INET6) ? "IPv6" : "IPv4");
+                break;
+            default:
+                ESP_LOGI(TAG, "Network event: %s", network_event_name(event.type));
+                break;
+        }
+        s_network_up = network_is_up();
+
+        // Only block for the first event, then drain the rest
+        wait_ticks = 0;
+    }
+}
+
+// Block until the network is (up) or is not (!up) usable, or timeout
+static bool wait_network_state(bool up, uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    TickType_t elapsed;
+
+    while (s_network_up != up) {
+        elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            return false;
+        }
+        process_network_events(timeout - elapsed);
+    }
+
+    return true;
 }
 
 /*******************************************************************************
@@ -328,7 +676,7 @@ void app_main(void)
 {
     esp_err_t esp_ret;
     EventGroupHandle_t network_event_group;
-    EventBits_t network_event_bits;
+    network_subscriber_handle_t network_sub;
 
     // Initialize event group
     network_event_group = xEventGroupCreate();
@@ -359,6 +707,18 @@ void app_main(void)
         abort();
     }
 
+    // Get network state transitions on a queue instead of polling bits
+    s_network_queue = xQueueCreate(NETWORK_QUEUE_LEN, sizeof(network_event_t));
+    if (s_network_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create network event queue");
+        abort();
+    }
+    esp_ret = network_subscribe_queue(s_network_queue, &network_sub);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to subscribe to network events", esp_ret);
+        abort();
+    }
+
     // Initialize network connection
     esp_ret = network_init(network_event_group);
     if (esp_ret != ESP_OK) {
@@ -366,13 +726,34 @@ void app_main(void)
         abort();
     }
 
+    // Load TLS configuration, RNG, and trust store once (shared by sessions)
+    esp_ret = tls_client_profile_init(&s_tls_profile);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to initialize Mbed TLS", esp_ret);
+        abort();
+    }
+
+#if CONFIG_HTTPS_REQUEST_BENCHMARK
+    // Trust the course CA that signed the local server's certificate
+    esp_ret = tls_client_profile_add_ca(&s_tls_profile,
+                                        ca_cert_start,
+                                        ca_cert_end - ca_cert_start);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to load CA certificate", esp_ret);
+        abort();
+    }
+#endif
+
+    // Set up where response bodies go
+    sinks_init();
+
     // Superloop
     while(1) {
 
-        // Initialize TLS
+        // Create TLS context for this session
         esp_ret = tls_init();
         if (esp_ret != ESP_OK) {
-            ESP_LOGE(TAG, "Error (%d): Failed to initialize Mbed TLS", esp_ret);
+            ESP_LOGE(TAG, "Error (%d): Failed to create TLS context", esp_ret);
             abort();
         }
 
@@ -380,24 +761,20 @@ void app_main(void)
         while(1) {
 
             // Make sure we have a connection and IP address
-            network_event_bits = xEventGroupGetBits(network_event_group);
-            if (!(network_event_bits & NETWORK_CONNECTED_BIT) ||
-                !((network_event_bits & NETWORK_IPV4_OBTAINED_BIT) ||
-                (network_event_bits & NETWORK_IPV6_OBTAINED_BIT))) {
+            process_network_events(0);
+            if (!s_network_up) {
                 ESP_LOGI(TAG, "Network connection not established yet.");
-                if (!wait_for_network(network_event_group, 
-                                    CONNECTION_TIMEOUT_SEC)) {
+                if (!wait_network_state(true, CONNECTION_TIMEOUT_SEC * 1000)) {
                     ESP_LOGE(TAG, "Failed to connect to WiFi. Reconnecting...");
                     esp_ret = network_reconnect();
                     if (esp_ret != ESP_OK) {
-                        ESP_LOGE(TAG, "Failed to reconnect WiFi (%d)", esp_ret);
-                        abort();
+                        ESP_LOGE(TAG, "Failed to reconnect WiFi (%d), will retry", esp_ret);
                     }
                     continue;
                 }
             }
 
-            // Perform HTTPS GET request and print response to terminal
+            // Perform HTTPS GET request and stream the body to the sink
             esp_ret = https_get();
             if (esp_ret != ESP_OK) {
                 ESP_LOGE(TAG, "Error (%d): HTTPS GET request failed", esp_ret);
@@ -405,11 +782,14 @@ void app_main(void)
                 break;
             }
 
+            // Use the next sink for the next request
+            s_sink_idx = (s_sink_idx + 1) % s_num_sinks;
+
             // Print amount of free heap memory (check for memory leak)
             printf("\r\nFree heap: %lu\r\n", esp_get_free_heap_size());
 
-            // Delay
-            vTaskDelay(sleep_time_ms / portTICK_PERIOD_MS);
+            // Wait before the next request (cut short if the network goes down)
+            wait_network_state(false, sleep_time_ms);
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,432 @@
+/**
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host-side schedule checks and bus load benchmark for the i2c_bus_manager
+ * component.
+ *
+ * Runs the scheduler against the simulated bus (i2c_bus_mock), whose clock
+ * only moves with transactions and simulated sleeps, so every run is exactly
+ * repeatable. Checks that:
+ *
+ *  - Devices with harmonic periods share batches
+ *  - The batch window merges reads that fall due close together, without
+ *    shifting any device's schedule
+ *  - A batch changes SCL speed at most once per distinct speed, and the
+ *    manager's count matches the bus
+ *  - Periods the bus was too late for are skipped and counted as missed
+ *  - Read data and errors reach the device callbacks
+ *
+ * Then measures the scheduler's own time per transaction.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "i2c_bus_manager.h"
+#include "i2c_bus_mock.h"
+
+// Settings
+#define SIM_TIME_US         1000000     // Simulated time per schedule
+#define BATCH_WINDOW_US     3000        // Batch window for the window check
+#define SWITCH_US           20          // Simulated cost of an SCL change
+#define FAST_HZ             400000      // Fast-mode devices
+#define SLOW_HZ             100000      // Standard-mode devices
+#define MIN_RUN_TIME_S      0.5         // Run the speed test for at least this long
+
+// Fail the current check (and keep going) if cond is false
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("    check failed (line %d): %s\n", __LINE__, #cond);   \
+            s_failed = 1;                                                   \
+        }                                                                   \
+    } while (0)
+
+// What a device callback saw
+typedef struct {
+    uint32_t calls;
+    uint32_t errors;
+    uint32_t bad_data;          // Successful reads with unexpected bytes
+    int last_err;
+    size_t last_len;
+    uint8_t expect[2];          // Bytes the simulated device returns
+} read_log_t;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static void on_read(void *ctx, uint8_t id, int err,
+                    const uint8_t *data, size_t len,
+                    int64_t timestamp_us);
+static uint8_t add_device(i2c_bus_manager_t *mgr,
+                          i2c_bus_mock_t *mock,
+                          uint16_t addr,
+                          uint32_t scl_speed_hz,
+                          uint32_t period_us,
+                          read_log_t *log);
+static void simulate(i2c_bus_manager_t *mgr, i2c_bus_mock_t *mock, int64_t duration_us);
+static void print_stats(const char *name, const i2c_bus_manager_t *mgr);
+static void check_harmonic(void);
+static void check_window(void);
+static void check_clock_switches(void);
+static void check_missed(void);
+static void check_errors(void);
+static double bench_run(void);
+static double now_s(void);
+
+// Static global variables
+static int s_failed = 0;
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Device callback: count calls and compare the bytes with the device's
+static void on_read(void *ctx, uint8_t id, int err,
+                    const uint8_t *data, size_t len,
+                    int64_t timestamp_us)
+{
+    read_log_t *log = (read_log_t *)ctx;
+
+    (void)id;
+    (void)timestamp_us;
+
+    log->calls++;
+    log->last_err = err;
+    log->last_len = len;
+    if (err != 0) {
+        log->errors++;
+    } else if ((len != sizeof(log->expect)) ||
+               (memcmp(data, log->expect, sizeof(log->expect)) != 0)) {
+        log->bad_data++;
+    }
+}
+
+// Add a 2-byte register read to the bus and the schedule
+static uint8_t add_device(i2c_bus_manager_t *mgr,
+                          i2c_bus_mock_t *mock,
+                          uint16_t addr,
+                          uint32_t scl_speed_hz,
+                          uint32_t period_us,
+                          read_log_t *log)
+{
+    i2c_bus_device_config_t config = {
+        .addr = addr,
+        .scl_speed_hz = scl_speed_hz,
+        .reg = {0x00},
+        .reg_len = 1,
+        .read_len = 2,
+        .period_us = period_us,
+        .on_read = on_read,
+        .ctx = log,
+    };
+    uint8_t id = 0;
+
+    memset(log, 0, sizeof(*log));
+    log->expect[0] = (uint8_t)addr;
+    log->expect[1] = (uint8_t)~addr;
+    i2c_bus_mock_set_data(mock, addr, log->expect, sizeof(log->expect));
+    CHECK(i2c_bus_manager_add(mgr, &config, &id) == I2C_BUS_OK);
+
+    return id;
+}
+
+// Run the schedule, sleeping (on the simulated clock) between batches
+static void simulate(i2c_bus_manager_t *mgr, i2c_bus_mock_t *mock, int64_t duration_us)
+{
+    int64_t end_us = mock->now_us + duration_us;
+    int64_t next_us;
+
+    while (mock->now_us < end_us) {
+        next_us = i2c_bus_manager_run(mgr);
+        if (next_us > end_us) {
+            next_us = end_us;
+        }
+        if (next_us > mock->now_us) {
+            i2c_bus_mock_advance(mock, next_us - mock->now_us);
+        }
+    }
+}
+
+// Print the bus counters of one run
+static void print_stats(const char *name, const i2c_bus_manager_t *mgr)
+{
+    i2c_bus_stats_t stats;
+
+    i2c_bus_manager_get_stats(mgr, &stats);
+    printf("    %-26s %5u reads  %5u batches  %4u switches  "
+           "busy %4.1f%%  load %4.1f%%\n",
+           name,
+           (unsigned int)stats.transactions,
+           (unsigned int)stats.batches,
+           (unsigned int)stats.clock_switches,
+           stats.utilization_permille / 10.0,
+           stats.load_permille / 10.0);
+}
+
+// Devices with periods of 10, 20, and 100 ms always share a batch
+static void check_harmonic(void)
+{
+    i2c_bus_manager_t mgr;
+    i2c_bus_mock_t mock;
+    i2c_bus_stats_t stats;
+    i2c_bus_device_stats_t dev_stats;
+    read_log_t logs[3];
+    const uint32_t periods[] = {10000, 20000, 100000};
+    uint32_t reads = 0;
+
+    i2c_bus_mock_init(&mock, SWITCH_US);
+    CHECK(i2c_bus_manager_init(&mgr, &i2c_bus_mock_backend, &mock, 0) == I2C_BUS_OK);
+    for (uint8_t i = 0; i < 3; i++) {
+        add_device(&mgr, &mock, 0x48 + i, FAST_HZ, periods[i], &logs[i]);
+    }
+    simulate(&mgr, &mock, SIM_TIME_US);
+    print_stats("harmonic 10/20/100 ms", &mgr);
+
+    // One batch per 10 ms tick, every read on time
+    i2c_bus_manager_get_stats(&mgr, &stats);
+    for (uint8_t i = 0; i < 3; i++) {
+        CHECK(i2c_bus_manager_get_device_stats(&mgr, i, &dev_stats) == I2C_BUS_OK);
+        CHECK(dev_stats.reads == (SIM_TIME_US - 1) / periods[i]);
+        CHECK(dev_stats.missed == 0);
+        CHECK(dev_stats.latency_max_us < periods[0] / 10);
+        CHECK(logs[i].calls == dev_stats.reads);
+        CHECK(logs[i].bad_data == 0);
+        reads += dev_stats.reads;
+    }
+    CHECK(stats.transactions == reads);
+    CHECK(stats.batches == (SIM_TIME_US - 1) / periods[0]);
+    CHECK(stats.clock_switches == 0);
+    CHECK(mock.transactions == reads);
+}
+
+// A batch window merges 10 and 11 ms reads without moving either schedule
+static void check_window(void)
+{
+    i2c_bus_manager_t mgr;
+    i2c_bus_mock_t mock;
+    i2c_bus_stats_t stats[2];
+    i2c_bus_device_stats_t dev_stats[2][2];
+    read_log_t logs[2];
+    const uint32_t windows[] = {0, BATCH_WINDOW_US};
+    char name[32];
+
+    for (uint8_t w = 0; w < 2; w++) {
+        i2c_bus_mock_init(&mock, SWITCH_US);
+        i2c_bus_manager_init(&mgr, &i2c_bus_mock_backend, &mock, windows[w]);
+        add_device(&mgr, &mock, 0x48, FAST_HZ, 10000, &logs[0]);
+        add_device(&mgr, &mock, 0x49, FAST_HZ, 11000, &logs[1]);
+        simulate(&mgr, &mock, SIM_TIME_US);
+        snprintf(name, sizeof(name), "10/11 ms, window %u us", (unsigned int)windows[w]);
+        print_stats(name, &mgr);
+
+        i2c_bus_manager_get_stats(&mgr, &stats[w]);
+        for (uint8_t i = 0; i < 2; i++) {
+            i2c_bus_manager_get_device_stats(&mgr, i, &dev_stats[w][i]);
+            CHECK(dev_stats[w][i].missed == 0);
+        }
+    }
+
+    // Fewer batches, same reads
+    CHECK(stats[1].batches < stats[0].batches);
+    CHECK(stats[1].transactions == stats[0].transactions);
+    CHECK(dev_stats[1][0].reads == dev_stats[0][0].reads);
+    CHECK(dev_stats[1][1].reads == dev_stats[0][1].reads);
+
+    // Reads pulled forward count as on time
+    CHECK(dev_stats[1][1].latency_min_us == 0);
+}
+
+// Mixed clocks: one SCL change per batch, not one per read
+static void check_clock_switches(void)
+{
+    i2c_bus_manager_t mgr;
+    i2c_bus_mock_t mock;
+    i2c_bus_stats_t stats;
+    read_log_t logs[4];
+
+    // Added alternating, so add order would switch on every read
+    i2c_bus_mock_init(&mock, SWITCH_US);
+    i2c_bus_manager_init(&mgr, &i2c_bus_mock_backend, &mock, 0);
+    add_device(&mgr, &mock, 0x48, FAST_HZ, 10000, &logs[0]);
+    add_device(&mgr, &mock, 0x50, SLOW_HZ, 10000, &logs[1]);
+    add_device(&mgr, &mock, 0x49, FAST_HZ, 10000, &logs[2]);
+    add_device(&mgr, &mock, 0x51, SLOW_HZ, 10000, &logs[3]);
+    simulate(&mgr, &mock, SIM_TIME_US);
+    print_stats("2 x 400 + 2 x 100 kHz", &mgr);
+    i2c_bus_manager_get_stats(&mgr, &stats);
+    printf("    %-26s %5u switches in add order\n",
+           "",
+           (unsigned int)(stats.batches * 3 + (stats.batches - 1)));
+
+    // Each batch starts at the clock the previous one ended on
+    CHECK(stats.batches > 0);
+    CHECK(stats.clock_switches == stats.batches);
+    CHECK(stats.clock_switches == mock.clock_switches);
+    CHECK(stats.transactions == 4 * stats.batches);
+    for (uint8_t i = 0; i < 4; i++) {
+        CHECK(logs[i].calls == stats.batches);
+        CHECK(logs[i].bad_data == 0);
+    }
+}
+
+// A late bus skips the periods it missed instead of catching up
+static void check_missed(void)
+{
+    i2c_bus_manager_t mgr;
+    i2c_bus_mock_t mock;
+    i2c_bus_device_stats_t dev_stats;
+    read_log_t log;
+    int64_t next_us;
+    uint32_t wire_us;
+
+    // 1 ms device first due at 1 ms, but the bus only runs at 10.5 ms
+    i2c_bus_mock_init(&mock, SWITCH_US);
+    i2c_bus_manager_init(&mgr, &i2c_bus_mock_backend, &mock, 0);
+    add_device(&mgr, &mock, 0x48, SLOW_HZ, 1000, &log);
+    i2c_bus_mock_advance(&mock, 10500);
+    next_us = i2c_bus_manager_run(&mgr);
+
+    // One read, ending at 10.5 ms plus its wire time. The periods due at
+    // 2 to 11 ms are skipped and the next read is due at 12 ms.
+    wire_us = i2c_bus_manager_wire_time_us(SLOW_HZ, 1, 2);
+    CHECK(i2c_bus_manager_get_device_stats(&mgr, 0, &dev_stats) == I2C_BUS_OK);
+    CHECK(dev_stats.reads == 1);
+    CHECK(dev_stats.missed == 10);
+    CHECK(dev_stats.latency_max_us == 10500 - 1000 + wire_us);
+    CHECK(next_us == 12000);
+    CHECK(log.calls == 1);
+    printf("    %-26s %5u missed  next due %lld us\n",
+           "1 ms device, 9.5 ms late",
+           (unsigned int)dev_stats.missed,
+           (long long)next_us);
+
+    // Back on schedule afterwards
+    simulate(&mgr, &mock, 100000);
+    CHECK(i2c_bus_manager_get_device_stats(&mgr, 0, &dev_stats) == I2C_BUS_OK);
+    CHECK(dev_stats.missed == 10);
+}
+
+// Failed reads reach the callback and the counters
+static void check_errors(void)
+{
+    i2c_bus_manager_t mgr;
+    i2c_bus_mock_t mock;
+    i2c_bus_device_stats_t dev_stats;
+    i2c_bus_device_config_t config;
+    read_log_t logs[I2C_BUS_MAX_DEVICES];
+    uint8_t id;
+
+    i2c_bus_mock_init(&mock, SWITCH_US);
+    i2c_bus_manager_init(&mgr, &i2c_bus_mock_backend, &mock, 0);
+    add_device(&mgr, &mock, 0x48, FAST_HZ, 10000, &logs[0]);
+    add_device(&mgr, &mock, 0x49, FAST_HZ, 10000, &logs[1]);
+    i2c_bus_mock_set_nack(&mock, 0x49, true);
+    simulate(&mgr, &mock, 100000);
+
+    CHECK(logs[0].errors == 0);
+    CHECK(logs[1].errors == logs[1].calls);
+    CHECK(logs[1].last_err == I2C_BUS_MOCK_ERR_NACK);
+    CHECK(logs[1].last_len == 0);
+    CHECK(i2c_bus_manager_get_device_stats(&mgr, 1, &dev_stats) == I2C_BUS_OK);
+    CHECK(dev_stats.errors == dev_stats.reads);
+    CHECK(i2c_bus_manager_get_device_stats(&mgr, 2, &dev_stats) == I2C_BUS_ERR_INVALID);
+
+    // Bad configurations, then a full table
+    config = (i2c_bus_device_config_t){
+        .addr = 0x60,
+        .scl_speed_hz = FAST_HZ,
+        .read_len = 0,
+        .period_us = 10000,
+    };
+    CHECK(i2c_bus_manager_add(&mgr, &config, &id) == I2C_BUS_ERR_INVALID);
+    config.read_len = I2C_BUS_DATA_MAX + 1;
+    CHECK(i2c_bus_manager_add(&mgr, &config, &id) == I2C_BUS_ERR_INVALID);
+    for (uint8_t i = 2; i < I2C_BUS_MAX_DEVICES; i++) {
+        add_device(&mgr, &mock, 0x60 + i, FAST_HZ, 10000, &logs[i]);
+    }
+    config.read_len = 2;
+    CHECK(i2c_bus_manager_add(&mgr, &config, &id) == I2C_BUS_ERR_FULL);
+}
+
+// Scheduler time per transaction with a full table at mixed clocks
+static double bench_run(void)
+{
+    static i2c_bus_manager_t mgr;
+    static i2c_bus_mock_t mock;
+    static read_log_t logs[I2C_BUS_MAX_DEVICES];
+    const uint32_t periods[] = {10000, 20000, 50000, 100000};
+    unsigned long transactions;
+    double start;
+    double elapsed;
+
+    i2c_bus_mock_init(&mock, SWITCH_US);
+    i2c_bus_manager_init(&mgr, &i2c_bus_mock_backend, &mock, BATCH_WINDOW_US);
+    for (uint8_t i = 0; i < I2C_BUS_MAX_DEVICES; i++) {
+        add_device(&mgr,
+                   &mock,
+                   0x40 + i,
+                   (i % 2) ? SLOW_HZ : FAST_HZ,
+                   periods[i % 4],
+                   &logs[i]);
+    }
+
+    start = now_s();
+    do {
+        simulate(&mgr, &mock, SIM_TIME_US);
+        elapsed = now_s() - start;
+    } while (elapsed < MIN_RUN_TIME_S);
+    transactions = mock.transactions;
+    print_stats("speed test schedule", &mgr);
+
+    return elapsed / (double)transactions;
+}
+
+// Monotonic time in seconds
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*******************************************************************************
+ * Main entrypoint
+ */
+
+int main(void)
+{
+    double per_transaction;
+
+    printf("i2c_bus_manager benchmark: %u bytes per manager (%d devices max)\n",
+           (unsigned int)sizeof(i2c_bus_manager_t), I2C_BUS_MAX_DEVICES);
+
+    // Schedules on the simulated bus
+    printf("  schedule (%d s simulated, %d us per SCL change)\n",
+           SIM_TIME_US / 1000000, SWITCH_US);
+    check_harmonic();
+    check_window();
+    check_clock_switches();
+    check_missed();
+    check_errors();
+
+    // Speed
+    printf("  speed (%d devices, 400 and 100 kHz)\n", I2C_BUS_MAX_DEVICES);
+    per_transaction = bench_run();
+    printf("    %-26s %7.1f ns/transaction  %6.2f M transactions/s\n",
+           "scheduler overhead",
+           per_transaction * 1e9,
+           1e-6 / per_transaction);
+
+    printf("  %s\n", s_failed ? "FAILED" : "all checks passed");
+
+    return s_failed;
+}
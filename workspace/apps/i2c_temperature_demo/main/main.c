@@ -1,28 +1,96 @@
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "driver/i2c_master.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "sensor_sampler.h"
+#include "tmp10x.h"
 
 // Settings
 static const i2c_port_num_t i2c_port = 0;           // -1 for auto-select
 static const gpio_num_t i2c_sda_pin = 5;            // GPIO number for SDA
 static const gpio_num_t i2c_scl_pin = 6;            // GPIO number for SCL
 static const uint8_t i2c_glitch_ignore_cnt = 7;     // 7 is typical
+static const size_t i2c_trans_queue_depth = 4;      // >0 for asynchronous transactions
+static const bool one_shot_mode = false;            // Sleep the sensor between readings
 static const uint16_t tmp10x_addr = 0x48;           // TMP102/105 I2C address
 static const uint32_t tmp10x_scl_speed_hz = 100000; // 100kHz (standard mode)
-static const uint32_t sleep_time_ms = 1000;
+static const uint32_t sample_rate_hz = 4;           // TMP10x converts at 4 Hz by default
+static const uint32_t one_shot_period_ms = 1000;    // Time between one-shot readings
+static const uint32_t stats_interval_ms = 10000;    // Print timing stats this often
 
 // Constants
 static const uint8_t tmp10x_reg_temp = 0x00;
 
+// Sampler with its ring buffer (too large for the stack)
+static sensor_sampler_t s_sampler;
+
+// Print a temperature with its timestamp
+static void print_temp(int64_t timestamp_us, int16_t temp)
+{
+    long temp_mc;
+
+    // Convert to m deg C (no fraction lost)
+    temp_mc = (long)tmp10x_to_milli_c(temp);
+
+    printf("[%lld us] Temperature: %s%ld.%03ld deg C\r\n",
+           timestamp_us,
+           (temp_mc < 0) ? "-" : "",
+           labs(temp_mc) / 1000,
+           labs(temp_mc) % 1000);
+}
+
+// Keep the sensor in shutdown and wake it for one conversion per reading
+static void run_one_shot(i2c_master_dev_handle_t dev)
+{
+    esp_err_t esp_ret;
+    tmp10x_t tmp;
+    int16_t temp;
+    int64_t timestamp_us;
+    TickType_t last_wake;
+
+    // Put the sensor in shutdown (12-bit mode)
+    tmp10x_config_t tmp_config = {
+        .rate = TMP10X_RATE_4HZ,
+        .extended = false,
+        .shutdown = true,
+    };
+    esp_ret = tmp10x_init(&tmp, dev, &tmp_config);
+    if (esp_ret != ESP_OK) {
+        printf("Error (%d): Failed to configure TMP10x\r\n", esp_ret);
+        abort();
+    }
+
+    // Superloop
+    last_wake = xTaskGetTickCount();
+    while (1) {
+
+        // Convert once and read the result
+        timestamp_us = esp_timer_get_time();
+        esp_ret = tmp10x_read_one_shot(&tmp, 1, &temp);
+        if (esp_ret != ESP_OK) {
+            printf("Error (%d): Failed to read temperature\r\n", esp_ret);
+        } else {
+            print_temp(timestamp_us, temp);
+        }
+
+        // The sensor draws almost nothing until the next reading
+        xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(one_shot_period_ms));
+    }
+}
+
 void app_main(void)
 {
     esp_err_t esp_ret;
     i2c_master_bus_handle_t i2c_bus;
     i2c_master_dev_handle_t tmp10x_dev;
-    uint8_t reg;
-    uint8_t data[2];
-    int16_t temperature;
+    sensor_sample_t sample;
+    sensor_sampler_stats_t stats;
+    int64_t last_stats_us;
 
     // Set I2C bus configuration
     i2c_master_bus_config_t bus_config = {
@@ -31,6 +99,7 @@ void app_main(void)
         .scl_io_num = i2c_scl_pin,
         .clk_source = I2C_CLK_SRC_DEFAULT,
         .glitch_ignore_cnt = i2c_glitch_ignore_cnt,
+        .trans_queue_depth = one_shot_mode ? 0 : i2c_trans_queue_depth,
         .flags.enable_internal_pullup = true,
     };
 
@@ -55,28 +124,64 @@ void app_main(void)
         abort();
     }
 
+    // One-shot readings use blocking transactions (synchronous bus)
+    if (one_shot_mode) {
+        run_one_shot(tmp10x_dev);
+    }
+
+    // Read the temperature register at a fixed rate in the background
+    sensor_sampler_config_t sampler_config = {
+        .dev = tmp10x_dev,
+        .reg = { tmp10x_reg_temp },
+        .reg_len = 1,
+        .read_len = 2,
+        .scl_speed_hz = tmp10x_scl_speed_hz,
+        .rate_hz = sample_rate_hz,
+        .consumer = xTaskGetCurrentTaskHandle(),
+    };
+    esp_ret = sensor_sampler_start(&s_sampler, &sampler_config);
+    if (esp_ret != ESP_OK) {
+        printf("Error: Failed to start sampler\r\n");
+        abort();
+    }
+    last_stats_us = esp_timer_get_time();
+
     // Superloop
     while (1) {
 
-        // Delay
-        vTaskDelay(sleep_time_ms / portTICK_PERIOD_MS);
+        // Wait for the sampler to push a sample
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(stats_interval_ms));
 
-        // Store register address in buffer
-        reg = tmp10x_reg_temp;
+        // Handle every sample waiting in the ring
+        while (sensor_sampler_read(&s_sampler, &sample)) {
+            if (sample.err != ESP_OK) {
+                printf("Error: Failed to read temperature (sample %lu)\r\n",
+                       (unsigned long)sample.seq);
+                continue;
+            }
 
-        // Read temperature
-        esp_ret = i2c_master_transmit_receive(tmp10x_dev, &reg, 1, data, 2, -1);
-        if (esp_ret != ESP_OK) {
-            printf("Error: Failed to read temperature\r\n");
-            continue;
+            // Convert data to temperature and print it
+            print_temp(sample.timestamp_us, tmp10x_decode(sample.data));
         }
 
-        // Convert data to temperature (deg C)
-        temperature = (data[0] << 8) | data[1];
-        temperature >>= 4;
-        temperature *= 0.0625;
-
-        // Print temperature
-        printf("Temperature: %d deg C\r\n", temperature);
+        // Print sample timing
+        if ((esp_timer_get_time() - last_stats_us) >= (int64_t)stats_interval_ms * 1000) {
+            last_stats_us = esp_timer_get_time();
+            sensor_sampler_get_stats(&s_sampler, &stats);
+            printf("Samples: %lu, errors: %lu, overruns: %lu, dropped: %lu\r\n",
+                   (unsigned long)stats.samples,
+                   (unsigned long)stats.errors,
+                   (unsigned long)stats.overruns,
+                   (unsigned long)stats.dropped);
+            printf("Jitter: min %ld us, max %ld us, mean %ld us, stddev %lu us\r\n",
+                   (long)stats.jitter_min_us,
+                   (long)stats.jitter_max_us,
+                   (long)stats.jitter_mean_us,
+                   (unsigned long)stats.jitter_stddev_us);
+            printf("Bus time: min %lu us, max %lu us, mean %lu us\r\n",
+                   (unsigned long)stats.latency_min_us,
+                   (unsigned long)stats.latency_max_us,
+                   (unsigned long)stats.latency_mean_us);
+        }
     }
-}
\ No newline at end of file
+}
@@ -5,17 +5,28 @@
 
  #include <string.h>
  #include "esp_log.h"
+ #include "esp_timer.h"
  #include "esp_netif.h"
  #include "mqtt_client.h"
  #include "nvs_flash.h"
+#include "lwip/netdb.h"
 
  #include "network_wrapper.h"
+#include "mqtt_publisher.h"
+#include "telemetry_codec.h"
+#if CONFIG_FLASH_QUEUE
+#include "flash_queue.h"
+#endif
+#if CONFIG_REPORT_FILTER
+#include "report_filter.h"
+#endif
 
  // Tag for debug messages
 static const char *TAG = "mqtt_demo";
 
 // Network settings
 #define CONNECTION_TIMEOUT_SEC  10  // Delay to wait for connection (sec)
+#define NETWORK_QUEUE_LEN       8   // Network state transitions kept queued
 
 // MQTT settings
 #if CONFIG_WIFI_STA_CONNECT
@@ -28,13 +39,275 @@ static const char *TAG = "mqtt_demo";
 #define MQTT_PASSWORD           "mosquitto"
 #define MQTT_QOS                2               // Quality of Service (0, 1, 2)
 #define MQTT_TOPIC         "my_topic/sensor_data"
-#define MQTT_MSG           "{\"temperature\": 25.0, \"humidity\": 50.0}"
+
+// Publish settings
+#define PUBLISH_INTERVAL_MS     CONFIG_MQTT_MOSQUITTO_DEMO_PUBLISH_INTERVAL_MS
+#define PUBLISH_TIMEOUT_MS      1000    // Max wait for a free in-flight slot
+#define STATS_INTERVAL_MS       5000    // How often to print publisher stats
+
+// Payload settings (CBOR is opt-in: subscribers must decode it)
+#if CONFIG_MQTT_MOSQUITTO_DEMO_PAYLOAD_CBOR
+#define PAYLOAD_FORMAT          TELEMETRY_FORMAT_CBOR
+#else
+#define PAYLOAD_FORMAT          TELEMETRY_FORMAT_JSON
+#endif
+#define PAYLOAD_MAX_SIZE        64
+
+// Placeholder readings until a sensor is wired up
+#define TEMP_READING            25.0f   // deg C
+#define HUMIDITY_READING        50.0f   // %RH
+
+#if CONFIG_REPORT_FILTER
+// Report-by-exception settings: a reading is taken every PUBLISH_INTERVAL_MS
+// but only published when it moves out of the deadband or the heartbeat is
+// due
+#define REPORT_HEARTBEAT_US     (5 * 60 * 1000000UL)    // Publish at least every 5 min
+#define REPORT_KEYFRAME_EVERY   16          // Delta messages between full values
+#define TEMP_DEADBAND           0.25f       // deg C
+#define TEMP_RESOLUTION         0.0625f     // deg C per delta step (TMP102 LSB)
+#define HUMIDITY_DEADBAND       1.0f        // %RH
+#define HUMIDITY_RESOLUTION     0.5f        // %RH per delta step
+#endif
+
+// Store-and-forward settings
+#define QUEUE_DRAIN_MAX         20      // Max queued messages sent per loop
+#define QUEUE_MIN_INTERVAL_MS   5000    // Store at most one reading per period
 
 // Event group bits
 #define MQTT_CONNECTED_BIT      BIT0
+#if CONFIG_REPORT_FILTER
+#define MQTT_RESYNC_BIT         BIT1    // Next message must be a keyframe
+#endif
 
 // Static global variables
 static EventGroupHandle_t s_mqtt_event_group = NULL;
+static QueueHandle_t s_network_queue = NULL;
+static bool s_network_up = false;
+#if CONFIG_FLASH_QUEUE
+static int64_t s_last_queued_us = 0;    // When a reading was last stored
+#endif
+#if CONFIG_REPORT_FILTER
+static report_filter_t s_report_filter;
+static uint8_t s_temp_channel;
+static uint8_t s_humidity_channel;
+#endif
+
+#if CONFIG_FLASH_QUEUE
+// Publish one message from the flash queue (called by flash_queue_drain())
+static esp_err_t publish_queued(const uint8_t *data,
+                                size_t len,
+                                int *id,
+                                void *ctx)
+{
+    // Stop draining if the broker went away
+    if (!(xEventGroupGetBits(s_mqtt_event_group) & MQTT_CONNECTED_BIT)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Hand message to the publisher (stop draining when the window is full).
+    // It stays in flash until the PUBACK/PUBCOMP for its msg_id arrives.
+    return mqtt_publisher_publish(MQTT_TOPIC, data, len, MQTT_QOS, 0, 0, id);
+}
+
+// Publish a message, or store it in flash while the broker is unreachable.
+// With len 0, only send the backlog. Return false if the message was lost.
+static bool publish_or_queue(const uint8_t *msg, size_t len)
+{
+    esp_err_t esp_ret;
+    bool connected;
+    size_t sent = 0;
+    int64_t now_us;
+    flash_queue_stats_t stats;
+
+    connected = xEventGroupGetBits(s_mqtt_event_group) & MQTT_CONNECTED_BIT;
+
+    // Send the backlog first (a few per loop) so messages stay in order. Also
+    // called with an empty queue to commit acks and compact once they are in.
+    if (connected) {
+        esp_ret = flash_queue_drain(QUEUE_DRAIN_MAX, publish_queued, NULL, &sent);
+        if ((esp_ret != ESP_OK) && (esp_ret != ESP_ERR_TIMEOUT)) {
+            ESP_LOGW(TAG, "Error (%d): Flash queue drain stopped", esp_ret);
+        }
+        if (sent > 0) {
+            ESP_LOGI(TAG, "Sent %u queued messages, %lu left",
+                     (unsigned int)sent, flash_queue_count());
+        }
+
+        // Report flash usage once the backlog is gone
+        if ((sent > 0) && (flash_queue_count() == 0)) {
+            flash_queue_get_stats(&stats);
+            ESP_LOGI(TAG, "Flash queue: %lu queued, %lu dropped, %lu erases, "
+                     "write amplification %.2f",
+                     stats.pushed,
+                     stats.dropped,
+                     stats.erases,
+                     (stats.payload_bytes > 0) ?
+                        (float)stats.flash_bytes / stats.payload_bytes : 0.0f);
+        }
+    }
+
+    // Nothing new to send
+    if (len == 0) {
+        return true;
+    }
+
+    // Publish directly only if nothing is waiting ahead of this message
+    esp_ret = ESP_FAIL;
+    if (connected && (flash_queue_count() == 0)) {
+        esp_ret = mqtt_publisher_publish(MQTT_TOPIC,
+                                         msg,
+                                         len,
+                                         MQTT_QOS,
+                                         0,
+                                         PUBLISH_TIMEOUT_MS,
+                                         NULL);
+        if (esp_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error (%d): Failed to publish message", esp_ret);
+        }
+    }
+    if (esp_ret == ESP_OK) {
+        return true;
+    }
+
+    // Otherwise keep it in flash until the broker is reachable again, but
+    // only one reading per period so a long outage doesn't cycle the whole
+    // partition (and its erase budget) in seconds
+    now_us = esp_timer_get_time();
+    if ((s_last_queued_us != 0) &&
+        (now_us - s_last_queued_us < QUEUE_MIN_INTERVAL_MS * 1000LL)) {
+        return false;
+    }
+    esp_ret = flash_queue_push(msg, len);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to queue message", esp_ret);
+        return false;
+    }
+    s_last_queued_us = now_us;
+    ESP_LOGD(TAG, "Queued message in flash (%lu waiting)",
+             flash_queue_count());
+
+    return true;
+}
+#endif
+
+// Print throughput, window use, and acknowledgement latency, then reset
+static void log_publisher_stats(uint32_t interval_ms)
+{
+    mqtt_publisher_stats_t stats;
+    char hist[MQTT_PUBLISHER_HIST_BUCKETS * 8];
+    int len = 0;
+
+    mqtt_publisher_get_stats(&stats);
+    mqtt_publisher_reset_stats();
+
+    ESP_LOGI(TAG, "Published %lu, acked %lu (%.1f msg/s), failed %lu, "
+             "window full %lu, timeouts %lu, expired %lu",
+             stats.published,
+             stats.acked,
+             (float)stats.acked * 1000.0f / (float)interval_ms,
+             stats.failed,
+             stats.window_full,
+             stats.timeouts,
+             stats.expired);
+    if (stats.acked == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "In flight %lu (max %lu), latency min/avg/max: "
+             "%.1f/%.1f/%.1f ms",
+             stats.in_flight,
+             stats.max_in_flight,
+             stats.latency_min_us / 1000.0f,
+             (float)(stats.latency_sum_us / stats.acked) / 1000.0f,
+             stats.latency_max_us / 1000.0f);
+
+    // Histogram: <1 ms, <2 ms, <4 ms, ...
+    for (int i = 0; i < MQTT_PUBLISHER_HIST_BUCKETS; i++) {
+        len += snprintf(&hist[len], sizeof(hist) - len, " %lu",
+                        stats.latency_hist[i]);
+    }
+    ESP_LOGI(TAG, "Latency histogram (<1, <2, <4 ... ms):%s", hist);
+}
+
+// Encode a sensor reading into buf, return its length (0 if there is
+// nothing to send or on error)
+static size_t encode_reading(uint8_t *buf, size_t size)
+{
+    telemetry_encoder_t enc;
+    size_t len;
+#if CONFIG_REPORT_FILTER
+    int64_t now_us;
+
+    // Start the receiver over with full values after a reconnect or loss
+    if (xEventGroupClearBits(s_mqtt_event_group, MQTT_RESYNC_BIT) & MQTT_RESYNC_BIT) {
+        report_filter_force_keyframe(&s_report_filter);
+    }
+
+    // Skip readings the broker does not need
+    now_us = esp_timer_get_time();
+    report_filter_set(&s_report_filter, s_temp_channel, TEMP_READING);
+    report_filter_set(&s_report_filter, s_humidity_channel, HUMIDITY_READING);
+    if (report_filter_check(&s_report_filter, now_us) == REPORT_FILTER_SKIP) {
+        return 0;
+    }
+
+    // Full values or deltas
+    telemetry_encoder_init(&enc, PAYLOAD_FORMAT, buf, size);
+    report_filter_encode(&s_report_filter, &enc, now_us);
+#else
+    telemetry_encoder_init(&enc, PAYLOAD_FORMAT, buf, size);
+    telemetry_encode_float(&enc, "temperature", TEMP_READING);
+    telemetry_encode_float(&enc, "humidity", HUMIDITY_READING);
+#endif
+    if (telemetry_encoder_finish(&enc, &len) != TELEMETRY_OK) {
+        ESP_LOGE(TAG, "Payload does not fit in %u bytes", (unsigned int)size);
+#if CONFIG_REPORT_FILTER
+        report_filter_force_keyframe(&s_report_filter);
+#endif
+        return 0;
+    }
+
+    return len;
+}
+
+// Print the fields of a received payload
+static void log_payload(const char *data, int len)
+{
+    telemetry_decoder_t dec;
+    telemetry_field_t field;
+    telemetry_result_t ret;
+
+    ret = telemetry_decoder_init(&dec,
+                                 PAYLOAD_FORMAT,
+                                 (const uint8_t *)data,
+                                 (size_t)len);
+    while ((ret == TELEMETRY_OK) &&
+           ((ret = telemetry_decoder_next(&dec, &field)) == TELEMETRY_OK)) {
+        switch (field.type) {
+            case TELEMETRY_TYPE_INT:
+                ESP_LOGD(TAG, "  %.*s: %lld", (int)field.key_len, field.key,
+                         (long long)field.value.i);
+                break;
+            case TELEMETRY_TYPE_FLOAT:
+                ESP_LOGD(TAG, "  %.*s: %.2f", (int)field.key_len, field.key,
+                         field.value.f);
+                break;
+            case TELEMETRY_TYPE_BOOL:
+                ESP_LOGD(TAG, "  %.*s: %s", (int)field.key_len, field.key,
+                         field.value.b ? "true" : "false");
+                break;
+            case TELEMETRY_TYPE_STRING:
+                ESP_LOGD(TAG, "  %.*s: %.*s", (int)field.key_len, field.key,
+                         (int)field.value.str.len, field.value.str.ptr);
+                break;
+            default:
+                ESP_LOGD(TAG, "  %.*s: null", (int)field.key_len, field.key);
+                break;
+        }
+    }
+    if (ret != TELEMETRY_END) {
+        ESP_LOGW(TAG, "  Could not decode payload (%d)", ret);
+    }
+}
 
 // MQTT event handler
 static void mqtt_event_handler(void *handler_args, 
@@ -44,6 +317,9 @@ static void mqtt_event_handler(void *handler_args,
 {
     esp_mqtt_event_handle_t event = event_data;
 
+    // Match acknowledgements to in-flight messages
+    mqtt_publisher_on_event(event);
+
     // Determine event type
     switch ((esp_mqtt_event_id_t)event_id) {
 
@@ -64,6 +340,10 @@ static void mqtt_event_handler(void *handler_args,
         // Connected to MQTT broker
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "Connected to MQTT broker");
+#if CONFIG_REPORT_FILTER
+            // Messages may have been lost while disconnected
+            xEventGroupSetBits(s_mqtt_event_group, MQTT_RESYNC_BIT);
+#endif
             xEventGroupSetBits(s_mqtt_event_group, MQTT_CONNECTED_BIT);
             break;
 
@@ -85,14 +365,33 @@ static void mqtt_event_handler(void *handler_args,
 
         // Published message to broker
         case MQTT_EVENT_PUBLISHED:
-            ESP_LOGI(TAG, "Published message to broker");
+            ESP_LOGD(TAG, "Published message to broker (msg_id=%d)",
+                     event->msg_id);
+#if CONFIG_FLASH_QUEUE
+            flash_queue_ack(event->msg_id);
+#endif
+            break;
+
+        // Message dropped from the outbox before it was acknowledged
+        case MQTT_EVENT_DELETED:
+            ESP_LOGW(TAG, "Message expired (msg_id=%d)", event->msg_id);
+#if CONFIG_REPORT_FILTER
+            // The receiver can't apply later deltas without it
+            xEventGroupSetBits(s_mqtt_event_group, MQTT_RESYNC_BIT);
+#endif
+#if CONFIG_FLASH_QUEUE
+            // Queued messages still waiting may have gone with it: resend
+            if (flash_queue_in_flight() > 0) {
+                flash_queue_rewind();
+            }
+#endif
             break;
 
         // Received message from broker
         case MQTT_EVENT_DATA:
-            ESP_LOGI(TAG, "Received message from broker");
-            ESP_LOGI(TAG, "  Topic: %.*s", event->topic_len, event->topic);
-            ESP_LOGI(TAG, "  Data: %.*s", event->data_len, event->data);
+            ESP_LOGD(TAG, "Received message from broker");
+            ESP_LOGD(TAG, "  Topic: %.*s", event->topic_len, event->topic);
+            log_payload(event->data, event->data_len);
             break;
 
         // Before connecting to MQTT broker
@@ -107,12 +406,62 @@ static void mqtt_event_handler(void *handler_args,
     }
 }
 
+// Apply queued network state transitions, blocking up to wait_ticks for one
+static void process_network_events(TickType_t wait_ticks)
+{
+    network_event_t event;
+
+    while (xQueueReceive(s_network_queue, &event, wait_ticks) == pdTRUE) {
+        switch (event.type) {
+            case NETWORK_EVENT_LINK_DOWN:
+                ESP_LOGW(TAG, "Network link down (reason %d)%s",
+                         event.reason,
+                         event.reconnecting ? ", driver reconnecting" : "");
+                break;
+            case NETWORK_EVENT_IP_ACQUIRED:
+                ESP_LOGI(TAG, "Network up (%s)",
+                         (event.family == AF_INET6) ? "IPv6" : "IPv4");
+                break;
+            default:
+                ESP_LOGI(TAG, "Network event: %s", network_event_name(event.type));
+                break;
+        }
+        s_network_up = network_is_up();
+
+        // Only block for the first event, then drain the rest
+        wait_ticks = 0;
+    }
+}
+
+// Block until the network is (up) or is not (!up) usable, or timeout
+static bool wait_network_state(bool up, uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    TickType_t elapsed;
+
+    while (s_network_up != up) {
+        elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            return false;
+        }
+        process_network_events(timeout - elapsed);
+    }
+
+    return true;
+}
+
 // Main app entrypoint
 void app_main(void)
 {
     esp_err_t esp_ret;
     int msg_id;
     EventGroupHandle_t network_event_group;
+    network_subscriber_handle_t network_sub;
+    uint8_t payload[PAYLOAD_MAX_SIZE];
+    size_t payload_len;
+    bool delivered;
+    int64_t stats_time_us;
 
     // Welcome message (after delay to allow serial connection)
     vTaskDelay(2000 / portTICK_PERIOD_MS);
@@ -138,6 +487,15 @@ void app_main(void)
         abort();
     }
 
+#if CONFIG_FLASH_QUEUE
+    // Mount store-and-forward queue (messages left from last boot are kept)
+    esp_ret = flash_queue_init();
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize flash queue (%d)", esp_ret);
+        abort();
+    }
+#endif
+
     // Initialize TCP/IP network interface (only call once in application)
     // Must be called prior to initializing the network driver!
     esp_ret = esp_netif_init();
@@ -154,6 +512,18 @@ void app_main(void)
         abort();
     }
 
+    // Get network state transitions on a queue instead of polling bits
+    s_network_queue = xQueueCreate(NETWORK_QUEUE_LEN, sizeof(network_event_t));
+    if (s_network_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create network event queue");
+        abort();
+    }
+    esp_ret = network_subscribe_queue(s_network_queue, &network_sub);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to subscribe to network events", esp_ret);
+        abort();
+    }
+
     // Initialize network connection
     esp_ret = network_init(network_event_group);
     if (esp_ret != ESP_OK) {
@@ -162,12 +532,11 @@ void app_main(void)
     }
 
     // Make sure network is connected and device has an IP address
-    while (!wait_for_network(network_event_group, CONNECTION_TIMEOUT_SEC)) {
+    while (!wait_network_state(true, CONNECTION_TIMEOUT_SEC * 1000)) {
         ESP_LOGE(TAG, "Failed to connect to WiFi. Reconnecting...");
         esp_ret = network_reconnect();
         if (esp_ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to reconnect WiFi (%d)", esp_ret);
-            abort();
+            ESP_LOGE(TAG, "Failed to reconnect WiFi (%d), will retry", esp_ret);
         }
     }
 
@@ -183,6 +552,14 @@ void app_main(void)
     // Initialize MQTT client
     esp_mqtt_client_handle_t mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
 
+    // Track acknowledgements of the messages we publish
+    esp_ret = mqtt_publisher_init(mqtt_client);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize MQTT publisher (%d)", esp_ret);
+        ESP_ERROR_CHECK(esp_mqtt_client_destroy(mqtt_client));
+        abort();
+    }
+
     // Register event handler
     esp_ret = esp_mqtt_client_register_event(mqtt_client,
                                              ESP_EVENT_ANY_ID, 
@@ -202,10 +579,10 @@ void app_main(void)
         abort();
     }
 
-    // Wait for MQTT client to connect (blocking)
+    // Wait for MQTT client to connect (blocking, leave bit set to track state)
     xEventGroupWaitBits(s_mqtt_event_group, 
                         MQTT_CONNECTED_BIT, 
-                        pdTRUE, 
+                        pdFALSE, 
                         pdTRUE, 
                         portMAX_DELAY);
 
@@ -219,21 +596,78 @@ void app_main(void)
         abort();
     }
 
+#if CONFIG_REPORT_FILTER
+    // Publish the readings by exception
+    report_filter_init(&s_report_filter, REPORT_HEARTBEAT_US, REPORT_KEYFRAME_EVERY);
+    report_filter_channel_config_t temp_config = {
+        .key = "temperature",
+        .deadband = TEMP_DEADBAND,
+        .resolution = TEMP_RESOLUTION,
+    };
+    report_filter_channel_config_t humidity_config = {
+        .key = "humidity",
+        .deadband = HUMIDITY_DEADBAND,
+        .resolution = HUMIDITY_RESOLUTION,
+    };
+    if ((report_filter_add_channel(&s_report_filter, 
+                                   &temp_config, 
+                                   &s_temp_channel) != TELEMETRY_OK) ||
+        (report_filter_add_channel(&s_report_filter, 
+                                   &humidity_config, 
+                                   &s_humidity_channel) != TELEMETRY_OK)) {
+        ESP_LOGE(TAG, "Error: Could not add report filter channels");
+        abort();
+    }
+#endif
+
     // Main loop
+    stats_time_us = esp_timer_get_time();
     while (1) {
 
-        // Publish message to MQTT broker
-        msg_id = esp_mqtt_client_publish(mqtt_client, 
-                                         MQTT_TOPIC, 
-                                         MQTT_MSG, 
-                                         0,         // Length (0 = auto detect)
-                                         MQTT_QOS,  // QoS
-                                         0);        // Retain
-        if (msg_id < 0) {
-            ESP_LOGE(TAG, "Error (%d): Failed to publish message", msg_id);
+        // Log network state transitions (the MQTT client reconnects itself)
+        process_network_events(0);
+
+        // Encode sensor reading (length 0 if the filter skipped it)
+        payload_len = encode_reading(payload, sizeof(payload));
+
+#if CONFIG_FLASH_QUEUE
+        // Publish message to MQTT broker (or queue it while offline). The
+        // backlog is sent even when there is no new message.
+        delivered = publish_or_queue(payload, payload_len);
+#else
+        // Publish message to MQTT broker (blocks while the window is full)
+        delivered = true;
+        if (payload_len > 0) {
+            esp_ret = mqtt_publisher_publish(MQTT_TOPIC,
+                                             payload,
+                                             payload_len,
+                                             MQTT_QOS,
+                                             0,
+                                             PUBLISH_TIMEOUT_MS,
+                                             NULL);
+            if (esp_ret != ESP_OK) {
+                ESP_LOGE(TAG, "Error (%d): Failed to publish message", esp_ret);
+                delivered = false;
+            }
+        }
+#endif
+
+#if CONFIG_REPORT_FILTER
+        // A lost message breaks the chain of deltas: send full values next
+        if (!delivered) {
+            report_filter_force_keyframe(&s_report_filter);
+        }
+#else
+        (void)delivered;
+#endif
+
+        // Report throughput and latency periodically
+        if (esp_timer_get_time() - stats_time_us >= STATS_INTERVAL_MS * 1000LL) {
+            log_publisher_stats(STATS_INTERVAL_MS);
+            stats_time_us = esp_timer_get_time();
         }
 
         // Wait before publishing another message
-        vTaskDelay(5000 / portTICK_PERIOD_MS);
+        vTaskDelay(PUBLISH_INTERVAL_MS / portTICK_PERIOD_MS);
     }
 }
\ No newline at end of file
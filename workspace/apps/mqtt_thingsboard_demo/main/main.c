@@ -1,13 +1,26 @@
 #include <string.h>
 #include "esp_log.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
 #include "mqtt_client.h"
-#include "nvs_flash.h"
 
 #include "network_wrapper.h"
+#include "telemetry_codec.h"
+#if CONFIG_FLASH_QUEUE
+#include "flash_queue.h"
+#endif
+#if CONFIG_STREAM_STATS
+#include "stream_stats.h"
+#endif
+#if CONFIG_REPORT_FILTER
+#include "report_filter.h"
+#endif
 
 // Settings
 static const uint32_t sleep_time_ms = 5000;
+#if CONFIG_STREAM_STATS
+static const uint32_t sample_time_ms = 500;     // Readings per message: 10
+#endif
 #define CONNECTION_TIMEOUT_SEC  10
 
 // MQTT settings
@@ -17,16 +30,212 @@ static const uint32_t sleep_time_ms = 5000;
 #define MQTT_PASSWORD           ""
 #define MQTT_PUB_QOS            1   // Quality of Service (0, 1, 2)
 #define MQTT_PUB_TOPIC          "v1/devices/me/telemetry"
-#define MQTT_MSG                "{\"temp\": 25}"
+
+// Payload settings (ThingsBoard's telemetry topic expects JSON)
+#if CONFIG_STREAM_STATS
+#define PAYLOAD_MAX_SIZE        192 // Summary of readings since the last message
+#else
+#define PAYLOAD_MAX_SIZE        64
+#endif
+
+// Placeholder reading until a sensor is wired up
+#define TEMP_READING            25.0f   // deg C
+
+#if CONFIG_REPORT_FILTER
+// Report-by-exception settings: a message is only published when the
+// temperature moves out of the deadband or the heartbeat is due. Full values
+// only, since ThingsBoard stores each key as its own time series.
+#define REPORT_HEARTBEAT_US     (5 * 60 * 1000000UL)    // Publish at least every 5 min
+#define TEMP_DEADBAND           0.25f   // deg C
+#endif
+
+// Store-and-forward settings
+#define QUEUE_DRAIN_MAX         20  // Max queued messages sent per loop
 
 // Event group bits
 #define MQTT_CONNECTED_BIT      BIT0
+#if CONFIG_REPORT_FILTER
+#define MQTT_RESYNC_BIT         BIT1    // Resend the latest value
+#endif
 
 // Tag for debug messages
 static const char *TAG = "mqtt_thingsboard_demo";
 
 // Static global variables
 static EventGroupHandle_t s_mqtt_event_group = NULL;
+static int64_t s_first_publish_us = 0;  // Time since boot, 0 until it happens
+#if CONFIG_STREAM_STATS
+static stream_stats_t s_temp_stats;     // Readings since the last message
+static const float s_temp_quantiles[] = {0.5f, 0.9f};
+#endif
+#if CONFIG_REPORT_FILTER
+static report_filter_t s_report_filter;
+static uint8_t s_temp_channel;
+#endif
+
+#if CONFIG_FLASH_QUEUE
+// Publish one message from the flash queue (called by flash_queue_drain())
+static esp_err_t publish_queued(const uint8_t *data,
+                               size_t len,
+                               int *id,
+                               void *ctx)
+{
+   esp_mqtt_client_handle_t mqtt_client = (esp_mqtt_client_handle_t)ctx;
+   int msg_id;
+
+   // Stop draining if the broker went away
+   if (!(xEventGroupGetBits(s_mqtt_event_group) & MQTT_CONNECTED_BIT)) {
+       return ESP_ERR_INVALID_STATE;
+   }
+
+   // Hand message to the MQTT client
+   msg_id = esp_mqtt_client_publish(mqtt_client,
+                                    MQTT_PUB_TOPIC,
+                                    (const char *)data,
+                                    (int)len,
+                                    MQTT_PUB_QOS,
+                                    0);
+   if (msg_id < 0) {
+       ESP_LOGE(TAG, "Error (%d): Failed to publish queued message", msg_id);
+       return ESP_FAIL;
+   }
+
+   // Keep it in flash until the PUBACK for this msg_id arrives
+   *id = msg_id;
+
+   return ESP_OK;
+}
+
+// Publish a message, or store it in flash while the broker is unreachable.
+// With an empty message, only send the backlog. Return false if the message
+// was lost.
+static bool publish_or_queue(esp_mqtt_client_handle_t mqtt_client,
+                            const char *msg)
+{
+   esp_err_t esp_ret;
+   bool connected;
+   size_t sent = 0;
+   int msg_id = -1;
+   flash_queue_stats_t stats;
+
+   connected = xEventGroupGetBits(s_mqtt_event_group) & MQTT_CONNECTED_BIT;
+
+   // Send the backlog first (a few per loop) so messages stay in order. Also
+   // called with an empty queue to commit acks and compact once they are in.
+   if (connected) {
+       esp_ret = flash_queue_drain(QUEUE_DRAIN_MAX, publish_queued, mqtt_client, &sent);
+       if ((esp_ret != ESP_OK) && (esp_ret != ESP_FAIL)) {
+           ESP_LOGW(TAG, "Error (%d): Flash queue drain stopped", esp_ret);
+       }
+       if (sent > 0) {
+           ESP_LOGI(TAG, "Sent %u queued messages, %lu left",
+                    (unsigned int)sent, flash_queue_count());
+       }
+
+       // Report flash usage once the backlog is gone
+       if ((sent > 0) && (flash_queue_count() == 0)) {
+           flash_queue_get_stats(&stats);
+           ESP_LOGI(TAG, "Flash queue: %lu queued, %lu dropped, %lu erases, "
+                    "write amplification %.2f",
+                    stats.pushed,
+                    stats.dropped,
+                    stats.erases,
+                    (stats.payload_bytes > 0) ?
+                       (float)stats.flash_bytes / stats.payload_bytes : 0.0f);
+       }
+   }
+
+   // Nothing new to send
+   if (msg[0] == '\0') {
+       return true;
+   }
+
+   // Publish directly only if nothing is waiting ahead of this message
+   if (connected && (flash_queue_count() == 0)) {
+       ESP_LOGI(TAG, "Publishing message: %s", msg);
+       msg_id = esp_mqtt_client_publish(mqtt_client,
+                                        MQTT_PUB_TOPIC,
+                                        msg,
+                                        0,              // Length (0 = auto detect)
+                                        MQTT_PUB_QOS,   // QoS
+                                        0);             // Retain
+       if (msg_id < 0) {
+           ESP_LOGE(TAG, "Error (%d): Failed to publish message", msg_id);
+       }
+   }
+
+   // Otherwise keep it in flash until the broker is reachable again
+   if (msg_id < 0) {
+       esp_ret = flash_queue_push(msg, strlen(msg));
+       if (esp_ret != ESP_OK) {
+           ESP_LOGE(TAG, "Error (%d): Failed to queue message", esp_ret);
+           return false;
+       }
+       ESP_LOGD(TAG, "Queued message in flash (%lu waiting)",
+                flash_queue_count());
+   }
+
+   return true;
+}
+#endif
+
+// Encode a sensor reading as a NUL-terminated JSON string (empty if there
+// is nothing to send)
+static esp_err_t encode_reading(char *buf, size_t size)
+{
+   telemetry_encoder_t enc;
+   size_t len;
+#if CONFIG_STREAM_STATS
+   stream_stats_summary_t summary;
+#endif
+#if CONFIG_REPORT_FILTER
+   int64_t now_us;
+
+   // Resend the latest value after a reconnect or loss
+   if (xEventGroupClearBits(s_mqtt_event_group, MQTT_RESYNC_BIT) & MQTT_RESYNC_BIT) {
+       report_filter_force_keyframe(&s_report_filter);
+   }
+
+   // Skip readings the broker does not need (the summary window keeps
+   // growing until one is sent)
+   now_us = esp_timer_get_time();
+#if CONFIG_STREAM_STATS
+   stream_stats_summarize(&s_temp_stats, &summary);
+   if (summary.count > 0) {
+       report_filter_set(&s_report_filter, s_temp_channel, summary.mean);
+   }
+#else
+   report_filter_set(&s_report_filter, s_temp_channel, TEMP_READING);
+#endif
+   if (report_filter_check(&s_report_filter, now_us) == REPORT_FILTER_SKIP) {
+       buf[0] = '\0';
+       return ESP_OK;
+   }
+#endif
+
+   telemetry_encoder_init(&enc, TELEMETRY_FORMAT_JSON, (uint8_t *)buf, size - 1);
+#if CONFIG_STREAM_STATS
+   // Summarize the readings taken since the last message and start over
+   stream_stats_close(&s_temp_stats, esp_timer_get_time(), &summary);
+   stream_stats_encode(&enc, "temp", &summary);
+#endif
+#if CONFIG_REPORT_FILTER
+   // Latest value ("temp", the window mean with summaries)
+   report_filter_encode(&s_report_filter, &enc, now_us);
+#elif !CONFIG_STREAM_STATS
+   telemetry_encode_int(&enc, "temp", (int32_t)TEMP_READING);
+#endif
+   if (telemetry_encoder_finish(&enc, &len) != TELEMETRY_OK) {
+       ESP_LOGE(TAG, "Payload does not fit in %u bytes", (unsigned int)size);
+#if CONFIG_REPORT_FILTER
+       report_filter_force_keyframe(&s_report_filter);
+#endif
+       return ESP_ERR_NO_MEM;
+   }
+   buf[len] = '\0';
+
+   return ESP_OK;
+}
 
 // MQTT event handler
 static void mqtt_event_handler(void *handler_args, 
@@ -50,6 +259,10 @@ static void mqtt_event_handler(void *handler_args,
        // Connected to MQTT broker
        case MQTT_EVENT_CONNECTED:
            ESP_LOGI(TAG, "Connected to MQTT broker");
+#if CONFIG_REPORT_FILTER
+           // Messages may have been lost while disconnected
+           xEventGroupSetBits(s_mqtt_event_group, MQTT_RESYNC_BIT);
+#endif
            xEventGroupSetBits(s_mqtt_event_group, MQTT_CONNECTED_BIT);
            break;
 
@@ -72,7 +285,31 @@ static void mqtt_event_handler(void *handler_args,
        // Published message to broker
        case MQTT_EVENT_PUBLISHED:
            ESP_LOGI(TAG, "Published message to broker");
+#if CONFIG_FLASH_QUEUE
+           flash_queue_ack(event->msg_id);
+#endif
+           if (s_first_publish_us == 0) {
+               s_first_publish_us = esp_timer_get_time();
+               ESP_LOGI(TAG, "Boot timing: first publish acknowledged at %lld ms",
+                        s_first_publish_us / 1000);
+           }
+           break;
+
+#if CONFIG_FLASH_QUEUE || CONFIG_REPORT_FILTER
+       // Message dropped from the outbox: resend queued messages still waiting
+       case MQTT_EVENT_DELETED:
+           ESP_LOGW(TAG, "Message expired (msg_id=%d)", event->msg_id);
+#if CONFIG_REPORT_FILTER
+           // It may have carried the latest value
+           xEventGroupSetBits(s_mqtt_event_group, MQTT_RESYNC_BIT);
+#endif
+#if CONFIG_FLASH_QUEUE
+           if (flash_queue_in_flight() > 0) {
+               flash_queue_rewind();
+           }
+#endif
            break;
+#endif
 
        // Received message from broker
        case MQTT_EVENT_DATA:
@@ -97,55 +334,63 @@ static void mqtt_event_handler(void *handler_args,
 void app_main(void)
 {
    esp_err_t esp_ret;
+#if !CONFIG_FLASH_QUEUE
    int msg_id;
+#endif
    EventGroupHandle_t network_event_group;
+   char payload[PAYLOAD_MAX_SIZE];
+   bool delivered;
+   bool mqtt_started = false;
+   int64_t first_sample_us = 0;
+   int64_t network_wait_us;
 
    // Initialize event groups
    network_event_group = xEventGroupCreate();
    s_mqtt_event_group = xEventGroupCreate();
 
-   // Initialize NVS (init once in app)
-   esp_ret = nvs_flash_init();
-   if ((esp_ret == ESP_ERR_NVS_NO_FREE_PAGES) ||
-       (esp_ret == ESP_ERR_NVS_NEW_VERSION_FOUND)) {
-       ESP_ERROR_CHECK(nvs_flash_erase());
-       esp_ret = nvs_flash_init();
-   }
-   if (esp_ret != ESP_OK) {
-       ESP_LOGE(TAG, "Error (%d): Could not initialize NVS", esp_ret);
-       abort();
-   }
-
-   // Initialize TCP/IP network interface (init once in app)
-   esp_ret = esp_netif_init();
+   // Bring up NVS, TCP/IP, the event loop, and the network in the background
+   // so sampling does not wait for the link
+   esp_ret = network_start(network_event_group);
    if (esp_ret != ESP_OK) {
-       ESP_LOGE(TAG, "Error (%d): Failed to initialize network interface", esp_ret);
+       ESP_LOGE(TAG, "Error (%d): Failed to start network", esp_ret);
        abort();
    }
-
-   // Create default event loop that runs in the background (init once in app)
-   esp_ret = esp_event_loop_create_default();
-   if (esp_ret != ESP_OK) {
-       ESP_LOGE(TAG, "Error (%d): Failed to create default event loop", esp_ret);
+   network_wait_us = esp_timer_get_time();
+
+#if CONFIG_STREAM_STATS
+   // Windows are closed by each message, not by time
+   stream_stats_init(&s_temp_stats,
+                     0,
+                     esp_timer_get_time(),
+                     s_temp_quantiles,
+                     sizeof(s_temp_quantiles) / sizeof(s_temp_quantiles[0]));
+   stream_stats_add(&s_temp_stats, TEMP_READING, esp_timer_get_time(), NULL);
+#endif
+
+#if CONFIG_REPORT_FILTER
+   // Publish the temperature by exception
+   report_filter_init(&s_report_filter, REPORT_HEARTBEAT_US, 0);
+   report_filter_channel_config_t temp_config = {
+       .key = "temp",
+       .deadband = TEMP_DEADBAND,
+       .resolution = 0.0f,
+   };
+   if (report_filter_add_channel(&s_report_filter, 
+                                 &temp_config, 
+                                 &s_temp_channel) != TELEMETRY_OK) {
+       ESP_LOGE(TAG, "Error: Could not add report filter channel");
        abort();
    }
+#endif
 
-   // Initialize network connection
-   esp_ret = network_init(network_event_group);
+#if CONFIG_FLASH_QUEUE
+   // Mount store-and-forward queue (messages left from last boot are kept)
+   esp_ret = flash_queue_init();
    if (esp_ret != ESP_OK) {
-       ESP_LOGE(TAG, "Error (%d): Failed to initialize network", esp_ret);
+       ESP_LOGE(TAG, "Error (%d): Could not initialize flash queue", esp_ret);
        abort();
    }
-
-   // Make sure network is connected and device has an IP address
-   while (!wait_for_network(network_event_group, CONNECTION_TIMEOUT_SEC)) {
-       ESP_LOGE(TAG, "Failed to connect to WiFi. Reconnecting...");
-       esp_ret = network_reconnect();
-       if (esp_ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to reconnect WiFi (%d)", esp_ret);
-            abort();
-       }
-   }
+#endif
 
    // Configure MQTT client
    esp_mqtt_client_config_t mqtt_cfg = {
@@ -156,7 +401,8 @@ void app_main(void)
        .credentials.authentication.password = MQTT_PASSWORD,
    };
 
-   // Initialize MQTT client
+   // Initialize MQTT client (QoS 1 messages published before it connects
+   // wait in its outbox)
    esp_mqtt_client_handle_t mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
 
    // Register event handler
@@ -170,39 +416,87 @@ void app_main(void)
        abort();
    }
 
-   // Start MQTT client
-   ESP_LOGI(TAG, "Connecting to MQTT server...");
-   esp_ret = esp_mqtt_client_start(mqtt_client);
-   if (esp_ret != ESP_OK) {
-       ESP_LOGE(TAG, "Error (%d): Failed to start MQTT client", esp_ret);
-       ESP_ERROR_CHECK(esp_mqtt_client_destroy(mqtt_client));
-       abort();
-   }
-
-   // Wait for MQTT client to connect (blocking)
-   xEventGroupWaitBits(s_mqtt_event_group, 
-                       MQTT_CONNECTED_BIT, 
-                       pdTRUE, 
-                       pdTRUE, 
-                       portMAX_DELAY);
-    ESP_LOGI(TAG, "Connected");
-
    // Main loop
    while (1) {
 
-       // Publish message to MQTT broker
-       ESP_LOGI(TAG, "Publishing message: %s", MQTT_MSG);
-       msg_id = esp_mqtt_client_publish(mqtt_client, 
-                                        MQTT_PUB_TOPIC, 
-                                        MQTT_MSG, 
-                                        0,              // Length (0 = auto detect)
-                                        MQTT_PUB_QOS,   // QoS
-                                        0);             // Retain
-       if (msg_id < 0) {
-           ESP_LOGE(TAG, "Error (%d): Failed to publish message", msg_id);
+       // Encode sensor reading
+       if (encode_reading(payload, sizeof(payload)) != ESP_OK) {
+           vTaskDelay(sleep_time_ms / portTICK_PERIOD_MS);
+           continue;
+       }
+       if (first_sample_us == 0) {
+           first_sample_us = esp_timer_get_time();
+           ESP_LOGI(TAG, "Boot timing: first sample at %lld ms",
+                    first_sample_us / 1000);
        }
 
+       // Start MQTT client once the network is up (checked without blocking)
+       if (!mqtt_started) {
+           esp_ret = network_wait_ready(0);
+           if (esp_ret == ESP_OK) {
+               ESP_LOGI(TAG, "Boot timing: network ready at %lld ms",
+                        esp_timer_get_time() / 1000);
+               ESP_LOGI(TAG, "Connecting to MQTT server...");
+               esp_ret = esp_mqtt_client_start(mqtt_client);
+               if (esp_ret != ESP_OK) {
+                   ESP_LOGE(TAG, "Error (%d): Failed to start MQTT client", esp_ret);
+               } else {
+                   mqtt_started = true;
+               }
+           } else if (esp_ret != ESP_ERR_TIMEOUT) {
+               ESP_LOGE(TAG, "Error (%d): Failed to bring up network", esp_ret);
+               abort();
+           } else if ((esp_timer_get_time() - network_wait_us) >= 
+                      (int64_t)CONNECTION_TIMEOUT_SEC * 1000000) {
+               ESP_LOGE(TAG, "Failed to connect to WiFi. Reconnecting...");
+               esp_ret = network_reconnect();
+               if (esp_ret != ESP_OK) {
+                   ESP_LOGE(TAG, "Failed to reconnect WiFi (%d), will retry", esp_ret);
+               }
+               network_wait_us = esp_timer_get_time();
+           }
+       }
+
+#if CONFIG_FLASH_QUEUE
+       // Publish message to MQTT broker (or queue it while offline). The
+       // backlog is sent even when there is no new message.
+       delivered = publish_or_queue(mqtt_client, payload);
+#else
+       // Publish message to MQTT broker (held in the outbox until connected)
+       delivered = true;
+       if (payload[0] != '\0') {
+           ESP_LOGI(TAG, "Publishing message: %s", payload);
+           msg_id = esp_mqtt_client_publish(mqtt_client, 
+                                            MQTT_PUB_TOPIC, 
+                                            payload, 
+                                            0,              // Length (0 = auto detect)
+                                            MQTT_PUB_QOS,   // QoS
+                                            0);             // Retain
+           if (msg_id < 0) {
+               ESP_LOGE(TAG, "Error (%d): Failed to publish message", msg_id);
+               delivered = false;
+           }
+       }
+#endif
+
+#if CONFIG_REPORT_FILTER
+       // Send the latest value again next time if this one was lost
+       if (!delivered) {
+           report_filter_force_keyframe(&s_report_filter);
+       }
+#else
+       (void)delivered;
+#endif
+
+#if CONFIG_STREAM_STATS
+       // Take readings until the next message
+       for (uint32_t i = 0; i < sleep_time_ms / sample_time_ms; i++) {
+           vTaskDelay(sample_time_ms / portTICK_PERIOD_MS);
+           stream_stats_add(&s_temp_stats, TEMP_READING, esp_timer_get_time(), NULL);
+       }
+#else
        // Wait before publishing another message
        vTaskDelay(sleep_time_ms / portTICK_PERIOD_MS);
+#endif
    }
-}
\ No newline at end of file
+}
@@ -3,12 +3,18 @@
 #include "esp_netif.h"
 #include "mqtt_client.h"
 #include "nvs_flash.h"
+#include "lwip/netdb.h"
 
 #include "network_wrapper.h"
+#if CONFIG_REPORT_FILTER
+#include "esp_timer.h"
+#include "report_filter.h"
+#endif
 
 // Settings
 static const uint32_t sleep_time_ms = 5000;
 #define CONNECTION_TIMEOUT_SEC 10
+#define NETWORK_QUEUE_LEN 8     // Network state transitions kept queued
 
 // MQTT settings
 #if CONFIG_WIFI_STA_CONNECT
@@ -26,14 +32,34 @@ static const uint32_t sleep_time_ms = 5000;
 #define MQTT_PUB_TOPIC          "kitchen/sensor"
 #define MQTT_MSG                "{\"temp\": 25}"
 
+#if CONFIG_REPORT_FILTER
+// Report-by-exception settings: a reading is taken every sleep_time_ms but
+// only published when it moves out of the deadband or the heartbeat is due
+#define REPORT_HEARTBEAT_US     (5 * 60 * 1000000UL)    // Publish at least every 5 min
+#define REPORT_KEYFRAME_EVERY   16          // Delta messages between full values
+#define TEMP_DEADBAND           0.25f       // deg C
+#define TEMP_RESOLUTION         0.0625f     // deg C per delta step (TMP102 LSB)
+#define TEMP_READING            25.0f       // Placeholder until a sensor is wired up
+#define PAYLOAD_MAX_SIZE        32
+#endif
+
 // Event group bits
 #define MQTT_CONNECTED_BIT      BIT0
+#if CONFIG_REPORT_FILTER
+#define MQTT_RESYNC_BIT         BIT1        // Next message must be a keyframe
+#endif
 
 // Tag for debug messages
 static const char *TAG = "mqtt_thingsboard_demo";
 
 // Static global variables
 static EventGroupHandle_t s_mqtt_event_group = NULL;
+static QueueHandle_t s_network_queue = NULL;
+static bool s_network_up = false;
+#if CONFIG_REPORT_FILTER
+static report_filter_t s_report_filter;
+static uint8_t s_temp_channel;
+#endif
 
 // Load CA certificate from binary data
 extern const uint8_t mqtt_ca_cert_start[]   asm("_binary_ca_crt_start");
@@ -61,6 +87,10 @@ static void mqtt_event_handler(void *handler_args,
         // Connected to MQTT broker
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "Connected to MQTT broker");
+#if CONFIG_REPORT_FILTER
+            // Messages may have been lost while disconnected
+            xEventGroupSetBits(s_mqtt_event_group, MQTT_RESYNC_BIT);
+#endif
             xEventGroupSetBits(s_mqtt_event_group, MQTT_CONNECTED_BIT);
             break;
 
@@ -104,12 +134,113 @@ static void mqtt_event_handler(void *handler_args,
     }
 }
 
+#if CONFIG_REPORT_FILTER
+// Take a reading and publish it if it changed or the heartbeat is due
+static void publish_reading(esp_mqtt_client_handle_t mqtt_client)
+{
+    telemetry_encoder_t enc;
+    report_filter_reason_t reason;
+    report_filter_stats_t stats;
+    char payload[PAYLOAD_MAX_SIZE];
+    size_t len;
+    int64_t now_us;
+    int msg_id;
+
+    // Start the receiver over with full values after a reconnect
+    if (xEventGroupClearBits(s_mqtt_event_group, MQTT_RESYNC_BIT) & MQTT_RESYNC_BIT) {
+        report_filter_force_keyframe(&s_report_filter);
+    }
+
+    // Skip readings the broker does not need
+    now_us = esp_timer_get_time();
+    report_filter_set(&s_report_filter, s_temp_channel, TEMP_READING);
+    reason = report_filter_check(&s_report_filter, now_us);
+    if (reason == REPORT_FILTER_SKIP) {
+        return;
+    }
+
+    // Encode full value or delta
+    telemetry_encoder_init(&enc, TELEMETRY_FORMAT_JSON, (uint8_t *)payload, sizeof(payload) - 1);
+    report_filter_encode(&s_report_filter, &enc, now_us);
+    if (telemetry_encoder_finish(&enc, &len) != TELEMETRY_OK) {
+        ESP_LOGE(TAG, "Payload does not fit in %u bytes", (unsigned int)sizeof(payload));
+        report_filter_force_keyframe(&s_report_filter);
+        return;
+    }
+    payload[len] = '\0';
+
+    // Publish message to MQTT broker
+    report_filter_get_stats(&s_report_filter, &stats);
+    ESP_LOGI(TAG, "Publishing message (%s, %lu of %lu readings sent): %s",
+             (reason == REPORT_FILTER_HEARTBEAT) ? "heartbeat" : "change",
+             (unsigned long)stats.reports,
+             (unsigned long)stats.checks,
+             payload);
+    msg_id = esp_mqtt_client_publish(mqtt_client,
+                                     MQTT_PUB_TOPIC,
+                                     payload,
+                                     0,             // Length (0 = auto detect)
+                                     MQTT_PUB_QOS,  // QoS
+                                     0);            // Retain
+    if (msg_id < 0) {
+        ESP_LOGE(TAG, "Error (%d): Failed to publish message", msg_id);
+        report_filter_force_keyframe(&s_report_filter);
+    }
+}
+#endif
+
+// Apply queued network state transitions, blocking up to wait_ticks for one
+static void process_network_events(TickType_t wait_ticks)
+{
+    network_event_t event;
+
+    while (xQueueReceive(s_network_queue, &event, wait_ticks) == pdTRUE) {
+        switch (event.type) {
+            case NETWORK_EVENT_LINK_DOWN:
+                ESP_LOGW(TAG, "Network link down (reason %d)%s",
+                         event.reason,
+                         event.reconnecting ? ", driver reconnecting" : "");
+                break;
+            case NETWORK_EVENT_IP_ACQUIRED:
+                ESP_LOGI(TAG, "Network up (%s)",
+                         (event.family == AF_INET6) ? "IPv6" : "IPv4");
+                break;
+            default:
+                ESP_LOGI(TAG, "Network event: %s", network_event_name(event.type));
+                break;
+        }
+        s_network_up = network_is_up();
+
+        // Only block for the first event, then drain the rest
+        wait_ticks = 0;
+    }
+}
+
+// Block until the network is (up) or is not (!up) usable, or timeout
+static bool wait_network_state(bool up, uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    TickType_t elapsed;
+
+    while (s_network_up != up) {
+        elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            return false;
+        }
+        process_network_events(timeout - elapsed);
+    }
+
+    return true;
+}
+
 // Main app entrypoint
 void app_main(void)
 {
     esp_err_t esp_ret;
     int msg_id;
     EventGroupHandle_t network_event_group;
+    network_subscriber_handle_t network_sub;
 
     // Initialize event groups
     network_event_group = xEventGroupCreate();
@@ -141,6 +272,18 @@ void app_main(void)
         abort();
     }
 
+    // Get network state transitions on a queue instead of polling bits
+    s_network_queue = xQueueCreate(NETWORK_QUEUE_LEN, sizeof(network_event_t));
+    if (s_network_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create network event queue");
+        abort();
+    }
+    esp_ret = network_subscribe_queue(s_network_queue, &network_sub);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to subscribe to network events", esp_ret);
+        abort();
+    }
+
     // Initialize network connection
     esp_ret = network_init(network_event_group);
     if (esp_ret != ESP_OK) {
@@ -149,12 +292,11 @@ void app_main(void)
     }
 
     // Make sure network is connected and device has an IP address
-    while (!wait_for_network(network_event_group, CONNECTION_TIMEOUT_SEC)) {
+    while (!wait_network_state(true, CONNECTION_TIMEOUT_SEC * 1000)) {
         ESP_LOGE(TAG, "Failed to connect to network. Reconnecting...");
         esp_ret = network_reconnect();
         if (esp_ret != ESP_OK) {
-            ESP_LOGE(TAG, "Error (%d): Failed to reconnect to network", esp_ret);
-            abort();
+            ESP_LOGE(TAG, "Error (%d): Failed to reconnect to network, will retry", esp_ret);
         }
     }
 
@@ -215,9 +357,30 @@ void app_main(void)
         abort();
     }
 
+#if CONFIG_REPORT_FILTER
+    // Publish the temperature by exception
+    report_filter_channel_config_t temp_config = {
+        .key = "temp",
+        .deadband = TEMP_DEADBAND,
+        .resolution = TEMP_RESOLUTION,
+    };
+    report_filter_init(&s_report_filter, REPORT_HEARTBEAT_US, REPORT_KEYFRAME_EVERY);
+    if (report_filter_add_channel(&s_report_filter, &temp_config, &s_temp_channel) != TELEMETRY_OK) {
+        ESP_LOGE(TAG, "Error: Could not add report filter channel");
+        abort();
+    }
+#endif
+
     // Superloop
     while (1) {
 
+        // Log network state transitions (the MQTT client reconnects itself)
+        process_network_events(0);
+
+#if CONFIG_REPORT_FILTER
+        // Publish the reading if the broker needs it
+        publish_reading(mqtt_client);
+#else
         // Publish message to MQTT broker
         ESP_LOGI(TAG, "Publishing message: %s", MQTT_MSG);
         msg_id = esp_mqtt_client_publish(mqtt_client,
@@ -229,6 +392,7 @@ void app_main(void)
         if (msg_id < 0) {
             ESP_LOGE(TAG, "Error (%d): Failed to publish message", msg_id);
         }
+#endif
 
         // Wait before publishing another message
         vTaskDelay(sleep_time_ms / portTICK_PERIOD_MS);
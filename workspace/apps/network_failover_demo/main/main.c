@@ -0,0 +1,194 @@
+/**
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "nvs_flash.h"
+
+#include "network_wrapper.h"
+
+// Settings
+#define CONNECTION_TIMEOUT_SEC  10  // Set delay to wait for connection (sec)
+#define SETTLE_TIME_MS          (3 * CONFIG_NETWORK_WRAPPER_PROBE_INTERVAL_MS)
+#define FAILOVER_TIMEOUT_MS     (2 * CONFIG_NETWORK_WRAPPER_PROBE_INTERVAL_MS + \
+                                 5000)
+#define NETWORK_QUEUE_LEN       16  // Network state transitions kept queued
+#define FAST_RTT_MS             0   // Simulated gateway faster than QEMU's
+#define SLOW_RTT_MS             50  // Simulated gateway slower than QEMU's
+
+// Tag for debug messages
+static const char *TAG = "network_failover_demo";
+
+// Route changes (from the subscription queue)
+static QueueHandle_t s_network_queue = NULL;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static void log_interfaces(void);
+static bool route_on(const char *iface);
+static bool wait_route_change(const char *from, uint32_t timeout_ms);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Print the state of every interface
+static void log_interfaces(void)
+{
+    network_iface_info_t info[4];
+    size_t num;
+
+    num = network_get_interfaces(info, sizeof(info) / sizeof(info[0]));
+    for (size_t i = 0; i < num; i++) {
+        ESP_LOGI(TAG, "  %-5s link %-4s ip %-3s %-9s RTT %ld ms%s",
+                 info[i].name,
+                 info[i].link_up ? "up" : "down",
+                 info[i].has_ip ? "yes" : "no",
+                 info[i].healthy ? "healthy" : "unhealthy",
+                 (info[i].rtt_ms == UINT32_MAX) ? -1L : (long)info[i].rtt_ms,
+                 info[i].is_default ? " (default)" : "");
+    }
+}
+
+// Check which interface carries the default route
+static bool route_on(const char *iface)
+{
+    const char *active = network_get_active_interface();
+
+    return (active != NULL) && (strcmp(active, iface) == 0);
+}
+
+// Wait for the route to move off an interface, print how long it took
+static bool wait_route_change(const char *from, uint32_t timeout_ms)
+{
+    network_event_t event;
+    int64_t start_us = esp_timer_get_time();
+    int64_t elapsed_ms;
+
+    while (1) {
+        elapsed_ms = (esp_timer_get_time() - start_us) / 1000;
+        if (elapsed_ms >= timeout_ms) {
+            ESP_LOGE(TAG, "Route still on %s after %lu ms", from, timeout_ms);
+            return false;
+        }
+        if (xQueueReceive(s_network_queue,
+                          &event,
+                          pdMS_TO_TICKS(timeout_ms - elapsed_ms)) != pdTRUE) {
+            continue;
+        }
+        if ((event.type == NETWORK_EVENT_ROUTE_CHANGED) &&
+            ((event.iface == NULL) || (strcmp(event.iface, from) != 0))) {
+            ESP_LOGI(TAG, "Failed over from %s to %s in %lld ms",
+                     from,
+                     (event.iface != NULL) ? event.iface : "nothing",
+                     (event.timestamp_us - start_us) / 1000);
+            return true;
+        }
+    }
+}
+
+/*******************************************************************************
+ * Main entrypoint
+ */
+
+// Main app entrypoint
+void app_main(void)
+{
+    esp_err_t esp_ret;
+    EventGroupHandle_t network_event_group;
+    network_subscriber_handle_t network_sub;
+
+    // Welcome message
+    ESP_LOGI(TAG, "Starting network failover demo");
+
+    // Initialize event group
+    network_event_group = xEventGroupCreate();
+
+    // Initialize NVS
+    esp_ret = nvs_flash_init();
+    if (esp_ret == ESP_ERR_NVS_NO_FREE_PAGES ||
+        esp_ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+      ESP_ERROR_CHECK(nvs_flash_erase());
+      esp_ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(esp_ret);
+
+    // Initialize TCP/IP network interface (only call once in application)
+    // Must be called prior to initializing the network driver!
+    esp_ret = esp_netif_init();
+    ESP_ERROR_CHECK(esp_ret);
+
+    // Create default event loop that runs in the background
+    // Must be running prior to initializing the network driver!
+    esp_ret = esp_event_loop_create_default();
+    ESP_ERROR_CHECK(esp_ret);
+
+    // Get network state transitions on a queue
+    s_network_queue = xQueueCreate(NETWORK_QUEUE_LEN, sizeof(network_event_t));
+    if (s_network_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create network event queue");
+        abort();
+    }
+    esp_ret = network_subscribe_queue(s_network_queue, &network_sub);
+    ESP_ERROR_CHECK(esp_ret);
+
+    // Bring up QEMU Ethernet and the simulated interface together
+    esp_ret = network_init(network_event_group);
+    ESP_ERROR_CHECK(esp_ret);
+    if (!wait_for_network(network_event_group, CONNECTION_TIMEOUT_SEC)) {
+        ESP_LOGE(TAG, "Failed to connect to network");
+        abort();
+    }
+
+    // Cycle through link changes and print how the route follows them
+    while (1) {
+
+        // Faster simulated gateway: the route should move to it
+        ESP_LOGI(TAG, "Simulated gateway gets faster");
+        network_sim_set_rtt(FAST_RTT_MS);
+        vTaskDelay(pdMS_TO_TICKS(SETTLE_TIME_MS));
+        log_interfaces();
+        if (!route_on("sim")) {
+            ESP_LOGW(TAG, "QEMU gateway answers as fast, skipping failover");
+        } else {
+
+            // Link loss: immediate failover
+            xQueueReset(s_network_queue);
+            ESP_LOGI(TAG, "Simulated link goes down");
+            network_sim_set_link(false);
+            wait_route_change("sim", FAILOVER_TIMEOUT_MS);
+            log_interfaces();
+
+            // Link back: the route returns once the probe measures it
+            ESP_LOGI(TAG, "Simulated link comes back");
+            network_sim_set_link(true);
+            vTaskDelay(pdMS_TO_TICKS(SETTLE_TIME_MS));
+            log_interfaces();
+        }
+
+        // Silent gateway: failover after the next probe
+        if (route_on("sim")) {
+            xQueueReset(s_network_queue);
+            ESP_LOGI(TAG, "Simulated gateway stops answering");
+            network_sim_set_rtt(NETWORK_SIM_NO_REPLY);
+            wait_route_change("sim", FAILOVER_TIMEOUT_MS);
+            log_interfaces();
+        }
+
+        // Slower gateway: the route should stay on Ethernet
+        ESP_LOGI(TAG, "Simulated gateway answers again, but slower");
+        network_sim_set_rtt(SLOW_RTT_MS);
+        vTaskDelay(pdMS_TO_TICKS(SETTLE_TIME_MS));
+        log_interfaces();
+    }
+}
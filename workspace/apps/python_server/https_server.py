@@ -0,0 +1,120 @@
+"""
+HTTPS variant of server_test.py for throughput benchmarks.
+
+Serves on port 8443 with certs/server.crt, which is signed by the course CA
+(scripts/esp-idf/ca.crt) and valid for 10.0.2.2 (the QEMU host), 127.0.0.1,
+and localhost. To regenerate it from the CA key:
+
+    openssl genrsa -out certs/server.key 2048
+    openssl req -new -key certs/server.key -out server.csr \
+        -subj "/C=US/ST=Colorado/L=Denver/O=python_server/CN=10.0.2.2" \
+        -addext "subjectAltName=IP:10.0.2.2,IP:127.0.0.1,DNS:localhost"
+    openssl x509 -req -days 36500 -in server.csr -copy_extensions copy \
+        -CA ca.crt -CAkey ca.key -CAcreateserial -out certs/server.crt
+
+Endpoints:
+    /               Small HTML page (same as server_test.py)
+    /bench/<n>      JSON document of about n bytes (Content-Length)
+    /bench/<n>?chunked=1
+                    Same document with Transfer-Encoding: chunked
+
+Use --no-tls to serve the same endpoints over plain HTTP.
+"""
+
+import argparse
+import json
+import os
+import ssl
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import urlparse, parse_qs
+
+CERT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "certs")
+MAX_BODY = 4 * 1024 * 1024
+WRITE_SIZE = 16 * 1024
+
+# Generated bodies by size (the benchmark asks for the same few sizes)
+bodies = {}
+
+def make_body(size):
+    """JSON array of small records, padded to exactly size bytes"""
+    if size in bodies:
+        return bodies[size]
+    items = []
+    length = len('{"items":[]}')
+    i = 0
+    while True:
+        item = json.dumps({"id": i, "name": "item-%d" % i, "value": i * 0.25,
+                           "ok": i % 2 == 0}, separators=(",", ":"))
+        if length + len(item) + 1 > size:
+            break
+        items.append(item)
+        length += len(item) + 1
+        i += 1
+    body = '{"items":[' + ",".join(items) + "]}"
+    body = body + " " * max(0, size - len(body))
+    bodies[size] = body.encode()
+    return bodies[size]
+
+class BenchRequestHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def do_GET(self):
+        url = urlparse(self.path)
+        parts = url.path.strip("/").split("/")
+
+        # Same page as server_test.py
+        if url.path == "/":
+            body = (b"<html><head><title>Title goes here.</title></head>"
+                    b"<body><p>Hello, world!</p></body></html>")
+            self.send_response(200)
+            self.send_header("Content-type", "text/html")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+            return
+
+        # Benchmark document
+        if len(parts) == 2 and parts[0] == "bench" and parts[1].isdigit():
+            size = min(int(parts[1]), MAX_BODY)
+            body = make_body(size)
+            chunked = parse_qs(url.query).get("chunked", ["0"])[0] == "1"
+            self.send_response(200)
+            self.send_header("Content-type", "application/json")
+            if chunked:
+                self.send_header("Transfer-Encoding", "chunked")
+            else:
+                self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            for pos in range(0, len(body), WRITE_SIZE):
+                piece = body[pos:pos + WRITE_SIZE]
+                if chunked:
+                    self.wfile.write(b"%x\r\n%s\r\n" % (len(piece), piece))
+                else:
+                    self.wfile.write(piece)
+            if chunked:
+                self.wfile.write(b"0\r\n\r\n")
+            return
+
+        self.send_error(404)
+
+def run(port, use_tls):
+    server_address = ('', port)  # Serve on all addresses
+    httpd = ThreadingHTTPServer(server_address, BenchRequestHandler)
+    if use_tls:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(os.path.join(CERT_DIR, "server.crt"),
+                                os.path.join(CERT_DIR, "server.key"))
+        httpd.socket = context.wrap_socket(httpd.socket, server_side=True)
+    print("Starting %s server on port %d..." %
+          ("HTTPS" if use_tls else "HTTP", port))
+    httpd.serve_forever()
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("--port", type=int, default=None,
+                        help="port (default: 8443, or 8000 with --no-tls)")
+    parser.add_argument("--no-tls", action="store_true",
+                        help="serve plain HTTP")
+    args = parser.parse_args()
+    port = args.port if args.port else (8000 if args.no_tls else 8443)
+    run(port, not args.no_tls)
@@ -0,0 +1,397 @@
+/**
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host-side traffic and accuracy benchmark for the report_filter component.
+ *
+ * Replays a day of simulated room temperature and humidity, sampled every
+ * 5 s like the MQTT demos, through several filter settings. Every message
+ * is decoded by a model receiver that rebuilds the values from keyframes
+ * and deltas, and the rebuilt values are checked against the readings at
+ * every sample: they must stay within the deadband (plus half a step for
+ * delta channels), and no gap between messages may exceed the heartbeat.
+ * Prints messages and bytes sent against publishing every sample, then the
+ * filter's cost per sample.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "report_filter.h"
+
+// Settings
+#define SAMPLE_PERIOD_US    5000000LL   // Time between readings
+#define NUM_SAMPLES         17280       // One day of readings
+#define MSG_OVERHEAD        60          // MQTT PUBLISH header, topic, TCP/IP
+#define MIN_RUN_TIME_S      0.5         // Run the speed test for at least this long
+#define BUF_SIZE            64          // Telemetry message buffer
+#define PI                  3.14159265358979323846
+
+// Channels
+#define NUM_CHANNELS        2
+#define TEMP_LSB            0.0625f     // TMP102 resolution (deg C)
+#define HUM_LSB             0.1f        // Typical humidity sensor resolution (%RH)
+
+// One set of filter settings
+typedef struct {
+    const char *name;
+    float deadband[NUM_CHANNELS];
+    float resolution[NUM_CHANNELS];
+    uint32_t heartbeat_s;
+    uint16_t keyframe_every;
+} bench_case_t;
+
+// What a receiver rebuilds from the messages
+typedef struct {
+    float value[NUM_CHANNELS];
+    int64_t steps[NUM_CHANNELS];
+    uint16_t seq;
+    int failed;
+} receiver_t;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static uint32_t rand_next(void);
+static float rand_normal(void);
+static void make_trace(void);
+static int key_is(const telemetry_field_t *field, const char *key);
+static void receive(receiver_t *rx,
+                    const bench_case_t *bc,
+                    telemetry_format_t format,
+                    const uint8_t *data,
+                    size_t len);
+static int run_case(const bench_case_t *bc, telemetry_format_t format, size_t base_bytes);
+static size_t baseline_bytes(telemetry_format_t format);
+static double bench_check(const bench_case_t *bc);
+static double now_s(void);
+
+// Channel keys
+static const char *s_keys[NUM_CHANNELS] = {"temp", "hum"};
+static const char *s_delta_keys[NUM_CHANNELS] = {"temp_d", "hum_d"};
+
+// Format names
+static const char *s_format_names[] = {"JSON", "CBOR"};
+
+// Filter settings under test
+static const bench_case_t s_cases[] = {
+    {"deadband",        {0.25f, 1.0f}, {0.0f, 0.0f},        300, 0},
+    {"deadband+delta",  {0.25f, 1.0f}, {TEMP_LSB, HUM_LSB}, 300, 16},
+    {"wide+delta",      {0.5f, 2.0f},  {TEMP_LSB, HUM_LSB}, 900, 16},
+};
+
+// Readings
+static uint32_t s_rand_state = 0x12345678;
+static float s_trace[NUM_SAMPLES][NUM_CHANNELS];
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Pseudo-random 32-bit number (xorshift)
+static uint32_t rand_next(void)
+{
+    s_rand_state ^= s_rand_state << 13;
+    s_rand_state ^= s_rand_state >> 17;
+    s_rand_state ^= s_rand_state << 5;
+
+    return s_rand_state;
+}
+
+// Standard normal value (Box-Muller)
+static float rand_normal(void)
+{
+    double u1 = ((double)rand_next() + 1.0) / 4294967297.0;
+    double u2 = ((double)rand_next() + 1.0) / 4294967297.0;
+
+    return (float)(sqrt(-2.0 * log(u1)) * cos(2.0 * PI * u2));
+}
+
+// Daily swing plus sensor noise, quantized like the sensors would
+static void make_trace(void)
+{
+    double day;
+    float temp;
+    float hum;
+
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        day = 2.0 * PI * (double)i / (double)NUM_SAMPLES;
+        temp = (float)(22.0 + 3.0 * sin(day)) + 0.03f * rand_normal();
+        hum = (float)(50.0 - 10.0 * sin(day)) + 0.3f * rand_normal();
+        s_trace[i][0] = roundf(temp / TEMP_LSB) * TEMP_LSB;
+        s_trace[i][1] = roundf(hum / HUM_LSB) * HUM_LSB;
+    }
+}
+
+// Compare a decoded key with a NUL-terminated one
+static int key_is(const telemetry_field_t *field, const char *key)
+{
+    return (strlen(key) == field->key_len) && (memcmp(field->key, key, field->key_len) == 0);
+}
+
+// Apply one message to the receiver's values
+static void receive(receiver_t *rx,
+                    const bench_case_t *bc,
+                    telemetry_format_t format,
+                    const uint8_t *data,
+                    size_t len)
+{
+    telemetry_decoder_t dec;
+    telemetry_field_t field;
+    float value;
+    int has_seq = 0;
+
+    if (telemetry_decoder_init(&dec, format, data, len) != TELEMETRY_OK) {
+        rx->failed = 1;
+        return;
+    }
+
+    while (telemetry_decoder_next(&dec, &field) == TELEMETRY_OK) {
+
+        // Deltas must arrive in sequence after a keyframe
+        if (key_is(&field, REPORT_FILTER_SEQ_KEY)) {
+            if (field.value.i != rx->seq + 1) {
+                rx->failed = 1;
+            }
+            rx->seq = (uint16_t)field.value.i;
+            has_seq = 1;
+            continue;
+        }
+
+        for (int c = 0; c < NUM_CHANNELS; c++) {
+
+            // Full value (keyframe, or a channel without a resolution)
+            if (key_is(&field, s_keys[c])) {
+                value = (field.type == TELEMETRY_TYPE_INT) ? (float)field.value.i : field.value.f;
+                if (bc->resolution[c] > 0.0f) {
+                    rx->steps[c] = (int64_t)roundf(value / bc->resolution[c]);
+                    value = (float)rx->steps[c] * bc->resolution[c];
+                }
+                rx->value[c] = value;
+            }
+
+            // Change in steps
+            if (key_is(&field, s_delta_keys[c])) {
+                rx->steps[c] += field.value.i;
+                rx->value[c] = (float)rx->steps[c] * bc->resolution[c];
+            }
+        }
+    }
+
+    // Keyframes start the count over
+    if (!has_seq) {
+        rx->seq = 0;
+    }
+}
+
+// Replay the trace through one filter and print what was sent (0 if correct)
+static int run_case(const bench_case_t *bc, telemetry_format_t format, size_t base_bytes)
+{
+    report_filter_t filter;
+    report_filter_stats_t stats;
+    telemetry_encoder_t enc;
+    receiver_t rx;
+    uint8_t buf[BUF_SIZE];
+    uint8_t channel[NUM_CHANNELS];
+    size_t len;
+    size_t bytes = 0;
+    int64_t now_us;
+    int64_t last_us = 0;
+    int64_t max_gap_us = 0;
+    float err;
+    float worst[NUM_CHANNELS] = {0.0f, 0.0f};
+    float bound;
+
+    memset(&rx, 0, sizeof(rx));
+    report_filter_init(&filter, bc->heartbeat_s * 1000000UL, bc->keyframe_every);
+    for (int c = 0; c < NUM_CHANNELS; c++) {
+        report_filter_channel_config_t config = {
+            .key = s_keys[c],
+            .deadband = bc->deadband[c],
+            .resolution = bc->resolution[c],
+        };
+        report_filter_add_channel(&filter, &config, &channel[c]);
+    }
+
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        now_us = (int64_t)i * SAMPLE_PERIOD_US;
+        for (int c = 0; c < NUM_CHANNELS; c++) {
+            report_filter_set(&filter, channel[c], s_trace[i][c]);
+        }
+
+        // Send (and receive) a message if the filter says so
+        if (report_filter_check(&filter, now_us) != REPORT_FILTER_SKIP) {
+            telemetry_encoder_init(&enc, format, buf, sizeof(buf));
+            report_filter_encode(&filter, &enc, now_us);
+            if (telemetry_encoder_finish(&enc, &len) != TELEMETRY_OK) {
+                rx.failed = 1;
+                break;
+            }
+            receive(&rx, bc, format, buf, len);
+            bytes += len;
+            if ((i > 0) && ((now_us - last_us) > max_gap_us)) {
+                max_gap_us = now_us - last_us;
+            }
+            last_us = now_us;
+        }
+
+        // What the receiver shows must track the reading
+        for (int c = 0; c < NUM_CHANNELS; c++) {
+            err = fabsf(rx.value[c] - s_trace[i][c]);
+            if (err > worst[c]) {
+                worst[c] = err;
+            }
+        }
+    }
+
+    // Errors stay inside the deadband (plus rounding to a step), and quiet
+    // stretches are broken up by heartbeats
+    for (int c = 0; c < NUM_CHANNELS; c++) {
+        bound = bc->deadband[c] + bc->resolution[c] / 2.0f + 1e-3f;
+        if (worst[c] > bound) {
+            rx.failed = 1;
+        }
+    }
+    if (max_gap_us > (int64_t)bc->heartbeat_s * 1000000LL) {
+        rx.failed = 1;
+    }
+
+    report_filter_get_stats(&filter, &stats);
+    printf("    %-15s %s %5u msgs (%4u key, %4u delta, %3u hb) %6u B payload  %5.1fx fewer bytes  "
+           "err %.3f/%.2f  max gap %4llds  %s\n",
+           bc->name,
+           s_format_names[format],
+           (unsigned int)stats.reports,
+           (unsigned int)stats.keyframes,
+           (unsigned int)stats.deltas,
+           (unsigned int)stats.heartbeats,
+           (unsigned int)bytes,
+           (double)base_bytes / (double)(bytes + (size_t)stats.reports * MSG_OVERHEAD),
+           worst[0],
+           worst[1],
+           (long long)(max_gap_us / 1000000),
+           rx.failed ? "FAILED" : "");
+
+    return rx.failed;
+}
+
+// Bytes on the wire when every reading is published (the baseline)
+static size_t baseline_bytes(telemetry_format_t format)
+{
+    telemetry_encoder_t enc;
+    uint8_t buf[BUF_SIZE];
+    size_t len;
+    size_t bytes = 0;
+
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        telemetry_encoder_init(&enc, format, buf, sizeof(buf));
+        for (int c = 0; c < NUM_CHANNELS; c++) {
+            telemetry_encode_float(&enc, s_keys[c], s_trace[i][c]);
+        }
+        telemetry_encoder_finish(&enc, &len);
+        bytes += len;
+    }
+    printf("    %-15s %s %5u msgs %38u B payload  (%u B with headers)\n",
+           "every sample",
+           s_format_names[format],
+           (unsigned int)NUM_SAMPLES,
+           (unsigned int)bytes,
+           (unsigned int)(bytes + NUM_SAMPLES * MSG_OVERHEAD));
+
+    return bytes + NUM_SAMPLES * MSG_OVERHEAD;
+}
+
+// Time per reading to set both channels and check the filter
+static double bench_check(const bench_case_t *bc)
+{
+    report_filter_t filter;
+    telemetry_encoder_t enc;
+    uint8_t buf[BUF_SIZE];
+    uint8_t channel[NUM_CHANNELS];
+    volatile uint32_t sink = 0;
+    unsigned long samples = 0;
+    int64_t now_us = 0;
+    double start;
+    double elapsed;
+
+    report_filter_init(&filter, bc->heartbeat_s * 1000000UL, bc->keyframe_every);
+    for (int c = 0; c < NUM_CHANNELS; c++) {
+        report_filter_channel_config_t config = {
+            .key = s_keys[c],
+            .deadband = bc->deadband[c],
+            .resolution = bc->resolution[c],
+        };
+        report_filter_add_channel(&filter, &config, &channel[c]);
+    }
+
+    start = now_s();
+    do {
+        for (int i = 0; i < NUM_SAMPLES; i++) {
+            for (int c = 0; c < NUM_CHANNELS; c++) {
+                report_filter_set(&filter, channel[c], s_trace[i][c]);
+            }
+            if (report_filter_check(&filter, now_us) != REPORT_FILTER_SKIP) {
+                telemetry_encoder_init(&enc, TELEMETRY_FORMAT_CBOR, buf, sizeof(buf));
+                report_filter_encode(&filter, &enc, now_us);
+                sink += enc.len;
+            }
+            now_us += SAMPLE_PERIOD_US;
+        }
+        samples += NUM_SAMPLES;
+        elapsed = now_s() - start;
+    } while (elapsed < MIN_RUN_TIME_S);
+
+    return elapsed / (double)samples;
+}
+
+// Monotonic time in seconds
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*******************************************************************************
+ * Main entrypoint
+ */
+
+int main(void)
+{
+    const size_t num_cases = sizeof(s_cases) / sizeof(s_cases[0]);
+    size_t base;
+    double per_sample;
+    int failed = 0;
+
+    printf("report_filter benchmark: %u bytes per filter (%d channels max)\n",
+           (unsigned int)sizeof(report_filter_t), REPORT_FILTER_MAX_CHANNELS);
+    make_trace();
+
+    // Traffic and receiver error for a day of readings
+    printf("  one day, a reading every %lld s (x fewer bytes includes %d B of headers per msg)\n",
+           SAMPLE_PERIOD_US / 1000000, MSG_OVERHEAD);
+    for (int f = TELEMETRY_FORMAT_JSON; f <= TELEMETRY_FORMAT_CBOR; f++) {
+        base = baseline_bytes((telemetry_format_t)f);
+        for (size_t i = 0; i < num_cases; i++) {
+            failed |= run_case(&s_cases[i], (telemetry_format_t)f, base);
+        }
+    }
+
+    // Speed
+    printf("  speed (two channels, set + check per reading)\n");
+    for (size_t i = 0; i < num_cases; i++) {
+        per_sample = bench_check(&s_cases[i]);
+        printf("    %-15s %7.1f ns/reading\n", s_cases[i].name, per_sample * 1e9);
+    }
+
+    return failed;
+}
@@ -0,0 +1,324 @@
+/**
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host-side speed and accuracy benchmark for the stream_stats component.
+ *
+ * Feeds synthetic sensor streams (uniform, normal, and skewed) through the
+ * aggregator and compares each window's summary with exact statistics
+ * computed from a sorted copy of the window. Then measures updates per
+ * second per stream with 0, 1, and 3 percentiles, against the baseline of
+ * buffering every value and sorting each window.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stream_stats.h"
+
+// Settings
+#define NUM_VALUES          4096        // Distinct values cycled through
+#define WINDOW_VALUES       1000        // Values per window in the speed test
+#define SAMPLE_PERIOD_US    1000        // Time between values (1 kHz stream)
+#define MAX_ACCURACY_WINDOW 10000       // Largest window checked for accuracy
+#define MIN_RUN_TIME_S      0.5         // Run each case for at least this long
+#define BUF_SIZE            256         // Telemetry message buffer
+#define PI                  3.14159265358979323846
+
+// Value distributions
+typedef enum {
+    DIST_UNIFORM = 0,       // Flat, 20 to 30
+    DIST_NORMAL,            // Temperature-like: 25 +/- 0.5
+    DIST_SKEWED,            // Latency-like: exponential, mean 10
+} dist_t;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static uint32_t rand_next(void);
+static float rand_value(dist_t dist);
+static int compare_doubles(const void *a, const void *b);
+static double exact_quantile(const double *sorted, size_t count, double p);
+static int check_accuracy(dist_t dist, size_t window);
+static double bench_stream(uint8_t num_quantiles);
+static double bench_sort(void);
+static double now_s(void);
+
+// Distribution names
+static const char *s_dist_names[] = {"uniform", "normal", "skewed"};
+
+// Percentiles tracked
+static const float s_quantiles[] = {0.5f, 0.9f, 0.99f};
+
+// Values and scratch space
+static uint32_t s_rand_state = 0x12345678;
+static float s_values[MAX_ACCURACY_WINDOW];
+static double s_sorted[MAX_ACCURACY_WINDOW];
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Pseudo-random 32-bit number (xorshift)
+static uint32_t rand_next(void)
+{
+    s_rand_state ^= s_rand_state << 13;
+    s_rand_state ^= s_rand_state >> 17;
+    s_rand_state ^= s_rand_state << 5;
+
+    return s_rand_state;
+}
+
+// One value from a distribution
+static float rand_value(dist_t dist)
+{
+    double u1 = ((double)rand_next() + 1.0) / 4294967297.0;
+    double u2 = ((double)rand_next() + 1.0) / 4294967297.0;
+
+    switch (dist) {
+        case DIST_UNIFORM:
+            return (float)(20.0 + 10.0 * u1);
+        case DIST_NORMAL:
+            return (float)(25.0 + 0.5 * sqrt(-2.0 * log(u1)) * cos(2.0 * PI * u2));
+        case DIST_SKEWED:
+        default:
+            return (float)(-10.0 * log(u1));
+    }
+}
+
+// qsort() comparison for doubles
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Quantile of sorted values (linear interpolation between ranks)
+static double exact_quantile(const double *sorted, size_t count, double p)
+{
+    double rank = p * (double)(count - 1);
+    size_t i = (size_t)rank;
+
+    if (i >= count - 1) {
+        return sorted[count - 1];
+    }
+
+    return sorted[i] + (rank - (double)i) * (sorted[i + 1] - sorted[i]);
+}
+
+// Summarize one window both ways and print the errors (0 if within bounds)
+static int check_accuracy(dist_t dist, size_t window)
+{
+    stream_stats_t stats;
+    stream_stats_summary_t summary;
+    double sum = 0.0;
+    double sq_sum = 0.0;
+    double mean;
+    double stddev;
+    double range;
+    double err;
+    double worst_q = 0.0;
+    int failed = 0;
+
+    // Feed the window (closed by hand, so timestamps do not matter)
+    stream_stats_init(&stats, 0, 0, s_quantiles, 3);
+    for (size_t i = 0; i < window; i++) {
+        s_values[i] = rand_value(dist);
+        s_sorted[i] = s_values[i];
+        stream_stats_add(&stats, s_values[i], (int64_t)i, NULL);
+    }
+    stream_stats_close(&stats, (int64_t)window, &summary);
+
+    // Exact statistics (two-pass, double precision)
+    qsort(s_sorted, window, sizeof(s_sorted[0]), compare_doubles);
+    for (size_t i = 0; i < window; i++) {
+        sum += s_sorted[i];
+    }
+    mean = sum / (double)window;
+    for (size_t i = 0; i < window; i++) {
+        sq_sum += (s_sorted[i] - mean) * (s_sorted[i] - mean);
+    }
+    stddev = sqrt(sq_sum / (double)(window - 1));
+    range = s_sorted[window - 1] - s_sorted[0];
+
+    // Count, extremes, mean, and standard deviation must be (nearly) exact
+    if ((summary.count != window) ||
+        (summary.min != (float)s_sorted[0]) ||
+        (summary.max != (float)s_sorted[window - 1]) ||
+        (fabs(summary.mean - mean) > 1e-4 * range) ||
+        (fabs(summary.stddev - stddev) > 1e-3 * stddev)) {
+        failed = 1;
+    }
+
+    // Percentiles are estimates: report the error as a fraction of the range
+    printf("    %-8s %6u values  mean err %8.2e  std err %8.2e  ",
+           s_dist_names[dist],
+           (unsigned int)window,
+           fabs(summary.mean - mean),
+           fabs(summary.stddev - stddev));
+    for (uint8_t q = 0; q < summary.num_quantiles; q++) {
+        err = fabs(summary.quantile[q] -
+                   exact_quantile(s_sorted, window, summary.quantile_p[q])) / range;
+        if (err > worst_q) {
+            worst_q = err;
+        }
+        printf("p%-2d %5.2f%%  ", (int)roundf(summary.quantile_p[q] * 100.0f), err * 100.0);
+    }
+    printf("%s\n", failed ? "FAILED" : "");
+
+    // P-square is accurate to a few percent of the range once warmed up
+    if ((window >= 1000) && (worst_q > 0.05)) {
+        failed = 1;
+    }
+
+    return failed;
+}
+
+// Time per update of one stream (windows close every WINDOW_VALUES values)
+static double bench_stream(uint8_t num_quantiles)
+{
+    stream_stats_t stats;
+    stream_stats_summary_t summary;
+    volatile float sink = 0.0f;
+    unsigned long updates = 0;
+    int64_t timestamp_us = 0;
+    double start;
+    double elapsed;
+
+    stream_stats_init(&stats,
+                      WINDOW_VALUES * SAMPLE_PERIOD_US,
+                      0,
+                      s_quantiles,
+                      num_quantiles);
+
+    start = now_s();
+    do {
+        for (int i = 0; i < NUM_VALUES; i++) {
+            if (stream_stats_add(&stats, s_values[i], timestamp_us, &summary)) {
+                sink += summary.mean;
+            }
+            timestamp_us += SAMPLE_PERIOD_US;
+        }
+        updates += NUM_VALUES;
+        elapsed = now_s() - start;
+    } while (elapsed < MIN_RUN_TIME_S);
+
+    return elapsed / (double)updates;
+}
+
+// Time per value when buffering each window and sorting it (the baseline)
+static double bench_sort(void)
+{
+    static double window[WINDOW_VALUES];
+    volatile double sink = 0.0;
+    unsigned long updates = 0;
+    size_t count = 0;
+    double start;
+    double elapsed;
+
+    start = now_s();
+    do {
+        for (int i = 0; i < NUM_VALUES; i++) {
+            window[count++] = s_values[i];
+            if (count == WINDOW_VALUES) {
+                qsort(window, count, sizeof(window[0]), compare_doubles);
+                sink += exact_quantile(window, count, 0.5) +
+                        exact_quantile(window, count, 0.9) +
+                        exact_quantile(window, count, 0.99);
+                count = 0;
+            }
+        }
+        updates += NUM_VALUES;
+        elapsed = now_s() - start;
+    } while (elapsed < MIN_RUN_TIME_S);
+
+    return elapsed / (double)updates;
+}
+
+// Monotonic time in seconds
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*******************************************************************************
+ * Main entrypoint
+ */
+
+int main(void)
+{
+    const size_t windows[] = {10, 100, 1000, MAX_ACCURACY_WINDOW};
+    const uint8_t quantile_counts[] = {0, 1, 3};
+    stream_stats_t stats;
+    stream_stats_summary_t summary;
+    telemetry_encoder_t enc;
+    uint8_t buf[BUF_SIZE];
+    size_t len;
+    double per_update;
+    double baseline;
+    int failed = 0;
+
+    printf("stream_stats benchmark: %u bytes per stream (%d percentiles max)\n",
+           (unsigned int)sizeof(stream_stats_t), STREAM_STATS_MAX_QUANTILES);
+
+    // Accuracy against exact statistics
+    printf("  accuracy (percentile error as %% of the window's range)\n");
+    for (int d = DIST_UNIFORM; d <= DIST_SKEWED; d++) {
+        for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+            failed |= check_accuracy((dist_t)d, windows[w]);
+        }
+    }
+
+    // Example summary as it would be published
+    stream_stats_init(&stats, 0, 0, s_quantiles, 3);
+    for (int i = 0; i < WINDOW_VALUES; i++) {
+        stream_stats_add(&stats, rand_value(DIST_NORMAL), i, NULL);
+    }
+    stream_stats_close(&stats, WINDOW_VALUES, &summary);
+    telemetry_encoder_init(&enc, TELEMETRY_FORMAT_JSON, buf, sizeof(buf) - 1);
+    stream_stats_encode(&enc, "temp", &summary);
+    if (telemetry_encoder_finish(&enc, &len) != TELEMETRY_OK) {
+        printf("  summary FAILED to encode\n");
+        failed = 1;
+    } else {
+        buf[len] = '\0';
+        printf("  summary of %d values: %s (%u bytes)\n",
+               WINDOW_VALUES, (const char *)buf, (unsigned int)len);
+    }
+
+    // Speed (normal values, windows of WINDOW_VALUES)
+    for (int i = 0; i < NUM_VALUES; i++) {
+        s_values[i] = rand_value(DIST_NORMAL);
+    }
+    printf("  speed (one stream, %d values per window)\n", WINDOW_VALUES);
+    baseline = bench_sort();
+    printf("    %-16s %7.1f ns/update  %6.2f M updates/s  (%u bytes per stream)\n",
+           "buffer + qsort",
+           baseline * 1e9,
+           1e-6 / baseline,
+           (unsigned int)(WINDOW_VALUES * sizeof(double)));
+    for (size_t q = 0; q < sizeof(quantile_counts) / sizeof(quantile_counts[0]); q++) {
+        per_update = bench_stream(quantile_counts[q]);
+        printf("    %d percentile%-5s %7.1f ns/update  %6.2f M updates/s  (%3.0f%%)\n",
+               quantile_counts[q],
+               (quantile_counts[q] == 1) ? "" : "s",
+               per_update * 1e9,
+               1e-6 / per_update,
+               100.0 * per_update / baseline);
+    }
+
+    return failed;
+}
@@ -0,0 +1,327 @@
+/**
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host-side size and speed benchmark for the telemetry_codec component.
+ *
+ * Encodes the same telemetry samples three ways: with snprintf() the way the
+ * demos build JSON today, with the codec's JSON backend, and with its CBOR
+ * backend. Every encoded message is decoded again and compared with the
+ * input. Prints encode/decode time in ns/message and bytes/message.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "telemetry_codec.h"
+
+// Settings
+#define NUM_SAMPLES         64          // Distinct samples cycled through
+#define BUF_SIZE            256         // Output buffer per message
+#define MIN_RUN_TIME_S      0.5         // Run each case for at least this long
+
+// One sensor reading (like the ones the MQTT demos publish)
+typedef struct {
+    float temperature;
+    float humidity;
+    float pressure;
+    int64_t battery_mv;
+    int64_t rssi;
+    int64_t uptime_s;
+    bool charging;
+} sample_t;
+
+// Ways of encoding a sample
+typedef enum {
+    METHOD_SNPRINTF = 0,
+    METHOD_JSON,
+    METHOD_CBOR,
+} method_t;
+
+// A benchmark case: which fields to encode
+typedef struct {
+    const char *name;
+    bool full;              // All fields, or just temperature and humidity
+} bench_case_t;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static size_t encode_sample(method_t method,
+                            const bench_case_t *bench,
+                            const sample_t *sample,
+                            uint8_t *buf);
+static int check_sample(method_t method,
+                        const bench_case_t *bench,
+                        const sample_t *sample,
+                        const uint8_t *buf,
+                        size_t len);
+static double now_s(void);
+
+// Method names
+static const char *s_method_names[] = {"snprintf json", "codec json", "codec cbor"};
+
+// Samples
+static sample_t s_samples[NUM_SAMPLES];
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Encode one sample, return the encoded length (0 on error)
+static size_t encode_sample(method_t method,
+                            const bench_case_t *bench,
+                            const sample_t *sample,
+                            uint8_t *buf)
+{
+    telemetry_encoder_t enc;
+    size_t len;
+    int num;
+
+    // Baseline: what the demos do today
+    if (method == METHOD_SNPRINTF) {
+        if (bench->full) {
+            num = snprintf((char *)buf, BUF_SIZE,
+                           "{\"temperature\":%.2f,\"humidity\":%.2f,"
+                           "\"pressure\":%.2f,\"battery_mv\":%lld,"
+                           "\"rssi\":%lld,\"uptime_s\":%lld,\"charging\":%s}",
+                           sample->temperature,
+                           sample->humidity,
+                           sample->pressure,
+                           (long long)sample->battery_mv,
+                           (long long)sample->rssi,
+                           (long long)sample->uptime_s,
+                           sample->charging ? "true" : "false");
+        } else {
+            num = snprintf((char *)buf, BUF_SIZE,
+                           "{\"temperature\":%.2f,\"humidity\":%.2f}",
+                           sample->temperature,
+                           sample->humidity);
+        }
+        return (num > 0) ? (size_t)num : 0;
+    }
+
+    // Telemetry codec
+    telemetry_encoder_init(&enc,
+                           (method == METHOD_JSON) ? TELEMETRY_FORMAT_JSON :
+                                                     TELEMETRY_FORMAT_CBOR,
+                           buf,
+                           BUF_SIZE);
+    telemetry_encode_float(&enc, "temperature", sample->temperature);
+    telemetry_encode_float(&enc, "humidity", sample->humidity);
+    if (bench->full) {
+        telemetry_encode_float(&enc, "pressure", sample->pressure);
+        telemetry_encode_int(&enc, "battery_mv", sample->battery_mv);
+        telemetry_encode_int(&enc, "rssi", sample->rssi);
+        telemetry_encode_int(&enc, "uptime_s", sample->uptime_s);
+        telemetry_encode_bool(&enc, "charging", sample->charging);
+    }
+    if (telemetry_encoder_finish(&enc, &len) != TELEMETRY_OK) {
+        return 0;
+    }
+
+    return len;
+}
+
+// Decode a message and compare it with the sample (0 if it matches)
+static int check_sample(method_t method,
+                        const bench_case_t *bench,
+                        const sample_t *sample,
+                        const uint8_t *buf,
+                        size_t len)
+{
+    telemetry_decoder_t dec;
+    telemetry_field_t field;
+    telemetry_result_t ret;
+    uint32_t fields = 0;
+    float expected_f;
+    int64_t expected_i;
+
+    ret = telemetry_decoder_init(&dec,
+                                 (method == METHOD_CBOR) ? TELEMETRY_FORMAT_CBOR :
+                                                           TELEMETRY_FORMAT_JSON,
+                                 buf,
+                                 len);
+    if (ret != TELEMETRY_OK) {
+        return -1;
+    }
+
+    while ((ret = telemetry_decoder_next(&dec, &field)) == TELEMETRY_OK) {
+        fields++;
+
+        // Floats (JSON is rounded to TELEMETRY_FLOAT_DECIMALS)
+        expected_f = NAN;
+        if (strncmp(field.key, "temperature", field.key_len) == 0) {
+            expected_f = sample->temperature;
+        } else if (strncmp(field.key, "humidity", field.key_len) == 0) {
+            expected_f = sample->humidity;
+        } else if (strncmp(field.key, "pressure", field.key_len) == 0) {
+            expected_f = sample->pressure;
+        }
+        if (!isnan(expected_f)) {
+            if ((field.type != TELEMETRY_TYPE_FLOAT) &&
+                (field.type != TELEMETRY_TYPE_INT)) {
+                return -1;
+            }
+            if (field.type == TELEMETRY_TYPE_INT) {
+                field.value.f = (float)field.value.i;
+            }
+            if (fabsf(field.value.f - expected_f) > 0.006f) {
+                return -1;
+            }
+            continue;
+        }
+
+        // Booleans
+        if (strncmp(field.key, "charging", field.key_len) == 0) {
+            if ((field.type != TELEMETRY_TYPE_BOOL) ||
+                (field.value.b != sample->charging)) {
+                return -1;
+            }
+            continue;
+        }
+
+        // Integers
+        if (strncmp(field.key, "battery_mv", field.key_len) == 0) {
+            expected_i = sample->battery_mv;
+        } else if (strncmp(field.key, "rssi", field.key_len) == 0) {
+            expected_i = sample->rssi;
+        } else if (strncmp(field.key, "uptime_s", field.key_len) == 0) {
+            expected_i = sample->uptime_s;
+        } else {
+            return -1;
+        }
+        if ((field.type != TELEMETRY_TYPE_INT) || (field.value.i != expected_i)) {
+            return -1;
+        }
+    }
+
+    if ((ret != TELEMETRY_END) || (fields != (bench->full ? 7U : 2U))) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Monotonic time in seconds
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*******************************************************************************
+ * Main entrypoint
+ */
+
+int main(void)
+{
+    const bench_case_t cases[] = {
+        { .name = "2 fields", .full = false },
+        { .name = "7 fields", .full = true },
+    };
+    static uint8_t buf[NUM_SAMPLES][BUF_SIZE];
+    size_t lens[NUM_SAMPLES];
+    size_t total_bytes;
+    size_t baseline_bytes = 0;
+    unsigned long iterations;
+    double start;
+    double enc_elapsed;
+    double dec_elapsed;
+    volatile uint32_t sink = 0;
+    telemetry_decoder_t dec;
+    telemetry_field_t field;
+    int failed = 0;
+
+    // Sensor-like samples: whole numbers, halves, and arbitrary readings
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        s_samples[i].temperature = (i % 4 == 0) ? 25.0f :
+                                   (i % 4 == 1) ? 21.5f :
+                                   18.0f + (float)i * 0.37f;
+        s_samples[i].humidity = (i % 2 == 0) ? 50.0f : 40.0f + (float)i * 0.21f;
+        s_samples[i].pressure = 1013.25f - (float)i * 0.13f;
+        s_samples[i].battery_mv = 3700 + i;
+        s_samples[i].rssi = -40 - i;
+        s_samples[i].uptime_s = 86400L * 3 + i * 5;
+        s_samples[i].charging = (i % 3 == 0);
+    }
+
+    printf("telemetry_codec benchmark: %d samples, %d float decimals\n",
+           NUM_SAMPLES, TELEMETRY_FLOAT_DECIMALS);
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        printf("  %s\n", cases[c].name);
+
+        for (int m = METHOD_SNPRINTF; m <= METHOD_CBOR; m++) {
+
+            // Encode every sample once and check it decodes to the same values
+            total_bytes = 0;
+            for (int i = 0; i < NUM_SAMPLES; i++) {
+                lens[i] = encode_sample((method_t)m, &cases[c], &s_samples[i], buf[i]);
+                total_bytes += lens[i];
+                if ((lens[i] == 0) ||
+                    (check_sample((method_t)m, &cases[c], &s_samples[i],
+                                  buf[i], lens[i]) != 0)) {
+                    printf("    %-14s FAILED on sample %d\n", s_method_names[m], i);
+                    failed = 1;
+                    break;
+                }
+            }
+            if (m == METHOD_SNPRINTF) {
+                baseline_bytes = total_bytes;
+            }
+
+            // Measure encoding
+            iterations = 0;
+            start = now_s();
+            do {
+                for (int i = 0; i < NUM_SAMPLES; i++) {
+                    sink += (uint32_t)encode_sample((method_t)m, &cases[c],
+                                                    &s_samples[i], buf[i]);
+                }
+                iterations += NUM_SAMPLES;
+                enc_elapsed = now_s() - start;
+            } while (enc_elapsed < MIN_RUN_TIME_S);
+            enc_elapsed /= (double)iterations;
+
+            // Measure decoding (walk every field)
+            iterations = 0;
+            start = now_s();
+            do {
+                for (int i = 0; i < NUM_SAMPLES; i++) {
+                    telemetry_decoder_init(&dec,
+                                           (m == METHOD_CBOR) ? TELEMETRY_FORMAT_CBOR :
+                                                                TELEMETRY_FORMAT_JSON,
+                                           buf[i],
+                                           lens[i]);
+                    while (telemetry_decoder_next(&dec, &field) == TELEMETRY_OK) {
+                        sink += (uint32_t)field.key_len;
+                    }
+                }
+                iterations += NUM_SAMPLES;
+                dec_elapsed = now_s() - start;
+            } while (dec_elapsed < MIN_RUN_TIME_S);
+            dec_elapsed /= (double)iterations;
+
+            printf("    %-14s %6.1f bytes/msg (%3.0f%%)  "
+                   "encode %7.1f ns/msg  decode %7.1f ns/msg\n",
+                   s_method_names[m],
+                   (double)total_bytes / NUM_SAMPLES,
+                   100.0 * (double)total_bytes / (double)baseline_bytes,
+                   enc_elapsed * 1e9,
+                   dec_elapsed * 1e9);
+        }
+    }
+
+    return failed;
+}
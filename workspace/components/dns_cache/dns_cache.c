@@ -0,0 +1,433 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Small fixed-size cache of getaddrinfo() results keyed by hostname.
+ *
+ * Every getaddrinfo() miss costs at least one round trip to the DNS server
+ * before the TCP handshake can even start. Entries are kept for a fixed TTL
+ * and dropped when the network driver reports that the IP address was lost,
+ * since the resolver (and the right answer) may differ on the next network.
+ */
+
+#include <fcntl.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+
+#include "dns_cache.h"
+#include "net_timeline.h"
+
+// Tag for debug messages
+static const char *TAG = "dns_cache";
+
+// One cached hostname
+typedef struct {
+    bool valid;                     // Entry holds addresses
+    int family;                     // Family requested in the lookup
+    char host[DNS_CACHE_HOST_MAX];  // Hostname
+    int64_t expires_us;             // esp_timer time when TTL runs out
+    int64_t last_used_us;           // esp_timer time of last hit (for LRU)
+    dns_cache_result_t addrs;       // Ordered addresses (port not set)
+} cache_entry_t;
+
+// Static global variables
+static cache_entry_t s_entries[CONFIG_DNS_CACHE_ENTRIES];
+static dns_cache_stats_t s_stats = {0};
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static cache_entry_t *find_entry(const char *host, int family);
+static cache_entry_t *alloc_entry(void);
+static void order_addresses(const struct addrinfo *res,
+                            int family,
+                            dns_cache_result_t *out);
+static void copy_result(const dns_cache_result_t *src,
+                        uint16_t port,
+                        dns_cache_result_t *dst);
+static int start_connect(const struct sockaddr_storage *addr,
+                         socklen_t addr_len,
+                         bool *connected);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Find the entry for a hostname and family (call with lock held)
+static cache_entry_t *find_entry(const char *host, int family)
+{
+    for (int i = 0; i < CONFIG_DNS_CACHE_ENTRIES; i++) {
+        if (s_entries[i].valid &&
+            (s_entries[i].family == family) &&
+            (strcmp(s_entries[i].host, host) == 0)) {
+            return &s_entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Get a free entry, or the least recently used one (call with lock held)
+static cache_entry_t *alloc_entry(void)
+{
+    cache_entry_t *oldest = &s_entries[0];
+
+    for (int i = 0; i < CONFIG_DNS_CACHE_ENTRIES; i++) {
+        if (!s_entries[i].valid) {
+            return &s_entries[i];
+        }
+        if (s_entries[i].last_used_us < oldest->last_used_us) {
+            oldest = &s_entries[i];
+        }
+    }
+
+    return oldest;
+}
+
+// Copy addresses in connection order (interleave IPv6/IPv4 for AF_UNSPEC)
+static void order_addresses(const struct addrinfo *res,
+                            int family,
+                            dns_cache_result_t *out)
+{
+    const struct addrinfo *v6[DNS_CACHE_MAX_ADDRS];
+    const struct addrinfo *v4[DNS_CACHE_MAX_ADDRS];
+    size_t num_v6 = 0;
+    size_t num_v4 = 0;
+    size_t i6 = 0;
+    size_t i4 = 0;
+    const struct addrinfo *ai;
+
+    // Split by family, keeping the resolver's order within each family
+    for (ai = res; ai != NULL; ai = ai->ai_next) {
+        if ((ai->ai_family == AF_INET6) && (num_v6 < DNS_CACHE_MAX_ADDRS)) {
+            v6[num_v6++] = ai;
+        } else if ((ai->ai_family == AF_INET) && (num_v4 < DNS_CACHE_MAX_ADDRS)) {
+            v4[num_v4++] = ai;
+        }
+    }
+
+    // Alternate families starting with IPv6 (RFC 8305, section 4)
+    memset(out, 0, sizeof(*out));
+    while ((out->count < DNS_CACHE_MAX_ADDRS) &&
+           ((i6 < num_v6) || (i4 < num_v4))) {
+        if (i6 < num_v6) {
+            ai = v6[i6++];
+        } else {
+            ai = v4[i4++];
+        }
+        memcpy(&out->addrs[out->count], ai->ai_addr, ai->ai_addrlen);
+        out->addr_lens[out->count] = ai->ai_addrlen;
+        out->count++;
+
+        // Without AF_UNSPEC there is only one family, so keep the order
+        if ((family == AF_UNSPEC) &&
+            (i4 < num_v4) &&
+            (out->count < DNS_CACHE_MAX_ADDRS)) {
+            ai = v4[i4++];
+            memcpy(&out->addrs[out->count], ai->ai_addr, ai->ai_addrlen);
+            out->addr_lens[out->count] = ai->ai_addrlen;
+            out->count++;
+        }
+    }
+}
+
+// Copy cached addresses to the caller and fill in the port
+static void copy_result(const dns_cache_result_t *src,
+                        uint16_t port,
+                        dns_cache_result_t *dst)
+{
+    memcpy(dst, src, sizeof(*dst));
+    for (size_t i = 0; i < dst->count; i++) {
+        if (dst->addrs[i].ss_family == AF_INET) {
+            ((struct sockaddr_in *)&dst->addrs[i])->sin_port = htons(port);
+        } else if (dst->addrs[i].ss_family == AF_INET6) {
+            ((struct sockaddr_in6 *)&dst->addrs[i])->sin6_port = htons(port);
+        }
+    }
+}
+
+// Start a non-blocking TCP connection, return socket or -1 on failure
+static int start_connect(const struct sockaddr_storage *addr,
+                         socklen_t addr_len,
+                         bool *connected)
+{
+    int sock;
+    int flags;
+
+    *connected = false;
+
+    // Create socket
+    sock = socket(addr->ss_family, SOCK_STREAM, IPPROTO_TCP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket (%d): %s", errno, strerror(errno));
+        return -1;
+    }
+
+    // Make connect() return immediately
+    flags = fcntl(sock, F_GETFL, 0);
+    if (fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0) {
+        ESP_LOGE(TAG, "Failed to set socket non-blocking (%d)", errno);
+        close(sock);
+        return -1;
+    }
+
+    // Start connecting
+    if (connect(sock, (const struct sockaddr *)addr, addr_len) == 0) {
+        *connected = true;
+    } else if (errno != EINPROGRESS) {
+        ESP_LOGD(TAG, "Connect attempt failed (%d): %s", errno, strerror(errno));
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Resolve a hostname, using the cache when possible
+esp_err_t dns_cache_lookup(const char *host,
+                           uint16_t port,
+                           int family,
+                           dns_cache_result_t *result)
+{
+    cache_entry_t *entry;
+    dns_cache_result_t resolved;
+    struct addrinfo *res = NULL;
+    int64_t now_us;
+    int64_t query_us;
+    bool hit = false;
+    int ret;
+
+    // Hints for DNS lookup
+    struct addrinfo hints = {
+        .ai_family = family,
+        .ai_socktype = SOCK_STREAM,
+    };
+
+    // Serve from memory if we have a fresh entry
+    now_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_lock);
+    entry = find_entry(host, family);
+    if ((entry != NULL) && (now_us >= entry->expires_us)) {
+        entry->valid = false;
+        s_stats.expired++;
+        entry = NULL;
+    }
+    if (entry != NULL) {
+        copy_result(&entry->addrs, port, result);
+        entry->last_used_us = now_us;
+        s_stats.hits++;
+        hit = true;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    if (hit) {
+        result->from_cache = true;
+        return ESP_OK;
+    }
+
+    // Ask the DNS server (note: blocking)
+    net_timeline_record(NET_TIMELINE_DNS_QUERY, 0);
+    ret = getaddrinfo(host, NULL, &hints, &res);
+    query_us = esp_timer_get_time() - now_us;
+    net_timeline_record(NET_TIMELINE_DNS_ANSWER, ret);
+    if ((ret != 0) || (res == NULL)) {
+        ESP_LOGE(TAG, "DNS lookup for %s failed (%d)", host, ret);
+        if (res != NULL) {
+            freeaddrinfo(res);
+        }
+        return ESP_ERR_NOT_FOUND;
+    }
+    order_addresses(res, family, &resolved);
+    freeaddrinfo(res);
+    if (resolved.count == 0) {
+        ESP_LOGE(TAG, "DNS lookup for %s returned no usable addresses", host);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Store for later (hostnames too long to cache are still returned)
+    now_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.misses++;
+    s_stats.last_query_us = query_us;
+    if (strlen(host) < DNS_CACHE_HOST_MAX) {
+        entry = find_entry(host, family);
+        if (entry == NULL) {
+            entry = alloc_entry();
+        }
+        entry->valid = true;
+        entry->family = family;
+        strcpy(entry->host, host);
+        entry->expires_us = now_us + (int64_t)CONFIG_DNS_CACHE_TTL_SEC * 1000000;
+        entry->last_used_us = now_us;
+        memcpy(&entry->addrs, &resolved, sizeof(resolved));
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    ESP_LOGD(TAG, "Resolved %s in %lld us", host, query_us);
+
+    // Return the new addresses
+    copy_result(&resolved, port, result);
+    result->from_cache = false;
+
+    return ESP_OK;
+}
+
+// Connect a TCP socket to the first reachable address (happy eyeballs)
+esp_err_t dns_cache_connect(const dns_cache_result_t *result,
+                            uint32_t timeout_ms,
+                            int *sock)
+{
+    int socks[DNS_CACHE_MAX_ADDRS];
+    size_t next = 0;
+    size_t in_flight = 0;
+    int winner = -1;
+    int64_t now_us;
+    int64_t deadline_us;
+    int64_t next_attempt_us = 0;
+    int64_t wait_us;
+    bool connected;
+    bool timed_out = false;
+    struct timeval tv;
+    fd_set write_fds;
+    int max_fd;
+    int sock_err;
+    socklen_t err_len;
+    int flags;
+    int ret;
+
+    // Nothing to connect to
+    if (result->count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (size_t i = 0; i < DNS_CACHE_MAX_ADDRS; i++) {
+        socks[i] = -1;
+    }
+    deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+
+    while (winner < 0) {
+        now_us = esp_timer_get_time();
+        if (now_us >= deadline_us) {
+            timed_out = true;
+            break;
+        }
+
+        // Start the next address if nothing is in flight or the delay passed
+        if ((next < result->count) &&
+            ((in_flight == 0) || (now_us >= next_attempt_us))) {
+            socks[next] = start_connect(&result->addrs[next],
+                                        result->addr_lens[next],
+                                        &connected);
+            if ((socks[next] >= 0) && connected) {
+                winner = (int)next;
+                break;
+            }
+            if (socks[next] >= 0) {
+                in_flight++;
+            }
+            next++;
+            next_attempt_us = now_us +
+                              (int64_t)CONFIG_DNS_CACHE_CONNECT_DELAY_MS * 1000;
+            continue;
+        }
+
+        // Every address has been tried and failed
+        if (in_flight == 0) {
+            break;
+        }
+
+        // Wait until an attempt completes, the next one is due, or time is up
+        wait_us = deadline_us - now_us;
+        if ((next < result->count) && (next_attempt_us - now_us < wait_us)) {
+            wait_us = next_attempt_us - now_us;
+        }
+        FD_ZERO(&write_fds);
+        max_fd = -1;
+        for (size_t i = 0; i < next; i++) {
+            if (socks[i] >= 0) {
+                FD_SET(socks[i], &write_fds);
+                if (socks[i] > max_fd) {
+                    max_fd = socks[i];
+                }
+            }
+        }
+        tv.tv_sec = (time_t)(wait_us / 1000000);
+        tv.tv_usec = (suseconds_t)(wait_us % 1000000);
+        ret = select(max_fd + 1, NULL, &write_fds, NULL, &tv);
+        if (ret < 0) {
+            ESP_LOGE(TAG, "select() failed (%d): %s", errno, strerror(errno));
+            break;
+        }
+
+        // Check which attempts finished (writable means done or failed)
+        for (size_t i = 0; (i < next) && (ret > 0); i++) {
+            if ((socks[i] < 0) || !FD_ISSET(socks[i], &write_fds)) {
+                continue;
+            }
+            sock_err = 0;
+            err_len = sizeof(sock_err);
+            getsockopt(socks[i], SOL_SOCKET, SO_ERROR, &sock_err, &err_len);
+            if (sock_err == 0) {
+                winner = (int)i;
+                break;
+            }
+
+            // Failed attempt: start the next address right away
+            ESP_LOGD(TAG, "Connect attempt %u failed (%d)", (unsigned)i, sock_err);
+            close(socks[i]);
+            socks[i] = -1;
+            in_flight--;
+            next_attempt_us = now_us;
+        }
+    }
+
+    // Close every attempt that lost the race
+    for (size_t i = 0; i < next; i++) {
+        if ((socks[i] >= 0) && ((int)i != winner)) {
+            close(socks[i]);
+        }
+    }
+    if (winner < 0) {
+        return timed_out ? ESP_ERR_TIMEOUT : ESP_FAIL;
+    }
+
+    // Hand back a normal blocking socket
+    flags = fcntl(socks[winner], F_GETFL, 0);
+    fcntl(socks[winner], F_SETFL, flags & ~O_NONBLOCK);
+    *sock = socks[winner];
+
+    return ESP_OK;
+}
+
+// Drop cached entries
+void dns_cache_invalidate(const char *host)
+{
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < CONFIG_DNS_CACHE_ENTRIES; i++) {
+        if (s_entries[i].valid &&
+            ((host == NULL) || (strcmp(s_entries[i].host, host) == 0))) {
+            s_entries[i].valid = false;
+            s_stats.invalidated++;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+// Get cache statistics
+void dns_cache_get_stats(dns_cache_stats_t *stats)
+{
+    taskENTER_CRITICAL(&s_lock);
+    memcpy(stats, &s_stats, sizeof(*stats));
+    taskEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,114 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "lwip/sockets.h"
+#include "sdkconfig.h"
+
+/**
+ * @brief Maximum number of addresses returned by one lookup
+ */
+#ifdef CONFIG_DNS_CACHE_MAX_ADDRS
+# define DNS_CACHE_MAX_ADDRS CONFIG_DNS_CACHE_MAX_ADDRS
+#else
+# define DNS_CACHE_MAX_ADDRS 4
+#endif
+
+/**
+ * @brief Longest hostname that can be cached (including NUL terminator)
+ */
+#define DNS_CACHE_HOST_MAX 64
+
+/**
+ * @brief Resolved addresses for one host and port, in connection order
+ *
+ * For AF_UNSPEC lookups, IPv6 and IPv4 addresses are interleaved (IPv6
+ * first) as recommended by RFC 8305 (happy eyeballs).
+ */
+typedef struct {
+    struct sockaddr_storage addrs[DNS_CACHE_MAX_ADDRS];
+    socklen_t addr_lens[DNS_CACHE_MAX_ADDRS];
+    size_t count;           // Number of valid addresses
+    bool from_cache;        // True if served without a DNS query
+} dns_cache_result_t;
+
+/**
+ * @brief Cache statistics
+ */
+typedef struct {
+    uint32_t hits;          // Lookups served from memory
+    uint32_t misses;        // Lookups that needed a DNS query
+    uint32_t expired;       // Entries dropped because their TTL ran out
+    uint32_t invalidated;   // Entries dropped by dns_cache_invalidate()
+    int64_t last_query_us;  // Duration of the most recent DNS query
+} dns_cache_stats_t;
+
+/**
+ * @brief Resolve a hostname, using the cache when possible
+ *
+ * On a miss, calls getaddrinfo() and stores the result for
+ * CONFIG_DNS_CACHE_TTL_SEC seconds. Safe to call from multiple tasks.
+ *
+ * @param[in] host Hostname to resolve
+ * @param[in] port Port number (host byte order) to set in each address
+ * @param[in] family AF_INET, AF_INET6, or AF_UNSPEC
+ * @param[out] result Resolved addresses
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_NOT_FOUND if the lookup failed
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t dns_cache_lookup(const char *host,
+                           uint16_t port,
+                           int family,
+                           dns_cache_result_t *result);
+
+/**
+ * @brief Connect a TCP socket to the first reachable address (happy eyeballs)
+ *
+ * Starts a non-blocking connection to the first address. If it has not
+ * completed after CONFIG_DNS_CACHE_CONNECT_DELAY_MS, starts the next address
+ * while keeping the earlier attempt open, and so on. The first connection to
+ * complete wins and the others are closed. The returned socket is blocking.
+ *
+ * @param[in] result Addresses from dns_cache_lookup()
+ * @param[in] timeout_ms Overall time limit for connecting
+ * @param[out] sock Connected socket
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_TIMEOUT if no address connected in time
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t dns_cache_connect(const dns_cache_result_t *result,
+                            uint32_t timeout_ms,
+                            int *sock);
+
+/**
+ * @brief Drop cached entries
+ *
+ * Called by the network drivers when the interface loses its IP address.
+ * Also call it after a connection to a cached address fails so the next
+ * lookup asks the DNS server again.
+ *
+ * @param[in] host Hostname to drop, or NULL to drop every entry
+ */
+void dns_cache_invalidate(const char *host);
+
+/**
+ * @brief Get cache statistics
+ *
+ * @param[out] stats Statistics since boot
+ */
+void dns_cache_get_stats(dns_cache_stats_t *stats);
+
+#endif // DNS_CACHE_H
@@ -7,8 +7,18 @@
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_netif.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#if CONFIG_DNS_CACHE
+# include "dns_cache.h"
+#endif
 
 #include "ethernet_qemu.h"
+#include "net_timeline.h"
+
+// Settings
+#define RESTART_TASK_STACK_SIZE 4096
+#define RESTART_TASK_PRIORITY   5
 
 // Tag for debug messages
 static const char *TAG = "eth_qemu";
@@ -20,6 +30,10 @@ static esp_eth_mac_t *s_eth_mac = NULL;
 static esp_netif_t *s_eth_netif = NULL;
 static esp_eth_netif_glue_handle_t s_eth_glue = NULL;
 static EventGroupHandle_t s_eth_event_group = NULL;
+#if CONFIG_ETHERNET_QEMU_AUTO_RECONNECT
+static reconnect_backoff_t s_backoff;
+static TaskHandle_t s_restart_task = NULL;
+#endif
 
 /*******************************************************************************
  * Private function prototypes
@@ -35,6 +49,12 @@ static void on_ip_event(void *arg,
                         int32_t event_id, 
                         void *event_data);
 
+static esp_err_t eth_restart(void);
+#if CONFIG_ETHERNET_QEMU_AUTO_RECONNECT
+static esp_err_t reconnect_attempt(void *arg);
+static void restart_task(void *arg);
+#endif
+
 /*******************************************************************************
  * Private function definitions
  */
@@ -75,6 +95,7 @@ static void on_eth_event(void *arg,
             // Get MAC address
             esp_eth_ioctl(eth_handle, ETH_CMD_G_MAC_ADDR, mac_addr);
             ESP_LOGI(TAG, "Ethernet link up");
+            net_timeline_record(NET_TIMELINE_LINK_UP, 0);
             ESP_LOGI(TAG, 
                      "Ethernet MAC address: %02x:%02x:%02x:%02x:%02x:%02x",
                      mac_addr[0], 
@@ -103,9 +124,10 @@ static void on_eth_event(void *arg,
             xEventGroupClearBits(s_eth_event_group, 
                                  ETHERNET_QEMU_CONNECTED_BIT);
             ESP_LOGI(TAG, "Ethernet disconnected");
+            net_timeline_record(NET_TIMELINE_LINK_DOWN, 0);
 #if CONFIG_ETHERNET_QEMU_AUTO_RECONNECT
-            ESP_LOGI(TAG, "Attempting to reconnect...");
-            eth_qemu_reconnect();
+            // Restart the driver after a randomized, growing delay
+            reconnect_backoff_schedule(&s_backoff, RECONNECT_CAUSE_LINK_LOST);
 #endif
             break;
 
@@ -140,11 +162,15 @@ static void on_ip_event(void *arg,
             // Set connected bit
             xEventGroupSetBits(s_eth_event_group, 
                                ETHERNET_QEMU_IPV4_OBTAINED_BIT);
+#if CONFIG_ETHERNET_QEMU_AUTO_RECONNECT
+            reconnect_backoff_connected(&s_backoff);
+#endif
             
             // Print IPv4 address
             ip_event_got_ip_t *event_ip = (ip_event_got_ip_t *)event_data;
             esp_netif_ip_info_t *ip_info = &event_ip->ip_info;
             ESP_LOGI(TAG, "Ethernet IPv4 address obtained");
+            net_timeline_record(NET_TIMELINE_GOT_IP, 0);
             ESP_LOGI(TAG, "  IP address: " IPSTR, IP2STR(&ip_info->ip));
             ESP_LOGI(TAG, "  Netmask: " IPSTR, IP2STR(&ip_info->netmask));
             ESP_LOGI(TAG, "  Gateway: " IPSTR, IP2STR(&ip_info->gw));
@@ -163,14 +189,23 @@ static void on_ip_event(void *arg,
                 return;
             }
 
+            // IPv6 events are shared by all interfaces: ignore the others
+            if (((ip_event_got_ip6_t *)event_data)->esp_netif != s_eth_netif) {
+                return;
+            }
+
             // Set connected bit
             xEventGroupSetBits(s_eth_event_group, 
                                ETHERNET_QEMU_IPV6_OBTAINED_BIT);
+#if CONFIG_ETHERNET_QEMU_AUTO_RECONNECT
+            reconnect_backoff_connected(&s_backoff);
+#endif
             
             // Print IPv6 address
             ip_event_got_ip6_t *event_ipv6 = (ip_event_got_ip6_t *)event_data;
             esp_netif_ip6_info_t *ip6_info = &event_ipv6->ip6_info;
             ESP_LOGI(TAG, "Ethernet IPv6 address obtained");
+            net_timeline_record(NET_TIMELINE_GOT_IP6, 0);
             ESP_LOGI(TAG, "  IP address: " IPV6STR, IPV62STR(ip6_info->ip));
 
             break;
@@ -183,6 +218,11 @@ static void on_ip_event(void *arg,
             xEventGroupClearBits(s_eth_event_group,
                                  ETHERNET_QEMU_IPV6_OBTAINED_BIT);
             ESP_LOGI(TAG, "Ethernet lost IP address");
+            net_timeline_record(NET_TIMELINE_IP_LOST, 0);
+#if CONFIG_DNS_CACHE
+            // Cached addresses may not be valid on the next network
+            dns_cache_invalidate(NULL);
+#endif
             break;
 
         // Default case: do nothing
@@ -192,6 +232,85 @@ static void on_ip_event(void *arg,
     }
 }
 
+// Stop and start the Ethernet driver
+static esp_err_t eth_restart(void)
+{
+    esp_err_t esp_ret;
+
+    // Stop Ethernet
+    esp_ret = eth_qemu_stop();
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to stop Ethernet");
+        return esp_ret;
+    }
+
+    // Initialize Ethernet
+    esp_ret = eth_qemu_init(NULL);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize Ethernet");
+        return esp_ret;
+    }
+
+    return ESP_OK;
+}
+
+#if CONFIG_ETHERNET_QEMU_AUTO_RECONNECT
+// Start one reconnect attempt (called by the reconnect scheduler in the
+// esp_timer task, so the restart itself is left to the restart task)
+static esp_err_t reconnect_attempt(void *arg)
+{
+    if (s_restart_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xTaskNotifyGive(s_restart_task);
+
+    return ESP_OK;
+}
+
+// Task: tear down and reinstall the driver whenever an attempt is due (the
+// only place restarts run, so scheduled and manual ones never overlap)
+static void restart_task(void *arg)
+{
+    esp_err_t esp_ret;
+    EventBits_t bits;
+    uint32_t delay_ms;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        ESP_LOGI(TAG, "Attempting to reconnect...");
+
+        // If the restart fails, back off and try again
+        esp_ret = eth_restart();
+        if (esp_ret != ESP_OK) {
+            delay_ms = reconnect_backoff_retry(&s_backoff);
+            ESP_LOGW(TAG, 
+                     "Error (%d): Restart failed, retrying in %lu ms", 
+                     esp_ret, 
+                     delay_ms);
+            continue;
+        }
+
+        // A restart that never gets an IP address counts as failed too
+        bits = xEventGroupWaitBits(s_eth_event_group,
+                                   ETHERNET_QEMU_IPV4_OBTAINED_BIT |
+                                   ETHERNET_QEMU_IPV6_OBTAINED_BIT,
+                                   pdFALSE,
+                                   pdFALSE,
+                                   pdMS_TO_TICKS(
+                                       CONFIG_ETHERNET_QEMU_RESTART_TIMEOUT_MS));
+        if ((bits & (ETHERNET_QEMU_IPV4_OBTAINED_BIT | 
+                     ETHERNET_QEMU_IPV6_OBTAINED_BIT)) == 0 &&
+            !reconnect_backoff_pending(&s_backoff)) {
+            delay_ms = reconnect_backoff_retry(&s_backoff);
+            ESP_LOGW(TAG, 
+                     "No IP address %d ms after restart, retrying in %lu ms", 
+                     CONFIG_ETHERNET_QEMU_RESTART_TIMEOUT_MS, 
+                     delay_ms);
+        }
+    }
+}
+#endif
+
 /*******************************************************************************
  * Public functions
  */
@@ -203,6 +322,7 @@ esp_err_t eth_qemu_init(EventGroupHandle_t event_group)
 
     // Print message
     ESP_LOGI(TAG, "Starting Ethernet...");
+    net_timeline_record(NET_TIMELINE_DRIVER_START, 0);
 
     // Save the event group handle
     if (event_group != NULL) {
@@ -213,6 +333,31 @@ esp_err_t eth_qemu_init(EventGroupHandle_t event_group)
         return ESP_FAIL;
     }
 
+#if CONFIG_ETHERNET_QEMU_AUTO_RECONNECT
+    // Set up the reconnect scheduler (kept across restarts)
+    esp_ret = reconnect_backoff_init(&s_backoff, 
+                                     "eth_qemu", 
+                                     reconnect_attempt, 
+                                     NULL);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize reconnect scheduler");
+        return esp_ret;
+    }
+
+    // Restarts run in their own task, not in the shared esp_timer task
+    if (s_restart_task == NULL) {
+        if (xTaskCreate(restart_task, 
+                        "eth_restart", 
+                        RESTART_TASK_STACK_SIZE, 
+                        NULL, 
+                        RESTART_TASK_PRIORITY, 
+                        &s_restart_task) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create restart task");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+#endif
+
     // Initialize network interface for Ethernet
     esp_netif_config_t netif_config = ESP_NETIF_DEFAULT_ETH();
     s_eth_netif = esp_netif_new(&netif_config);
@@ -307,6 +452,7 @@ esp_err_t eth_qemu_init(EventGroupHandle_t event_group)
     }
 
     // Start Ethernet driver
+    net_timeline_record(NET_TIMELINE_CONNECT, 0);
     esp_ret = esp_eth_start(s_eth_handle);
     if (esp_ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start Ethernet driver");
@@ -324,6 +470,11 @@ esp_err_t eth_qemu_stop(void)
     // Print message
     ESP_LOGI(TAG, "Stopping Ethernet...");
 
+#if CONFIG_ETHERNET_QEMU_AUTO_RECONNECT
+    // Don't let a scheduled attempt run while the driver is down
+    reconnect_backoff_cancel(&s_backoff);
+#endif
+
     // Unregister Ethernet event handlers
     esp_ret = esp_event_handler_unregister(ETH_EVENT, 
                                            ESP_EVENT_ANY_ID, 
@@ -442,21 +593,38 @@ esp_err_t eth_qemu_stop(void)
 // Attempt reconnection to Ethernet
 esp_err_t eth_qemu_reconnect(void)
 {
-    esp_err_t esp_ret;
-
-    // Stop Ethernet
-    esp_ret = eth_qemu_stop();
-    if (esp_ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to stop Ethernet");
-        return esp_ret;
+#if CONFIG_ETHERNET_QEMU_AUTO_RECONNECT
+    // Leave it to the scheduler so the retries stay spread out
+    if (reconnect_backoff_pending(&s_backoff)) {
+        ESP_LOGI(TAG, "Reconnect already scheduled");
+        return ESP_OK;
     }
 
-    // Initialize Ethernet
-    esp_ret = eth_qemu_init(NULL);
-    if (esp_ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize Ethernet");
-        return esp_ret;
+    // Restart in the restart task so it can't overlap a scheduled attempt
+    if (s_restart_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
     }
+    xTaskNotifyGive(s_restart_task);
 
     return ESP_OK;
-}
\ No newline at end of file
+#else
+    return eth_restart();
+#endif
+}
+
+// Get reconnection statistics
+esp_err_t eth_qemu_get_reconnect_stats(reconnect_stats_t *stats)
+{
+#if CONFIG_ETHERNET_QEMU_AUTO_RECONNECT
+    reconnect_backoff_get_stats(&s_backoff, stats);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+// Get the Ethernet network interface
+esp_netif_t *eth_qemu_get_netif(void)
+{
+    return s_eth_netif;
+}
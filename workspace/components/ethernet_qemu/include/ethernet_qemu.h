@@ -7,6 +7,8 @@
 #define ETHERNET_QEMU_H
 
 #include "esp_err.h"
+#include "esp_netif.h"
+#include "reconnect_backoff.h"
 
 /**
  * @brief Event group bits for Ethernet events
@@ -44,10 +46,34 @@ esp_err_t eth_qemu_stop(void);
 /**
  * @brief Attempt to reconnect Ethernet for QEMU
  * 
+ * With ETHERNET_QEMU_AUTO_RECONNECT, the driver is restarted by the restart
+ * task (one restart at a time) and this function returns without waiting
+ * for it; wait for the IP obtained bits instead.
+ * 
  * @return
  *  - ESP_OK on success
  *  - Other errors on failure. See esp_err.h for error codes.
  */
 esp_err_t eth_qemu_reconnect(void);
 
-#endif // ETHERNET_QEMU_H
\ No newline at end of file
+/**
+ * @brief Get automatic reconnection statistics
+ * 
+ * Includes the time it took to reconnect after each outage.
+ * 
+ * @param[out] stats Statistics since boot
+ * 
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_NOT_SUPPORTED if ETHERNET_QEMU_AUTO_RECONNECT is disabled
+ */
+esp_err_t eth_qemu_get_reconnect_stats(reconnect_stats_t *stats);
+
+/**
+ * @brief Get the Ethernet network interface
+ * 
+ * @return Interface handle, or NULL if the driver is not running
+ */
+esp_netif_t *eth_qemu_get_netif(void);
+
+#endif // ETHERNET_QEMU_H
@@ -0,0 +1,874 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Log-structured FIFO of messages in a dedicated flash partition.
+ *
+ * The partition is used as a ring of erase sectors. Records are only ever
+ * appended at the head: message records, and small acknowledgement (ACK)
+ * records that say which messages have been consumed. Nothing is rewritten
+ * in place, so each flash byte is programmed once per erase cycle. The ring
+ * advances through every sector in turn, which spreads wear evenly.
+ *
+ * Record layout (padded to 4 bytes, never spans a sector):
+ *
+ *   | magic (2) | len (2) | seq (4) | crc32 (4) | payload (len) | 0xFF pad |
+ *
+ * Every record gets the next sequence number, so the sector holding the
+ * lowest first sequence number is the tail. On boot the partition is scanned
+ * to find the head, the tail, and the highest acknowledged message.
+ *
+ * Messages sent by flash_queue_drain() are kept in an in-flight list until
+ * the receiver acknowledges them, and only the oldest run of acknowledged
+ * messages is consumed. Sectors are not reclaimed past the oldest message
+ * still in flight, so a reset before the acknowledgement sends it again.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "flash_queue.h"
+
+// Record types (value of an erased header is 0xFFFF)
+#define MAGIC_DATA      0x5144
+#define MAGIC_ACK       0x4B41
+#define MAGIC_ERASED    0xFFFF
+
+// Capacity of the in-flight list
+#define IN_FLIGHT_MAX   CONFIG_FLASH_QUEUE_MAX_IN_FLIGHT
+
+// Record sizes
+#define HDR_SIZE        sizeof(record_hdr_t)
+#define RECORD_SIZE(len) (((HDR_SIZE + (len)) + 3) & ~((size_t)3))
+#define RECORD_MAX_SIZE RECORD_SIZE(CONFIG_FLASH_QUEUE_MAX_MSG_SIZE)
+
+// Tag for debug messages
+static const char *TAG = "flash_queue";
+
+// Record header as stored in flash
+typedef struct {
+    uint16_t magic;     // MAGIC_DATA or MAGIC_ACK
+    uint16_t len;       // Payload length (bytes)
+    uint32_t seq;       // Sequence number (increments for every record)
+    uint32_t crc;       // CRC32 of magic, len, seq, and payload
+} record_hdr_t;
+
+// Result of reading one record
+typedef enum {
+    RECORD_OK = 0,      // Valid record
+    RECORD_END,         // Erased space or end of sector
+    RECORD_CORRUPT,     // Interrupted write or bad data
+} record_result_t;
+
+// Sent message waiting for its acknowledgement
+typedef struct {
+    uint32_t seq;       // Sequence number of the message
+    uint32_t sector;    // Sector holding the message
+    int id;             // Identifier the acknowledgement will carry
+    bool acked;         // Acknowledged (possibly ahead of older messages)
+} in_flight_t;
+
+// Static global variables
+static const esp_partition_t *s_part = NULL;
+static SemaphoreHandle_t s_mutex = NULL;
+static SemaphoreHandle_t s_drain_mutex = NULL; // One drain at a time
+static uint32_t s_sector_size = 0;
+static uint32_t s_num_sectors = 0;
+static uint32_t *s_first_seq = NULL;    // First record seq per sector (0 = erased)
+static uint32_t s_head = 0;             // Sector being written
+static uint32_t s_head_off = 0;         // Next write offset in head sector
+static uint32_t s_tail = 0;             // Oldest sector holding records
+static uint32_t s_read_sector = 0;      // Sector of the next record to read
+static uint32_t s_read_off = 0;         // Offset of the next record to read
+static uint32_t s_next_seq = 1;         // Sequence number of the next record
+static uint32_t s_acked = 0;            // Last consumed message (RAM)
+static uint32_t s_acked_flash = 0;      // Last consumed message (committed)
+static uint32_t s_count = 0;            // Unconsumed messages
+static bool s_peeked = false;           // Read position holds a peeked message
+static uint32_t s_peek_seq = 0;
+static size_t s_peek_size = 0;
+static uint8_t s_scratch[RECORD_MAX_SIZE];
+static uint8_t s_drain_buf[CONFIG_FLASH_QUEUE_MAX_MSG_SIZE];
+static in_flight_t s_in_flight[IN_FLIGHT_MAX];
+static uint32_t s_in_flight_first = 0;  // Oldest entry
+static uint32_t s_in_flight_num = 0;
+static int s_early_acks[IN_FLIGHT_MAX]; // Acks that beat the drain's pop
+static uint32_t s_early_next = 0;
+static flash_queue_stats_t s_stats = {0};
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static uint32_t record_crc(const record_hdr_t *hdr, const uint8_t *payload);
+static record_result_t read_record(uint32_t sector,
+                                   uint32_t off,
+                                   record_hdr_t *hdr,
+                                   uint8_t *payload);
+static record_result_t scan_sector(uint32_t sector,
+                                   uint32_t *end_off,
+                                   uint32_t *max_seq,
+                                   uint32_t *acked);
+static esp_err_t find_pending(uint32_t *sector,
+                              uint32_t *off,
+                              record_hdr_t *hdr);
+static esp_err_t erase_sector(uint32_t sector);
+static esp_err_t advance_head(void);
+static esp_err_t append_record(uint16_t magic, const void *payload, size_t len);
+static esp_err_t commit_locked(void);
+static void release_acked(void);
+static esp_err_t pop_locked(int id);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// CRC32 over the header fields (except the CRC itself) and the payload
+static uint32_t record_crc(const record_hdr_t *hdr, const uint8_t *payload)
+{
+    uint32_t crc;
+
+    crc = esp_rom_crc32_le(0, (const uint8_t *)hdr, offsetof(record_hdr_t, crc));
+    crc = esp_rom_crc32_le(crc, payload, hdr->len);
+
+    return crc;
+}
+
+// Read and check the record at the given position
+static record_result_t read_record(uint32_t sector,
+                                   uint32_t off,
+                                   record_hdr_t *hdr,
+                                   uint8_t *payload)
+{
+    size_t addr = (size_t)sector * s_sector_size + off;
+
+    // No room for another record in this sector
+    if (off + HDR_SIZE > s_sector_size) {
+        return RECORD_END;
+    }
+
+    // Read header
+    if (esp_partition_read(s_part, addr, hdr, HDR_SIZE) != ESP_OK) {
+        return RECORD_CORRUPT;
+    }
+    if (hdr->magic == MAGIC_ERASED) {
+        return RECORD_END;
+    }
+    if (((hdr->magic != MAGIC_DATA) && (hdr->magic != MAGIC_ACK)) ||
+        (hdr->len > CONFIG_FLASH_QUEUE_MAX_MSG_SIZE) ||
+        (off + RECORD_SIZE(hdr->len) > s_sector_size)) {
+        return RECORD_CORRUPT;
+    }
+
+    // Read and check payload
+    if (esp_partition_read(s_part, addr + HDR_SIZE, payload, hdr->len) != ESP_OK) {
+        return RECORD_CORRUPT;
+    }
+    if (record_crc(hdr, payload) != hdr->crc) {
+        return RECORD_CORRUPT;
+    }
+
+    return RECORD_OK;
+}
+
+// Walk every record in a sector (used when mounting)
+static record_result_t scan_sector(uint32_t sector,
+                                   uint32_t *end_off,
+                                   uint32_t *max_seq,
+                                   uint32_t *acked)
+{
+    record_hdr_t hdr;
+    record_result_t ret;
+    uint32_t off = 0;
+    uint32_t ack;
+
+    s_first_seq[sector] = 0;
+    while ((ret = read_record(sector, off, &hdr, s_scratch)) == RECORD_OK) {
+        if (off == 0) {
+            s_first_seq[sector] = hdr.seq;
+        }
+        if (hdr.seq > *max_seq) {
+            *max_seq = hdr.seq;
+        }
+        if ((hdr.magic == MAGIC_ACK) && (hdr.len == sizeof(ack))) {
+            memcpy(&ack, s_scratch, sizeof(ack));
+            if (ack > *acked) {
+                *acked = ack;
+            }
+        }
+        off += RECORD_SIZE(hdr.len);
+    }
+
+    // Don't write after an interrupted write: treat the sector as full
+    *end_off = (ret == RECORD_CORRUPT) ? s_sector_size : off;
+
+    return ret;
+}
+
+// Find the next unconsumed message at or after the given position
+static esp_err_t find_pending(uint32_t *sector,
+                              uint32_t *off,
+                              record_hdr_t *hdr)
+{
+    while (1) {
+
+        // Skip ACK records and messages that were already consumed
+        if (read_record(*sector, *off, hdr, s_scratch) == RECORD_OK) {
+            if ((hdr->magic == MAGIC_DATA) && (hdr->seq > s_acked)) {
+                return ESP_OK;
+            }
+            *off += RECORD_SIZE(hdr->len);
+            continue;
+        }
+
+        // End of this sector's records: continue in the next one
+        if (*sector == s_head) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        *sector = (*sector + 1) % s_num_sectors;
+        *off = 0;
+    }
+}
+
+// Erase one sector of the ring
+static esp_err_t erase_sector(uint32_t sector)
+{
+    esp_err_t esp_ret;
+
+    esp_ret = esp_partition_erase_range(s_part,
+                                        (size_t)sector * s_sector_size,
+                                        s_sector_size);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to erase sector %lu", esp_ret, sector);
+        return esp_ret;
+    }
+    s_first_seq[sector] = 0;
+    s_stats.erases++;
+
+    return ESP_OK;
+}
+
+// Move writing to the next sector, reclaiming it first if it is in use
+static esp_err_t advance_head(void)
+{
+    esp_err_t esp_ret;
+    uint32_t next = (s_head + 1) % s_num_sectors;
+    uint32_t sector;
+    uint32_t off;
+    record_hdr_t hdr;
+    in_flight_t *msg;
+
+    // Next sector still holds records: the ring is full and it is the tail
+    if (s_first_seq[next] != 0) {
+
+        // Drop unsent messages in that sector and move the read position on
+        sector = s_read_sector;
+        off = s_read_off;
+        while ((find_pending(&sector, &off, &hdr) == ESP_OK) &&
+               (sector == next)) {
+            s_acked = hdr.seq;
+            s_count--;
+            s_stats.dropped++;
+            off += RECORD_SIZE(hdr.len);
+        }
+        if (s_read_sector == next) {
+            s_read_sector = sector;
+            s_read_off = off;
+            s_peeked = false;
+        }
+        if (s_stats.dropped > 0) {
+            ESP_LOGW(TAG, "Queue full, %lu messages dropped so far",
+                     s_stats.dropped);
+        }
+
+        // Sent messages in that sector can no longer be sent again
+        for (uint32_t i = 0; i < s_in_flight_num; i++) {
+            msg = &s_in_flight[(s_in_flight_first + i) % IN_FLIGHT_MAX];
+            if ((msg->sector == next) && (msg->seq > s_acked)) {
+                s_acked = msg->seq;
+            }
+        }
+
+        // Reclaim the sector
+        esp_ret = erase_sector(next);
+        if (esp_ret != ESP_OK) {
+            return esp_ret;
+        }
+        s_tail = (next + 1) % s_num_sectors;
+    }
+
+    s_head = next;
+    s_head_off = 0;
+
+    return ESP_OK;
+}
+
+// Append one record at the head
+static esp_err_t append_record(uint16_t magic, const void *payload, size_t len)
+{
+    esp_err_t esp_ret;
+    record_hdr_t hdr;
+    size_t size = RECORD_SIZE(len);
+
+    // Records never span sectors
+    if (s_head_off + size > s_sector_size) {
+        esp_ret = advance_head();
+        if (esp_ret != ESP_OK) {
+            return esp_ret;
+        }
+    }
+
+    // Build the record (header, payload, erased-value padding)
+    hdr.magic = magic;
+    hdr.len = (uint16_t)len;
+    hdr.seq = s_next_seq;
+    hdr.crc = record_crc(&hdr, payload);
+    memset(s_scratch, 0xFF, size);
+    memcpy(s_scratch, &hdr, HDR_SIZE);
+    memcpy(&s_scratch[HDR_SIZE], payload, len);
+
+    // Program it with a single write
+    esp_ret = esp_partition_write(s_part,
+                                  (size_t)s_head * s_sector_size + s_head_off,
+                                  s_scratch,
+                                  size);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to write record", esp_ret);
+        s_head_off = s_sector_size;
+        return esp_ret;
+    }
+
+    // Update positions
+    if (s_head_off == 0) {
+        s_first_seq[s_head] = hdr.seq;
+    }
+    s_head_off += size;
+    s_next_seq++;
+    s_stats.flash_bytes += size;
+
+    return ESP_OK;
+}
+
+// Append an ACK record if messages were popped since the last one
+static esp_err_t commit_locked(void)
+{
+    esp_err_t esp_ret;
+
+    if (s_acked <= s_acked_flash) {
+        return ESP_OK;
+    }
+    esp_ret = append_record(MAGIC_ACK, &s_acked, sizeof(s_acked));
+    if (esp_ret == ESP_OK) {
+        s_acked_flash = s_acked;
+    }
+
+    return esp_ret;
+}
+
+// Consume acknowledged messages from the front of the in-flight list
+static void release_acked(void)
+{
+    in_flight_t *msg;
+
+    while (s_in_flight_num > 0) {
+        msg = &s_in_flight[s_in_flight_first];
+        if (!msg->acked) {
+            break;
+        }
+        if (msg->seq > s_acked) {
+            s_acked = msg->seq;
+        }
+        s_stats.popped++;
+        s_in_flight_first = (s_in_flight_first + 1) % IN_FLIGHT_MAX;
+        s_in_flight_num--;
+    }
+}
+
+// Remove the peeked message, keeping it in flight until it is acknowledged
+static esp_err_t pop_locked(int id)
+{
+    in_flight_t *msg;
+
+    if (!s_peeked) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_in_flight_num >= IN_FLIGHT_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Track it in send order (id 0 needs no acknowledgement)
+    msg = &s_in_flight[(s_in_flight_first + s_in_flight_num) % IN_FLIGHT_MAX];
+    msg->seq = s_peek_seq;
+    msg->sector = s_read_sector;
+    msg->id = id;
+    msg->acked = (id == 0);
+    s_in_flight_num++;
+
+    // The acknowledgement may have arrived while the callback was returning
+    for (uint32_t i = 0; (id != 0) && (i < IN_FLIGHT_MAX); i++) {
+        if (s_early_acks[i] == id) {
+            s_early_acks[i] = 0;
+            msg->acked = true;
+            break;
+        }
+    }
+
+    s_read_off += s_peek_size;
+    s_count--;
+    s_peeked = false;
+    release_acked();
+
+    return ESP_OK;
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Mount the queue on its flash partition
+esp_err_t flash_queue_init(void)
+{
+    esp_err_t esp_ret;
+    record_result_t ret;
+    record_hdr_t hdr;
+    uint32_t end_off;
+    uint32_t max_seq = 0;
+    uint32_t acked = 0;
+    uint32_t sector;
+    uint32_t off;
+    bool found = false;
+
+    // Find the partition
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                      ESP_PARTITION_SUBTYPE_ANY,
+                                      CONFIG_FLASH_QUEUE_PARTITION_LABEL);
+    if (s_part == NULL) {
+        ESP_LOGE(TAG, "Partition '%s' not found", CONFIG_FLASH_QUEUE_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_sector_size = s_part->erase_size;
+    s_num_sectors = s_part->size / s_sector_size;
+    if ((s_num_sectors < 2) || (RECORD_MAX_SIZE > s_sector_size)) {
+        ESP_LOGE(TAG, "Partition '%s' is too small", s_part->label);
+        s_part = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Allocate per-sector state
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_peeked = false;
+    s_in_flight_first = 0;
+    s_in_flight_num = 0;
+    s_first_seq = calloc(s_num_sectors, sizeof(uint32_t));
+    s_mutex = xSemaphoreCreateMutex();
+    s_drain_mutex = xSemaphoreCreateMutex();
+    if ((s_first_seq == NULL) || (s_mutex == NULL) || (s_drain_mutex == NULL)) {
+        ESP_LOGE(TAG, "Failed to allocate queue state");
+        esp_ret = ESP_ERR_NO_MEM;
+        goto cleanup;
+    }
+
+    // Scan every sector for its first record, highest seq, and latest ACK
+    s_head = 0;
+    s_head_off = 0;
+    s_tail = 0;
+    for (uint32_t i = 0; i < s_num_sectors; i++) {
+        ret = scan_sector(i, &end_off, &max_seq, &acked);
+
+        // Garbage at the start (e.g. interrupted erase): erase it now
+        if ((ret == RECORD_CORRUPT) && (s_first_seq[i] == 0)) {
+            ESP_LOGW(TAG, "Sector %lu is corrupt, erasing", i);
+            esp_ret = erase_sector(i);
+            if (esp_ret != ESP_OK) {
+                goto cleanup;
+            }
+            continue;
+        }
+        if (s_first_seq[i] == 0) {
+            continue;
+        }
+
+        // Head has the newest first record, tail the oldest
+        if (!found || (s_first_seq[i] > s_first_seq[s_head])) {
+            s_head = i;
+            s_head_off = end_off;
+        }
+        if (!found || (s_first_seq[i] < s_first_seq[s_tail])) {
+            s_tail = i;
+        }
+        found = true;
+    }
+    s_next_seq = max_seq + 1;
+    s_acked = acked;
+    s_acked_flash = acked;
+
+    // Count unsent messages and find the first one
+    s_count = 0;
+    s_read_sector = s_tail;
+    s_read_off = 0;
+    sector = s_tail;
+    off = 0;
+    while (found && (find_pending(&sector, &off, &hdr) == ESP_OK)) {
+        if (s_count == 0) {
+            s_read_sector = sector;
+            s_read_off = off;
+        }
+        s_count++;
+        off += RECORD_SIZE(hdr.len);
+    }
+    if (s_count == 0) {
+        s_read_sector = s_head;
+        s_read_off = s_head_off;
+    }
+
+    ESP_LOGI(TAG, "Mounted '%s': %lu sectors, %lu messages queued",
+             s_part->label, s_num_sectors, s_count);
+
+    return ESP_OK;
+
+cleanup:
+    free(s_first_seq);
+    s_first_seq = NULL;
+    if (s_mutex != NULL) {
+        vSemaphoreDelete(s_mutex);
+        s_mutex = NULL;
+    }
+    if (s_drain_mutex != NULL) {
+        vSemaphoreDelete(s_drain_mutex);
+        s_drain_mutex = NULL;
+    }
+    s_part = NULL;
+
+    return esp_ret;
+}
+
+// Unmount the queue
+esp_err_t flash_queue_deinit(void)
+{
+    if (s_part == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    free(s_first_seq);
+    s_first_seq = NULL;
+    vSemaphoreDelete(s_mutex);
+    s_mutex = NULL;
+    vSemaphoreDelete(s_drain_mutex);
+    s_drain_mutex = NULL;
+    s_part = NULL;
+
+    return ESP_OK;
+}
+
+// Append a message to the queue
+esp_err_t flash_queue_push(const void *data, size_t len)
+{
+    esp_err_t esp_ret;
+
+    if (s_part == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len > CONFIG_FLASH_QUEUE_MAX_MSG_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_ret = append_record(MAGIC_DATA, data, len);
+    if (esp_ret == ESP_OK) {
+        s_count++;
+        s_stats.pushed++;
+        s_stats.payload_bytes += len;
+    }
+    xSemaphoreGive(s_mutex);
+
+    return esp_ret;
+}
+
+// Read the oldest message without removing it
+esp_err_t flash_queue_peek(void *buf, size_t buf_size, size_t *len)
+{
+    esp_err_t esp_ret;
+    record_hdr_t hdr;
+
+    if (s_part == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    // Move the read position past consumed records and ACKs
+    s_peeked = false;
+    esp_ret = find_pending(&s_read_sector, &s_read_off, &hdr);
+    if (esp_ret != ESP_OK) {
+        goto cleanup;
+    }
+
+    // Copy message out (find_pending left the payload in the scratch buffer)
+    if (hdr.len > buf_size) {
+        esp_ret = ESP_ERR_INVALID_SIZE;
+        goto cleanup;
+    }
+    memcpy(buf, s_scratch, hdr.len);
+    *len = hdr.len;
+    s_peeked = true;
+    s_peek_seq = hdr.seq;
+    s_peek_size = RECORD_SIZE(hdr.len);
+
+cleanup:
+    xSemaphoreGive(s_mutex);
+
+    return esp_ret;
+}
+
+// Remove the message returned by the last flash_queue_peek()
+esp_err_t flash_queue_pop(void)
+{
+    esp_err_t esp_ret;
+
+    if (s_part == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_ret = pop_locked(0);
+    xSemaphoreGive(s_mutex);
+
+    return esp_ret;
+}
+
+// Record removed messages in flash so they are not resent after reset
+esp_err_t flash_queue_commit(void)
+{
+    esp_err_t esp_ret;
+
+    if (s_part == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_ret = commit_locked();
+    xSemaphoreGive(s_mutex);
+
+    return esp_ret;
+}
+
+// Erase every sector that holds only consumed messages
+esp_err_t flash_queue_compact(void)
+{
+    esp_err_t esp_ret;
+    record_hdr_t hdr;
+    in_flight_t *msg;
+    uint32_t limit;
+
+    if (s_part == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    // Persist consumption first so erased messages can't come back
+    esp_ret = commit_locked();
+    if (esp_ret != ESP_OK) {
+        goto cleanup;
+    }
+
+    // Move the read position to the next unsent message (or the head)
+    if (find_pending(&s_read_sector, &s_read_off, &hdr) != ESP_OK) {
+        s_read_sector = s_head;
+        s_read_off = s_head_off;
+    }
+    s_peeked = false;
+
+    // Erase fully consumed sectors up to the read position, keeping the
+    // oldest sector that holds a message still in flight
+    limit = s_read_sector;
+    for (uint32_t i = 0; i < s_in_flight_num; i++) {
+        msg = &s_in_flight[(s_in_flight_first + i) % IN_FLIGHT_MAX];
+        if (msg->seq > s_acked) {
+            limit = msg->sector;
+            break;
+        }
+    }
+    while ((s_tail != limit) && (s_tail != s_head)) {
+        esp_ret = erase_sector(s_tail);
+        if (esp_ret != ESP_OK) {
+            goto cleanup;
+        }
+        s_tail = (s_tail + 1) % s_num_sectors;
+    }
+
+cleanup:
+    xSemaphoreGive(s_mutex);
+
+    return esp_ret;
+}
+
+// Send up to max queued messages, oldest first
+esp_err_t flash_queue_drain(size_t max,
+                            flash_queue_send_cb_t send,
+                            void *ctx,
+                            size_t *sent)
+{
+    esp_err_t esp_ret = ESP_OK;
+    esp_err_t ret;
+    size_t num = 0;
+    size_t len;
+    int id;
+
+    if (s_part == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The send buffer is shared, and the callback runs without s_mutex held
+    // so that flash_queue_ack() can be called while it waits on the receiver
+    xSemaphoreTake(s_drain_mutex, portMAX_DELAY);
+
+    // Only acks that arrive during this drain can belong to its messages
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    memset(s_early_acks, 0, sizeof(s_early_acks));
+    xSemaphoreGive(s_mutex);
+
+    // Hand messages to the sender until it refuses one, we hit the limit,
+    // or too many are waiting for acknowledgement
+    while ((num < max) && (flash_queue_in_flight() < IN_FLIGHT_MAX)) {
+        esp_ret = flash_queue_peek(s_drain_buf, sizeof(s_drain_buf), &len);
+        if (esp_ret == ESP_ERR_NOT_FOUND) {
+            esp_ret = ESP_OK;
+            break;
+        }
+        if (esp_ret != ESP_OK) {
+            break;
+        }
+        id = 0;
+        esp_ret = send(s_drain_buf, len, &id, ctx);
+        if (esp_ret != ESP_OK) {
+            break;
+        }
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        ret = pop_locked(id);
+        xSemaphoreGive(s_mutex);
+
+        // Rewound meanwhile: the message will be sent again
+        if (ret != ESP_OK) {
+            break;
+        }
+        num++;
+    }
+    if (sent != NULL) {
+        *sent = num;
+    }
+
+    // One ACK per batch, and reclaim space once everything has been delivered
+    ret = ESP_OK;
+    if ((flash_queue_count() == 0) && (flash_queue_in_flight() == 0)) {
+        ret = flash_queue_compact();
+    } else if (num > 0) {
+        ret = flash_queue_commit();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to commit sent messages", ret);
+        esp_ret = ret;
+    }
+
+    xSemaphoreGive(s_drain_mutex);
+
+    return esp_ret;
+}
+
+// Report a message sent by flash_queue_drain() as delivered
+esp_err_t flash_queue_ack(int id)
+{
+    esp_err_t esp_ret = ESP_ERR_NOT_FOUND;
+    in_flight_t *msg;
+
+    if (s_part == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    for (uint32_t i = 0; i < s_in_flight_num; i++) {
+        msg = &s_in_flight[(s_in_flight_first + i) % IN_FLIGHT_MAX];
+        if (!msg->acked && (msg->id == id)) {
+            msg->acked = true;
+            esp_ret = ESP_OK;
+            break;
+        }
+    }
+
+    // Maybe sent by a drain that has not recorded it yet
+    if ((esp_ret == ESP_ERR_NOT_FOUND) && (id != 0)) {
+        s_early_acks[s_early_next] = id;
+        s_early_next = (s_early_next + 1) % IN_FLIGHT_MAX;
+    }
+
+    // Commit once the whole batch has been delivered
+    if (esp_ret == ESP_OK) {
+        release_acked();
+        if (s_in_flight_num == 0) {
+            esp_ret = commit_locked();
+        }
+    }
+    xSemaphoreGive(s_mutex);
+
+    return esp_ret;
+}
+
+// Put every sent but unacknowledged message back in the queue
+esp_err_t flash_queue_rewind(void)
+{
+    in_flight_t *msg;
+
+    if (s_part == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    // Everything after the last consumed message is unsent again
+    for (uint32_t i = 0; i < s_in_flight_num; i++) {
+        msg = &s_in_flight[(s_in_flight_first + i) % IN_FLIGHT_MAX];
+        if (msg->seq > s_acked) {
+            s_count++;
+            s_stats.rewound++;
+        }
+    }
+    s_in_flight_first = 0;
+    s_in_flight_num = 0;
+
+    // Read again from the tail (find_pending() skips consumed messages)
+    s_read_sector = s_tail;
+    s_read_off = 0;
+    s_peeked = false;
+
+    xSemaphoreGive(s_mutex);
+
+    return ESP_OK;
+}
+
+// Get the number of unsent messages
+uint32_t flash_queue_count(void)
+{
+    return s_count;
+}
+
+// Get the number of sent messages waiting for acknowledgement
+uint32_t flash_queue_in_flight(void)
+{
+    return s_in_flight_num;
+}
+
+// Get queue statistics
+void flash_queue_get_stats(flash_queue_stats_t *stats)
+{
+    memcpy(stats, &s_stats, sizeof(*stats));
+}
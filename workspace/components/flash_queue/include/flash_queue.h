@@ -0,0 +1,217 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef FLASH_QUEUE_H
+#define FLASH_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/**
+ * @brief Queue statistics (since flash_queue_init())
+ */
+typedef struct {
+    uint32_t pushed;            // Messages appended
+    uint32_t popped;            // Messages consumed (acknowledged if sent by drain)
+    uint32_t dropped;           // Unsent messages lost because the queue filled
+    uint32_t payload_bytes;     // Message bytes appended
+    uint32_t flash_bytes;       // Bytes written to flash (headers, padding, acks)
+    uint32_t erases;            // Sectors erased
+    uint32_t rewound;           // Sent messages put back by flash_queue_rewind()
+} flash_queue_stats_t;
+
+/**
+ * @brief Callback used by flash_queue_drain() to send one message
+ *
+ * Set *id to the identifier the receiver's acknowledgement will carry (e.g.
+ * the MQTT msg_id) and pass it to flash_queue_ack() when it arrives. Leave
+ * *id at 0 if no acknowledgement will follow: the message is then consumed
+ * as soon as the callback returns ESP_OK.
+ *
+ * @param[in] data Message
+ * @param[in] len Message length (bytes)
+ * @param[out] id Acknowledgement identifier (preset to 0)
+ * @param[in] ctx User context
+ *
+ * @return ESP_OK if the message was handed off, anything else to stop
+ */
+typedef esp_err_t (*flash_queue_send_cb_t)(const uint8_t *data,
+                                           size_t len,
+                                           int *id,
+                                           void *ctx);
+
+/**
+ * @brief Mount the queue on its flash partition
+ *
+ * Scans the partition (CONFIG_FLASH_QUEUE_PARTITION_LABEL) to rebuild the
+ * write and read positions. Messages that were queued but not committed as
+ * consumed before a reset are delivered again.
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_NOT_FOUND if the partition does not exist
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t flash_queue_init(void);
+
+/**
+ * @brief Unmount the queue and free its state
+ *
+ * Messages popped but not committed are delivered again after the next
+ * flash_queue_init(), exactly as after a reset.
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_STATE if the queue is not mounted
+ */
+esp_err_t flash_queue_deinit(void);
+
+/**
+ * @brief Append a message to the queue
+ *
+ * If the queue is full, the oldest sector of unsent messages is dropped to
+ * make room.
+ *
+ * @param[in] data Message
+ * @param[in] len Message length (at most CONFIG_FLASH_QUEUE_MAX_MSG_SIZE)
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t flash_queue_push(const void *data, size_t len);
+
+/**
+ * @brief Read the oldest message without removing it
+ *
+ * @param[out] buf Buffer for the message
+ * @param[in] buf_size Size of buf (bytes)
+ * @param[out] len Message length (bytes)
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_NOT_FOUND if the queue is empty
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t flash_queue_peek(void *buf, size_t buf_size, size_t *len);
+
+/**
+ * @brief Remove the message returned by the last flash_queue_peek()
+ *
+ * Removal is kept in RAM until flash_queue_commit() is called.
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_STATE if there was no successful peek
+ *  - ESP_ERR_NO_MEM if CONFIG_FLASH_QUEUE_MAX_IN_FLIGHT sent messages are
+ *    still waiting for acknowledgement
+ */
+esp_err_t flash_queue_pop(void);
+
+/**
+ * @brief Record removed messages in flash so they are not resent after reset
+ *
+ * Appends one small acknowledgement record covering every message popped so
+ * far. Call it once per batch rather than after every pop.
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t flash_queue_commit(void);
+
+/**
+ * @brief Erase every sector that holds only consumed messages
+ *
+ * Commits first, then erases the consumed sectors in one pass so that later
+ * pushes do not have to wait for an erase.
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t flash_queue_compact(void);
+
+/**
+ * @brief Send up to max queued messages, oldest first
+ *
+ * Pops each message the callback accepts and stops at the first one it
+ * rejects. Messages given an acknowledgement identifier stay in flash until
+ * flash_queue_ack() reports them delivered; the rest are consumed at once.
+ * Commits what has been consumed, and compacts the queue once every message
+ * has been delivered. Only one drain runs at a time.
+ *
+ * @param[in] max Maximum number of messages to send (rate limit)
+ * @param[in] send Callback that sends one message
+ * @param[in] ctx User context passed to the callback
+ * @param[out] sent Number of messages sent (may be NULL)
+ *
+ * @return
+ *  - ESP_OK on success (including an empty queue)
+ *  - The callback's error if it rejected a message
+ *  - Other errors (commit or compaction) on failure. See esp_err.h for
+ *    error codes.
+ */
+esp_err_t flash_queue_drain(size_t max,
+                            flash_queue_send_cb_t send,
+                            void *ctx,
+                            size_t *sent);
+
+/**
+ * @brief Report a message sent by flash_queue_drain() as delivered
+ *
+ * Messages are consumed in queue order, so one acknowledged ahead of an
+ * older message waits for it. An ACK record is committed once every sent
+ * message has been acknowledged. Safe to call from the receiver's event
+ * task (e.g. on MQTT_EVENT_PUBLISHED).
+ *
+ * @param[in] id Identifier the send callback set for the message
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_NOT_FOUND if no sent message is waiting for this identifier
+ *    (it is kept briefly in case the drain that sent it has not recorded
+ *    it yet)
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t flash_queue_ack(int id);
+
+/**
+ * @brief Put every sent but unacknowledged message back in the queue
+ *
+ * Call when the receiver dropped a message (e.g. MQTT_EVENT_DELETED). The
+ * next flash_queue_drain() sends them again, so messages acknowledged out
+ * of order behind the dropped one may arrive twice.
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_STATE if the queue is not mounted
+ */
+esp_err_t flash_queue_rewind(void);
+
+/**
+ * @brief Get the number of unsent messages
+ *
+ * @return Number of messages in the queue
+ */
+uint32_t flash_queue_count(void);
+
+/**
+ * @brief Get the number of sent messages waiting for acknowledgement
+ *
+ * @return Number of messages in flight
+ */
+uint32_t flash_queue_in_flight(void);
+
+/**
+ * @brief Get queue statistics
+ *
+ * @param[out] stats Statistics since flash_queue_init()
+ */
+void flash_queue_get_stats(flash_queue_stats_t *stats);
+
+#endif // FLASH_QUEUE_H
@@ -0,0 +1,466 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Multiplexed HTTP/1.1 client.
+ *
+ * Each request occupies one slot with its own non-blocking socket, receive
+ * ring, and parser. http_mux_poll() waits in a single select() on every
+ * socket that is connecting (writable), sending (writable), or receiving
+ * (readable), and moves each ready request one step forward. One task can
+ * therefore keep several requests in flight without a task (and stack) per
+ * connection. The select() timeout is capped by the earliest request
+ * deadline so timeouts are handled on time.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+
+#include "http_mux.h"
+
+// Settings
+#define MAX_REQUESTS        CONFIG_HTTP_MUX_MAX_REQUESTS
+
+// Tag for debug messages
+static const char *TAG = "http_mux";
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static int format_header(http_mux_slot_t *slot);
+static esp_err_t start_connect(http_mux_slot_t *slot);
+static void finish(http_mux_slot_t *slot, esp_err_t err);
+static void handle_connect(http_mux_slot_t *slot);
+static void handle_send(http_mux_slot_t *slot);
+static void handle_recv(http_mux_slot_t *slot);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Write the request line and headers into the slot
+static int format_header(http_mux_slot_t *slot)
+{
+    const http_mux_request_t *req = &slot->req;
+    int len;
+    int ret;
+
+    len = snprintf(slot->tx_buf, sizeof(slot->tx_buf),
+                   "%s %s HTTP/1.1\r\n"
+                   "Host: %s\r\n"
+                   "User-Agent: esp-idf/1.0 esp32\r\n"
+                   "Connection: close\r\n",
+                   (req->method != NULL) ? req->method : "GET",
+                   req->path,
+                   req->host);
+    if ((len < 0) || (len >= (int)sizeof(slot->tx_buf))) {
+        return -1;
+    }
+
+    // Body headers
+    if ((req->body != NULL) || (req->body_len > 0)) {
+        ret = snprintf(&slot->tx_buf[len], sizeof(slot->tx_buf) - len,
+                       "Content-Type: %s\r\n"
+                       "Content-Length: %u\r\n",
+                       (req->content_type != NULL) ?
+                           req->content_type : "application/octet-stream",
+                       (unsigned int)req->body_len);
+        if ((ret < 0) || (ret >= (int)(sizeof(slot->tx_buf) - len))) {
+            return -1;
+        }
+        len += ret;
+    }
+
+    // End of headers
+    ret = snprintf(&slot->tx_buf[len], sizeof(slot->tx_buf) - len, "\r\n");
+    if ((ret < 0) || (ret >= (int)(sizeof(slot->tx_buf) - len))) {
+        return -1;
+    }
+
+    return len + ret;
+}
+
+// Start a non-blocking connection to the slot's current address
+static esp_err_t start_connect(http_mux_slot_t *slot)
+{
+    const struct sockaddr_storage *addr;
+    int flags;
+
+    while (slot->addr_idx < slot->addrs.count) {
+        addr = &slot->addrs.addrs[slot->addr_idx];
+
+        // Create socket
+        slot->sock = socket(addr->ss_family, SOCK_STREAM, IPPROTO_TCP);
+        if (slot->sock < 0) {
+            ESP_LOGE(TAG, "Failed to create socket (%d): %s",
+                     errno,
+                     strerror(errno));
+            return ESP_FAIL;
+        }
+
+        // Every call on the socket must return immediately
+        flags = fcntl(slot->sock, F_GETFL, 0);
+        if (fcntl(slot->sock, F_SETFL, flags | O_NONBLOCK) < 0) {
+            ESP_LOGE(TAG, "Failed to set socket non-blocking (%d)", errno);
+            close(slot->sock);
+            slot->sock = -1;
+            return ESP_FAIL;
+        }
+
+        // Start connecting (select() reports completion as writable)
+        if ((connect(slot->sock,
+                     (const struct sockaddr *)addr,
+                     slot->addrs.addr_lens[slot->addr_idx]) == 0) ||
+            (errno == EINPROGRESS)) {
+            slot->state = HTTP_MUX_SLOT_CONNECTING;
+            return ESP_OK;
+        }
+
+        // Refused right away: try the next address
+        ESP_LOGD(TAG, "Connect attempt %u failed (%d): %s",
+                 (unsigned int)slot->addr_idx,
+                 errno,
+                 strerror(errno));
+        close(slot->sock);
+        slot->sock = -1;
+        slot->addr_idx++;
+    }
+
+    return ESP_FAIL;
+}
+
+// Close a request and report how it ended
+static void finish(http_mux_slot_t *slot, esp_err_t err)
+{
+    http_mux_result_t result = {
+        .id = slot->id,
+        .err = err,
+        .status_code = slot->parser.status_code,
+        .body_len = slot->parser.body_received,
+        .elapsed_us = esp_timer_get_time() - slot->start_us,
+    };
+
+    if (slot->sock >= 0) {
+        close(slot->sock);
+        slot->sock = -1;
+    }
+    slot->state = HTTP_MUX_SLOT_FREE;
+
+    // The callback may submit a new request into this slot
+    if (slot->req.on_done != NULL) {
+        slot->req.on_done(slot->req.ctx, &result);
+    }
+}
+
+// The socket is writable: check how the connection attempt ended
+static void handle_connect(http_mux_slot_t *slot)
+{
+    int sock_err = 0;
+    socklen_t err_len = sizeof(sock_err);
+
+    getsockopt(slot->sock, SOL_SOCKET, SO_ERROR, &sock_err, &err_len);
+    if (sock_err == 0) {
+        slot->state = HTTP_MUX_SLOT_SENDING;
+        handle_send(slot);
+        return;
+    }
+
+    // Move on to the next address, if any
+    ESP_LOGD(TAG, "[%d] Connect to %s failed (%d)",
+             slot->id,
+             slot->req.host,
+             sock_err);
+    close(slot->sock);
+    slot->sock = -1;
+    slot->addr_idx++;
+    if (start_connect(slot) != ESP_OK) {
+        dns_cache_invalidate(slot->req.host);
+        finish(slot, ESP_FAIL);
+    }
+}
+
+// The socket is writable: send as much of the header and body as fits
+static void handle_send(http_mux_slot_t *slot)
+{
+    size_t total = slot->tx_len + slot->req.body_len;
+    const uint8_t *data;
+    size_t len;
+    ssize_t ret;
+
+    while (slot->tx_sent < total) {
+
+        // Header first, then the body straight from the caller's buffer
+        if (slot->tx_sent < slot->tx_len) {
+            data = (const uint8_t *)&slot->tx_buf[slot->tx_sent];
+            len = slot->tx_len - slot->tx_sent;
+        } else {
+            data = &slot->req.body[slot->tx_sent - slot->tx_len];
+            len = total - slot->tx_sent;
+        }
+        ret = send(slot->sock, data, len, 0);
+        if (ret < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                return;
+            }
+            ESP_LOGE(TAG, "[%d] Failed to send (%d): %s",
+                     slot->id,
+                     errno,
+                     strerror(errno));
+            finish(slot, ESP_FAIL);
+            return;
+        }
+        slot->tx_sent += (size_t)ret;
+    }
+
+    // Everything is queued, wait for the response
+    slot->state = HTTP_MUX_SLOT_RECEIVING;
+}
+
+// The socket is readable: receive and parse what has arrived
+static void handle_recv(http_mux_slot_t *slot)
+{
+    http_parser_result_t parse_ret = HTTP_PARSER_NEED_MORE;
+    uint8_t *ptr;
+    size_t free_len;
+    ssize_t ret;
+
+    // Drain the socket without blocking
+    while (parse_ret == HTTP_PARSER_NEED_MORE) {
+        ptr = http_ring_write_ptr(&slot->ring, &free_len);
+        ret = recv(slot->sock, ptr, free_len, 0);
+        if (ret < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                return;
+            }
+            ESP_LOGE(TAG, "[%d] Failed to receive (%d): %s",
+                     slot->id,
+                     errno,
+                     strerror(errno));
+            finish(slot, ESP_FAIL);
+            return;
+        }
+
+        // Server closed the connection
+        if (ret == 0) {
+            parse_ret = http_parser_finish(&slot->parser);
+            break;
+        }
+
+        // Parse in place
+        http_ring_commit(&slot->ring, (size_t)ret);
+        parse_ret = http_parser_execute_ring(&slot->parser, &slot->ring);
+    }
+
+    // Report how the response ended (a paused parser means the caller
+    // wants no more of it)
+    switch (parse_ret) {
+        case HTTP_PARSER_COMPLETE:
+            finish(slot, ESP_OK);
+            break;
+        case HTTP_PARSER_PAUSED:
+            finish(slot, ESP_ERR_INVALID_STATE);
+            break;
+        default:
+            ESP_LOGE(TAG, "[%d] Incomplete or malformed response", slot->id);
+            finish(slot, ESP_ERR_INVALID_RESPONSE);
+            break;
+    }
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Initialize a client with no requests in flight
+void http_mux_init(http_mux_t *mux)
+{
+    memset(mux, 0, sizeof(*mux));
+    for (int i = 0; i < MAX_REQUESTS; i++) {
+        mux->slots[i].state = HTTP_MUX_SLOT_FREE;
+        mux->slots[i].sock = -1;
+    }
+    mux->next_id = 1;
+}
+
+// Start a request
+esp_err_t http_mux_submit(http_mux_t *mux, const http_mux_request_t *req, int *id)
+{
+    http_mux_slot_t *slot = NULL;
+    esp_err_t esp_ret;
+    int len;
+
+    if ((req == NULL) || (req->host == NULL) || (req->path == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Find a free slot
+    for (int i = 0; i < MAX_REQUESTS; i++) {
+        if (mux->slots[i].state == HTTP_MUX_SLOT_FREE) {
+            slot = &mux->slots[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Set up the slot
+    slot->req = *req;
+    slot->id = mux->next_id++;
+    slot->sock = -1;
+    slot->addr_idx = 0;
+    slot->tx_sent = 0;
+    slot->start_us = esp_timer_get_time();
+    slot->deadline_us = (req->timeout_ms > 0) ?
+                        slot->start_us + (int64_t)req->timeout_ms * 1000 :
+                        INT64_MAX;
+    http_ring_init(&slot->ring, slot->rx_buf, sizeof(slot->rx_buf));
+    http_parser_init(&slot->parser, req->callbacks, req->ctx);
+
+    // Request header
+    len = format_header(slot);
+    if (len < 0) {
+        ESP_LOGE(TAG, "Request header for %s does not fit", req->host);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    slot->tx_len = (size_t)len;
+
+    // Resolve (only a cache miss blocks)
+    esp_ret = dns_cache_lookup(req->host, req->port, AF_UNSPEC, &slot->addrs);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to resolve %s", esp_ret, req->host);
+        return esp_ret;
+    }
+
+    // Start connecting (the slot is in use from here on)
+    esp_ret = start_connect(slot);
+    if (esp_ret != ESP_OK) {
+        dns_cache_invalidate(req->host);
+        return esp_ret;
+    }
+    if (id != NULL) {
+        *id = slot->id;
+    }
+    ESP_LOGD(TAG, "[%d] %s %s:%u%s",
+             slot->id,
+             (req->method != NULL) ? req->method : "GET",
+             req->host,
+             req->port,
+             req->path);
+
+    return ESP_OK;
+}
+
+// Move every request forward (one select() round)
+size_t http_mux_poll(http_mux_t *mux, uint32_t timeout_ms)
+{
+    fd_set read_fds;
+    fd_set write_fds;
+    struct timeval tv;
+    http_mux_slot_t *slot;
+    int64_t now_us = esp_timer_get_time();
+    int64_t wait_us = (int64_t)timeout_ms * 1000;
+    int first_new_id;
+    int max_fd = -1;
+    int ret;
+
+    // Expire late requests, and wait no longer than the earliest deadline
+    FD_ZERO(&read_fds);
+    FD_ZERO(&write_fds);
+    for (int i = 0; i < MAX_REQUESTS; i++) {
+        slot = &mux->slots[i];
+        if (slot->state == HTTP_MUX_SLOT_FREE) {
+            continue;
+        }
+        if (now_us >= slot->deadline_us) {
+            ESP_LOGW(TAG, "[%d] %s timed out", slot->id, slot->req.host);
+            finish(slot, ESP_ERR_TIMEOUT);
+            continue;
+        }
+        if (slot->deadline_us - now_us < wait_us) {
+            wait_us = slot->deadline_us - now_us;
+        }
+        if (slot->state == HTTP_MUX_SLOT_RECEIVING) {
+            FD_SET(slot->sock, &read_fds);
+        } else {
+            FD_SET(slot->sock, &write_fds);
+        }
+        if (slot->sock > max_fd) {
+            max_fd = slot->sock;
+        }
+    }
+    if (max_fd < 0) {
+        return http_mux_active(mux);
+    }
+
+    // Wait for any socket
+    first_new_id = mux->next_id;
+    tv.tv_sec = (time_t)(wait_us / 1000000);
+    tv.tv_usec = (suseconds_t)(wait_us % 1000000);
+    ret = select(max_fd + 1, &read_fds, &write_fds, NULL, &tv);
+    if (ret < 0) {
+        ESP_LOGE(TAG, "select() failed (%d): %s", errno, strerror(errno));
+        return http_mux_active(mux);
+    }
+
+    // Move each ready request one step (skip slots freed or reused by a
+    // done callback since the select())
+    for (int i = 0; (i < MAX_REQUESTS) && (ret > 0); i++) {
+        slot = &mux->slots[i];
+        if ((slot->state == HTTP_MUX_SLOT_FREE) ||
+            (slot->sock < 0) ||
+            (slot->id >= first_new_id)) {
+            continue;
+        }
+        if (FD_ISSET(slot->sock, &write_fds)) {
+            ret--;
+            if (slot->state == HTTP_MUX_SLOT_CONNECTING) {
+                handle_connect(slot);
+            } else if (slot->state == HTTP_MUX_SLOT_SENDING) {
+                handle_send(slot);
+            }
+        } else if (FD_ISSET(slot->sock, &read_fds)) {
+            ret--;
+            handle_recv(slot);
+        }
+    }
+
+    return http_mux_active(mux);
+}
+
+// Cancel a request
+esp_err_t http_mux_cancel(http_mux_t *mux, int id)
+{
+    for (int i = 0; i < MAX_REQUESTS; i++) {
+        if ((mux->slots[i].state != HTTP_MUX_SLOT_FREE) &&
+            (mux->slots[i].id == id)) {
+            finish(&mux->slots[i], ESP_ERR_INVALID_STATE);
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+// Get the number of requests in flight
+size_t http_mux_active(const http_mux_t *mux)
+{
+    size_t count = 0;
+
+    for (int i = 0; i < MAX_REQUESTS; i++) {
+        if (mux->slots[i].state != HTTP_MUX_SLOT_FREE) {
+            count++;
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,158 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HTTP_MUX_H
+#define HTTP_MUX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#include "dns_cache.h"
+#include "http_parser.h"
+
+/**
+ * @brief Outcome of one request (passed to the done callback)
+ */
+typedef struct {
+    int id;                         // ID returned by http_mux_submit()
+    esp_err_t err;                  // ESP_OK if a full response was parsed
+    int status_code;                // HTTP status (0 if none was received)
+    uint64_t body_len;              // Decoded body bytes
+    int64_t elapsed_us;             // Time from submission to completion
+} http_mux_result_t;
+
+/**
+ * @brief Called once when a request completes, fails, or times out
+ */
+typedef void (*http_mux_done_cb_t)(void *ctx, const http_mux_result_t *result);
+
+/**
+ * @brief One request
+ *
+ * The strings and the body are not copied: they must stay valid until the
+ * done callback has run.
+ */
+typedef struct {
+    const char *host;               // Hostname or address
+    uint16_t port;                  // TCP port
+    const char *path;               // Path and query (e.g. "/api/v1/time")
+    const char *method;             // "GET" if NULL
+    const char *content_type;       // Content-Type of the body (or NULL)
+    const uint8_t *body;            // Request body (or NULL)
+    size_t body_len;
+    uint32_t timeout_ms;            // Deadline for the whole request (0: none)
+    const http_parser_callbacks_t *callbacks; // Response callbacks (or NULL)
+    http_mux_done_cb_t on_done;     // Completion callback (or NULL)
+    void *ctx;                      // Passed to all callbacks
+} http_mux_request_t;
+
+/**
+ * @brief Request slot states
+ */
+typedef enum {
+    HTTP_MUX_SLOT_FREE = 0,
+    HTTP_MUX_SLOT_CONNECTING,       // Non-blocking connect() in progress
+    HTTP_MUX_SLOT_SENDING,          // Writing the header and body
+    HTTP_MUX_SLOT_RECEIVING,        // Reading and parsing the response
+} http_mux_slot_state_t;
+
+/**
+ * @brief State of one request in flight (internal)
+ */
+typedef struct {
+    http_mux_slot_state_t state;
+    int id;
+    int sock;
+    http_mux_request_t req;
+    dns_cache_result_t addrs;       // Addresses to try, in order
+    size_t addr_idx;                // Address being connected to
+    size_t tx_len;                  // Request header length
+    size_t tx_sent;                 // Header and body bytes sent
+    int64_t start_us;
+    int64_t deadline_us;
+    http_parser_t parser;
+    http_ring_t ring;
+    uint8_t rx_buf[CONFIG_HTTP_MUX_RX_BUF_SIZE];
+    char tx_buf[CONFIG_HTTP_MUX_TX_BUF_SIZE];
+} http_mux_slot_t;
+
+/**
+ * @brief Multiplexed HTTP client (allocate statically, it holds all buffers)
+ */
+typedef struct {
+    http_mux_slot_t slots[CONFIG_HTTP_MUX_MAX_REQUESTS];
+    int next_id;
+} http_mux_t;
+
+/**
+ * @brief Initialize a client with no requests in flight
+ *
+ * @param[out] mux Client
+ */
+void http_mux_init(http_mux_t *mux);
+
+/**
+ * @brief Start a request
+ *
+ * Resolves the host (from the DNS cache when possible; a cache miss blocks
+ * for the DNS query), starts a non-blocking connection, and formats the
+ * request header. Nothing is sent until http_mux_poll() runs. Each request
+ * uses its own connection and asks the server to close it afterwards.
+ *
+ * @param[in] mux Client
+ * @param[in] req Request (copied, but not the strings it points to)
+ * @param[out] id Request ID for the done callback (or NULL)
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_ARG if the request has no host or path
+ *  - ESP_ERR_NO_MEM if every slot is busy
+ *  - ESP_ERR_INVALID_SIZE if the request header does not fit
+ *  - ESP_ERR_NOT_FOUND if the host could not be resolved
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t http_mux_submit(http_mux_t *mux, const http_mux_request_t *req, int *id);
+
+/**
+ * @brief Move every request forward (one select() round)
+ *
+ * Waits up to timeout_ms (less if a deadline is earlier) for any socket to
+ * become ready, then connects, sends, or receives on every ready socket.
+ * Requests that finish, fail, or pass their deadline are closed and their
+ * done callbacks run from this call.
+ *
+ * @param[in] mux Client
+ * @param[in] timeout_ms Longest time to wait (0 to only handle ready sockets)
+ *
+ * @return Number of requests still in flight
+ */
+size_t http_mux_poll(http_mux_t *mux, uint32_t timeout_ms);
+
+/**
+ * @brief Cancel a request (its done callback runs with ESP_ERR_INVALID_STATE)
+ *
+ * @param[in] mux Client
+ * @param[in] id Request ID
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_NOT_FOUND if the request is not in flight
+ */
+esp_err_t http_mux_cancel(http_mux_t *mux, int id);
+
+/**
+ * @brief Get the number of requests in flight
+ *
+ * @param[in] mux Client
+ *
+ * @return Requests in flight
+ */
+size_t http_mux_active(const http_mux_t *mux);
+
+#endif // HTTP_MUX_H
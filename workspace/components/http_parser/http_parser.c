@@ -0,0 +1,546 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Incremental HTTP/1.1 response parser.
+ *
+ * Lines (status line, headers, chunk sizes) are handed to the line handler in
+ * place when they are fully contained in the input span. Only a line that is
+ * split across two spans is reassembled in the parser's small line buffer.
+ * Body bytes are never copied: each body callback receives a slice of the
+ * caller's buffer.
+ */
+
+#include <string.h>
+#include <strings.h>
+
+#include "http_parser.h"
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static const char *take_line(http_parser_t *parser,
+                             const uint8_t **data,
+                             size_t *len,
+                             size_t *line_len);
+static http_parser_result_t handle_line(http_parser_t *parser,
+                                        const char *line,
+                                        size_t len);
+static http_parser_result_t parse_status_line(http_parser_t *parser,
+                                              const char *line,
+                                              size_t len);
+static http_parser_result_t parse_header_line(http_parser_t *parser,
+                                              const char *line,
+                                              size_t len);
+static http_parser_result_t headers_complete(http_parser_t *parser);
+static http_parser_result_t response_complete(http_parser_t *parser);
+static bool has_token(const char *value, size_t len, const char *token);
+static bool name_equals(const char *name, size_t len, const char *expected);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Return the next complete line (without CRLF), or NULL if more input needed
+static const char *take_line(http_parser_t *parser,
+                             const uint8_t **data,
+                             size_t *len,
+                             size_t *line_len)
+{
+    const uint8_t *newline;
+    const char *line;
+    size_t num;
+    size_t copy;
+
+    // No line ending yet: save the partial line for the next span
+    newline = memchr(*data, '\n', *len);
+    if (newline == NULL) {
+        copy = *len;
+        if (copy > sizeof(parser->line) - parser->line_len) {
+            copy = sizeof(parser->line) - parser->line_len;
+        }
+        memcpy(&parser->line[parser->line_len], *data, copy);
+        parser->line_len += copy;
+        *data += *len;
+        *len = 0;
+        return NULL;
+    }
+    num = (size_t)(newline - *data);
+
+    // Zero-copy if the whole line is in this span, else finish reassembly
+    if (parser->line_len == 0) {
+        line = (const char *)*data;
+    } else {
+        copy = num;
+        if (copy > sizeof(parser->line) - parser->line_len) {
+            copy = sizeof(parser->line) - parser->line_len;
+        }
+        memcpy(&parser->line[parser->line_len], *data, copy);
+        num = parser->line_len + copy;
+        line = parser->line;
+        parser->line_len = 0;
+    }
+    *len -= (size_t)(newline + 1 - *data);
+    *data = newline + 1;
+
+    // Strip carriage return
+    if ((num > 0) && (line[num - 1] == '\r')) {
+        num--;
+    }
+    *line_len = num;
+
+    return line;
+}
+
+// Dispatch a complete line based on where we are in the response
+static http_parser_result_t handle_line(http_parser_t *parser,
+                                        const char *line,
+                                        size_t len)
+{
+    uint64_t size = 0;
+    size_t i;
+    int digit;
+
+    switch (parser->state) {
+
+        // "HTTP/1.1 200 OK"
+        case HTTP_PARSER_STATE_STATUS_LINE:
+            return parse_status_line(parser, line, len);
+
+        // "Name: value" or empty line at end of headers
+        case HTTP_PARSER_STATE_HEADER_LINE:
+            if (len == 0) {
+                return headers_complete(parser);
+            }
+            return parse_header_line(parser, line, len);
+
+        // Chunk size in hex, optionally followed by ";extensions"
+        case HTTP_PARSER_STATE_CHUNK_SIZE:
+            for (i = 0; i < len; i++) {
+                char c = line[i];
+                if (c >= '0' && c <= '9') {
+                    digit = c - '0';
+                } else if (c >= 'a' && c <= 'f') {
+                    digit = c - 'a' + 10;
+                } else if (c >= 'A' && c <= 'F') {
+                    digit = c - 'A' + 10;
+                } else {
+                    break;
+                }
+                if (size > (UINT64_MAX >> 4)) {
+                    parser->state = HTTP_PARSER_STATE_ERROR;
+                    return HTTP_PARSER_ERROR;
+                }
+                size = (size << 4) | (uint64_t)digit;
+            }
+            if (i == 0) {
+                parser->state = HTTP_PARSER_STATE_ERROR;
+                return HTTP_PARSER_ERROR;
+            }
+            parser->remaining = size;
+            parser->state = (size > 0) ? HTTP_PARSER_STATE_CHUNK_DATA :
+                                         HTTP_PARSER_STATE_TRAILER_LINE;
+            return HTTP_PARSER_NEED_MORE;
+
+        // CRLF that follows each chunk's data
+        case HTTP_PARSER_STATE_CHUNK_DATA_END:
+            if (len != 0) {
+                parser->state = HTTP_PARSER_STATE_ERROR;
+                return HTTP_PARSER_ERROR;
+            }
+            parser->state = HTTP_PARSER_STATE_CHUNK_SIZE;
+            return HTTP_PARSER_NEED_MORE;
+
+        // Trailer headers are ignored, empty line ends the response
+        case HTTP_PARSER_STATE_TRAILER_LINE:
+            if (len == 0) {
+                return response_complete(parser);
+            }
+            return HTTP_PARSER_NEED_MORE;
+
+        default:
+            parser->state = HTTP_PARSER_STATE_ERROR;
+            return HTTP_PARSER_ERROR;
+    }
+}
+
+// Parse "HTTP/1.x SSS reason"
+static http_parser_result_t parse_status_line(http_parser_t *parser,
+                                              const char *line,
+                                              size_t len)
+{
+    if ((len < 12) ||
+        (memcmp(line, "HTTP/1.", 7) != 0) ||
+        (line[7] < '0' || line[7] > '9') ||
+        (line[8] != ' ') ||
+        (line[9] < '0' || line[9] > '9') ||
+        (line[10] < '0' || line[10] > '9') ||
+        (line[11] < '0' || line[11] > '9')) {
+        parser->state = HTTP_PARSER_STATE_ERROR;
+        return HTTP_PARSER_ERROR;
+    }
+
+    // HTTP/1.1 connections are persistent by default, HTTP/1.0 are not
+    parser->version_minor = (uint8_t)(line[7] - '0');
+    parser->keep_alive = (parser->version_minor >= 1);
+    parser->status_code = (line[9] - '0') * 100 +
+                          (line[10] - '0') * 10 +
+                          (line[11] - '0');
+    parser->state = HTTP_PARSER_STATE_HEADER_LINE;
+
+    return HTTP_PARSER_NEED_MORE;
+}
+
+// Parse "Name: value" and pick out the headers that affect framing
+static http_parser_result_t parse_header_line(http_parser_t *parser,
+                                              const char *line,
+                                              size_t len)
+{
+    const char *colon;
+    const char *value;
+    size_t name_len;
+    size_t value_len;
+    uint64_t length = 0;
+
+    // Split name and value, trimming whitespace around the value
+    colon = memchr(line, ':', len);
+    if (colon == NULL) {
+        parser->state = HTTP_PARSER_STATE_ERROR;
+        return HTTP_PARSER_ERROR;
+    }
+    name_len = (size_t)(colon - line);
+    value = colon + 1;
+    value_len = len - name_len - 1;
+    while ((value_len > 0) && (*value == ' ' || *value == '\t')) {
+        value++;
+        value_len--;
+    }
+    while ((value_len > 0) &&
+           (value[value_len - 1] == ' ' || value[value_len - 1] == '\t')) {
+        value_len--;
+    }
+
+    // Framing headers
+    if (name_equals(line, name_len, "Content-Length")) {
+        if (value_len == 0) {
+            parser->state = HTTP_PARSER_STATE_ERROR;
+            return HTTP_PARSER_ERROR;
+        }
+        for (size_t i = 0; i < value_len; i++) {
+            if ((value[i] < '0') || (value[i] > '9') ||
+                (length > (UINT64_MAX / 10))) {
+                parser->state = HTTP_PARSER_STATE_ERROR;
+                return HTTP_PARSER_ERROR;
+            }
+            length = length * 10 + (uint64_t)(value[i] - '0');
+        }
+        parser->content_length = length;
+        parser->has_content_length = true;
+    } else if (name_equals(line, name_len, "Transfer-Encoding")) {
+        parser->chunked = has_token(value, value_len, "chunked");
+    } else if (name_equals(line, name_len, "Connection")) {
+        if (has_token(value, value_len, "close")) {
+            parser->keep_alive = false;
+        } else if (has_token(value, value_len, "keep-alive")) {
+            parser->keep_alive = true;
+        }
+    }
+
+    // Hand header to the application
+    if ((parser->callbacks != NULL) && (parser->callbacks->on_header != NULL)) {
+        if (parser->callbacks->on_header(parser->ctx,
+                                         line, name_len,
+                                         value, value_len) != 0) {
+            return HTTP_PARSER_PAUSED;
+        }
+    }
+
+    return HTTP_PARSER_NEED_MORE;
+}
+
+// Pick how the body is delimited once all headers are known
+static http_parser_result_t headers_complete(http_parser_t *parser)
+{
+    int pause = 0;
+
+    // Interim responses (e.g. 100 Continue) are followed by the real one
+    if ((parser->status_code >= 100) && (parser->status_code < 200) &&
+        (parser->status_code != 101)) {
+        parser->state = HTTP_PARSER_STATE_STATUS_LINE;
+        parser->chunked = false;
+        parser->has_content_length = false;
+        return HTTP_PARSER_NEED_MORE;
+    }
+
+    // Notify application
+    if ((parser->callbacks != NULL) &&
+        (parser->callbacks->on_headers_complete != NULL)) {
+        pause = parser->callbacks->on_headers_complete(parser->ctx, parser);
+    }
+
+    // Responses that never have a body
+    if ((parser->status_code == 204) || (parser->status_code == 304)) {
+        return response_complete(parser);
+    }
+
+    // Chunked takes precedence over Content-Length (RFC 9112, 6.3)
+    if (parser->chunked) {
+        parser->state = HTTP_PARSER_STATE_CHUNK_SIZE;
+    } else if (parser->has_content_length) {
+        if (parser->content_length == 0) {
+            return response_complete(parser);
+        }
+        parser->remaining = parser->content_length;
+        parser->state = HTTP_PARSER_STATE_BODY_LENGTH;
+    } else {
+        parser->keep_alive = false;
+        parser->state = HTTP_PARSER_STATE_BODY_UNTIL_CLOSE;
+    }
+
+    return pause ? HTTP_PARSER_PAUSED : HTTP_PARSER_NEED_MORE;
+}
+
+// Mark the response as complete and notify the application
+static http_parser_result_t response_complete(http_parser_t *parser)
+{
+    parser->state = HTTP_PARSER_STATE_COMPLETE;
+    if ((parser->callbacks != NULL) &&
+        (parser->callbacks->on_complete != NULL)) {
+        parser->callbacks->on_complete(parser->ctx, parser);
+    }
+
+    return HTTP_PARSER_COMPLETE;
+}
+
+// Check for a token in a comma-separated header value (case-insensitive)
+static bool has_token(const char *value, size_t len, const char *token)
+{
+    size_t token_len = strlen(token);
+    size_t start = 0;
+    size_t end;
+
+    while (start < len) {
+
+        // Skip separators and whitespace
+        while ((start < len) &&
+               (value[start] == ',' || value[start] == ' ' ||
+                value[start] == '\t')) {
+            start++;
+        }
+
+        // Find end of token
+        end = start;
+        while ((end < len) && (value[end] != ',')) {
+            end++;
+        }
+        while ((end > start) &&
+               (value[end - 1] == ' ' || value[end - 1] == '\t')) {
+            end--;
+        }
+
+        // Compare
+        if ((end - start == token_len) &&
+            (strncasecmp(&value[start], token, token_len) == 0)) {
+            return true;
+        }
+        start = end + 1;
+    }
+
+    return false;
+}
+
+// Compare a header name (case-insensitive)
+static bool name_equals(const char *name, size_t len, const char *expected)
+{
+    return (strlen(expected) == len) &&
+           (strncasecmp(name, expected, len) == 0);
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Initialize a parser for a new response
+void http_parser_init(http_parser_t *parser,
+                      const http_parser_callbacks_t *callbacks,
+                      void *ctx)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->callbacks = callbacks;
+    parser->ctx = ctx;
+    parser->state = HTTP_PARSER_STATE_STATUS_LINE;
+}
+
+// Reset a parser for the next response on the same connection
+void http_parser_reset(http_parser_t *parser)
+{
+    http_parser_init(parser, parser->callbacks, parser->ctx);
+}
+
+// Parse a contiguous span of response bytes
+http_parser_result_t http_parser_execute(http_parser_t *parser,
+                                         const uint8_t *data,
+                                         size_t len,
+                                         size_t *consumed)
+{
+    http_parser_result_t result = HTTP_PARSER_NEED_MORE;
+    const uint8_t *start = data;
+    const char *line;
+    size_t line_len;
+    size_t num;
+    int pause;
+
+    if (len > 0) {
+        parser->started = true;
+    }
+
+    while ((result == HTTP_PARSER_NEED_MORE) && (len > 0)) {
+        switch (parser->state) {
+
+            // Body bytes with known length (whole body or current chunk)
+            case HTTP_PARSER_STATE_BODY_LENGTH:
+            case HTTP_PARSER_STATE_CHUNK_DATA:
+                num = (len < parser->remaining) ? len : (size_t)parser->remaining;
+                pause = 0;
+                if ((parser->callbacks != NULL) &&
+                    (parser->callbacks->on_body != NULL)) {
+                    pause = parser->callbacks->on_body(parser->ctx, data, num);
+                }
+                data += num;
+                len -= num;
+                parser->remaining -= num;
+                parser->body_received += num;
+                if (parser->remaining == 0) {
+                    if (parser->state == HTTP_PARSER_STATE_BODY_LENGTH) {
+                        result = response_complete(parser);
+                    } else {
+                        parser->state = HTTP_PARSER_STATE_CHUNK_DATA_END;
+                    }
+                }
+                if (pause && (result == HTTP_PARSER_NEED_MORE)) {
+                    result = HTTP_PARSER_PAUSED;
+                }
+                break;
+
+            // Body ends when the server closes the connection
+            case HTTP_PARSER_STATE_BODY_UNTIL_CLOSE:
+                pause = 0;
+                if ((parser->callbacks != NULL) &&
+                    (parser->callbacks->on_body != NULL)) {
+                    pause = parser->callbacks->on_body(parser->ctx, data, len);
+                }
+                parser->body_received += len;
+                data += len;
+                len = 0;
+                if (pause) {
+                    result = HTTP_PARSER_PAUSED;
+                }
+                break;
+
+            // Nothing more to parse for this response
+            case HTTP_PARSER_STATE_COMPLETE:
+                result = HTTP_PARSER_COMPLETE;
+                break;
+            case HTTP_PARSER_STATE_ERROR:
+                result = HTTP_PARSER_ERROR;
+                break;
+
+            // Line-based parts of the response
+            default:
+                line = take_line(parser, &data, &len, &line_len);
+                if (line != NULL) {
+                    result = handle_line(parser, line, line_len);
+                }
+                break;
+        }
+    }
+
+    // Report a response that completed exactly at the end of the input
+    if ((result == HTTP_PARSER_NEED_MORE) &&
+        (parser->state == HTTP_PARSER_STATE_COMPLETE)) {
+        result = HTTP_PARSER_COMPLETE;
+    }
+
+    *consumed = (size_t)(data - start);
+
+    return result;
+}
+
+// Tell the parser the connection was closed by the server
+http_parser_result_t http_parser_finish(http_parser_t *parser)
+{
+    if (parser->state == HTTP_PARSER_STATE_COMPLETE) {
+        return HTTP_PARSER_COMPLETE;
+    }
+    if (parser->state == HTTP_PARSER_STATE_BODY_UNTIL_CLOSE) {
+        return response_complete(parser);
+    }
+    parser->state = HTTP_PARSER_STATE_ERROR;
+
+    return HTTP_PARSER_ERROR;
+}
+
+// Initialize a ring buffer over caller-supplied storage
+void http_ring_init(http_ring_t *ring, uint8_t *storage, size_t size)
+{
+    ring->buf = storage;
+    ring->size = size;
+    ring->head = 0;
+    ring->count = 0;
+}
+
+// Get the largest contiguous free region
+uint8_t *http_ring_write_ptr(http_ring_t *ring, size_t *len)
+{
+    size_t tail;
+
+    // Rewind to the start of storage when empty to maximize contiguous space
+    if (ring->count == 0) {
+        ring->head = 0;
+    }
+
+    tail = (ring->head + ring->count) % ring->size;
+    if (ring->count == ring->size) {
+        *len = 0;
+    } else if (tail >= ring->head) {
+        *len = ring->size - tail;
+    } else {
+        *len = ring->head - tail;
+    }
+
+    return &ring->buf[tail];
+}
+
+// Mark bytes written to the free region as readable
+void http_ring_commit(http_ring_t *ring, size_t len)
+{
+    ring->count += len;
+}
+
+// Parse all readable bytes in the ring and release what was consumed
+http_parser_result_t http_parser_execute_ring(http_parser_t *parser,
+                                              http_ring_t *ring)
+{
+    http_parser_result_t result = HTTP_PARSER_NEED_MORE;
+    size_t span;
+    size_t consumed;
+
+    // Readable bytes form at most two contiguous spans (before/after wrap)
+    while ((ring->count > 0) && (result == HTTP_PARSER_NEED_MORE)) {
+        span = ring->size - ring->head;
+        if (span > ring->count) {
+            span = ring->count;
+        }
+        result = http_parser_execute(parser,
+                                     &ring->buf[ring->head],
+                                     span,
+                                     &consumed);
+        ring->head = (ring->head + consumed) % ring->size;
+        ring->count -= consumed;
+    }
+
+    return result;
+}
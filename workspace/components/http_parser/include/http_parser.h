@@ -0,0 +1,181 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Longest status, header, or chunk-size line that can be reassembled
+ *        when it is split across two input spans. Longer header lines are
+ *        truncated.
+ */
+#ifndef HTTP_PARSER_LINE_MAX
+# define HTTP_PARSER_LINE_MAX 256
+#endif
+
+/**
+ * @brief Result of feeding data to the parser
+ */
+typedef enum {
+    HTTP_PARSER_NEED_MORE = 0,  // All input consumed, response not complete
+    HTTP_PARSER_PAUSED,         // A callback asked the parser to stop
+    HTTP_PARSER_COMPLETE,       // Full response parsed
+    HTTP_PARSER_ERROR,          // Malformed response
+} http_parser_result_t;
+
+/**
+ * @brief Internal parser state
+ */
+typedef enum {
+    HTTP_PARSER_STATE_STATUS_LINE = 0,
+    HTTP_PARSER_STATE_HEADER_LINE,
+    HTTP_PARSER_STATE_BODY_LENGTH,
+    HTTP_PARSER_STATE_BODY_UNTIL_CLOSE,
+    HTTP_PARSER_STATE_CHUNK_SIZE,
+    HTTP_PARSER_STATE_CHUNK_DATA,
+    HTTP_PARSER_STATE_CHUNK_DATA_END,
+    HTTP_PARSER_STATE_TRAILER_LINE,
+    HTTP_PARSER_STATE_COMPLETE,
+    HTTP_PARSER_STATE_ERROR,
+} http_parser_state_t;
+
+typedef struct http_parser http_parser_t;
+
+/**
+ * @brief Parser callbacks (any of them may be NULL)
+ *
+ * Return 0 from a callback to keep parsing or non-zero to pause. Pointers
+ * passed to callbacks are only valid for the duration of the call. Body
+ * slices point directly into the caller's buffer.
+ */
+typedef struct {
+    int (*on_header)(void *ctx,
+                     const char *name, size_t name_len,
+                     const char *value, size_t value_len);
+    int (*on_headers_complete)(void *ctx, const http_parser_t *parser);
+    int (*on_body)(void *ctx, const uint8_t *data, size_t len);
+    int (*on_complete)(void *ctx, const http_parser_t *parser);
+} http_parser_callbacks_t;
+
+/**
+ * @brief Parser instance (fields are read-only for the caller)
+ */
+struct http_parser {
+    http_parser_state_t state;
+    int status_code;                // Status code from the status line
+    uint8_t version_minor;          // 0 for HTTP/1.0, 1 for HTTP/1.1
+    bool chunked;                   // Transfer-Encoding: chunked
+    bool has_content_length;        // Content-Length header present
+    bool keep_alive;                // Connection may be reused afterwards
+    bool started;                   // At least one byte received
+    uint64_t content_length;        // Value of Content-Length header
+    uint64_t remaining;             // Bytes left in body or current chunk
+    uint64_t body_received;         // Decoded body bytes handed out so far
+    const http_parser_callbacks_t *callbacks;
+    void *ctx;
+    size_t line_len;
+    char line[HTTP_PARSER_LINE_MAX];
+};
+
+/**
+ * @brief Caller-supplied ring buffer that the parser reads in place
+ *
+ * Receive directly into http_ring_write_ptr() and let
+ * http_parser_execute_ring() consume what it parses. Bytes left unconsumed
+ * (e.g. after a callback paused the parser) stay in the ring.
+ */
+typedef struct {
+    uint8_t *buf;       // Storage
+    size_t size;        // Storage size (bytes)
+    size_t head;        // Index of the oldest unread byte
+    size_t count;       // Number of unread bytes
+} http_ring_t;
+
+/**
+ * @brief Initialize a parser for a new response
+ *
+ * @param[out] parser Parser to initialize
+ * @param[in] callbacks Callbacks (must outlive the parser), or NULL
+ * @param[in] ctx User context passed to callbacks
+ */
+void http_parser_init(http_parser_t *parser,
+                      const http_parser_callbacks_t *callbacks,
+                      void *ctx);
+
+/**
+ * @brief Reset a parser for the next response on the same connection
+ *
+ * @param[in] parser Parser to reset (callbacks are kept)
+ */
+void http_parser_reset(http_parser_t *parser);
+
+/**
+ * @brief Parse a contiguous span of response bytes
+ *
+ * @param[in] parser Parser instance
+ * @param[in] data Received bytes
+ * @param[in] len Number of received bytes
+ * @param[out] consumed Number of bytes the parser used
+ *
+ * @return Parser result (see http_parser_result_t)
+ */
+http_parser_result_t http_parser_execute(http_parser_t *parser,
+                                         const uint8_t *data,
+                                         size_t len,
+                                         size_t *consumed);
+
+/**
+ * @brief Tell the parser the connection was closed by the server
+ *
+ * @param[in] parser Parser instance
+ *
+ * @return HTTP_PARSER_COMPLETE if the body was delimited by the close,
+ *         HTTP_PARSER_ERROR if the response was truncated
+ */
+http_parser_result_t http_parser_finish(http_parser_t *parser);
+
+/**
+ * @brief Initialize a ring buffer over caller-supplied storage
+ *
+ * @param[out] ring Ring buffer to initialize
+ * @param[in] storage Backing memory
+ * @param[in] size Size of backing memory (bytes)
+ */
+void http_ring_init(http_ring_t *ring, uint8_t *storage, size_t size);
+
+/**
+ * @brief Get the largest contiguous free region (for recv())
+ *
+ * @param[in] ring Ring buffer
+ * @param[out] len Size of the free region (bytes), 0 if the ring is full
+ *
+ * @return Pointer to the free region
+ */
+uint8_t *http_ring_write_ptr(http_ring_t *ring, size_t *len);
+
+/**
+ * @brief Mark bytes written to the free region as readable
+ *
+ * @param[in] ring Ring buffer
+ * @param[in] len Number of bytes written
+ */
+void http_ring_commit(http_ring_t *ring, size_t len);
+
+/**
+ * @brief Parse all readable bytes in the ring and release what was consumed
+ *
+ * @param[in] parser Parser instance
+ * @param[in] ring Ring buffer holding received bytes
+ *
+ * @return Parser result (see http_parser_result_t)
+ */
+http_parser_result_t http_parser_execute_ring(http_parser_t *parser,
+                                              http_ring_t *ring);
+
+#endif // HTTP_PARSER_H
@@ -0,0 +1,234 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Long-lived esp_http_client wrapper.
+ *
+ * Creating a client allocates its request/response buffers and header lists,
+ * and every new connection costs a TCP (and possibly TLS) handshake. Keeping
+ * one client and one connection for the life of the application avoids both.
+ */
+
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "http_session.h"
+
+// Tag for debug messages
+static const char *TAG = "http_session";
+
+#if CONFIG_HTTP_SESSION_COUNT_ALLOCS
+// Static global variables (written from the heap hooks)
+static TaskHandle_t s_count_task = NULL;
+static volatile uint32_t s_alloc_count = 0;
+static volatile uint32_t s_alloc_bytes = 0;
+#endif
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static esp_err_t on_http_event(esp_http_client_event_t *evt);
+static void alloc_count_start(void);
+static void alloc_count_stop(http_session_stats_t *stats);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Event handler: track the connection, then forward to the application
+static esp_err_t on_http_event(esp_http_client_event_t *evt)
+{
+    http_session_t *session = (http_session_t *)evt->user_data;
+
+    // Count connections
+    switch (evt->event_id) {
+        case HTTP_EVENT_ON_CONNECTED:
+            session->connected = true;
+            session->stats.connects++;
+            break;
+        case HTTP_EVENT_DISCONNECTED:
+            if (session->connected) {
+                session->stats.disconnects++;
+            }
+            session->connected = false;
+            break;
+        default:
+            break;
+    }
+
+    // Forward to the application's handler with its own user data
+    if (session->user_handler != NULL) {
+        evt->user_data = session->user_data;
+        return session->user_handler(evt);
+    }
+
+    return ESP_OK;
+}
+
+// Start counting heap allocations made by the calling task
+static void alloc_count_start(void)
+{
+#if CONFIG_HTTP_SESSION_COUNT_ALLOCS
+    s_alloc_count = 0;
+    s_alloc_bytes = 0;
+    s_count_task = xTaskGetCurrentTaskHandle();
+#endif
+}
+
+// Stop counting and record the result
+static void alloc_count_stop(http_session_stats_t *stats)
+{
+#if CONFIG_HTTP_SESSION_COUNT_ALLOCS
+    s_count_task = NULL;
+    stats->last_allocs = s_alloc_count;
+    stats->last_alloc_bytes = s_alloc_bytes;
+    stats->total_allocs += s_alloc_count;
+#else
+    (void)stats;
+#endif
+}
+
+#if CONFIG_HTTP_SESSION_COUNT_ALLOCS
+// Heap hook: called by the allocator after every successful allocation
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+    if ((s_count_task != NULL) && (xTaskGetCurrentTaskHandle() == s_count_task)) {
+        s_alloc_count++;
+        s_alloc_bytes += size;
+    }
+}
+
+// Heap hook: called by the allocator on every free (not needed)
+void IRAM_ATTR esp_heap_trace_free_hook(void *ptr)
+{
+}
+#endif
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Create the client for a session (call once)
+esp_err_t http_session_init(http_session_t *session,
+                            const esp_http_client_config_t *config)
+{
+    esp_http_client_config_t session_config;
+
+    // Route events through our handler so we can see connects/disconnects
+    memset(session, 0, sizeof(*session));
+    memcpy(&session_config, config, sizeof(session_config));
+    session->user_handler = config->event_handler;
+    session->user_data = config->user_data;
+    session_config.event_handler = on_http_event;
+    session_config.user_data = session;
+
+    // Create the client (allocates buffers once for the life of the session)
+    session->client = esp_http_client_init(&session_config);
+    if (session->client == NULL) {
+        ESP_LOGE(TAG, "Failed to initialize HTTP client");
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+// Close the connection and free the client
+void http_session_deinit(http_session_t *session)
+{
+    if (session->client != NULL) {
+        esp_http_client_cleanup(session->client);
+        session->client = NULL;
+    }
+    session->connected = false;
+}
+
+// Send a POST request over the session's connection
+esp_err_t http_session_post(http_session_t *session,
+                            const char *content_type,
+                            const char *data,
+                            int len,
+                            int *status)
+{
+    esp_err_t esp_ret;
+    bool reused;
+
+    // Make sure the session was created
+    if (session->client == NULL) {
+        ESP_LOGE(TAG, "HTTP session is not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    alloc_count_start();
+
+    // Rewrite the header only when it changes (setting a header allocates)
+    if (strcmp(session->content_type, content_type) != 0) {
+        if (strlen(content_type) >= sizeof(session->content_type)) {
+            ESP_LOGE(TAG, "Content-Type is too long: %s", content_type);
+            esp_ret = ESP_ERR_INVALID_ARG;
+            goto cleanup;
+        }
+        esp_ret = esp_http_client_set_header(session->client,
+                                             "Content-Type",
+                                             content_type);
+        if (esp_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error (%d): Could not set HTTP header", esp_ret);
+            goto cleanup;
+        }
+        strcpy(session->content_type, content_type);
+    }
+
+    // Set the POST data (the client keeps a pointer, no copy is made)
+    esp_ret = esp_http_client_set_post_field(session->client, data, len);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Could not set POST field", esp_ret);
+        goto cleanup;
+    }
+
+    // Perform request on the open connection (or open a new one)
+    reused = session->connected;
+    esp_ret = esp_http_client_perform(session->client);
+
+    // The server may have closed an idle connection: resend on a new one
+    if ((esp_ret != ESP_OK) && reused) {
+        ESP_LOGW(TAG, "Error (%d): Kept-alive connection failed, reconnecting",
+                 esp_ret);
+        esp_http_client_close(session->client);
+        session->connected = false;
+        session->stats.retries++;
+        esp_ret = esp_http_client_perform(session->client);
+    }
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): HTTP POST request failed", esp_ret);
+        goto cleanup;
+    }
+
+    // Return status code
+    if (status != NULL) {
+        *status = esp_http_client_get_status_code(session->client);
+    }
+
+cleanup:
+    alloc_count_stop(&session->stats);
+    if (esp_ret == ESP_OK) {
+        session->stats.requests++;
+    } else {
+        session->stats.failures++;
+    }
+
+    return esp_ret;
+}
+
+// Get session statistics
+void http_session_get_stats(const http_session_t *session,
+                            http_session_stats_t *stats)
+{
+    memcpy(stats, &session->stats, sizeof(*stats));
+}
@@ -0,0 +1,103 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HTTP_SESSION_H
+#define HTTP_SESSION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_http_client.h"
+
+/**
+ * @brief Longest Content-Type value that can be set (including NUL)
+ */
+#define HTTP_SESSION_CONTENT_TYPE_MAX 48
+
+/**
+ * @brief Session statistics
+ */
+typedef struct {
+    uint32_t requests;          // Requests completed (any status code)
+    uint32_t failures;          // Requests that failed after any retry
+    uint32_t connects;          // Connections opened to the server
+    uint32_t disconnects;       // Connections closed (by either side)
+    uint32_t retries;           // Requests resent after a stale connection
+    uint32_t last_allocs;       // Heap allocations during the last request
+    uint32_t last_alloc_bytes;  // Bytes allocated during the last request
+    uint32_t total_allocs;      // Heap allocations during all requests
+} http_session_stats_t;
+
+/**
+ * @brief Long-lived HTTP client session (fields are private)
+ */
+typedef struct {
+    esp_http_client_handle_t client;        // Reused client handle
+    http_event_handle_cb user_handler;      // Application event handler
+    void *user_data;                        // Application user data
+    char content_type[HTTP_SESSION_CONTENT_TYPE_MAX];  // Current header
+    bool connected;                         // Connection currently open
+    http_session_stats_t stats;
+} http_session_t;
+
+/**
+ * @brief Create the client for a session (call once)
+ *
+ * The configuration is copied. Its event_handler and user_data are called
+ * and passed through as usual.
+ *
+ * @param[out] session Session to initialize
+ * @param[in] config Client configuration (URL, method, timeouts, etc.)
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t http_session_init(http_session_t *session,
+                            const esp_http_client_config_t *config);
+
+/**
+ * @brief Close the connection and free the client
+ *
+ * @param[in] session Session to free
+ */
+void http_session_deinit(http_session_t *session);
+
+/**
+ * @brief Send a POST request over the session's connection
+ *
+ * Only the post field is swapped for each request. The Content-Type header
+ * is rewritten only when it changes, since setting a header allocates. The
+ * data is not copied and must stay valid until this function returns. If
+ * the server closed the kept-alive connection since the last request, the
+ * request is sent once more on a new connection.
+ *
+ * @param[in] session Session to use
+ * @param[in] content_type Value of the Content-Type header
+ * @param[in] data Request body
+ * @param[in] len Length of the request body (bytes)
+ * @param[out] status HTTP status code of the response (may be NULL)
+ *
+ * @return
+ *  - ESP_OK if a response was received (check status)
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t http_session_post(http_session_t *session,
+                            const char *content_type,
+                            const char *data,
+                            int len,
+                            int *status);
+
+/**
+ * @brief Get session statistics
+ *
+ * @param[in] session Session to read
+ * @param[out] stats Statistics since http_session_init()
+ */
+void http_session_get_stats(const http_session_t *session,
+                            http_session_stats_t *stats);
+
+#endif // HTTP_SESSION_H
@@ -0,0 +1,203 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * I2C master driver backend and bus task for the bus manager.
+ *
+ * One task owns the bus: it runs the batch that is due, then blocks on its
+ * notification until the next due time, so it never polls. Adding a device
+ * or reading counters takes the lock, and unlocking notifies the task so a
+ * device that falls due sooner than the current sleep is not late.
+ */
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "i2c_bus_esp.h"
+
+// Settings
+#define TASK_STACK_SIZE     CONFIG_I2C_BUS_MANAGER_TASK_STACK_SIZE
+#define TASK_PRIORITY       CONFIG_I2C_BUS_MANAGER_TASK_PRIORITY
+#define TIMEOUT_MS          CONFIG_I2C_BUS_MANAGER_TIMEOUT_MS
+#define STOP_TIMEOUT_MS     (TIMEOUT_MS * I2C_BUS_MAX_DEVICES + 100)
+
+// Tag for debug messages
+static const char *TAG = "i2c_bus_manager";
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static int esp_add_device(void *ctx, uint16_t addr, uint32_t scl_speed_hz, void **handle);
+static int esp_read(void *ctx, void *handle,
+                    const uint8_t *reg, size_t reg_len,
+                    uint8_t *data, size_t len);
+static int64_t esp_now_us(void *ctx);
+static void runner_task(void *arg);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Backend: add a device to the master bus
+static int esp_add_device(void *ctx, uint16_t addr, uint32_t scl_speed_hz, void **handle)
+{
+    esp_err_t esp_ret;
+    i2c_master_dev_handle_t dev;
+
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = addr,
+        .scl_speed_hz = scl_speed_hz,
+    };
+
+    esp_ret = i2c_master_bus_add_device((i2c_master_bus_handle_t)ctx, &dev_config, &dev);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to add device 0x%02x", esp_ret, addr);
+        return esp_ret;
+    }
+    *handle = dev;
+
+    return ESP_OK;
+}
+
+// Backend: blocking register read
+static int esp_read(void *ctx, void *handle,
+                    const uint8_t *reg, size_t reg_len,
+                    uint8_t *data, size_t len)
+{
+    i2c_master_dev_handle_t dev = (i2c_master_dev_handle_t)handle;
+
+    if (reg_len == 0) {
+        return i2c_master_receive(dev, data, len, TIMEOUT_MS);
+    }
+
+    return i2c_master_transmit_receive(dev, reg, reg_len, data, len, TIMEOUT_MS);
+}
+
+// Backend: microseconds since boot
+static int64_t esp_now_us(void *ctx)
+{
+    return esp_timer_get_time();
+}
+
+// Bus task: run what is due, then sleep until the next due time
+static void runner_task(void *arg)
+{
+    i2c_bus_runner_t *runner = (i2c_bus_runner_t *)arg;
+    int64_t next_us;
+    int64_t wait_us;
+    TickType_t wait;
+
+    while (!runner->stopping) {
+
+        // Run the batch that is due
+        xSemaphoreTake(runner->lock, portMAX_DELAY);
+        next_us = i2c_bus_manager_run(runner->mgr);
+        xSemaphoreGive(runner->lock);
+
+        // Sleep until the next read (rounded up to whole ticks), or until
+        // the schedule changes
+        if (next_us == INT64_MAX) {
+            wait = portMAX_DELAY;
+        } else {
+            wait_us = next_us - esp_timer_get_time();
+            if (wait_us <= 0) {
+                continue;
+            }
+            wait = (TickType_t)((wait_us + portTICK_PERIOD_MS * 1000 - 1) /
+                                (portTICK_PERIOD_MS * 1000));
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+
+    runner->task = NULL;
+    vTaskDelete(NULL);
+}
+
+/*******************************************************************************
+ * Public data
+ */
+
+// I2C master driver backend
+const i2c_bus_backend_t i2c_bus_esp_backend = {
+    .add_device = esp_add_device,
+    .read = esp_read,
+    .now_us = esp_now_us,
+};
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Start a task that runs the manager's schedule
+esp_err_t i2c_bus_runner_start(i2c_bus_runner_t *runner, i2c_bus_manager_t *mgr)
+{
+    BaseType_t ret;
+
+    runner->mgr = mgr;
+    runner->stopping = false;
+    runner->task = NULL;
+    runner->lock = xSemaphoreCreateMutex();
+    if (runner->lock == NULL) {
+        ESP_LOGE(TAG, "Failed to create lock");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ret = xTaskCreate(runner_task,
+                      "i2c_bus",
+                      TASK_STACK_SIZE,
+                      runner,
+                      TASK_PRIORITY,
+                      &runner->task);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create bus task");
+        vSemaphoreDelete(runner->lock);
+        runner->lock = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+// Stop the task (waits for the batch in progress)
+esp_err_t i2c_bus_runner_stop(i2c_bus_runner_t *runner)
+{
+    TickType_t start;
+
+    if (runner->task != NULL) {
+        runner->stopping = true;
+        xTaskNotifyGive(runner->task);
+        start = xTaskGetTickCount();
+        while (runner->task != NULL) {
+            if ((xTaskGetTickCount() - start) > pdMS_TO_TICKS(STOP_TIMEOUT_MS)) {
+                ESP_LOGE(TAG, "Bus task did not stop");
+                return ESP_ERR_TIMEOUT;
+            }
+            vTaskDelay(1);
+        }
+    }
+    if (runner->lock != NULL) {
+        vSemaphoreDelete(runner->lock);
+        runner->lock = NULL;
+    }
+
+    return ESP_OK;
+}
+
+// Lock the manager to add devices or read counters while it runs
+void i2c_bus_runner_lock(i2c_bus_runner_t *runner)
+{
+    xSemaphoreTake(runner->lock, portMAX_DELAY);
+}
+
+// Unlock the manager and let the task pick up schedule changes
+void i2c_bus_runner_unlock(i2c_bus_runner_t *runner)
+{
+    xSemaphoreGive(runner->lock);
+    if (runner->task != NULL) {
+        xTaskNotifyGive(runner->task);
+    }
+}
@@ -0,0 +1,343 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Multi-device I2C bus scheduler.
+ *
+ * Every device has a period and a next-due time on a common time base, so
+ * devices with harmonic periods fall due at the same instants. Each call to
+ * i2c_bus_manager_run() collects the reads due now or within the batch
+ * window, orders them to keep the bus at one clock as long as possible, and
+ * runs them back to back. The caller sleeps until the returned due time, so
+ * the bus sees a few dense bursts instead of many scattered transactions.
+ *
+ * The manager has no ESP-IDF dependencies: the bus, the clock, and device
+ * registration all go through a backend.
+ */
+
+#include <string.h>
+
+#include "i2c_bus_manager.h"
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static bool read_before(const i2c_bus_manager_t *mgr,
+                        const i2c_bus_device_t *a,
+                        const i2c_bus_device_t *b);
+static void run_read(i2c_bus_manager_t *mgr, uint8_t id);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Batch order: current clock first, then by clock, then earliest due
+static bool read_before(const i2c_bus_manager_t *mgr,
+                        const i2c_bus_device_t *a,
+                        const i2c_bus_device_t *b)
+{
+    bool a_current = (a->config.scl_speed_hz == mgr->current_scl_hz);
+    bool b_current = (b->config.scl_speed_hz == mgr->current_scl_hz);
+
+    if (a_current != b_current) {
+        return a_current;
+    }
+    if (a->config.scl_speed_hz != b->config.scl_speed_hz) {
+        return a->config.scl_speed_hz > b->config.scl_speed_hz;
+    }
+
+    return a->next_due_us < b->next_due_us;
+}
+
+// Run one read, hand it to the device callback, and schedule the next one
+static void run_read(i2c_bus_manager_t *mgr, uint8_t id)
+{
+    i2c_bus_device_t *dev = &mgr->devices[id];
+    const i2c_bus_backend_t *backend = mgr->backend;
+    uint8_t data[I2C_BUS_DATA_MAX];
+    int64_t start_us;
+    int64_t done_us;
+    int64_t late_us;
+    uint32_t latency_us;
+    uint32_t skipped;
+    int err;
+
+    // Count a clock switch when the previous read ran at another speed
+    if ((mgr->current_scl_hz != 0) &&
+        (mgr->current_scl_hz != dev->config.scl_speed_hz)) {
+        mgr->clock_switches++;
+    }
+    mgr->current_scl_hz = dev->config.scl_speed_hz;
+
+    // Run the transaction
+    start_us = backend->now_us(mgr->backend_ctx);
+    err = backend->read(mgr->backend_ctx,
+                        dev->handle,
+                        dev->config.reg,
+                        dev->config.reg_len,
+                        data,
+                        dev->config.read_len);
+    done_us = backend->now_us(mgr->backend_ctx);
+
+    // Update counters
+    mgr->transactions++;
+    mgr->busy_us += (uint64_t)(done_us - start_us);
+    dev->reads++;
+    dev->bus_time_sum_us += (uint64_t)(done_us - start_us);
+    if (err != 0) {
+        dev->errors++;
+    }
+    late_us = done_us - dev->next_due_us;
+    latency_us = (late_us > 0) ? (uint32_t)late_us : 0;
+    if ((dev->reads == 1) || (latency_us < dev->latency_min_us)) {
+        dev->latency_min_us = latency_us;
+    }
+    if (latency_us > dev->latency_max_us) {
+        dev->latency_max_us = latency_us;
+    }
+    dev->latency_sum_us += latency_us;
+
+    // Next period; skip whole periods the bus was too late for
+    dev->next_due_us += dev->config.period_us;
+    if (dev->next_due_us <= done_us) {
+        skipped = (uint32_t)((done_us - dev->next_due_us) / dev->config.period_us) + 1;
+        dev->next_due_us += (int64_t)skipped * dev->config.period_us;
+        dev->missed += skipped;
+    }
+
+    // Hand over the result
+    if (dev->config.on_read != NULL) {
+        dev->config.on_read(dev->config.ctx,
+                            id,
+                            err,
+                            data,
+                            (err == 0) ? dev->config.read_len : 0,
+                            start_us);
+    }
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Initialize a manager with no devices
+i2c_bus_result_t i2c_bus_manager_init(i2c_bus_manager_t *mgr,
+                                      const i2c_bus_backend_t *backend,
+                                      void *backend_ctx,
+                                      uint32_t batch_window_us)
+{
+    if ((mgr == NULL) ||
+        (backend == NULL) ||
+        (backend->add_device == NULL) ||
+        (backend->read == NULL) ||
+        (backend->now_us == NULL)) {
+        return I2C_BUS_ERR_INVALID;
+    }
+
+    memset(mgr, 0, sizeof(*mgr));
+    mgr->backend = backend;
+    mgr->backend_ctx = backend_ctx;
+    mgr->batch_window_us = batch_window_us;
+    mgr->start_us = backend->now_us(backend_ctx);
+    mgr->stats_start_us = mgr->start_us;
+
+    return I2C_BUS_OK;
+}
+
+// Add a device to the schedule
+i2c_bus_result_t i2c_bus_manager_add(i2c_bus_manager_t *mgr,
+                                     const i2c_bus_device_config_t *config,
+                                     uint8_t *id)
+{
+    i2c_bus_device_t *dev;
+    int64_t now_us;
+    int64_t periods;
+
+    // Check parameters
+    if ((config == NULL) ||
+        (config->scl_speed_hz == 0) ||
+        (config->reg_len > I2C_BUS_REG_MAX) ||
+        (config->read_len == 0) ||
+        (config->read_len > I2C_BUS_DATA_MAX) ||
+        (config->period_us == 0)) {
+        return I2C_BUS_ERR_INVALID;
+    }
+    if (mgr->num_devices >= I2C_BUS_MAX_DEVICES) {
+        return I2C_BUS_ERR_FULL;
+    }
+
+    // Register the device with the bus
+    dev = &mgr->devices[mgr->num_devices];
+    memset(dev, 0, sizeof(*dev));
+    if (mgr->backend->add_device(mgr->backend_ctx,
+                                 config->addr,
+                                 config->scl_speed_hz,
+                                 &dev->handle) != 0) {
+        return I2C_BUS_ERR_BACKEND;
+    }
+    dev->config = *config;
+    dev->wire_us = i2c_bus_manager_wire_time_us(config->scl_speed_hz,
+                                                config->reg_len,
+                                                config->read_len);
+
+    // First read at the next multiple of the period on the common time base
+    now_us = mgr->backend->now_us(mgr->backend_ctx);
+    periods = (now_us - mgr->start_us) / config->period_us + 1;
+    dev->next_due_us = mgr->start_us + periods * config->period_us;
+
+    if (id != NULL) {
+        *id = mgr->num_devices;
+    }
+    mgr->num_devices++;
+
+    return I2C_BUS_OK;
+}
+
+// Run every read that is due (or due within the batch window)
+int64_t i2c_bus_manager_run(i2c_bus_manager_t *mgr)
+{
+    uint8_t batch[I2C_BUS_MAX_DEVICES];
+    uint8_t count = 0;
+    uint8_t tmp;
+    uint32_t window_us;
+    int64_t now_us;
+    int64_t next_us = INT64_MAX;
+
+    // Collect the reads due before the end of the window. A read is never
+    // pulled forward by more than half its period, so fast devices keep
+    // roughly even spacing.
+    now_us = mgr->backend->now_us(mgr->backend_ctx);
+    for (uint8_t i = 0; i < mgr->num_devices; i++) {
+        window_us = mgr->devices[i].config.period_us / 2;
+        if (window_us > mgr->batch_window_us) {
+            window_us = mgr->batch_window_us;
+        }
+        if (mgr->devices[i].next_due_us <= now_us + window_us) {
+            batch[count++] = i;
+        }
+    }
+
+    // Order them (insertion sort; batches are small)
+    for (uint8_t i = 1; i < count; i++) {
+        tmp = batch[i];
+        uint8_t j = i;
+        while ((j > 0) &&
+               read_before(mgr, &mgr->devices[tmp], &mgr->devices[batch[j - 1]])) {
+            batch[j] = batch[j - 1];
+            j--;
+        }
+        batch[j] = tmp;
+    }
+
+    // Run them back to back
+    for (uint8_t i = 0; i < count; i++) {
+        run_read(mgr, batch[i]);
+    }
+    if (count > 0) {
+        mgr->batches++;
+    }
+
+    // Find the next due time
+    for (uint8_t i = 0; i < mgr->num_devices; i++) {
+        if (mgr->devices[i].next_due_us < next_us) {
+            next_us = mgr->devices[i].next_due_us;
+        }
+    }
+
+    return next_us;
+}
+
+// Get the bus counters
+void i2c_bus_manager_get_stats(const i2c_bus_manager_t *mgr, i2c_bus_stats_t *stats)
+{
+    uint64_t load = 0;
+    int64_t now_us;
+
+    now_us = mgr->backend->now_us(mgr->backend_ctx);
+
+    stats->transactions = mgr->transactions;
+    stats->batches = mgr->batches;
+    stats->clock_switches = mgr->clock_switches;
+    stats->busy_us = mgr->busy_us;
+    stats->elapsed_us = (now_us > mgr->stats_start_us) ?
+                        (uint64_t)(now_us - mgr->stats_start_us) : 0;
+    stats->utilization_permille = (stats->elapsed_us > 0) ?
+        (uint32_t)((mgr->busy_us * 1000) / stats->elapsed_us) : 0;
+
+    // Sum of wire time over period for every device
+    for (uint8_t i = 0; i < mgr->num_devices; i++) {
+        load += ((uint64_t)mgr->devices[i].wire_us * 1000) /
+                mgr->devices[i].config.period_us;
+    }
+    stats->load_permille = (uint32_t)load;
+}
+
+// Get the counters of one device
+i2c_bus_result_t i2c_bus_manager_get_device_stats(const i2c_bus_manager_t *mgr,
+                                                  uint8_t id,
+                                                  i2c_bus_device_stats_t *stats)
+{
+    const i2c_bus_device_t *dev;
+
+    if (id >= mgr->num_devices) {
+        return I2C_BUS_ERR_INVALID;
+    }
+    dev = &mgr->devices[id];
+
+    stats->reads = dev->reads;
+    stats->errors = dev->errors;
+    stats->missed = dev->missed;
+    stats->latency_min_us = dev->latency_min_us;
+    stats->latency_max_us = dev->latency_max_us;
+    stats->latency_mean_us = (dev->reads > 0) ?
+                             (uint32_t)(dev->latency_sum_us / dev->reads) : 0;
+    stats->bus_time_mean_us = (dev->reads > 0) ?
+                              (uint32_t)(dev->bus_time_sum_us / dev->reads) : 0;
+
+    return I2C_BUS_OK;
+}
+
+// Reset the bus and device counters (the schedule is kept)
+void i2c_bus_manager_reset_stats(i2c_bus_manager_t *mgr)
+{
+    i2c_bus_device_t *dev;
+
+    mgr->stats_start_us = mgr->backend->now_us(mgr->backend_ctx);
+    mgr->busy_us = 0;
+    mgr->transactions = 0;
+    mgr->batches = 0;
+    mgr->clock_switches = 0;
+    for (uint8_t i = 0; i < mgr->num_devices; i++) {
+        dev = &mgr->devices[i];
+        dev->reads = 0;
+        dev->errors = 0;
+        dev->missed = 0;
+        dev->latency_min_us = 0;
+        dev->latency_max_us = 0;
+        dev->latency_sum_us = 0;
+        dev->bus_time_sum_us = 0;
+    }
+}
+
+// Estimate the time one read takes on the wire
+uint32_t i2c_bus_manager_wire_time_us(uint32_t scl_speed_hz, size_t reg_len, size_t read_len)
+{
+    uint32_t bits;
+
+    if (scl_speed_hz == 0) {
+        return 0;
+    }
+
+    // Start + address, register bytes, repeated start + address, data, stop
+    bits = 1 + 9;
+    if (reg_len > 0) {
+        bits += (9 * reg_len) + 1 + 9;
+    }
+    bits += (9 * read_len) + 1;
+
+    return (uint32_t)(((uint64_t)bits * 1000000 + scl_speed_hz - 1) / scl_speed_hz) +
+           I2C_BUS_OVERHEAD_US;
+}
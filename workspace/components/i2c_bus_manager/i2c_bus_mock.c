@@ -0,0 +1,154 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Simulated I2C bus backend.
+ *
+ * Lets the bus manager be driven on the host with a deterministic clock:
+ * transactions cost their estimated wire time (and a penalty for changing
+ * SCL speed), devices return canned bytes or NACK on request.
+ */
+
+#include <string.h>
+
+#include "i2c_bus_mock.h"
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static i2c_bus_mock_device_t *find_device(i2c_bus_mock_t *mock, uint16_t addr);
+static int mock_add_device(void *ctx, uint16_t addr, uint32_t scl_speed_hz, void **handle);
+static int mock_read(void *ctx, void *handle,
+                     const uint8_t *reg, size_t reg_len,
+                     uint8_t *data, size_t len);
+static int64_t mock_now_us(void *ctx);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Find a device by address, creating it if there is room
+static i2c_bus_mock_device_t *find_device(i2c_bus_mock_t *mock, uint16_t addr)
+{
+    i2c_bus_mock_device_t *dev;
+
+    for (uint8_t i = 0; i < mock->num_devices; i++) {
+        if (mock->devices[i].addr == addr) {
+            return &mock->devices[i];
+        }
+    }
+    if (mock->num_devices >= I2C_BUS_MAX_DEVICES) {
+        return NULL;
+    }
+    dev = &mock->devices[mock->num_devices++];
+    memset(dev, 0, sizeof(*dev));
+    dev->addr = addr;
+
+    return dev;
+}
+
+// Backend: register a device
+static int mock_add_device(void *ctx, uint16_t addr, uint32_t scl_speed_hz, void **handle)
+{
+    i2c_bus_mock_device_t *dev = find_device((i2c_bus_mock_t *)ctx, addr);
+
+    if (dev == NULL) {
+        return I2C_BUS_MOCK_ERR_NACK;
+    }
+    dev->scl_speed_hz = scl_speed_hz;
+    *handle = dev;
+
+    return 0;
+}
+
+// Backend: run one read and advance the clock by its duration
+static int mock_read(void *ctx, void *handle,
+                     const uint8_t *reg, size_t reg_len,
+                     uint8_t *data, size_t len)
+{
+    i2c_bus_mock_t *mock = (i2c_bus_mock_t *)ctx;
+    i2c_bus_mock_device_t *dev = (i2c_bus_mock_device_t *)handle;
+
+    // Charge the clock change and the transaction
+    if ((mock->scl_speed_hz != 0) && (mock->scl_speed_hz != dev->scl_speed_hz)) {
+        mock->now_us += mock->switch_us;
+        mock->clock_switches++;
+    }
+    mock->scl_speed_hz = dev->scl_speed_hz;
+    mock->now_us += i2c_bus_manager_wire_time_us(dev->scl_speed_hz, reg_len, len);
+    mock->transactions++;
+    dev->reads++;
+
+    if (dev->nack) {
+        return I2C_BUS_MOCK_ERR_NACK;
+    }
+    memcpy(dev->last_reg, reg, (reg_len < I2C_BUS_REG_MAX) ? reg_len : I2C_BUS_REG_MAX);
+    memcpy(data, dev->data, (len < I2C_BUS_DATA_MAX) ? len : I2C_BUS_DATA_MAX);
+
+    return 0;
+}
+
+// Backend: current simulated time
+static int64_t mock_now_us(void *ctx)
+{
+    return ((i2c_bus_mock_t *)ctx)->now_us;
+}
+
+/*******************************************************************************
+ * Public data
+ */
+
+// Simulated bus backend
+const i2c_bus_backend_t i2c_bus_mock_backend = {
+    .add_device = mock_add_device,
+    .read = mock_read,
+    .now_us = mock_now_us,
+};
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Initialize an empty bus with its clock at 0
+void i2c_bus_mock_init(i2c_bus_mock_t *mock, uint32_t switch_us)
+{
+    memset(mock, 0, sizeof(*mock));
+    mock->switch_us = switch_us;
+}
+
+// Set the bytes a device returns (creates the device if needed)
+i2c_bus_mock_device_t *i2c_bus_mock_set_data(i2c_bus_mock_t *mock,
+                                             uint16_t addr,
+                                             const uint8_t *data,
+                                             size_t len)
+{
+    i2c_bus_mock_device_t *dev = find_device(mock, addr);
+
+    if (dev != NULL) {
+        memset(dev->data, 0, sizeof(dev->data));
+        memcpy(dev->data, data, (len < I2C_BUS_DATA_MAX) ? len : I2C_BUS_DATA_MAX);
+    }
+
+    return dev;
+}
+
+// Make a device fail (or stop failing) every read
+i2c_bus_mock_device_t *i2c_bus_mock_set_nack(i2c_bus_mock_t *mock, uint16_t addr, bool nack)
+{
+    i2c_bus_mock_device_t *dev = find_device(mock, addr);
+
+    if (dev != NULL) {
+        dev->nack = nack;
+    }
+
+    return dev;
+}
+
+// Move the clock forward (e.g. to stand in for sleeping)
+void i2c_bus_mock_advance(i2c_bus_mock_t *mock, int64_t us)
+{
+    mock->now_us += us;
+}
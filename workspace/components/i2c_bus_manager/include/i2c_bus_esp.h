@@ -0,0 +1,80 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef I2C_BUS_ESP_H
+#define I2C_BUS_ESP_H
+
+#include <stdbool.h>
+
+#include "driver/i2c_master.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "i2c_bus_manager.h"
+
+/**
+ * @brief Backend for i2c_bus_manager_init() on the I2C master driver
+ *
+ * The context is the i2c_master_bus_handle_t. The bus must be created with
+ * trans_queue_depth = 0 (synchronous): the manager runs reads back to back
+ * and needs each one finished before it starts the next. Backend errors are
+ * esp_err_t codes.
+ */
+extern const i2c_bus_backend_t i2c_bus_esp_backend;
+
+/**
+ * @brief Task that runs a bus manager (internal state)
+ */
+typedef struct {
+    i2c_bus_manager_t *mgr;
+    SemaphoreHandle_t lock;
+    TaskHandle_t task;
+    volatile bool stopping;
+} i2c_bus_runner_t;
+
+/**
+ * @brief Start a task that runs the manager's schedule
+ *
+ * The task runs each batch, then sleeps until the next read is due. Read
+ * callbacks are called from this task with the manager locked, so they must
+ * not call i2c_bus_runner_lock().
+ *
+ * @param[out] runner Runner (must stay valid until stopped)
+ * @param[in] mgr Initialized manager (devices can be added before or after)
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_NO_MEM if the task or its lock could not be created
+ */
+esp_err_t i2c_bus_runner_start(i2c_bus_runner_t *runner, i2c_bus_manager_t *mgr);
+
+/**
+ * @brief Stop the task (waits for the batch in progress)
+ *
+ * @param[in] runner Runner
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_TIMEOUT if the task did not stop
+ */
+esp_err_t i2c_bus_runner_stop(i2c_bus_runner_t *runner);
+
+/**
+ * @brief Lock the manager to add devices or read counters while it runs
+ *
+ * @param[in] runner Runner
+ */
+void i2c_bus_runner_lock(i2c_bus_runner_t *runner);
+
+/**
+ * @brief Unlock the manager and let the task pick up schedule changes
+ *
+ * @param[in] runner Runner
+ */
+void i2c_bus_runner_unlock(i2c_bus_runner_t *runner);
+
+#endif // I2C_BUS_ESP_H
@@ -0,0 +1,249 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef I2C_BUS_MANAGER_H
+#define I2C_BUS_MANAGER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Largest number of devices on one bus (set from
+ *        CONFIG_I2C_BUS_MANAGER_MAX_DEVICES in ESP-IDF builds)
+ */
+#ifndef I2C_BUS_MAX_DEVICES
+# define I2C_BUS_MAX_DEVICES 8
+#endif
+
+/**
+ * @brief Longest register address written before each read
+ */
+#define I2C_BUS_REG_MAX         2
+
+/**
+ * @brief Largest number of data bytes in one read
+ */
+#define I2C_BUS_DATA_MAX        8
+
+/**
+ * @brief Software overhead per transaction used in wire time estimates
+ */
+#ifndef I2C_BUS_OVERHEAD_US
+# define I2C_BUS_OVERHEAD_US    60
+#endif
+
+/**
+ * @brief Result of a bus manager call
+ */
+typedef enum {
+    I2C_BUS_OK = 0,             // Success
+    I2C_BUS_ERR_INVALID,        // Bad argument
+    I2C_BUS_ERR_FULL,           // No room for another device
+    I2C_BUS_ERR_BACKEND,        // The backend refused the device
+} i2c_bus_result_t;
+
+/**
+ * @brief How the manager reaches the bus
+ *
+ * All calls come from the task running i2c_bus_manager_run(). Backend
+ * functions return 0 on success or a backend error code (esp_err_t for the
+ * I2C master driver backend), which is passed on to the read callback.
+ */
+typedef struct {
+    int (*add_device)(void *ctx, uint16_t addr, uint32_t scl_speed_hz, void **handle);
+    int (*read)(void *ctx, void *handle,
+                const uint8_t *reg, size_t reg_len,
+                uint8_t *data, size_t len);
+    int64_t (*now_us)(void *ctx);
+} i2c_bus_backend_t;
+
+/**
+ * @brief Called after each scheduled read (from the task running the manager)
+ *
+ * @param[in] ctx Device context from its configuration
+ * @param[in] id Device ID returned by i2c_bus_manager_add()
+ * @param[in] err 0 on success, otherwise the backend error code
+ * @param[in] data Bytes read (only valid during the call)
+ * @param[in] len Number of bytes read (0 on error)
+ * @param[in] timestamp_us When the transaction started
+ */
+typedef void (*i2c_bus_read_cb_t)(void *ctx, uint8_t id, int err,
+                                  const uint8_t *data, size_t len,
+                                  int64_t timestamp_us);
+
+/**
+ * @brief One device and how often to read it
+ */
+typedef struct {
+    uint16_t addr;                  // 7-bit address
+    uint32_t scl_speed_hz;          // Clock for this device
+    uint8_t reg[I2C_BUS_REG_MAX];   // Register address written first
+    size_t reg_len;                 // Register address bytes (0: read only)
+    size_t read_len;                // Bytes read (1 to I2C_BUS_DATA_MAX)
+    uint32_t period_us;             // Time between reads
+    i2c_bus_read_cb_t on_read;      // Result callback (or NULL)
+    void *ctx;                      // Passed to on_read
+} i2c_bus_device_config_t;
+
+/**
+ * @brief Per-device counters
+ *
+ * Latency runs from the time a read was due to the end of its transaction.
+ * Reads pulled forward into an earlier batch count as 0.
+ */
+typedef struct {
+    uint32_t reads;                 // Transactions run
+    uint32_t errors;                // Transactions that failed
+    uint32_t missed;                // Periods skipped because the bus was late
+    uint32_t latency_min_us;
+    uint32_t latency_max_us;
+    uint32_t latency_mean_us;
+    uint32_t bus_time_mean_us;      // Mean time on the bus per transaction
+} i2c_bus_device_stats_t;
+
+/**
+ * @brief Bus counters
+ */
+typedef struct {
+    uint32_t transactions;          // Reads run on the bus
+    uint32_t batches;               // Back-to-back runs of reads
+    uint32_t clock_switches;        // Reads at a different SCL from the previous
+    uint64_t busy_us;               // Time spent in transactions
+    uint64_t elapsed_us;            // Time since the counters were reset
+    uint32_t utilization_permille;  // busy_us / elapsed_us
+    uint32_t load_permille;         // Estimated bus time the schedule needs
+} i2c_bus_stats_t;
+
+/**
+ * @brief Scheduled device (internal state)
+ */
+typedef struct {
+    i2c_bus_device_config_t config;
+    void *handle;                   // Backend handle
+    int64_t next_due_us;            // When the next read is due
+    uint32_t wire_us;               // Estimated transaction time
+    uint32_t reads;
+    uint32_t errors;
+    uint32_t missed;
+    uint32_t latency_min_us;
+    uint32_t latency_max_us;
+    uint64_t latency_sum_us;
+    uint64_t bus_time_sum_us;
+} i2c_bus_device_t;
+
+/**
+ * @brief Bus manager (internal state; allocate statically or on the heap)
+ */
+typedef struct {
+    const i2c_bus_backend_t *backend;
+    void *backend_ctx;
+    uint32_t batch_window_us;
+    i2c_bus_device_t devices[I2C_BUS_MAX_DEVICES];
+    uint8_t num_devices;
+    uint32_t current_scl_hz;        // Clock of the last transaction (0: none)
+    int64_t start_us;               // Schedule origin
+    int64_t stats_start_us;
+    uint64_t busy_us;
+    uint32_t transactions;
+    uint32_t batches;
+    uint32_t clock_switches;
+} i2c_bus_manager_t;
+
+/**
+ * @brief Initialize a manager with no devices
+ *
+ * @param[out] mgr Manager
+ * @param[in] backend Bus backend
+ * @param[in] backend_ctx Passed to every backend call
+ * @param[in] batch_window_us Reads due within this time of a batch run in it
+ *
+ * @return I2C_BUS_OK or I2C_BUS_ERR_INVALID
+ */
+i2c_bus_result_t i2c_bus_manager_init(i2c_bus_manager_t *mgr,
+                                      const i2c_bus_backend_t *backend,
+                                      void *backend_ctx,
+                                      uint32_t batch_window_us);
+
+/**
+ * @brief Add a device to the schedule
+ *
+ * The first read is due at the next multiple of the device period counted
+ * from i2c_bus_manager_init(), so devices with harmonic periods (e.g. 10, 20,
+ * and 100 ms) always fall due together and share batches.
+ *
+ * @param[in] mgr Manager
+ * @param[in] config Device and how often to read it
+ * @param[out] id Device ID (index for i2c_bus_manager_get_device_stats())
+ *
+ * @return
+ *  - I2C_BUS_OK on success
+ *  - I2C_BUS_ERR_INVALID if the configuration is invalid
+ *  - I2C_BUS_ERR_FULL if I2C_BUS_MAX_DEVICES are already added
+ *  - I2C_BUS_ERR_BACKEND if the backend could not add the device
+ */
+i2c_bus_result_t i2c_bus_manager_add(i2c_bus_manager_t *mgr,
+                                     const i2c_bus_device_config_t *config,
+                                     uint8_t *id);
+
+/**
+ * @brief Run every read that is due (or due within the batch window)
+ *
+ * A read is pulled forward by at most the batch window or half its period,
+ * whichever is shorter.
+ *
+ * Reads run back to back. Reads at the clock the bus is already using go
+ * first, then the rest grouped by clock, each group earliest-due first, so
+ * a batch switches SCL speed at most once per distinct speed.
+ *
+ * @param[in] mgr Manager
+ *
+ * @return When the next read is due (INT64_MAX if there are no devices)
+ */
+int64_t i2c_bus_manager_run(i2c_bus_manager_t *mgr);
+
+/**
+ * @brief Get the bus counters
+ *
+ * @param[in] mgr Manager
+ * @param[out] stats Counters
+ */
+void i2c_bus_manager_get_stats(const i2c_bus_manager_t *mgr, i2c_bus_stats_t *stats);
+
+/**
+ * @brief Get the counters of one device
+ *
+ * @param[in] mgr Manager
+ * @param[in] id Device ID
+ * @param[out] stats Counters
+ *
+ * @return I2C_BUS_OK or I2C_BUS_ERR_INVALID if id is unknown
+ */
+i2c_bus_result_t i2c_bus_manager_get_device_stats(const i2c_bus_manager_t *mgr,
+                                                  uint8_t id,
+                                                  i2c_bus_device_stats_t *stats);
+
+/**
+ * @brief Reset the bus and device counters (the schedule is kept)
+ *
+ * @param[in] mgr Manager
+ */
+void i2c_bus_manager_reset_stats(i2c_bus_manager_t *mgr);
+
+/**
+ * @brief Estimate the time one read takes on the wire
+ *
+ * Counts start, address, register, repeated start, address, data, acks, and
+ * stop bits at the given clock, plus I2C_BUS_OVERHEAD_US for the driver.
+ *
+ * @param[in] scl_speed_hz Bus clock
+ * @param[in] reg_len Register address bytes
+ * @param[in] read_len Data bytes
+ *
+ * @return Microseconds
+ */
+uint32_t i2c_bus_manager_wire_time_us(uint32_t scl_speed_hz, size_t reg_len, size_t read_len);
+
+#endif // I2C_BUS_MANAGER_H
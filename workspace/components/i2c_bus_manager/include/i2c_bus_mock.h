@@ -0,0 +1,100 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef I2C_BUS_MOCK_H
+#define I2C_BUS_MOCK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "i2c_bus_manager.h"
+
+/**
+ * @brief Error returned by the mock for a device that does not acknowledge
+ */
+#define I2C_BUS_MOCK_ERR_NACK   (-1)
+
+/**
+ * @brief Simulated device
+ */
+typedef struct {
+    uint16_t addr;
+    uint32_t scl_speed_hz;          // Clock it was added with (0: not added)
+    uint8_t data[I2C_BUS_DATA_MAX]; // Returned by every read
+    bool nack;                      // Fail every read
+    uint32_t reads;                 // Transactions addressed to it
+    uint8_t last_reg[I2C_BUS_REG_MAX];
+} i2c_bus_mock_device_t;
+
+/**
+ * @brief Simulated bus with its own clock
+ *
+ * Every transaction advances the clock by i2c_bus_manager_wire_time_us() for
+ * its length and clock speed, plus switch_us when its clock differs from the
+ * previous transaction's. Nothing else moves the clock except
+ * i2c_bus_mock_advance(), so runs are exactly repeatable.
+ *
+ * Host builds only: i2c_bus_mock.c is compiled by
+ * apps/i2c_bus_manager_benchmark, not by the ESP-IDF component.
+ */
+typedef struct {
+    int64_t now_us;
+    uint32_t switch_us;             // Cost of changing SCL speed
+    uint32_t scl_speed_hz;          // Clock of the last transaction
+    i2c_bus_mock_device_t devices[I2C_BUS_MAX_DEVICES];
+    uint8_t num_devices;
+    uint32_t transactions;
+    uint32_t clock_switches;
+} i2c_bus_mock_t;
+
+/**
+ * @brief Backend for i2c_bus_manager_init() (context: i2c_bus_mock_t *)
+ */
+extern const i2c_bus_backend_t i2c_bus_mock_backend;
+
+/**
+ * @brief Initialize an empty bus with its clock at 0
+ *
+ * @param[out] mock Bus
+ * @param[in] switch_us Extra time for a transaction that changes SCL speed
+ */
+void i2c_bus_mock_init(i2c_bus_mock_t *mock, uint32_t switch_us);
+
+/**
+ * @brief Set the bytes a device returns (creates the device if needed)
+ *
+ * @param[in] mock Bus
+ * @param[in] addr Device address
+ * @param[in] data Bytes returned by every read
+ * @param[in] len Number of bytes (up to I2C_BUS_DATA_MAX)
+ *
+ * @return Device, or NULL if the bus is full
+ */
+i2c_bus_mock_device_t *i2c_bus_mock_set_data(i2c_bus_mock_t *mock,
+                                             uint16_t addr,
+                                             const uint8_t *data,
+                                             size_t len);
+
+/**
+ * @brief Make a device fail (or stop failing) every read
+ *
+ * @param[in] mock Bus
+ * @param[in] addr Device address
+ * @param[in] nack true to fail with I2C_BUS_MOCK_ERR_NACK
+ *
+ * @return Device, or NULL if the bus is full
+ */
+i2c_bus_mock_device_t *i2c_bus_mock_set_nack(i2c_bus_mock_t *mock, uint16_t addr, bool nack);
+
+/**
+ * @brief Move the clock forward (e.g. to stand in for sleeping)
+ *
+ * @param[in] mock Bus
+ * @param[in] us Microseconds
+ */
+void i2c_bus_mock_advance(i2c_bus_mock_t *mock, int64_t us);
+
+#endif // I2C_BUS_MOCK_H
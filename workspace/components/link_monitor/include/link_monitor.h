@@ -0,0 +1,140 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/**
+ * @brief RTT value when nothing has been measured
+ */
+#define LINK_MONITOR_RTT_UNKNOWN    UINT32_MAX
+
+/**
+ * @brief Overall link grade (worse grades compare lower)
+ */
+typedef enum {
+    LINK_QUALITY_DOWN = 0,          // No usable interface
+    LINK_QUALITY_POOR,              // Long RTT, weak signal, or no replies
+    LINK_QUALITY_FAIR,              // Usable but slow
+    LINK_QUALITY_GOOD,
+} link_quality_t;
+
+/**
+ * @brief Link measurements
+ */
+typedef struct {
+    link_quality_t quality;         // Grade from the values below
+    const char *iface;              // Interface with the route (NULL if down)
+    uint32_t gateway_rtt_ms;        // Average gateway RTT (ICMP)
+    uint32_t target_rtt_ms;         // Average TCP connect time to the target
+    int8_t rssi;                    // WiFi signal (dBm), 0 if not WiFi
+    uint32_t throughput_bps;        // Average reported throughput (bytes/s)
+    uint32_t transfers;             // Transfers reported since start
+    uint64_t bytes;                 // Bytes reported since start
+    uint32_t probes;                // Probes that got an answer
+    uint32_t probe_failures;        // Probes that did not
+    int64_t updated_us;             // esp_timer time of the last measurement
+} link_monitor_stats_t;
+
+/**
+ * @brief Start the monitor task
+ *
+ * Call after network_init(). The first measurement is taken right away.
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t link_monitor_start(void);
+
+/**
+ * @brief Stop the monitor task (the last measurements stay readable)
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t link_monitor_stop(void);
+
+/**
+ * @brief Also measure the TCP connect time to a server (e.g. the broker)
+ *
+ * The connect time is one round trip to the server, so it covers the whole
+ * path rather than the first hop. When set, it is used instead of the
+ * gateway RTT to grade the link.
+ *
+ * @param[in] host Hostname or address, or NULL to stop probing
+ * @param[in] port TCP port
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_SIZE if the hostname is too long
+ */
+esp_err_t link_monitor_set_target(const char *host, uint16_t port);
+
+/**
+ * @brief Report a completed transfer
+ *
+ * Call after sending (or receiving) a request with the number of bytes and
+ * how long it took. Short requests mostly measure latency, which is what
+ * small uploads actually get from the link.
+ *
+ * @param[in] bytes Bytes transferred
+ * @param[in] elapsed_us Time the transfer took (us)
+ */
+void link_monitor_record_transfer(size_t bytes, int64_t elapsed_us);
+
+/**
+ * @brief Get the latest measurements
+ *
+ * @param[out] stats Measurements
+ */
+void link_monitor_get_stats(link_monitor_stats_t *stats);
+
+/**
+ * @brief Get the current link grade
+ *
+ * @return Link grade
+ */
+link_quality_t link_monitor_get_quality(void);
+
+/**
+ * @brief Stretch an interval to the current link
+ *
+ * @param[in] base_ms Interval for a good link
+ *
+ * @return base_ms on a good link, 2x on a fair link, 4x on a poor link
+ */
+uint32_t link_monitor_scale_interval(uint32_t base_ms);
+
+/**
+ * @brief Grow a batch size to the current link
+ *
+ * Fewer, larger requests spend less time on round trips when the link is
+ * slow.
+ *
+ * @param[in] base Batch size for a good link
+ * @param[in] max Largest batch the caller can handle
+ *
+ * @return base on a good link, 2x on a fair link, 4x on a poor link, at
+ *         most max
+ */
+size_t link_monitor_scale_batch(size_t base, size_t max);
+
+/**
+ * @brief Get a printable name for a link grade
+ *
+ * @param[in] quality Link grade
+ *
+ * @return Name of the grade (e.g. "good")
+ */
+const char *link_quality_name(link_quality_t quality);
+
+#endif // LINK_MONITOR_H
@@ -0,0 +1,401 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Link quality monitor.
+ *
+ * A background task measures the gateway RTT through the network wrapper,
+ * the TCP connect time to an optional target server, and the WiFi signal
+ * strength. The application reports the transfers it makes, which gives an
+ * average of the throughput it actually achieves. All values are smoothed
+ * with an exponentially weighted moving average and graded so uploaders can
+ * stretch their intervals or grow their batches on a slow link.
+ */
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+
+#include "dns_cache.h"
+#include "network_wrapper.h"
+#if CONFIG_WIFI_STA_CONNECT
+# include "wifi_sta.h"
+#endif
+
+#include "link_monitor.h"
+
+// Settings
+#define INTERVAL_MS         CONFIG_LINK_MONITOR_INTERVAL_MS
+#define TCP_TIMEOUT_MS      CONFIG_LINK_MONITOR_TCP_TIMEOUT_MS
+#define EWMA_WEIGHT         CONFIG_LINK_MONITOR_EWMA_WEIGHT
+#define FAIR_RTT_MS         CONFIG_LINK_MONITOR_FAIR_RTT_MS
+#define POOR_RTT_MS         CONFIG_LINK_MONITOR_POOR_RTT_MS
+#define FAIR_RSSI           CONFIG_LINK_MONITOR_FAIR_RSSI
+#define POOR_RSSI           CONFIG_LINK_MONITOR_POOR_RSSI
+#define FAIR_SCALE          2       // Interval/batch multiplier, fair link
+#define POOR_SCALE          4       // Interval/batch multiplier, poor link
+#define HOST_MAX_LEN        64
+#define TASK_STACK_SIZE     4096
+#define TASK_PRIORITY       4
+
+// Tag for debug messages
+static const char *TAG = "link_monitor";
+
+// Static global variables
+static link_monitor_stats_t s_stats = {
+    .quality = LINK_QUALITY_DOWN,
+    .gateway_rtt_ms = LINK_MONITOR_RTT_UNKNOWN,
+    .target_rtt_ms = LINK_MONITOR_RTT_UNKNOWN,
+};
+static char s_host[HOST_MAX_LEN + 1];
+static uint16_t s_port = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_task = NULL;
+static volatile bool s_running = false;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static uint32_t ewma(uint32_t avg, uint32_t sample);
+static esp_err_t probe_target(uint32_t *rtt_ms);
+static link_quality_t grade(const link_monitor_stats_t *stats);
+static void measure(void);
+static void monitor_task(void *arg);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Fold a sample into a moving average (an unknown average takes the sample)
+static uint32_t ewma(uint32_t avg, uint32_t sample)
+{
+    if (avg == LINK_MONITOR_RTT_UNKNOWN) {
+        return sample;
+    }
+
+    return (uint32_t)(((uint64_t)EWMA_WEIGHT * sample +
+                       (uint64_t)(100 - EWMA_WEIGHT) * avg) / 100);
+}
+
+// Time a TCP connection to the target (one round trip)
+static esp_err_t probe_target(uint32_t *rtt_ms)
+{
+    char host[HOST_MAX_LEN + 1];
+    uint16_t port;
+    dns_cache_result_t dns_res;
+    int64_t start_us;
+    int sock;
+    esp_err_t esp_ret;
+
+    taskENTER_CRITICAL(&s_lock);
+    memcpy(host, s_host, sizeof(host));
+    port = s_port;
+    taskEXIT_CRITICAL(&s_lock);
+    if (host[0] == '\0') {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Resolve outside the timed part (served from the cache after the first)
+    esp_ret = dns_cache_lookup(host, port, WEB_FAMILY, &dns_res);
+    if (esp_ret != ESP_OK) {
+        return esp_ret;
+    }
+
+    // Connect and hang up right away
+    start_us = esp_timer_get_time();
+    esp_ret = dns_cache_connect(&dns_res, TCP_TIMEOUT_MS, &sock);
+    if (esp_ret != ESP_OK) {
+        dns_cache_invalidate(host);
+        return esp_ret;
+    }
+    *rtt_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    close(sock);
+
+    return ESP_OK;
+}
+
+// Grade the link from its measurements (the worst value decides)
+static link_quality_t grade(const link_monitor_stats_t *stats)
+{
+    link_quality_t quality = LINK_QUALITY_GOOD;
+    uint32_t rtt_ms;
+
+    if (stats->iface == NULL) {
+        return LINK_QUALITY_DOWN;
+    }
+
+    // End-to-end RTT if there is a target, first hop otherwise
+    rtt_ms = (stats->target_rtt_ms != LINK_MONITOR_RTT_UNKNOWN) ?
+             stats->target_rtt_ms : stats->gateway_rtt_ms;
+    if (rtt_ms != LINK_MONITOR_RTT_UNKNOWN) {
+        if (rtt_ms >= POOR_RTT_MS) {
+            quality = LINK_QUALITY_POOR;
+        } else if (rtt_ms >= FAIR_RTT_MS) {
+            quality = LINK_QUALITY_FAIR;
+        }
+    }
+
+    // Signal strength (WiFi only)
+    if (stats->rssi != 0) {
+        if (stats->rssi <= POOR_RSSI) {
+            quality = LINK_QUALITY_POOR;
+        } else if ((stats->rssi <= FAIR_RSSI) && (quality > LINK_QUALITY_FAIR)) {
+            quality = LINK_QUALITY_FAIR;
+        }
+    }
+
+    return quality;
+}
+
+// Take one round of measurements
+static void measure(void)
+{
+    const char *iface;
+    uint32_t gateway_rtt_ms = LINK_MONITOR_RTT_UNKNOWN;
+    uint32_t target_rtt_ms = LINK_MONITOR_RTT_UNKNOWN;
+    esp_err_t gateway_ret = ESP_ERR_INVALID_STATE;
+    esp_err_t target_ret = ESP_ERR_INVALID_STATE;
+    int8_t rssi = 0;
+    link_quality_t old_quality;
+    link_quality_t quality;
+    link_monitor_stats_t snapshot;
+
+    // Probe through the interface that carries the route
+    iface = network_is_up() ? network_get_active_interface() : NULL;
+    if (iface != NULL) {
+        gateway_ret = network_probe_gateway(&gateway_rtt_ms);
+        target_ret = probe_target(&target_rtt_ms);
+#if CONFIG_WIFI_STA_CONNECT
+        if ((strcmp(iface, "wifi") != 0) || (wifi_sta_get_rssi(&rssi) != ESP_OK)) {
+            rssi = 0;
+        }
+#endif
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+
+    // Averages from another interface say nothing about this one
+    if (iface != s_stats.iface) {
+        s_stats.gateway_rtt_ms = LINK_MONITOR_RTT_UNKNOWN;
+        s_stats.target_rtt_ms = LINK_MONITOR_RTT_UNKNOWN;
+        s_stats.throughput_bps = 0;
+    }
+    s_stats.iface = iface;
+    s_stats.rssi = rssi;
+
+    // Fold in the probe results (ESP_ERR_NOT_FOUND: nothing to probe)
+    if (gateway_ret == ESP_OK) {
+        s_stats.gateway_rtt_ms = ewma(s_stats.gateway_rtt_ms, gateway_rtt_ms);
+        s_stats.probes++;
+    } else if ((iface != NULL) && (gateway_ret != ESP_ERR_NOT_FOUND)) {
+        s_stats.probe_failures++;
+    }
+    if (target_ret == ESP_OK) {
+        s_stats.target_rtt_ms = ewma(s_stats.target_rtt_ms, target_rtt_ms);
+        s_stats.probes++;
+    } else if ((iface != NULL) && (target_ret != ESP_ERR_NOT_FOUND)) {
+        s_stats.probe_failures++;
+    }
+
+    // A link that answers nothing is poor whatever its averages say
+    old_quality = s_stats.quality;
+    quality = grade(&s_stats);
+    if ((iface != NULL) &&
+        (gateway_ret != ESP_OK) &&
+        (target_ret != ESP_OK) &&
+        !((gateway_ret == ESP_ERR_NOT_FOUND) &&
+          (target_ret == ESP_ERR_NOT_FOUND))) {
+        quality = LINK_QUALITY_POOR;
+    }
+    s_stats.quality = quality;
+    s_stats.updated_us = esp_timer_get_time();
+    snapshot = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+
+    // Report grade changes
+    if (quality != old_quality) {
+        ESP_LOGI(TAG, "Link %s on %s (gateway %ld ms, target %ld ms, "
+                      "RSSI %d dBm, %lu B/s)",
+                 link_quality_name(quality),
+                 (iface != NULL) ? iface : "none",
+                 (snapshot.gateway_rtt_ms == LINK_MONITOR_RTT_UNKNOWN) ?
+                     -1L : (long)snapshot.gateway_rtt_ms,
+                 (snapshot.target_rtt_ms == LINK_MONITOR_RTT_UNKNOWN) ?
+                     -1L : (long)snapshot.target_rtt_ms,
+                 snapshot.rssi,
+                 snapshot.throughput_bps);
+    }
+}
+
+// Task: measure the link until stopped
+static void monitor_task(void *arg)
+{
+    while (s_running) {
+        measure();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(INTERVAL_MS));
+    }
+    s_task = NULL;
+    vTaskDelete(NULL);
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Start the monitor task
+esp_err_t link_monitor_start(void)
+{
+    BaseType_t ret;
+
+    if (s_task != NULL) {
+        return ESP_OK;
+    }
+
+    s_running = true;
+    ret = xTaskCreate(monitor_task,
+                      "link_monitor",
+                      TASK_STACK_SIZE,
+                      NULL,
+                      TASK_PRIORITY,
+                      &s_task);
+    if (ret != pdPASS) {
+        s_running = false;
+        ESP_LOGE(TAG, "Failed to create monitor task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+// Stop the monitor task (the last measurements stay readable)
+esp_err_t link_monitor_stop(void)
+{
+    TaskHandle_t task = s_task;
+
+    if (task == NULL) {
+        return ESP_OK;
+    }
+
+    // The task exits after its current measurement
+    s_running = false;
+    xTaskNotifyGive(task);
+
+    return ESP_OK;
+}
+
+// Also measure the TCP connect time to a server
+esp_err_t link_monitor_set_target(const char *host, uint16_t port)
+{
+    size_t len = (host != NULL) ? strlen(host) : 0;
+
+    if (len > HOST_MAX_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    memcpy(s_host, (host != NULL) ? host : "", len + 1);
+    s_port = port;
+    s_stats.target_rtt_ms = LINK_MONITOR_RTT_UNKNOWN;
+    taskEXIT_CRITICAL(&s_lock);
+
+    return ESP_OK;
+}
+
+// Report a completed transfer
+void link_monitor_record_transfer(size_t bytes, int64_t elapsed_us)
+{
+    uint64_t sample_bps;
+
+    if ((bytes == 0) || (elapsed_us <= 0)) {
+        return;
+    }
+    sample_bps = (uint64_t)bytes * 1000000 / (uint64_t)elapsed_us;
+    if (sample_bps >= LINK_MONITOR_RTT_UNKNOWN) {
+        sample_bps = LINK_MONITOR_RTT_UNKNOWN - 1;
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.throughput_bps = (s_stats.throughput_bps == 0) ?
+                             (uint32_t)sample_bps :
+                             ewma(s_stats.throughput_bps, (uint32_t)sample_bps);
+    s_stats.transfers++;
+    s_stats.bytes += bytes;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+// Get the latest measurements
+void link_monitor_get_stats(link_monitor_stats_t *stats)
+{
+    taskENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+// Get the current link grade
+link_quality_t link_monitor_get_quality(void)
+{
+    link_quality_t quality;
+
+    taskENTER_CRITICAL(&s_lock);
+    quality = s_stats.quality;
+    taskEXIT_CRITICAL(&s_lock);
+
+    return quality;
+}
+
+// Stretch an interval to the current link
+uint32_t link_monitor_scale_interval(uint32_t base_ms)
+{
+    switch (link_monitor_get_quality()) {
+        case LINK_QUALITY_GOOD:
+            return base_ms;
+        case LINK_QUALITY_FAIR:
+            return base_ms * FAIR_SCALE;
+        default:
+            return base_ms * POOR_SCALE;
+    }
+}
+
+// Grow a batch size to the current link
+size_t link_monitor_scale_batch(size_t base, size_t max)
+{
+    size_t size;
+
+    switch (link_monitor_get_quality()) {
+        case LINK_QUALITY_GOOD:
+            size = base;
+            break;
+        case LINK_QUALITY_FAIR:
+            size = base * FAIR_SCALE;
+            break;
+        default:
+            size = base * POOR_SCALE;
+            break;
+    }
+
+    return (size < max) ? size : max;
+}
+
+// Get a printable name for a link grade
+const char *link_quality_name(link_quality_t quality)
+{
+    switch (quality) {
+        case LINK_QUALITY_DOWN:
+            return "down";
+        case LINK_QUALITY_POOR:
+            return "poor";
+        case LINK_QUALITY_FAIR:
+            return "fair";
+        case LINK_QUALITY_GOOD:
+            return "good";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MQTT_PUBLISHER_H
+#define MQTT_PUBLISHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "mqtt_client.h"
+
+/**
+ * @brief Number of latency histogram buckets
+ *
+ * Bucket 0 counts acknowledgements under 1 ms, bucket i counts those from
+ * 2^(i-1) ms up to 2^i ms, and the last bucket counts everything slower.
+ */
+#define MQTT_PUBLISHER_HIST_BUCKETS 14
+
+/**
+ * @brief Publisher statistics
+ */
+typedef struct {
+    uint32_t published;         // Messages handed to the client (all QoS)
+    uint32_t acked;             // QoS 1/2 messages acknowledged
+    uint32_t failed;            // Publish calls rejected by the client
+    uint32_t window_full;       // Publish calls that had to wait for a slot
+    uint32_t timeouts;          // Publish calls that gave up waiting
+    uint32_t expired;           // Messages dropped without an acknowledgement
+    uint32_t in_flight;         // Messages waiting for acknowledgement now
+    uint32_t max_in_flight;     // Highest in_flight seen
+    uint32_t latency_min_us;    // Fastest acknowledgement
+    uint32_t latency_max_us;    // Slowest acknowledgement
+    uint64_t latency_sum_us;    // Sum of latencies (for the mean)
+    uint32_t latency_hist[MQTT_PUBLISHER_HIST_BUCKETS];
+} mqtt_publisher_stats_t;
+
+/**
+ * @brief Start tracking publishes on a client (call once)
+ *
+ * @param[in] client MQTT client to publish with
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t mqtt_publisher_init(esp_mqtt_client_handle_t client);
+
+/**
+ * @brief Publish a message, waiting for a window slot if needed
+ *
+ * QoS 1/2 messages take a slot in the in-flight window until the broker
+ * acknowledges them. If the window is full, waits up to timeout_ms for a
+ * slot to open. QoS 0 messages are sent without using the window.
+ *
+ * @param[in] topic Topic to publish to
+ * @param[in] data Message payload
+ * @param[in] len Payload length (bytes)
+ * @param[in] qos Quality of service (0, 1, or 2)
+ * @param[in] retain Retain flag
+ * @param[in] timeout_ms How long to wait for a free slot (0 = don't wait)
+ * @param[out] msg_id msg_id the acknowledgement will carry, 0 for QoS 0
+ *                    (may be NULL)
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_TIMEOUT if the window stayed full
+ *  - ESP_FAIL if the client rejected the message
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t mqtt_publisher_publish(const char *topic,
+                                 const void *data,
+                                 size_t len,
+                                 int qos,
+                                 int retain,
+                                 uint32_t timeout_ms,
+                                 int *msg_id);
+
+/**
+ * @brief Feed an MQTT event to the publisher
+ *
+ * Call from the application's MQTT event handler for every event.
+ * MQTT_EVENT_PUBLISHED (PUBACK/PUBCOMP) and MQTT_EVENT_DELETED release
+ * the matching window slot.
+ *
+ * @param[in] event Event from the MQTT client
+ */
+void mqtt_publisher_on_event(esp_mqtt_event_handle_t event);
+
+/**
+ * @brief Get publisher statistics
+ *
+ * @param[out] stats Statistics since init or the last reset
+ */
+void mqtt_publisher_get_stats(mqtt_publisher_stats_t *stats);
+
+/**
+ * @brief Clear the counters and histogram (in_flight is kept)
+ */
+void mqtt_publisher_reset_stats(void);
+
+#endif // MQTT_PUBLISHER_H
@@ -0,0 +1,349 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Flow-controlled MQTT publisher.
+ *
+ * esp_mqtt_client_publish() keeps every unacknowledged QoS 1/2 message in
+ * the client's outbox, so publishing faster than the broker acknowledges
+ * grows the outbox until memory runs out. This module gives each QoS 1/2
+ * message a slot in a fixed window (a counting semaphore) and records its
+ * msg_id. The slot is released when MQTT_EVENT_PUBLISHED reports the
+ * PUBACK/PUBCOMP for that msg_id, and the time since publishing goes into a
+ * latency histogram. Slots of messages that were never acknowledged are only
+ * reclaimed once the client's outbox is empty, so the window never admits
+ * more messages than the outbox is really holding.
+ */
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "mqtt_publisher.h"
+
+// Settings
+#define WINDOW              CONFIG_MQTT_PUBLISHER_WINDOW
+#define ACK_TIMEOUT_US      ((int64_t)CONFIG_MQTT_PUBLISHER_ACK_TIMEOUT_MS * 1000)
+
+// Slot states (valid msg_ids are positive)
+#define SLOT_FREE           0
+#define SLOT_RESERVED       -1
+
+// Tag for debug messages
+static const char *TAG = "mqtt_publisher";
+
+// One in-flight message
+typedef struct {
+    int msg_id;             // msg_id, SLOT_FREE, or SLOT_RESERVED
+    int64_t start_us;       // When publishing started
+} slot_t;
+
+// An acknowledgement that arrived before its msg_id was recorded
+typedef struct {
+    int msg_id;
+    int64_t ack_us;
+} early_ack_t;
+
+// Static global variables
+static esp_mqtt_client_handle_t s_client = NULL;
+static SemaphoreHandle_t s_free_slots = NULL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static slot_t s_slots[WINDOW];
+static early_ack_t s_early_acks[WINDOW];
+static uint32_t s_early_next = 0;
+static mqtt_publisher_stats_t s_stats;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static void record_latency(int64_t latency_us);
+static void release_locked(slot_t *slot, int64_t now_us, bool acked);
+static void expire_stale(void);
+static void complete(int msg_id, bool acked);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Add one acknowledgement latency to the statistics (call with lock held)
+static void record_latency(int64_t latency_us)
+{
+    uint32_t us = (latency_us > UINT32_MAX) ? UINT32_MAX : (uint32_t)latency_us;
+    uint32_t ms = us / 1000;
+    uint32_t bucket;
+
+    // Bucket 0 is < 1 ms, then one bucket per power of two
+    bucket = (ms == 0) ? 0 : (32 - __builtin_clz(ms));
+    if (bucket >= MQTT_PUBLISHER_HIST_BUCKETS) {
+        bucket = MQTT_PUBLISHER_HIST_BUCKETS - 1;
+    }
+    s_stats.latency_hist[bucket]++;
+    s_stats.latency_sum_us += us;
+    if (us < s_stats.latency_min_us) {
+        s_stats.latency_min_us = us;
+    }
+    if (us > s_stats.latency_max_us) {
+        s_stats.latency_max_us = us;
+    }
+}
+
+// Free a slot and count the outcome (call with lock held)
+static void release_locked(slot_t *slot, int64_t now_us, bool acked)
+{
+    if (acked) {
+        s_stats.acked++;
+        record_latency(now_us - slot->start_us);
+    } else {
+        s_stats.expired++;
+    }
+    slot->msg_id = SLOT_FREE;
+    s_stats.in_flight--;
+}
+
+// Give up on messages that were never acknowledged
+static void expire_stale(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    uint32_t freed = 0;
+    bool stale = false;
+
+    // Look for messages that should have been acknowledged by now
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < WINDOW; i++) {
+        if ((s_slots[i].msg_id > 0) &&
+            (now_us - s_slots[i].start_us > ACK_TIMEOUT_US)) {
+            stale = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    // While the client's outbox holds messages, they will still be acked or
+    // reported as MQTT_EVENT_DELETED, so their slots stay taken
+    if (!stale || (esp_mqtt_client_get_outbox_size(s_client) > 0)) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < WINDOW; i++) {
+        if ((s_slots[i].msg_id > 0) &&
+            (now_us - s_slots[i].start_us > ACK_TIMEOUT_US)) {
+            release_locked(&s_slots[i], now_us, false);
+            freed++;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    // Semaphores can't be given inside a critical section
+    for (uint32_t i = 0; i < freed; i++) {
+        xSemaphoreGive(s_free_slots);
+    }
+    if (freed > 0) {
+        ESP_LOGW(TAG, "%lu messages were not acknowledged in time", freed);
+    }
+}
+
+// Release the slot of an acknowledged (or deleted) message
+static void complete(int msg_id, bool acked)
+{
+    int64_t now_us = esp_timer_get_time();
+    bool found = false;
+
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < WINDOW; i++) {
+        if (s_slots[i].msg_id == msg_id) {
+            release_locked(&s_slots[i], now_us, acked);
+            found = true;
+            break;
+        }
+    }
+
+    // The publishing task may not have recorded the msg_id yet
+    if (!found && acked) {
+        s_early_acks[s_early_next].msg_id = msg_id;
+        s_early_acks[s_early_next].ack_us = now_us;
+        s_early_next = (s_early_next + 1) % WINDOW;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (found) {
+        xSemaphoreGive(s_free_slots);
+    }
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Start tracking publishes on a client
+esp_err_t mqtt_publisher_init(esp_mqtt_client_handle_t client)
+{
+    // Every slot starts free
+    s_free_slots = xSemaphoreCreateCounting(WINDOW, WINDOW);
+    if (s_free_slots == NULL) {
+        ESP_LOGE(TAG, "Failed to create window semaphore");
+        return ESP_ERR_NO_MEM;
+    }
+    memset(s_slots, 0, sizeof(s_slots));
+    memset(s_early_acks, 0, sizeof(s_early_acks));
+    s_client = client;
+    mqtt_publisher_reset_stats();
+
+    return ESP_OK;
+}
+
+// Publish a message, waiting for a window slot if needed
+esp_err_t mqtt_publisher_publish(const char *topic,
+                                 const void *data,
+                                 size_t len,
+                                 int qos,
+                                 int retain,
+                                 uint32_t timeout_ms,
+                                 int *msg_id_out)
+{
+    slot_t *slot = NULL;
+    int64_t ack_us = 0;
+    int msg_id;
+
+    if (s_client == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (msg_id_out != NULL) {
+        *msg_id_out = 0;
+    }
+
+    // QoS 0 is never acknowledged: send without using the window
+    if (qos == 0) {
+        msg_id = esp_mqtt_client_publish(s_client, topic, data, (int)len, 0, retain);
+        taskENTER_CRITICAL(&s_lock);
+        if (msg_id < 0) {
+            s_stats.failed++;
+        } else {
+            s_stats.published++;
+        }
+        taskEXIT_CRITICAL(&s_lock);
+        return (msg_id < 0) ? ESP_FAIL : ESP_OK;
+    }
+
+    // Wait for a free slot (backpressure)
+    expire_stale();
+    if (xSemaphoreTake(s_free_slots, 0) != pdTRUE) {
+        taskENTER_CRITICAL(&s_lock);
+        s_stats.window_full++;
+        taskEXIT_CRITICAL(&s_lock);
+        if ((timeout_ms == 0) ||
+            (xSemaphoreTake(s_free_slots, pdMS_TO_TICKS(timeout_ms)) != pdTRUE)) {
+            taskENTER_CRITICAL(&s_lock);
+            s_stats.timeouts++;
+            taskEXIT_CRITICAL(&s_lock);
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    // Reserve the slot before publishing so the start time is accurate
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < WINDOW; i++) {
+        if (s_slots[i].msg_id == SLOT_FREE) {
+            slot = &s_slots[i];
+            break;
+        }
+    }
+    slot->msg_id = SLOT_RESERVED;
+    slot->start_us = esp_timer_get_time();
+    s_stats.in_flight++;
+    if (s_stats.in_flight > s_stats.max_in_flight) {
+        s_stats.max_in_flight = s_stats.in_flight;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    // Hand the message to the client (stored in its outbox until acked)
+    msg_id = esp_mqtt_client_publish(s_client, topic, data, (int)len, qos, retain);
+    if (msg_id <= 0) {
+        taskENTER_CRITICAL(&s_lock);
+        slot->msg_id = SLOT_FREE;
+        s_stats.in_flight--;
+        s_stats.failed++;
+        taskEXIT_CRITICAL(&s_lock);
+        xSemaphoreGive(s_free_slots);
+        ESP_LOGE(TAG, "Error (%d): Failed to publish message", msg_id);
+        return ESP_FAIL;
+    }
+
+    // Record the msg_id, unless the acknowledgement already arrived
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.published++;
+    for (int i = 0; i < WINDOW; i++) {
+        if ((s_early_acks[i].msg_id == msg_id) &&
+            (s_early_acks[i].ack_us >= slot->start_us)) {
+            s_early_acks[i].msg_id = SLOT_FREE;
+            ack_us = s_early_acks[i].ack_us;
+            break;
+        }
+    }
+    if (ack_us != 0) {
+        release_locked(slot, ack_us, true);
+    } else {
+        slot->msg_id = msg_id;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    if (ack_us != 0) {
+        xSemaphoreGive(s_free_slots);
+    }
+    if (msg_id_out != NULL) {
+        *msg_id_out = msg_id;
+    }
+
+    return ESP_OK;
+}
+
+// Feed an MQTT event to the publisher
+void mqtt_publisher_on_event(esp_mqtt_event_handle_t event)
+{
+    if ((s_free_slots == NULL) || (event->msg_id <= 0)) {
+        return;
+    }
+
+    switch ((esp_mqtt_event_id_t)event->event_id) {
+
+        // PUBACK (QoS 1) or PUBCOMP (QoS 2) received
+        case MQTT_EVENT_PUBLISHED:
+            complete(event->msg_id, true);
+            break;
+
+        // Message expired from the client's outbox without being acked
+        case MQTT_EVENT_DELETED:
+            complete(event->msg_id, false);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Get publisher statistics
+void mqtt_publisher_get_stats(mqtt_publisher_stats_t *stats)
+{
+    taskENTER_CRITICAL(&s_lock);
+    memcpy(stats, &s_stats, sizeof(*stats));
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+// Clear the counters and histogram (in_flight is kept)
+void mqtt_publisher_reset_stats(void)
+{
+    uint32_t in_flight;
+
+    taskENTER_CRITICAL(&s_lock);
+    in_flight = s_stats.in_flight;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.in_flight = in_flight;
+    s_stats.max_in_flight = in_flight;
+    s_stats.latency_min_us = UINT32_MAX;
+    taskEXIT_CRITICAL(&s_lock);
+}
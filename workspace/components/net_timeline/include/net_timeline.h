@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NET_TIMELINE_H
+#define NET_TIMELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+/**
+ * @brief Binary export format
+ *
+ * All fields are little-endian.
+ *
+ * Header (16 bytes):
+ *  - uint16 magic (NET_TIMELINE_MAGIC)
+ *  - uint8 version (NET_TIMELINE_VERSION)
+ *  - uint8 number of entries that follow
+ *  - uint32 events overwritten since the last clear
+ *  - uint64 timestamp of the first entry (us since boot)
+ *
+ * Entry (9 bytes each, oldest first):
+ *  - uint8 phase (net_timeline_phase_t)
+ *  - uint32 time since the previous entry (us, saturates at UINT32_MAX)
+ *  - int32 argument (meaning depends on the phase)
+ */
+#define NET_TIMELINE_MAGIC          0x4C54
+#define NET_TIMELINE_VERSION        1
+#define NET_TIMELINE_HEADER_SIZE    16
+#define NET_TIMELINE_ENTRY_SIZE     9
+
+/**
+ * @brief Phases of bringing up the network
+ */
+typedef enum {
+    NET_TIMELINE_DRIVER_START = 0,  // Driver init called (arg: 0)
+    NET_TIMELINE_CONNECT,           // Connect issued (arg: 1 if cached AP)
+    NET_TIMELINE_LINK_UP,           // Associated / link up (arg: channel)
+    NET_TIMELINE_LINK_DOWN,         // Link lost (arg: disconnect reason)
+    NET_TIMELINE_GOT_IP,            // IPv4 address assigned (arg: 0)
+    NET_TIMELINE_GOT_IP6,           // IPv6 address assigned (arg: 0)
+    NET_TIMELINE_IP_LOST,           // Address lost (arg: 0)
+    NET_TIMELINE_DNS_QUERY,         // DNS query sent (arg: 0)
+    NET_TIMELINE_DNS_ANSWER,        // DNS query done (arg: getaddrinfo result)
+    NET_TIMELINE_PHASE_MAX,
+} net_timeline_phase_t;
+
+/**
+ * @brief One recorded event
+ */
+typedef struct {
+    int64_t timestamp_us;           // esp_timer time of the event
+    net_timeline_phase_t phase;     // What happened
+    int32_t arg;                    // Phase-specific detail
+} net_timeline_entry_t;
+
+#if CONFIG_NET_TIMELINE
+
+/**
+ * @brief Record an event (safe to call from any task)
+ *
+ * @param[in] phase What happened
+ * @param[in] arg Phase-specific detail
+ */
+void net_timeline_record(net_timeline_phase_t phase, int32_t arg);
+
+#else
+
+// Hooks compile away when the timeline is disabled
+static inline void net_timeline_record(net_timeline_phase_t phase, int32_t arg)
+{
+    (void)phase;
+    (void)arg;
+}
+
+#endif
+
+/**
+ * @brief Copy the recorded events, oldest first
+ *
+ * @param[out] entries Array to fill
+ * @param[in] max_entries Size of the array
+ *
+ * @return Number of entries copied
+ */
+size_t net_timeline_read(net_timeline_entry_t *entries, size_t max_entries);
+
+/**
+ * @brief Export the recorded events as a binary record
+ *
+ * See NET_TIMELINE_MAGIC for the format. A buffer of
+ * NET_TIMELINE_HEADER_SIZE + CONFIG_NET_TIMELINE_ENTRIES *
+ * NET_TIMELINE_ENTRY_SIZE bytes always fits the whole timeline; a smaller
+ * buffer gets the newest entries that fit.
+ *
+ * @param[out] buf Output buffer
+ * @param[in] size Size of the buffer
+ * @param[out] len Number of bytes written
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_SIZE if the buffer can't hold the header
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t net_timeline_export(uint8_t *buf, size_t size, size_t *len);
+
+/**
+ * @brief Forget all recorded events
+ */
+void net_timeline_clear(void);
+
+/**
+ * @brief Print the timeline with the time between events
+ */
+void net_timeline_log(void);
+
+/**
+ * @brief Get a printable name for a phase
+ *
+ * @param[in] phase Phase
+ *
+ * @return Name of the phase (e.g. "GOT_IP")
+ */
+const char *net_timeline_phase_name(net_timeline_phase_t phase);
+
+#endif // NET_TIMELINE_H
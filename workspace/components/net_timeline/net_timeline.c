@@ -0,0 +1,199 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Network connection timeline.
+ *
+ * The network drivers and the DNS cache call net_timeline_record() at each
+ * phase of bringing up the network. Events go into a fixed ring buffer with
+ * their esp_timer timestamp, so the time spent scanning and associating,
+ * waiting for DHCP, or resolving the first hostname can be read back on the
+ * device or exported in a compact binary form and collected from a fleet.
+ */
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#include "net_timeline.h"
+
+// Settings
+#define NUM_ENTRIES         CONFIG_NET_TIMELINE_ENTRIES
+
+// Tag for debug messages
+static const char *TAG = "net_timeline";
+
+// Static global variables
+static net_timeline_entry_t s_entries[NUM_ENTRIES];
+static uint32_t s_head = 0;         // Next slot to write
+static uint32_t s_count = 0;        // Valid entries
+static uint32_t s_dropped = 0;      // Overwritten since the last clear
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static void put_le(uint8_t *buf, uint64_t value, size_t bytes);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Write an unsigned value in little-endian byte order
+static void put_le(uint8_t *buf, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++) {
+        buf[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Record an event
+void net_timeline_record(net_timeline_phase_t phase, int32_t arg)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_lock);
+    s_entries[s_head].timestamp_us = now_us;
+    s_entries[s_head].phase = phase;
+    s_entries[s_head].arg = arg;
+    s_head = (s_head + 1) % NUM_ENTRIES;
+    if (s_count < NUM_ENTRIES) {
+        s_count++;
+    } else {
+        s_dropped++;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+// Copy the recorded events, oldest first
+size_t net_timeline_read(net_timeline_entry_t *entries, size_t max_entries)
+{
+    size_t num;
+    uint32_t start;
+
+    taskENTER_CRITICAL(&s_lock);
+
+    // Skip the oldest entries if the array is too small
+    num = (s_count < max_entries) ? s_count : max_entries;
+    start = (s_head + NUM_ENTRIES - num) % NUM_ENTRIES;
+    for (size_t i = 0; i < num; i++) {
+        entries[i] = s_entries[(start + i) % NUM_ENTRIES];
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    return num;
+}
+
+// Export the recorded events as a binary record
+esp_err_t net_timeline_export(uint8_t *buf, size_t size, size_t *len)
+{
+    net_timeline_entry_t entries[NUM_ENTRIES];
+    size_t max_entries;
+    size_t num;
+    uint32_t dropped;
+    int64_t delta_us;
+    uint8_t *p;
+
+    if (size < NET_TIMELINE_HEADER_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Snapshot as many entries as fit
+    max_entries = (size - NET_TIMELINE_HEADER_SIZE) / NET_TIMELINE_ENTRY_SIZE;
+    if (max_entries > NUM_ENTRIES) {
+        max_entries = NUM_ENTRIES;
+    }
+    num = net_timeline_read(entries, max_entries);
+    taskENTER_CRITICAL(&s_lock);
+    dropped = s_dropped;
+    taskEXIT_CRITICAL(&s_lock);
+
+    // Header
+    put_le(&buf[0], NET_TIMELINE_MAGIC, 2);
+    buf[2] = NET_TIMELINE_VERSION;
+    buf[3] = (uint8_t)num;
+    put_le(&buf[4], dropped, 4);
+    put_le(&buf[8], (num > 0) ? (uint64_t)entries[0].timestamp_us : 0, 8);
+
+    // Entries, timestamps as deltas
+    p = &buf[NET_TIMELINE_HEADER_SIZE];
+    for (size_t i = 0; i < num; i++) {
+        delta_us = (i == 0) ? 0 : entries[i].timestamp_us - entries[i - 1].timestamp_us;
+        if (delta_us > UINT32_MAX) {
+            delta_us = UINT32_MAX;
+        }
+        p[0] = (uint8_t)entries[i].phase;
+        put_le(&p[1], (uint64_t)delta_us, 4);
+        put_le(&p[5], (uint32_t)entries[i].arg, 4);
+        p += NET_TIMELINE_ENTRY_SIZE;
+    }
+    *len = (size_t)(p - buf);
+
+    return ESP_OK;
+}
+
+// Forget all recorded events
+void net_timeline_clear(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    s_head = 0;
+    s_count = 0;
+    s_dropped = 0;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+// Print the timeline with the time between events
+void net_timeline_log(void)
+{
+    net_timeline_entry_t entries[NUM_ENTRIES];
+    size_t num;
+    int64_t prev_us;
+
+    num = net_timeline_read(entries, NUM_ENTRIES);
+    ESP_LOGI(TAG, "Network timeline (%u events):", (unsigned)num);
+    prev_us = (num > 0) ? entries[0].timestamp_us : 0;
+    for (size_t i = 0; i < num; i++) {
+        ESP_LOGI(TAG, "  %10lld us  +%8lld us  %-12s %ld",
+                 entries[i].timestamp_us,
+                 entries[i].timestamp_us - prev_us,
+                 net_timeline_phase_name(entries[i].phase),
+                 (long)entries[i].arg);
+        prev_us = entries[i].timestamp_us;
+    }
+}
+
+// Get a printable name for a phase
+const char *net_timeline_phase_name(net_timeline_phase_t phase)
+{
+    switch (phase) {
+        case NET_TIMELINE_DRIVER_START:
+            return "DRIVER_START";
+        case NET_TIMELINE_CONNECT:
+            return "CONNECT";
+        case NET_TIMELINE_LINK_UP:
+            return "LINK_UP";
+        case NET_TIMELINE_LINK_DOWN:
+            return "LINK_DOWN";
+        case NET_TIMELINE_GOT_IP:
+            return "GOT_IP";
+        case NET_TIMELINE_GOT_IP6:
+            return "GOT_IP6";
+        case NET_TIMELINE_IP_LOST:
+            return "IP_LOST";
+        case NET_TIMELINE_DNS_QUERY:
+            return "DNS_QUERY";
+        case NET_TIMELINE_DNS_ANSWER:
+            return "DNS_ANSWER";
+        default:
+            return "UNKNOWN";
+    }
+}
@@ -6,60 +6,168 @@
 #ifndef NETWORK_WRAPPER_H
 #define NETWORK_WRAPPER_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include "esp_event.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "reconnect_backoff.h"
 
-// Set constants based on network driver selected in menuconfig
+// Set constants based on network drivers selected in menuconfig
 #ifdef CONFIG_SIMPLE_NETWORK_WRAPPER
-# if CONFIG_WIFI_STA_CONNECT && !CONFIG_ETHERNET_QEMU_CONNECT
+# if !CONFIG_WIFI_STA_CONNECT && !CONFIG_ETHERNET_QEMU_CONNECT
+#  error Please select the WiFi STA and/or QEMU Ethernet driver in menuconfig
+# endif
+# if CONFIG_WIFI_STA_CONNECT
 #  include "wifi_sta.h"
-#  define NETWORK_CONNECTED_BIT      WIFI_STA_CONNECTED_BIT
-#  define NETWORK_IPV4_OBTAINED_BIT  WIFI_STA_IPV4_OBTAINED_BIT
-#  define NETWORK_IPV6_OBTAINED_BIT  WIFI_STA_IPV6_OBTAINED_BIT
-#  if CONFIG_WIFI_STA_CONNECT_IPV4
-#   define WEB_FAMILY                AF_INET
-#  elif CONFIG_WIFI_STA_CONNECT_IPV6
-#   define WEB_FAMILY                AF_INET6
-#  elif CONFIG_WIFI_STA_CONNECT_UNSPECIFIED
-#   define WEB_FAMILY                AF_UNSPEC
-#  else
-#   error Please select an IP family from WiFi STA driver config in menuconfig
-#  endif
-# elif CONFIG_ETHERNET_QEMU_CONNECT && !CONFIG_WIFI_STA_CONNECT
+# endif
+# if CONFIG_ETHERNET_QEMU_CONNECT
 #  include "ethernet_qemu.h"
-#  define NETWORK_CONNECTED_BIT      ETHERNET_QEMU_CONNECTED_BIT
-#  define NETWORK_IPV4_OBTAINED_BIT  ETHERNET_QEMU_IPV4_OBTAINED_BIT
-#  define NETWORK_IPV6_OBTAINED_BIT  ETHERNET_QEMU_IPV6_OBTAINED_BIT
-#  if CONFIG_ETHERNET_QEMU_CONNECT_IPV4
-#   define WEB_FAMILY                AF_INET
-#  elif CONFIG_ETHERNET_QEMU_CONNECT_IPV6
-#   define WEB_FAMILY                AF_INET6
-#  elif CONFIG_ETHERNET_QEMU_CONNECT_UNSPECIFIED
-#   define WEB_FAMILY                AF_UNSPEC
-#  else
-#   error Please select an IP family from QEMU Ethernet driver config in menuconfig
-#  endif
+# endif
+# define NETWORK_CONNECTED_BIT      BIT0
+# define NETWORK_IPV4_OBTAINED_BIT  BIT1
+# define NETWORK_IPV6_OBTAINED_BIT  BIT2
+// Use a family that every enabled driver is configured for
+# define NETWORK_WIFI_ONLY(family) \
+    (!CONFIG_WIFI_STA_CONNECT || CONFIG_WIFI_STA_CONNECT_##family)
+# define NETWORK_ETH_ONLY(family) \
+    (!CONFIG_ETHERNET_QEMU_CONNECT || CONFIG_ETHERNET_QEMU_CONNECT_##family)
+# if NETWORK_WIFI_ONLY(IPV4) && NETWORK_ETH_ONLY(IPV4)
+#  define WEB_FAMILY                AF_INET
+# elif NETWORK_WIFI_ONLY(IPV6) && NETWORK_ETH_ONLY(IPV6)
+#  define WEB_FAMILY                AF_INET6
 # else
-#  error Please select one (and only one) WiFi STA or QEMU Ethernet driver in menuconfig
+#  define WEB_FAMILY                AF_UNSPEC
 # endif
 #endif
 
 /**
- * @brief Initialize network driver
+ * @brief Network state transitions reported to subscribers
+ */
+typedef enum {
+    NETWORK_EVENT_LINK_UP = 0,      // Associated with AP / Ethernet link up
+    NETWORK_EVENT_LINK_DOWN,        // Link lost (see reason, reconnecting)
+    NETWORK_EVENT_IP_ACQUIRED,      // Got an address (see family)
+    NETWORK_EVENT_IP_LOST,          // DHCP lease or address lost
+    NETWORK_EVENT_ROUTE_CHANGED,    // Default route moved (iface: new, or NULL)
+} network_event_type_t;
+
+/**
+ * @brief One network state transition
+ */
+typedef struct {
+    network_event_type_t type;      // What happened
+    const char *iface;              // Interface name (e.g. "eth", "wifi")
+    int family;                     // AF_INET or AF_INET6 (IP_ACQUIRED only)
+    int reason;                     // Driver disconnect reason (0 if none)
+    bool reconnecting;              // Driver is reconnecting on its own
+    int64_t timestamp_us;           // esp_timer time of the transition
+} network_event_t;
+
+/**
+ * @brief Subscriber callback
+ *
+ * Runs in the task that caused the transition: the default event loop task
+ * for driver and IP events, the net_monitor task for route changes after a
+ * gateway probe, and the caller's task for route changes from
+ * network_stop() and for the state replayed by network_subscribe(). Keep it
+ * short, don't block, and don't call network_subscribe() or
+ * network_unsubscribe() from it. To handle events in a task of your own,
+ * use network_subscribe_queue() instead.
+ *
+ * @param[in] event State transition
+ * @param[in] arg User argument given to network_subscribe()
+ */
+typedef void (*network_event_cb_t)(const network_event_t *event, void *arg);
+
+/**
+ * @brief Subscription handle
+ */
+typedef struct network_subscriber *network_subscriber_handle_t;
+
+/**
+ * @brief State of one network interface
+ */
+typedef struct {
+    const char *name;               // Interface name (e.g. "eth", "wifi")
+    bool link_up;                   // Link is up
+    bool has_ip;                    // An address is assigned
+    bool healthy;                   // Gateway answered the last probe
+    bool is_default;                // Carries the default route
+    uint32_t rtt_ms;                // Last gateway RTT (UINT32_MAX if unknown)
+    uint32_t probe_failures;        // Probes without any reply since boot
+} network_iface_info_t;
+
+/**
+ * @brief Initialize network drivers
  * 
- * Initialize the network driver (WiFi or virtual Ethernet) and connect to the 
- * network. Choose the network driver (WIFI_STA_CONNECT or 
+ * Initialize the network drivers (WiFi and/or virtual Ethernet) and connect
+ * to the network. Choose the network drivers (WIFI_STA_CONNECT,
  * ETHERNET_QEMU_CONNECT) in menuconfig.
  * 
+ * With more than one interface enabled, they are all brought up at once. The
+ * gateway of each one is pinged periodically and the interface with the
+ * lowest round-trip time becomes the default route. If that interface loses
+ * its link or address, or its gateway stops answering, the route moves to the
+ * next best interface.
+ * 
+ * The event group gets NETWORK_CONNECTED_BIT while any link is up, and the
+ * IPV4/IPV6 bits of the interface that carries the default route.
+ * 
+ * A driver that fails to start is logged and skipped; it can be brought up
+ * later with network_reconnect().
+ * 
  * @param[in] event_group Event group handle for network events
  * 
  * @return
+ * - ESP_OK if at least one driver started
+ * - Other errors on failure (the first driver error if none started).
+ *   See esp_err.h for error codes
+ */
+esp_err_t network_init(EventGroupHandle_t event_group);
+
+/**
+ * @brief Bring up the network in the background (non-blocking)
+ *
+ * Returns right away. A background task initializes NVS (erasing it if it
+ * is full or from a newer version), the TCP/IP stack, and the default event
+ * loop, then calls network_init(). Skip those steps in the application: it
+ * can start sampling while the link comes up, and use network_wait_ready()
+ * or a subscription (IP_ACQUIRED) to find out when it can send.
+ *
+ * Steps the application already did are fine (e.g. an existing default
+ * event loop is kept).
+ *
+ * @param[in] event_group Event group handle for network events
+ *
+ * @return
  * - ESP_OK on success
+ * - ESP_ERR_INVALID_STATE if the network was already started
  * - Other errors on failure. See esp_err.h for error codes
  */
-esp_err_t network_init(EventGroupHandle_t event_group);
+esp_err_t network_start(EventGroupHandle_t event_group);
 
 /**
- * @brief Stop network driver (WiFi or virtual Ethernet)
+ * @brief Wait until the network is usable
+ *
+ * Waits for network_start() to finish (if it was used), then for an
+ * interface with an IP address. Pass 0 to check without blocking.
+ *
+ * @param[in] timeout_ms Time to wait (ms)
+ *
+ * @return
+ * - ESP_OK if the network is up
+ * - ESP_ERR_TIMEOUT if it did not come up in time
+ * - ESP_ERR_INVALID_STATE if the network was not started
+ * - Other errors if NVS, the TCP/IP stack, or the event loop failed to
+ *   start. See esp_err.h for error codes
+ */
+esp_err_t network_wait_ready(uint32_t timeout_ms);
+
+/**
+ * @brief Stop network drivers (WiFi and/or virtual Ethernet)
  * 
  * @return
  * - ESP_OK on success
@@ -68,7 +176,9 @@ esp_err_t network_init(EventGroupHandle_t event_group);
 esp_err_t network_stop(void);
 
 /**
- * @brief Reconnect network driver (WiFi or virtual Ethernet)
+ * @brief Reconnect network drivers (WiFi and/or virtual Ethernet)
+ * 
+ * Only interfaces that are not up are reconnected.
  * 
  * @return
  * - ESP_OK on success
@@ -76,6 +186,19 @@ esp_err_t network_stop(void);
  */
 esp_err_t network_reconnect(void);
 
+/**
+ * @brief Get the drivers' automatic reconnection statistics
+ * 
+ * With several drivers, the counters of all of them are added up.
+ * 
+ * @param[out] stats Statistics since boot (including time to reconnect)
+ * 
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_NOT_SUPPORTED if no driver has its auto reconnect option enabled
+ */
+esp_err_t network_get_reconnect_stats(reconnect_stats_t *stats);
+
 /**
  * @brief Wait for network connection and IP address (blocking)
  * 
@@ -87,4 +210,145 @@ esp_err_t network_reconnect(void);
 bool wait_for_network(EventGroupHandle_t network_event_group, 
                       uint32_t timeout_sec);
 
+/**
+ * @brief Call a function on every network state transition
+ *
+ * If the network is already up, the callback is immediately given LINK_UP
+ * and IP_ACQUIRED events for each interface that is up, then ROUTE_CHANGED
+ * for the active interface, so late subscribers don't have to check the
+ * event group bits first.
+ *
+ * @param[in] cb Function to call (see network_event_cb_t for which task
+ *            it runs in)
+ * @param[in] arg User argument passed to the callback
+ * @param[out] handle Subscription handle (for network_unsubscribe())
+ *
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_NO_MEM if CONFIG_NETWORK_WRAPPER_MAX_SUBSCRIBERS are registered
+ * - Other errors on failure. See esp_err.h for error codes
+ */
+esp_err_t network_subscribe(network_event_cb_t cb, 
+                            void *arg, 
+                            network_subscriber_handle_t *handle);
+
+/**
+ * @brief Send every network state transition to a FreeRTOS queue
+ *
+ * The queue must hold network_event_t items. Events are sent without
+ * waiting: if the queue is full, the event is dropped and counted (see
+ * network_get_dropped_events()). Replays the current state like
+ * network_subscribe().
+ *
+ * @param[in] queue Queue created with sizeof(network_event_t) items
+ * @param[out] handle Subscription handle (for network_unsubscribe())
+ *
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_NO_MEM if CONFIG_NETWORK_WRAPPER_MAX_SUBSCRIBERS are registered
+ * - Other errors on failure. See esp_err.h for error codes
+ */
+esp_err_t network_subscribe_queue(QueueHandle_t queue, 
+                                  network_subscriber_handle_t *handle);
+
+/**
+ * @brief Stop delivering events to a subscriber
+ *
+ * @param[in] handle Handle from network_subscribe() or 
+ *                   network_subscribe_queue()
+ *
+ * @return
+ * - ESP_OK on success
+ * - Other errors on failure. See esp_err.h for error codes
+ */
+esp_err_t network_unsubscribe(network_subscriber_handle_t handle);
+
+/**
+ * @brief Check whether an interface with an IP address carries the route
+ * 
+ * @return true if the network is usable, false otherwise
+ */
+bool network_is_up(void);
+
+/**
+ * @brief Get the name of the interface that carries the default route
+ * 
+ * @return Interface name (e.g. "eth"), or NULL if the network is down
+ */
+const char *network_get_active_interface(void);
+
+/**
+ * @brief Measure the RTT to the gateway of the active interface (blocking)
+ * 
+ * Sends CONFIG_NETWORK_WRAPPER_PROBE_COUNT pings and returns the mean
+ * round-trip time of the replies. Probes from several tasks run one at a
+ * time.
+ * 
+ * @param[out] rtt_ms Round-trip time (ms)
+ * 
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_STATE if the network is down
+ * - ESP_ERR_NOT_FOUND if the interface has no IPv4 gateway
+ * - ESP_ERR_TIMEOUT if the gateway did not answer
+ * - Other errors on failure. See esp_err.h for error codes
+ */
+esp_err_t network_probe_gateway(uint32_t *rtt_ms);
+
+/**
+ * @brief Get the state of every enabled interface
+ * 
+ * @param[out] info Array to fill
+ * @param[in] max_ifaces Size of the array
+ * 
+ * @return Number of entries filled
+ */
+size_t network_get_interfaces(network_iface_info_t *info, size_t max_ifaces);
+
+/**
+ * @brief Get number of events dropped because a subscriber queue was full
+ * 
+ * @return Dropped event count since boot
+ */
+uint32_t network_get_dropped_events(void);
+
+/**
+ * @brief Get a printable name for an event type
+ * 
+ * @param[in] type Event type
+ * 
+ * @return Name of the event type (e.g. "LINK_UP")
+ */
+const char *network_event_name(network_event_type_t type);
+
+#if CONFIG_NETWORK_WRAPPER_SIM_IFACE
+
+/**
+ * @brief RTT that makes the simulated gateway stop answering
+ */
+#define NETWORK_SIM_NO_REPLY        UINT32_MAX
+
+/**
+ * @brief Bring the simulated interface's link up or down
+ * 
+ * Going up reports LINK_UP and IP_ACQUIRED (IPv4) as a real driver would;
+ * going down reports LINK_DOWN.
+ * 
+ * @param[in] up true to bring the link up
+ * 
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_STATE if network_init() has not been called
+ */
+esp_err_t network_sim_set_link(bool up);
+
+/**
+ * @brief Set the round-trip time the simulated gateway reports
+ * 
+ * @param[in] rtt_ms RTT (ms), or NETWORK_SIM_NO_REPLY to fail every probe
+ */
+void network_sim_set_rtt(uint32_t rtt_ms);
+
+#endif
+
 #endif  // NETWORK_WRAPPER_H
\ No newline at end of file
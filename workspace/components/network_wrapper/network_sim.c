@@ -0,0 +1,238 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Simulated network interface.
+ *
+ * QEMU only emulates one network adapter (open_eth). This module adds a
+ * second esp_netif whose link state and gateway RTT are set by the
+ * application, so route selection and failover in the network wrapper can be
+ * exercised without real hardware. The interface has no address and drops
+ * every packet handed to it.
+ */
+
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "network_wrapper.h"
+#include "network_sim.h"
+
+// Settings
+#define PROBE_TIMEOUT_MS    (CONFIG_NETWORK_WRAPPER_PROBE_COUNT * \
+                             CONFIG_NETWORK_WRAPPER_PROBE_TIMEOUT_MS)
+
+// Driver handle given to esp_netif
+typedef struct {
+    esp_netif_driver_base_t base;
+} sim_driver_t;
+
+// Tag for debug messages
+static const char *TAG = "network_sim";
+
+// Event base
+ESP_EVENT_DEFINE_BASE(NETWORK_SIM_EVENT);
+
+// Static global variables
+static esp_netif_t *s_sim_netif = NULL;
+static sim_driver_t s_sim_driver;
+static EventGroupHandle_t s_sim_event_group = NULL;
+static bool s_link_up = false;
+static volatile uint32_t s_rtt_ms = CONFIG_NETWORK_WRAPPER_SIM_RTT_MS;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static esp_err_t sim_transmit(void *handle, void *buffer, size_t len);
+static void sim_free_rx_buffer(void *handle, void *buffer);
+static esp_err_t sim_post_attach(esp_netif_t *netif, void *args);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Drop outgoing packets
+static esp_err_t sim_transmit(void *handle, void *buffer, size_t len)
+{
+    return ESP_OK;
+}
+
+// Nothing is ever received
+static void sim_free_rx_buffer(void *handle, void *buffer)
+{
+}
+
+// Connect the driver to the interface (called by esp_netif_attach())
+static esp_err_t sim_post_attach(esp_netif_t *netif, void *args)
+{
+    sim_driver_t *driver = (sim_driver_t *)args;
+    esp_netif_driver_ifconfig_t driver_ifconfig = {
+        .handle = driver,
+        .transmit = sim_transmit,
+        .driver_free_rx_buffer = sim_free_rx_buffer,
+    };
+
+    driver->base.netif = netif;
+
+    return esp_netif_set_driver_config(netif, &driver_ifconfig);
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Start the simulated interface and bring its link up
+esp_err_t network_sim_init(EventGroupHandle_t event_group)
+{
+    esp_err_t esp_ret;
+
+    // Use the existing event group if none is given
+    if (event_group != NULL) {
+        s_sim_event_group = event_group;
+    }
+    if (s_sim_event_group == NULL) {
+        ESP_LOGE(TAG, "No event group");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_sim_netif != NULL) {
+        return ESP_OK;
+    }
+
+    // Ethernet-like interface without DHCP: it never gets an address, so no
+    // IP events are posted for it
+    esp_netif_inherent_config_t base_config = ESP_NETIF_INHERENT_DEFAULT_ETH();
+    base_config.flags = 0;
+    base_config.if_key = "SIM_DEF";
+    base_config.if_desc = "sim";
+    base_config.route_prio = 1;
+    esp_netif_config_t netif_config = {
+        .base = &base_config,
+        .driver = NULL,
+        .stack = ESP_NETIF_NETSTACK_DEFAULT_ETH,
+    };
+
+    // Create the interface
+    s_sim_netif = esp_netif_new(&netif_config);
+    if (s_sim_netif == NULL) {
+        ESP_LOGE(TAG, "Failed to create network interface");
+        return ESP_FAIL;
+    }
+
+    // Attach the packet-dropping driver
+    s_sim_driver.base.post_attach = sim_post_attach;
+    esp_ret = esp_netif_attach(s_sim_netif, &s_sim_driver);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to attach driver", esp_ret);
+        esp_netif_destroy(s_sim_netif);
+        s_sim_netif = NULL;
+        return esp_ret;
+    }
+    esp_netif_action_start(s_sim_netif, NULL, 0, NULL);
+    ESP_LOGI(TAG, "Simulated interface started (gateway RTT %lu ms)",
+             s_rtt_ms);
+
+    return network_sim_set_link(true);
+}
+
+// Stop the simulated interface
+esp_err_t network_sim_stop(void)
+{
+    if (s_sim_netif == NULL) {
+        return ESP_OK;
+    }
+
+    network_sim_set_link(false);
+    esp_netif_action_stop(s_sim_netif, NULL, 0, NULL);
+    esp_netif_destroy(s_sim_netif);
+    s_sim_netif = NULL;
+    ESP_LOGI(TAG, "Simulated interface stopped");
+
+    return ESP_OK;
+}
+
+// Bring the simulated link back up
+esp_err_t network_sim_reconnect(void)
+{
+    if (s_sim_netif == NULL) {
+        return network_sim_init(NULL);
+    }
+
+    return network_sim_set_link(true);
+}
+
+// Get the simulated network interface
+esp_netif_t *network_sim_get_netif(void)
+{
+    return s_sim_netif;
+}
+
+// Measure the simulated gateway RTT
+esp_err_t network_sim_probe(esp_netif_t *netif, uint32_t *rtt_ms)
+{
+    uint32_t rtt = s_rtt_ms;
+
+    // Take as long as a real probe would
+    if (rtt == NETWORK_SIM_NO_REPLY) {
+        vTaskDelay(pdMS_TO_TICKS(PROBE_TIMEOUT_MS));
+        return ESP_ERR_TIMEOUT;
+    }
+    vTaskDelay(pdMS_TO_TICKS(rtt));
+    *rtt_ms = rtt;
+
+    return ESP_OK;
+}
+
+// Bring the simulated interface's link up or down
+esp_err_t network_sim_set_link(bool up)
+{
+    esp_err_t esp_ret;
+
+    if (s_sim_netif == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (up == s_link_up) {
+        return ESP_OK;
+    }
+    s_link_up = up;
+
+    // Update the interface and the driver bits
+    if (up) {
+        esp_netif_action_connected(s_sim_netif, NULL, 0, NULL);
+        xEventGroupSetBits(s_sim_event_group,
+                           NETWORK_CONNECTED_BIT | NETWORK_IPV4_OBTAINED_BIT);
+        ESP_LOGI(TAG, "Simulated link up");
+    } else {
+        esp_netif_action_disconnected(s_sim_netif, NULL, 0, NULL);
+        xEventGroupClearBits(s_sim_event_group,
+                             NETWORK_CONNECTED_BIT | NETWORK_IPV4_OBTAINED_BIT);
+        ESP_LOGI(TAG, "Simulated link down");
+    }
+
+    // Report it through the event loop like a real driver
+    esp_ret = esp_event_post(NETWORK_SIM_EVENT,
+                             up ? NETWORK_SIM_EVENT_LINK_UP :
+                                  NETWORK_SIM_EVENT_LINK_DOWN,
+                             NULL,
+                             0,
+                             portMAX_DELAY);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to post link event", esp_ret);
+    }
+
+    return esp_ret;
+}
+
+// Set the round-trip time the simulated gateway reports
+void network_sim_set_rtt(uint32_t rtt_ms)
+{
+    s_rtt_ms = rtt_ms;
+    if (rtt_ms == NETWORK_SIM_NO_REPLY) {
+        ESP_LOGI(TAG, "Simulated gateway stops answering");
+    } else {
+        ESP_LOGI(TAG, "Simulated gateway RTT: %lu ms", rtt_ms);
+    }
+}
@@ -0,0 +1,85 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Private interface between network_wrapper.c and the simulated interface.
+ * Not part of the component's public API (see network_sim_set_link() and
+ * network_sim_set_rtt() in network_wrapper.h).
+ */
+
+#ifndef NETWORK_SIM_H
+#define NETWORK_SIM_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+/**
+ * @brief Events posted by the simulated interface
+ */
+ESP_EVENT_DECLARE_BASE(NETWORK_SIM_EVENT);
+
+typedef enum {
+    NETWORK_SIM_EVENT_LINK_UP = 0,  // Link up with an IPv4 address
+    NETWORK_SIM_EVENT_LINK_DOWN,    // Link down
+} network_sim_event_t;
+
+/**
+ * @brief Start the simulated interface and bring its link up
+ *
+ * @param[in] event_group Event group for the driver bits. Pass NULL to use
+ *                        the existing event group.
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t network_sim_init(EventGroupHandle_t event_group);
+
+/**
+ * @brief Stop the simulated interface
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t network_sim_stop(void);
+
+/**
+ * @brief Bring the simulated link back up
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t network_sim_reconnect(void);
+
+/**
+ * @brief Get the simulated network interface
+ *
+ * @return Interface handle, or NULL if it is not running
+ */
+esp_netif_t *network_sim_get_netif(void);
+
+/**
+ * @brief Measure the simulated gateway RTT
+ *
+ * Blocks for the simulated RTT (or the probe timeout if the gateway does not
+ * answer), like a real ping would.
+ *
+ * @param[in] netif Simulated interface
+ * @param[out] rtt_ms Round-trip time (ms)
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_TIMEOUT if the gateway is set to not answer
+ */
+esp_err_t network_sim_probe(esp_netif_t *netif, uint32_t *rtt_ms);
+
+#endif // NETWORK_SIM_H
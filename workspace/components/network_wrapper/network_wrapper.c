@@ -2,69 +2,1180 @@
  * SPDX-FileCopyrightText: 2025 Shawn Hymel
  * SPDX-License-Identifier: Apache-2.0
  */
+
+/**
+ * Common interface for the WiFi STA and QEMU Ethernet drivers.
+ *
+ * The enabled drivers are kept in a table and brought up together. This
+ * module listens to their link and IP events, tracks the state of each
+ * interface, and turns the events into typed state transitions
+ * (network_event_t). Any number of tasks (up to
+ * CONFIG_NETWORK_WRAPPER_MAX_SUBSCRIBERS) can subscribe with a callback or a
+ * queue, so they no longer need to poll the shared event group bits.
+ *
+ * The interface with the lowest gateway round-trip time carries the esp_netif
+ * default route. With more than one interface, a monitor task pings every
+ * gateway each CONFIG_NETWORK_WRAPPER_PROBE_INTERVAL_MS. Losing the link or
+ * the address moves the route at once; a gateway that stops answering moves
+ * it as soon as its probe fails.
+ *
+ * network_start() runs the system setup and network_init() in a short-lived
+ * task so applications can do useful work while the link comes up.
+ */
+
+#include <string.h>
+
+#include "esp_eth.h"
 #include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lwip/ip_addr.h"
+#include "lwip/sockets.h"
+#include "nvs_flash.h"
+#include "ping/ping_sock.h"
 
 #include "network_wrapper.h"
+#if CONFIG_NETWORK_WRAPPER_SIM_IFACE
+# include "network_sim.h"
+#endif
 
-// Include the correct network driver: WiFi STA xor QEMU Ethernet
-#if CONFIG_WIFI_STA_CONNECT && !CONFIG_ETHERNET_QEMU_CONNECT
-# include "wifi_sta.h"
-#elif CONFIG_ETHERNET_QEMU_CONNECT && !CONFIG_WIFI_STA_CONNECT
-# include "ethernet_qemu.h"
+// Settings
+#define MAX_SUBSCRIBERS     CONFIG_NETWORK_WRAPPER_MAX_SUBSCRIBERS
+#define PROBE_INTERVAL_MS   CONFIG_NETWORK_WRAPPER_PROBE_INTERVAL_MS
+#define PROBE_COUNT         CONFIG_NETWORK_WRAPPER_PROBE_COUNT
+#define PROBE_TIMEOUT_MS    CONFIG_NETWORK_WRAPPER_PROBE_TIMEOUT_MS
+#define PROBE_GAP_MS        100     // Time between the pings of one probe
+#define SWITCH_MARGIN_MS    CONFIG_NETWORK_WRAPPER_SWITCH_MARGIN_MS
+#define MONITOR_STACK_SIZE  4096
+#define MONITOR_PRIORITY    5
+#define START_STACK_SIZE    4096
+#define START_PRIORITY      5
+#define START_DONE_BIT      BIT0
+#define RTT_UNKNOWN         UINT32_MAX
+#define NETWORK_ALL_BITS    (NETWORK_CONNECTED_BIT | \
+                             NETWORK_IPV4_OBTAINED_BIT | \
+                             NETWORK_IPV6_OBTAINED_BIT)
+
+// Drivers that reconnect on their own
+#if CONFIG_WIFI_STA_AUTO_RECONNECT
+# define WIFI_RECONNECTS    true
+#else
+# define WIFI_RECONNECTS    false
+#endif
+#if CONFIG_ETHERNET_QEMU_AUTO_RECONNECT
+# define ETH_RECONNECTS     true
 #else
-# error Please select one (and only one) WiFi STA or QEMU Ethernet driver in menuconfig
+# define ETH_RECONNECTS     false
+#endif
+
+// Interfaces (the first one wins between equal RTTs)
+enum {
+#if CONFIG_ETHERNET_QEMU_CONNECT
+    IFACE_ETH,
 #endif
+#if CONFIG_WIFI_STA_CONNECT
+    IFACE_WIFI,
+#endif
+#if CONFIG_NETWORK_WRAPPER_SIM_IFACE
+    IFACE_SIM,
+#endif
+    NUM_IFACES
+};
+
+// Network driver operations
+typedef struct {
+    const char *name;
+    esp_err_t (*init)(EventGroupHandle_t event_group);
+    esp_err_t (*stop)(void);
+    esp_err_t (*reconnect)(void);
+    esp_err_t (*get_reconnect_stats)(reconnect_stats_t *stats);
+    esp_netif_t *(*get_netif)(void);
+    esp_err_t (*probe)(esp_netif_t *netif, uint32_t *rtt_ms);
+    bool reconnects;                // Driver reconnects on its own
+} network_driver_t;
+
+// State of one interface
+typedef struct {
+    EventGroupHandle_t event_group; // Bits set by the driver itself
+    bool link_up;
+    bool ipv4;
+    bool ipv6;
+    bool healthy;                   // Gateway answered the last probe
+    uint32_t rtt_ms;                // Last gateway RTT
+    uint32_t probe_failures;
+} iface_state_t;
+
+// Replies collected by one ping session
+typedef struct {
+    SemaphoreHandle_t done;
+    uint32_t replies;
+    uint32_t sum_ms;
+} ping_ctx_t;
+
+// One registered callback or queue
+struct network_subscriber {
+    bool used;
+    network_event_cb_t cb;
+    void *arg;
+    QueueHandle_t queue;
+};
 
 // Tag for debug messages
 static const char *TAG = "network_wrapper";
 
-// Wrapper for network driver initialization
-esp_err_t network_init(EventGroupHandle_t event_group)
-{
-    esp_err_t esp_ret;
+// Static global variables
+static struct network_subscriber s_subscribers[MAX_SUBSCRIBERS];
+static SemaphoreHandle_t s_subscribers_mutex = NULL;
+static SemaphoreHandle_t s_route_mutex = NULL;
+static portMUX_TYPE s_state_lock = portMUX_INITIALIZER_UNLOCKED;
+static iface_state_t s_ifaces[NUM_IFACES];
+static int s_active = -1;           // Interface with the default route
+static uint32_t s_route_seq = 0;    // Bumped on every route change
+static EventGroupHandle_t s_event_group = NULL;
+static TaskHandle_t s_monitor_task = NULL;
+static ping_ctx_t s_ping_ctx;
+static SemaphoreHandle_t s_ping_mutex = NULL;
+static bool s_handlers_registered = false;
+static uint32_t s_dropped_events = 0;
+static EventGroupHandle_t s_start_group = NULL;
+static esp_err_t s_start_ret = ESP_OK;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
 
-    // Initialize network driver
+static esp_err_t subscribers_lock(void);
+static void deliver(struct network_subscriber *sub, const network_event_t *event);
+static void publish(const network_event_t *event);
+static void publish_route(const network_event_t *event, uint32_t seq);
+static void on_ping_success(esp_ping_handle_t hdl, void *args);
+static void on_ping_end(esp_ping_handle_t hdl, void *args);
+static esp_err_t ping_gateway(esp_netif_t *netif, uint32_t *rtt_ms);
+static bool iface_up(const iface_state_t *iface);
+static bool iface_better(int a, int b);
+static void iface_reset(iface_state_t *iface);
+static int iface_from_netif(esp_netif_t *netif);
+static void select_route(void);
+static void iface_event(int idx, network_event_t *event);
+static void on_network_event(void *arg,
+                             esp_event_base_t event_base,
+                             int32_t event_id,
+                             void *event_data);
+static esp_err_t register_handlers(void);
+static esp_err_t add_subscriber(network_event_cb_t cb,
+                                void *arg,
+                                QueueHandle_t queue,
+                                network_subscriber_handle_t *handle);
+static void merge_stats(reconnect_stats_t *total,
+                        const reconnect_stats_t *stats);
+static void monitor_task(void *arg);
+static esp_err_t start_system(void);
+static void start_task(void *arg);
+
+// Enabled network drivers
+static const network_driver_t s_drivers[NUM_IFACES] = {
+#if CONFIG_ETHERNET_QEMU_CONNECT
+    [IFACE_ETH] = {
+        .name = "eth",
+        .init = eth_qemu_init,
+        .stop = eth_qemu_stop,
+        .reconnect = eth_qemu_reconnect,
+        .get_reconnect_stats = eth_qemu_get_reconnect_stats,
+        .get_netif = eth_qemu_get_netif,
+        .probe = ping_gateway,
+        .reconnects = ETH_RECONNECTS,
+    },
+#endif
 #if CONFIG_WIFI_STA_CONNECT
-    esp_ret = wifi_sta_init(event_group);
-#elif CONFIG_ETHERNET_QEMU_CONNECT
-    esp_ret = eth_qemu_init(event_group);
-#else
-    esp_ret = ESP_FAIL;
+    [IFACE_WIFI] = {
+        .name = "wifi",
+        .init = wifi_sta_init,
+        .stop = wifi_sta_stop,
+        .reconnect = wifi_sta_reconnect,
+        .get_reconnect_stats = wifi_sta_get_reconnect_stats,
+        .get_netif = wifi_sta_get_netif,
+        .probe = ping_gateway,
+        .reconnects = WIFI_RECONNECTS,
+    },
+#endif
+#if CONFIG_NETWORK_WRAPPER_SIM_IFACE
+    [IFACE_SIM] = {
+        .name = "sim",
+        .init = network_sim_init,
+        .stop = network_sim_stop,
+        .reconnect = network_sim_reconnect,
+        .get_reconnect_stats = NULL,
+        .get_netif = network_sim_get_netif,
+        .probe = network_sim_probe,
+        .reconnects = false,
+    },
 #endif
+};
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Take the subscriber list mutex (created on first use)
+static esp_err_t subscribers_lock(void)
+{
+    SemaphoreHandle_t mutex;
+
+    // Subscribing may happen before network_init(), so create it lazily
+    if (s_subscribers_mutex == NULL) {
+        mutex = xSemaphoreCreateMutex();
+        if (mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        taskENTER_CRITICAL(&s_state_lock);
+        if (s_subscribers_mutex == NULL) {
+            s_subscribers_mutex = mutex;
+            mutex = NULL;
+        }
+        taskEXIT_CRITICAL(&s_state_lock);
+        if (mutex != NULL) {
+            vSemaphoreDelete(mutex);
+        }
+    }
+    xSemaphoreTake(s_subscribers_mutex, portMAX_DELAY);
+
+    return ESP_OK;
+}
+
+// Hand one event to one subscriber (call with the subscriber mutex held)
+static void deliver(struct network_subscriber *sub, const network_event_t *event)
+{
+    if (sub->cb != NULL) {
+        sub->cb(event, sub->arg);
+    } else if (xQueueSend(sub->queue, event, 0) != pdTRUE) {
+        taskENTER_CRITICAL(&s_state_lock);
+        s_dropped_events++;
+        taskEXIT_CRITICAL(&s_state_lock);
+    }
+}
+
+// Hand one event to every subscriber
+static void publish(const network_event_t *event)
+{
+    if (subscribers_lock() != ESP_OK) {
+        return;
+    }
+    for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (s_subscribers[i].used) {
+            deliver(&s_subscribers[i], event);
+        }
+    }
+    xSemaphoreGive(s_subscribers_mutex);
+}
+
+// Hand a route change to every subscriber, unless a newer one was made
+// meanwhile (its own caller reports that one)
+static void publish_route(const network_event_t *event, uint32_t seq)
+{
+    bool current;
+
+    if (subscribers_lock() != ESP_OK) {
+        return;
+    }
+    taskENTER_CRITICAL(&s_state_lock);
+    current = (seq == s_route_seq);
+    taskEXIT_CRITICAL(&s_state_lock);
+    if (current) {
+        for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+            if (s_subscribers[i].used) {
+                deliver(&s_subscribers[i], event);
+            }
+        }
+    }
+    xSemaphoreGive(s_subscribers_mutex);
+}
+
+// Ping callback: collect the round-trip time of one reply
+static void on_ping_success(esp_ping_handle_t hdl, void *args)
+{
+    ping_ctx_t *ctx = (ping_ctx_t *)args;
+    uint32_t elapsed_ms = 0;
+
+    esp_ping_get_profile(hdl, 
+                         ESP_PING_PROF_TIMEGAP, 
+                         &elapsed_ms, 
+                         sizeof(elapsed_ms));
+    ctx->replies++;
+    ctx->sum_ms += elapsed_ms;
+}
+
+// Ping callback: session finished
+static void on_ping_end(esp_ping_handle_t hdl, void *args)
+{
+    ping_ctx_t *ctx = (ping_ctx_t *)args;
+
+    xSemaphoreGive(ctx->done);
+}
+
+// Measure the mean RTT to an interface's IPv4 gateway (blocking)
+static esp_err_t ping_gateway(esp_netif_t *netif, uint32_t *rtt_ms)
+{
+    esp_netif_ip_info_t ip_info;
+    esp_ping_config_t config = ESP_PING_DEFAULT_CONFIG();
+    esp_ping_callbacks_t callbacks = {
+        .cb_args = &s_ping_ctx,
+        .on_ping_success = on_ping_success,
+        .on_ping_timeout = NULL,
+        .on_ping_end = on_ping_end,
+    };
+    esp_ping_handle_t ping;
+    esp_err_t esp_ret;
+
+    // Nothing to ping without an IPv4 gateway (e.g. IPv6 only)
+    esp_ret = esp_netif_get_ip_info(netif, &ip_info);
+    if ((esp_ret != ESP_OK) || (ip_info.gw.addr == 0)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Ping the gateway through this interface only
+    ip_addr_set_ip4_u32(&config.target_addr, ip_info.gw.addr);
+    config.count = PROBE_COUNT;
+    config.interval_ms = PROBE_GAP_MS;
+    config.timeout_ms = PROBE_TIMEOUT_MS;
+    config.interface = esp_netif_get_netif_impl_index(netif);
+
+    // One session at a time shares the context. Drop a late end
+    // notification from a session that timed out.
+    xSemaphoreTake(s_ping_mutex, portMAX_DELAY);
+    xSemaphoreTake(s_ping_ctx.done, 0);
+    s_ping_ctx.replies = 0;
+    s_ping_ctx.sum_ms = 0;
+
+    // Run the session and wait for it to end
+    esp_ret = esp_ping_new_session(&config, &callbacks, &ping);
+    if (esp_ret != ESP_OK) {
+        xSemaphoreGive(s_ping_mutex);
+        ESP_LOGE(TAG, "Error (%d): Failed to create ping session", esp_ret);
+        return esp_ret;
+    }
+    esp_ret = esp_ping_start(ping);
+    if (esp_ret == ESP_OK) {
+        xSemaphoreTake(s_ping_ctx.done, 
+                       pdMS_TO_TICKS(PROBE_COUNT * 
+                                     (PROBE_GAP_MS + PROBE_TIMEOUT_MS) + 
+                                     1000));
+        esp_ping_stop(ping);
+    }
+    esp_ping_delete_session(ping);
+    if (esp_ret != ESP_OK) {
+        xSemaphoreGive(s_ping_mutex);
+        ESP_LOGE(TAG, "Error (%d): Failed to start ping session", esp_ret);
+        return esp_ret;
+    }
+
+    // Mean of the replies
+    if (s_ping_ctx.replies == 0) {
+        esp_ret = ESP_ERR_TIMEOUT;
+    } else {
+        *rtt_ms = s_ping_ctx.sum_ms / s_ping_ctx.replies;
+    }
+    xSemaphoreGive(s_ping_mutex);
 
     return esp_ret;
 }
 
-// Wrapper for network driver deinitialization
-esp_err_t network_stop(void)
+// Check whether an interface is usable (call with the state lock held)
+static bool iface_up(const iface_state_t *iface)
+{
+    return iface->link_up && (iface->ipv4 || iface->ipv6);
+}
+
+// Check whether interface a should carry the route instead of b (lock held)
+static bool iface_better(int a, int b)
+{
+    if (b < 0) {
+        return true;
+    }
+
+    // A gateway that answers beats a faster one that stopped answering
+    if (s_ifaces[a].healthy != s_ifaces[b].healthy) {
+        return s_ifaces[a].healthy;
+    }
+
+    return s_ifaces[a].rtt_ms < s_ifaces[b].rtt_ms;
+}
+
+// Forget an interface's link state and measurements (lock held)
+static void iface_reset(iface_state_t *iface)
+{
+    iface->link_up = false;
+    iface->ipv4 = false;
+    iface->ipv6 = false;
+    iface->healthy = true;
+    iface->rtt_ms = RTT_UNKNOWN;
+}
+
+// Find the interface that owns an esp_netif (-1 if none)
+static int iface_from_netif(esp_netif_t *netif)
+{
+    if (netif == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < NUM_IFACES; i++) {
+        if (s_drivers[i].get_netif() == netif) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Give the default route to the best usable interface
+static void select_route(void)
 {
+    network_event_t event = {
+        .type = NETWORK_EVENT_ROUTE_CHANGED,
+        .iface = NULL,
+        .family = AF_UNSPEC,
+        .reason = 0,
+        .reconnecting = false,
+        .timestamp_us = esp_timer_get_time(),
+    };
+    EventBits_t bits = 0;
+    esp_netif_t *netif;
+    uint32_t rtt_ms = RTT_UNKNOWN;
+    uint32_t seq;
+    int current;
+    int best = -1;
     esp_err_t esp_ret;
 
-    // Stop network driver
+    xSemaphoreTake(s_route_mutex, portMAX_DELAY);
+
+    // Pick the best interface
+    taskENTER_CRITICAL(&s_state_lock);
+    current = s_active;
+    for (int i = 0; i < NUM_IFACES; i++) {
+        if (iface_up(&s_ifaces[i]) && iface_better(i, best)) {
+            best = i;
+        }
+    }
+
+    // Keep the current one unless the best one is clearly faster
+    if ((best >= 0) && 
+        (current >= 0) && 
+        (best != current) && 
+        iface_up(&s_ifaces[current]) &&
+        (s_ifaces[current].healthy == s_ifaces[best].healthy) &&
+        ((uint64_t)s_ifaces[best].rtt_ms + SWITCH_MARGIN_MS >= 
+         s_ifaces[current].rtt_ms)) {
+        best = current;
+    }
+    s_active = best;
+    if (best != current) {
+        s_route_seq++;
+    }
+    seq = s_route_seq;
+
+    // Mirror the state into the application's event bits
+    for (int i = 0; i < NUM_IFACES; i++) {
+        if (s_ifaces[i].link_up) {
+            bits |= NETWORK_CONNECTED_BIT;
+        }
+    }
+    if (best >= 0) {
+        rtt_ms = s_ifaces[best].rtt_ms;
+        if (s_ifaces[best].ipv4) {
+            bits |= NETWORK_IPV4_OBTAINED_BIT;
+        }
+        if (s_ifaces[best].ipv6) {
+            bits |= NETWORK_IPV6_OBTAINED_BIT;
+        }
+    }
+    taskEXIT_CRITICAL(&s_state_lock);
+    if (s_event_group != NULL) {
+        xEventGroupClearBits(s_event_group, NETWORK_ALL_BITS & ~bits);
+        xEventGroupSetBits(s_event_group, bits);
+    }
+
+    // esp_netif picks its own default when an interface comes up, so check
+    // the route every time rather than only when the choice changes
+    if (best >= 0) {
+        netif = s_drivers[best].get_netif();
+        if ((netif != NULL) && (esp_netif_get_default_netif() != netif)) {
+            esp_ret = esp_netif_set_default_netif(netif);
+            if (esp_ret != ESP_OK) {
+                ESP_LOGE(TAG, "Error (%d): Failed to set default route", 
+                         esp_ret);
+            }
+        }
+    }
+
+    xSemaphoreGive(s_route_mutex);
+
+    // Tell subscribers when the route moves (after releasing the route
+    // mutex, so callbacks never run with it held)
+    if (best != current) {
+        if (best < 0) {
+            ESP_LOGW(TAG, "No usable interface");
+        } else if (rtt_ms == RTT_UNKNOWN) {
+            ESP_LOGI(TAG, "Default route: %s", s_drivers[best].name);
+            event.iface = s_drivers[best].name;
+        } else {
+            ESP_LOGI(TAG, "Default route: %s (gateway RTT %lu ms)", 
+                     s_drivers[best].name, 
+                     rtt_ms);
+            event.iface = s_drivers[best].name;
+        }
+        publish_route(&event, seq);
+    }
+}
+
+// Apply one transition to an interface, tell subscribers, update the route
+static void iface_event(int idx, network_event_t *event)
+{
+    iface_state_t *iface = &s_ifaces[idx];
+
+    event->iface = s_drivers[idx].name;
+    event->reconnecting = (event->type == NETWORK_EVENT_LINK_DOWN) && 
+                          s_drivers[idx].reconnects;
+    event->timestamp_us = esp_timer_get_time();
+
+    // Update the interface state
+    taskENTER_CRITICAL(&s_state_lock);
+    switch (event->type) {
+        case NETWORK_EVENT_LINK_UP:
+            iface->link_up = true;
+            break;
+        case NETWORK_EVENT_LINK_DOWN:
+            // Addresses are not usable without the link
+            iface_reset(iface);
+            break;
+        case NETWORK_EVENT_IP_ACQUIRED:
+            if (event->family == AF_INET6) {
+                iface->ipv6 = true;
+            } else {
+                iface->ipv4 = true;
+            }
+            break;
+        case NETWORK_EVENT_IP_LOST:
+            iface->ipv4 = false;
+            iface->ipv6 = false;
+            iface->healthy = true;
+            iface->rtt_ms = RTT_UNKNOWN;
+            break;
+        default:
+            break;
+    }
+    taskEXIT_CRITICAL(&s_state_lock);
+
+    ESP_LOGD(TAG, "%s: %s (family %d, reason %d)", 
+             event->iface,
+             network_event_name(event->type), 
+             event->family, 
+             event->reason);
+    publish(event);
+    select_route();
+
+    // Measure a new interface right away instead of at the next round
+    if ((event->type == NETWORK_EVENT_IP_ACQUIRED) && (s_monitor_task != NULL)) {
+        xTaskNotifyGive(s_monitor_task);
+    }
+}
+
+// Event handler: translate driver and IP events into state transitions
+static void on_network_event(void *arg,
+                             esp_event_base_t event_base,
+                             int32_t event_id,
+                             void *event_data)
+{
+    network_event_t event = {
+        .family = AF_UNSPEC,
+        .reason = 0,
+    };
+    int idx = -1;
+
+    // Link events
 #if CONFIG_WIFI_STA_CONNECT
-    esp_ret = wifi_sta_stop();
-#elif CONFIG_ETHERNET_QEMU_CONNECT
-    esp_ret = eth_qemu_stop();
-#else
-    esp_ret = ESP_FAIL;
+    if (event_base == WIFI_EVENT) {
+        if (event_id == WIFI_EVENT_STA_CONNECTED) {
+            event.type = NETWORK_EVENT_LINK_UP;
+            idx = IFACE_WIFI;
+        } else if (event_id == WIFI_EVENT_STA_DISCONNECTED) {
+            event.type = NETWORK_EVENT_LINK_DOWN;
+            event.reason = ((wifi_event_sta_disconnected_t *)event_data)->reason;
+            idx = IFACE_WIFI;
+        }
+    }
+#endif
+#if CONFIG_ETHERNET_QEMU_CONNECT
+    if (event_base == ETH_EVENT) {
+        if (event_id == ETHERNET_EVENT_CONNECTED) {
+            event.type = NETWORK_EVENT_LINK_UP;
+            idx = IFACE_ETH;
+        } else if (event_id == ETHERNET_EVENT_DISCONNECTED) {
+            event.type = NETWORK_EVENT_LINK_DOWN;
+            idx = IFACE_ETH;
+        }
+    }
+#endif
+
+    // IP events (matched to the interface by their esp_netif)
+    if (event_base == IP_EVENT) {
+        if ((event_id == IP_EVENT_STA_GOT_IP) || 
+            (event_id == IP_EVENT_ETH_GOT_IP)) {
+            event.type = NETWORK_EVENT_IP_ACQUIRED;
+            event.family = AF_INET;
+            idx = iface_from_netif(((ip_event_got_ip_t *)event_data)->esp_netif);
+        } else if (event_id == IP_EVENT_GOT_IP6) {
+            event.type = NETWORK_EVENT_IP_ACQUIRED;
+            event.family = AF_INET6;
+            idx = iface_from_netif(
+                ((ip_event_got_ip6_t *)event_data)->esp_netif);
+        } else if ((event_id == IP_EVENT_STA_LOST_IP) || 
+                   (event_id == IP_EVENT_ETH_LOST_IP)) {
+            event.type = NETWORK_EVENT_IP_LOST;
+            idx = iface_from_netif(((ip_event_got_ip_t *)event_data)->esp_netif);
+        }
+    }
+
+    // Simulated interface: link up comes with its address
+#if CONFIG_NETWORK_WRAPPER_SIM_IFACE
+    if (event_base == NETWORK_SIM_EVENT) {
+        idx = IFACE_SIM;
+        if (event_id == NETWORK_SIM_EVENT_LINK_UP) {
+            event.type = NETWORK_EVENT_LINK_UP;
+            iface_event(idx, &event);
+            event.type = NETWORK_EVENT_IP_ACQUIRED;
+            event.family = AF_INET;
+        } else {
+            event.type = NETWORK_EVENT_LINK_DOWN;
+        }
+    }
 #endif
 
+    if (idx < 0) {
+        return;
+    }
+    iface_event(idx, &event);
+}
+
+// Listen to the drivers' link and IP events (once, survives reconnects)
+static esp_err_t register_handlers(void)
+{
+    esp_event_base_t bases[] = {
+        IP_EVENT,
+#if CONFIG_WIFI_STA_CONNECT
+        WIFI_EVENT,
+#endif
+#if CONFIG_ETHERNET_QEMU_CONNECT
+        ETH_EVENT,
+#endif
+#if CONFIG_NETWORK_WRAPPER_SIM_IFACE
+        NETWORK_SIM_EVENT,
+#endif
+    };
+    const int num_bases = sizeof(bases) / sizeof(bases[0]);
+    esp_err_t esp_ret;
+
+    if (s_handlers_registered) {
+        return ESP_OK;
+    }
+
+    // Register every event base, undo on failure
+    for (int i = 0; i < num_bases; i++) {
+        esp_ret = esp_event_handler_register(bases[i],
+                                             ESP_EVENT_ANY_ID,
+                                             &on_network_event,
+                                             NULL);
+        if (esp_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error (%d): Failed to register %s event handler", 
+                     esp_ret,
+                     bases[i]);
+            while (--i >= 0) {
+                esp_event_handler_unregister(bases[i], 
+                                             ESP_EVENT_ANY_ID, 
+                                             &on_network_event);
+            }
+            return esp_ret;
+        }
+    }
+    s_handlers_registered = true;
+
+    return ESP_OK;
+}
+
+// Register a callback or queue and replay the current state to it
+static esp_err_t add_subscriber(network_event_cb_t cb,
+                                void *arg,
+                                QueueHandle_t queue,
+                                network_subscriber_handle_t *handle)
+{
+    struct network_subscriber *sub = NULL;
+    network_event_t event = {
+        .family = AF_UNSPEC,
+        .reason = 0,
+        .reconnecting = false,
+        .timestamp_us = esp_timer_get_time(),
+    };
+    iface_state_t ifaces[NUM_IFACES];
+    int active;
+    esp_err_t esp_ret;
+
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Find a free slot
+    esp_ret = subscribers_lock();
+    if (esp_ret != ESP_OK) {
+        return esp_ret;
+    }
+    for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (!s_subscribers[i].used) {
+            sub = &s_subscribers[i];
+            break;
+        }
+    }
+    if (sub == NULL) {
+        xSemaphoreGive(s_subscribers_mutex);
+        ESP_LOGE(TAG, "No free subscriber slots");
+        return ESP_ERR_NO_MEM;
+    }
+    sub->used = true;
+    sub->cb = cb;
+    sub->arg = arg;
+    sub->queue = queue;
+
+    // Replay the current state (holding the mutex keeps the order intact)
+    taskENTER_CRITICAL(&s_state_lock);
+    memcpy(ifaces, s_ifaces, sizeof(ifaces));
+    active = s_active;
+    taskEXIT_CRITICAL(&s_state_lock);
+    for (int i = 0; i < NUM_IFACES; i++) {
+        if (!ifaces[i].link_up) {
+            continue;
+        }
+        event.iface = s_drivers[i].name;
+        event.type = NETWORK_EVENT_LINK_UP;
+        event.family = AF_UNSPEC;
+        deliver(sub, &event);
+        event.type = NETWORK_EVENT_IP_ACQUIRED;
+        if (ifaces[i].ipv4) {
+            event.family = AF_INET;
+            deliver(sub, &event);
+        }
+        if (ifaces[i].ipv6) {
+            event.family = AF_INET6;
+            deliver(sub, &event);
+        }
+    }
+    if (active >= 0) {
+        event.type = NETWORK_EVENT_ROUTE_CHANGED;
+        event.iface = s_drivers[active].name;
+        event.family = AF_UNSPEC;
+        deliver(sub, &event);
+    }
+    xSemaphoreGive(s_subscribers_mutex);
+
+    *handle = sub;
+
+    return ESP_OK;
+}
+
+// Add one driver's reconnection statistics to a total
+static void merge_stats(reconnect_stats_t *total,
+                        const reconnect_stats_t *stats)
+{
+    total->outages += stats->outages;
+    total->reconnects += stats->reconnects;
+    total->attempts += stats->attempts;
+    for (int i = 0; i < RECONNECT_CAUSE_MAX; i++) {
+        total->causes[i] += stats->causes[i];
+    }
+
+    // Soonest pending retry
+    if ((stats->next_delay_ms != 0) && 
+        ((total->next_delay_ms == 0) || 
+         (stats->next_delay_ms < total->next_delay_ms))) {
+        total->next_delay_ms = stats->next_delay_ms;
+    }
+    if (stats->last_ttr_ms != 0) {
+        total->last_ttr_ms = stats->last_ttr_ms;
+    }
+    if (stats->min_ttr_ms < total->min_ttr_ms) {
+        total->min_ttr_ms = stats->min_ttr_ms;
+    }
+    if (stats->max_ttr_ms > total->max_ttr_ms) {
+        total->max_ttr_ms = stats->max_ttr_ms;
+    }
+    total->sum_ttr_ms += stats->sum_ttr_ms;
+}
+
+// Task: measure each interface's gateway RTT and keep the route on the best
+static void monitor_task(void *arg)
+{
+    esp_netif_t *netif;
+    uint32_t rtt_ms = RTT_UNKNOWN;
+    bool up;
+    esp_err_t esp_ret;
+
+    while (1) {
+        for (int i = 0; i < NUM_IFACES; i++) {
+
+            // Only probe usable interfaces
+            taskENTER_CRITICAL(&s_state_lock);
+            up = iface_up(&s_ifaces[i]);
+            taskEXIT_CRITICAL(&s_state_lock);
+            netif = s_drivers[i].get_netif();
+            if (!up || (netif == NULL)) {
+                continue;
+            }
+
+            // Probe the gateway
+            esp_ret = s_drivers[i].probe(netif, &rtt_ms);
+            if (esp_ret == ESP_ERR_NOT_FOUND) {
+                continue;
+            }
+
+            // Skip results of an interface that went down meanwhile
+            taskENTER_CRITICAL(&s_state_lock);
+            if (iface_up(&s_ifaces[i])) {
+                if (esp_ret == ESP_OK) {
+                    s_ifaces[i].healthy = true;
+                    s_ifaces[i].rtt_ms = rtt_ms;
+                } else {
+                    s_ifaces[i].healthy = false;
+                    s_ifaces[i].probe_failures++;
+                }
+            }
+            taskEXIT_CRITICAL(&s_state_lock);
+            if (esp_ret == ESP_OK) {
+                ESP_LOGD(TAG, "%s: gateway RTT %lu ms", 
+                         s_drivers[i].name, 
+                         rtt_ms);
+            } else {
+                ESP_LOGW(TAG, "%s: gateway did not answer", s_drivers[i].name);
+            }
+
+            // Fail over right after a bad probe, not at the end of the round
+            select_route();
+        }
+
+        // Wait for the next round, or for an interface to get an address
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PROBE_INTERVAL_MS));
+    }
+}
+
+// Initialize NVS, the TCP/IP stack, and the default event loop
+static esp_err_t start_system(void)
+{
+    esp_err_t esp_ret;
+
+    // WiFi keeps its calibration and settings in NVS
+    esp_ret = nvs_flash_init();
+    if ((esp_ret == ESP_ERR_NVS_NO_FREE_PAGES) ||
+        (esp_ret == ESP_ERR_NVS_NEW_VERSION_FOUND)) {
+        esp_ret = nvs_flash_erase();
+        if (esp_ret == ESP_OK) {
+            esp_ret = nvs_flash_init();
+        }
+    }
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Could not initialize NVS", esp_ret);
+        return esp_ret;
+    }
+
+    // TCP/IP stack
+    esp_ret = esp_netif_init();
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to initialize network interface", 
+                 esp_ret);
+        return esp_ret;
+    }
+
+    // Default event loop (keep the application's if it made one)
+    esp_ret = esp_event_loop_create_default();
+    if (esp_ret == ESP_ERR_INVALID_STATE) {
+        esp_ret = ESP_OK;
+    }
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to create default event loop", 
+                 esp_ret);
+        return esp_ret;
+    }
+
+    return ESP_OK;
+}
+
+// Task: bring up the network once, then exit
+static void start_task(void *arg)
+{
+    EventGroupHandle_t event_group = (EventGroupHandle_t)arg;
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t esp_ret;
+
+    // Without these there is no network at all
+    esp_ret = start_system();
+
+    // A driver that fails to start can still be brought up later with
+    // network_reconnect(), and the others keep working
+    if (esp_ret == ESP_OK) {
+        if (network_init(event_group) != ESP_OK) {
+            ESP_LOGW(TAG, "No network driver started");
+        }
+        ESP_LOGI(TAG, "Network started in background in %lld ms", 
+                 (esp_timer_get_time() - start_us) / 1000);
+    }
+
+    // Wake everyone waiting in network_wait_ready()
+    s_start_ret = esp_ret;
+    xEventGroupSetBits(s_start_group, START_DONE_BIT);
+    vTaskDelete(NULL);
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Wrapper for network driver initialization
+esp_err_t network_init(EventGroupHandle_t event_group)
+{
+    esp_err_t esp_ret = ESP_OK;
+    esp_err_t drv_ret;
+    BaseType_t task_ret;
+    int started = 0;
+
+    // Serializes route changes from the event loop and the monitor task
+    if (s_route_mutex == NULL) {
+        s_route_mutex = xSemaphoreCreateMutex();
+        if (s_route_mutex == NULL) {
+            ESP_LOGE(TAG, "Failed to create route mutex");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // Gateway probes can come from the monitor task and from the application
+    if (s_ping_mutex == NULL) {
+        s_ping_ctx.done = xSemaphoreCreateBinary();
+        s_ping_mutex = xSemaphoreCreateMutex();
+        if ((s_ping_ctx.done == NULL) || (s_ping_mutex == NULL)) {
+            ESP_LOGE(TAG, "Failed to create ping semaphores");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    s_event_group = event_group;
+
+    // Start translating driver events for subscribers
+    drv_ret = register_handlers();
+    if (drv_ret != ESP_OK) {
+        return drv_ret;
+    }
+
+    // Bring up every driver, each with its own event bits. Keep going if one
+    // fails so the others can still carry traffic.
+    for (int i = 0; i < NUM_IFACES; i++) {
+        if (s_ifaces[i].event_group == NULL) {
+            s_ifaces[i].event_group = xEventGroupCreate();
+            if (s_ifaces[i].event_group == NULL) {
+                ESP_LOGE(TAG, "Failed to create %s event group", 
+                         s_drivers[i].name);
+                return ESP_ERR_NO_MEM;
+            }
+            taskENTER_CRITICAL(&s_state_lock);
+            iface_reset(&s_ifaces[i]);
+            taskEXIT_CRITICAL(&s_state_lock);
+        }
+        drv_ret = s_drivers[i].init(s_ifaces[i].event_group);
+        if (drv_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error (%d): Failed to initialize %s", 
+                     drv_ret, 
+                     s_drivers[i].name);
+            if (esp_ret == ESP_OK) {
+                esp_ret = drv_ret;
+            }
+            continue;
+        }
+        started++;
+    }
+
+    // Compare gateway RTTs when there is more than one way out
+    if ((NUM_IFACES > 1) && (s_monitor_task == NULL)) {
+        task_ret = xTaskCreate(monitor_task,
+                               "net_monitor",
+                               MONITOR_STACK_SIZE,
+                               NULL,
+                               MONITOR_PRIORITY,
+                               &s_monitor_task);
+        if (task_ret != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create monitor task");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // One working driver is enough: the others can be brought up later with
+    // network_reconnect()
+    if (started == 0) {
+        ESP_LOGE(TAG, "No network driver started");
+        return esp_ret;
+    }
+    if (esp_ret != ESP_OK) {
+        ESP_LOGW(TAG, "Started %d of %d network drivers", started, NUM_IFACES);
+    }
+
+    return ESP_OK;
+}
+
+// Bring up the network in the background
+esp_err_t network_start(EventGroupHandle_t event_group)
+{
+    BaseType_t task_ret;
+
+    if (event_group == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_start_group != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Lets any number of tasks wait for the bring-up to finish
+    s_start_group = xEventGroupCreate();
+    if (s_start_group == NULL) {
+        ESP_LOGE(TAG, "Failed to create start event group");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Run the slow steps (NVS, driver init, association) off the caller
+    task_ret = xTaskCreate(start_task,
+                           "net_start",
+                           START_STACK_SIZE,
+                           event_group,
+                           START_PRIORITY,
+                           NULL);
+    if (task_ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create start task");
+        vEventGroupDelete(s_start_group);
+        s_start_group = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+// Wait until the network is usable
+esp_err_t network_wait_ready(uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    TickType_t elapsed;
+    EventBits_t bits;
+
+    // Wait for the background bring-up first
+    if (s_start_group != NULL) {
+        bits = xEventGroupWaitBits(s_start_group,
+                                   START_DONE_BIT,
+                                   pdFALSE,
+                                   pdTRUE,
+                                   timeout);
+        if (!(bits & START_DONE_BIT)) {
+            return ESP_ERR_TIMEOUT;
+        }
+        if (s_start_ret != ESP_OK) {
+            return s_start_ret;
+        }
+    }
+    if (s_event_group == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Then for an address on the interface that carries the route
+    elapsed = xTaskGetTickCount() - start;
+    xEventGroupWaitBits(s_event_group,
+                        NETWORK_IPV4_OBTAINED_BIT | NETWORK_IPV6_OBTAINED_BIT,
+                        pdFALSE,
+                        pdFALSE,
+                        (elapsed < timeout) ? (timeout - elapsed) : 0);
+
+    return network_is_up() ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+// Wrapper for network driver deinitialization
+esp_err_t network_stop(void)
+{
+    esp_err_t esp_ret = ESP_OK;
+    esp_err_t drv_ret;
+
+    // Stop every driver
+    for (int i = 0; i < NUM_IFACES; i++) {
+        drv_ret = s_drivers[i].stop();
+        if (drv_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error (%d): Failed to stop %s", 
+                     drv_ret, 
+                     s_drivers[i].name);
+            if (esp_ret == ESP_OK) {
+                esp_ret = drv_ret;
+            }
+        }
+    }
+
+    // Drivers don't always report the link going down when stopped
+    if (s_route_mutex != NULL) {
+        taskENTER_CRITICAL(&s_state_lock);
+        for (int i = 0; i < NUM_IFACES; i++) {
+            iface_reset(&s_ifaces[i]);
+        }
+        taskEXIT_CRITICAL(&s_state_lock);
+        select_route();
+    }
+
     return esp_ret;
 }
 
 // Wrapper for network driver reconnection
 esp_err_t network_reconnect(void)
 {
-    esp_err_t esp_ret;
+    esp_err_t esp_ret = ESP_OK;
+    esp_err_t drv_ret;
+    bool up;
 
-    // Reconnect network driver
-#if CONFIG_WIFI_STA_CONNECT
-    esp_ret = wifi_sta_reconnect();
-#elif CONFIG_ETHERNET_QEMU_CONNECT
-    esp_ret = eth_qemu_reconnect();
-#else
-    esp_ret = ESP_FAIL;
-#endif
+    // Reconnect the drivers that are down
+    for (int i = 0; i < NUM_IFACES; i++) {
+        taskENTER_CRITICAL(&s_state_lock);
+        up = iface_up(&s_ifaces[i]);
+        taskEXIT_CRITICAL(&s_state_lock);
+        if (up) {
+            continue;
+        }
+        drv_ret = s_drivers[i].reconnect();
+        if (drv_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error (%d): Failed to reconnect %s", 
+                     drv_ret, 
+                     s_drivers[i].name);
+            if (esp_ret == ESP_OK) {
+                esp_ret = drv_ret;
+            }
+        }
+    }
+
+    return esp_ret;
+}
+
+// Wrapper for the drivers' reconnection statistics
+esp_err_t network_get_reconnect_stats(reconnect_stats_t *stats)
+{
+    reconnect_stats_t drv_stats;
+    esp_err_t esp_ret = ESP_ERR_NOT_SUPPORTED;
+
+    // Add up the drivers that keep statistics
+    for (int i = 0; i < NUM_IFACES; i++) {
+        if ((s_drivers[i].get_reconnect_stats == NULL) || 
+            (s_drivers[i].get_reconnect_stats(&drv_stats) != ESP_OK)) {
+            continue;
+        }
+        if (esp_ret != ESP_OK) {
+            *stats = drv_stats;
+            esp_ret = ESP_OK;
+        } else {
+            merge_stats(stats, &drv_stats);
+        }
+    }
 
     return esp_ret;
 }
@@ -107,4 +1218,150 @@ bool wait_for_network(EventGroupHandle_t network_event_group,
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+// Call a function on every network state transition
+esp_err_t network_subscribe(network_event_cb_t cb, 
+                            void *arg, 
+                            network_subscriber_handle_t *handle)
+{
+    if (cb == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return add_subscriber(cb, arg, NULL, handle);
+}
+
+// Send every network state transition to a FreeRTOS queue
+esp_err_t network_subscribe_queue(QueueHandle_t queue, 
+                                  network_subscriber_handle_t *handle)
+{
+    if (queue == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return add_subscriber(NULL, NULL, queue, handle);
+}
+
+// Stop delivering events to a subscriber
+esp_err_t network_unsubscribe(network_subscriber_handle_t handle)
+{
+    esp_err_t esp_ret;
+
+    if ((handle == NULL) || 
+        (handle < &s_subscribers[0]) || 
+        (handle >= &s_subscribers[MAX_SUBSCRIBERS])) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_ret = subscribers_lock();
+    if (esp_ret != ESP_OK) {
+        return esp_ret;
+    }
+    memset(handle, 0, sizeof(*handle));
+    xSemaphoreGive(s_subscribers_mutex);
+
+    return ESP_OK;
+}
+
+// Check whether an interface with an IP address carries the route
+bool network_is_up(void)
+{
+    bool up;
+
+    taskENTER_CRITICAL(&s_state_lock);
+    up = (s_active >= 0) && iface_up(&s_ifaces[s_active]);
+    taskEXIT_CRITICAL(&s_state_lock);
+
+    return up;
+}
+
+// Get the name of the interface that carries the default route
+const char *network_get_active_interface(void)
+{
+    int active;
+
+    taskENTER_CRITICAL(&s_state_lock);
+    active = s_active;
+    taskEXIT_CRITICAL(&s_state_lock);
+
+    return (active >= 0) ? s_drivers[active].name : NULL;
+}
+
+// Measure the RTT to the gateway of the interface with the default route
+esp_err_t network_probe_gateway(uint32_t *rtt_ms)
+{
+    esp_netif_t *netif;
+    int active;
+
+    if (rtt_ms == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_ping_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    taskENTER_CRITICAL(&s_state_lock);
+    active = s_active;
+    taskEXIT_CRITICAL(&s_state_lock);
+    if (active < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    netif = s_drivers[active].get_netif();
+    if (netif == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return s_drivers[active].probe(netif, rtt_ms);
+}
+
+// Get the state of every enabled interface
+size_t network_get_interfaces(network_iface_info_t *info, size_t max_ifaces)
+{
+    size_t num = (max_ifaces < NUM_IFACES) ? max_ifaces : NUM_IFACES;
+
+    taskENTER_CRITICAL(&s_state_lock);
+    for (size_t i = 0; i < num; i++) {
+        info[i].name = s_drivers[i].name;
+        info[i].link_up = s_ifaces[i].link_up;
+        info[i].has_ip = s_ifaces[i].ipv4 || s_ifaces[i].ipv6;
+        info[i].healthy = s_ifaces[i].healthy;
+        info[i].is_default = ((int)i == s_active);
+        info[i].rtt_ms = s_ifaces[i].rtt_ms;
+        info[i].probe_failures = s_ifaces[i].probe_failures;
+    }
+    taskEXIT_CRITICAL(&s_state_lock);
+
+    return num;
+}
+
+// Get number of events dropped because a subscriber queue was full
+uint32_t network_get_dropped_events(void)
+{
+    uint32_t dropped;
+
+    taskENTER_CRITICAL(&s_state_lock);
+    dropped = s_dropped_events;
+    taskEXIT_CRITICAL(&s_state_lock);
+
+    return dropped;
+}
+
+// Get a printable name for an event type
+const char *network_event_name(network_event_type_t type)
+{
+    switch (type) {
+        case NETWORK_EVENT_LINK_UP:
+            return "LINK_UP";
+        case NETWORK_EVENT_LINK_DOWN:
+            return "LINK_DOWN";
+        case NETWORK_EVENT_IP_ACQUIRED:
+            return "IP_ACQUIRED";
+        case NETWORK_EVENT_IP_LOST:
+            return "IP_LOST";
+        case NETWORK_EVENT_ROUTE_CHANGED:
+            return "ROUTE_CHANGED";
+        default:
+            return "UNKNOWN";
+    }
+}
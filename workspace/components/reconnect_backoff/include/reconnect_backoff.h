@@ -0,0 +1,167 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef RECONNECT_BACKOFF_H
+#define RECONNECT_BACKOFF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Why the link went down (picks the retry strategy)
+ */
+typedef enum {
+    RECONNECT_CAUSE_LINK_LOST = 0,  // Link dropped (beacon timeout, cable)
+    RECONNECT_CAUSE_NOT_FOUND,      // Network not found (AP rebooting)
+    RECONNECT_CAUSE_AUTH,           // Credentials rejected
+    RECONNECT_CAUSE_MAX,
+} reconnect_cause_t;
+
+/**
+ * @brief Reconnection statistics
+ */
+typedef struct {
+    uint32_t outages;               // Disconnects from a working connection
+    uint32_t reconnects;            // Outages that ended with a connection
+    uint32_t attempts;              // Reconnect attempts started
+    uint32_t causes[RECONNECT_CAUSE_MAX];   // Disconnects by cause
+    uint32_t next_delay_ms;         // Delay of the pending retry (0 if none)
+    uint32_t last_ttr_ms;           // Time to reconnect of the last outage
+    uint32_t min_ttr_ms;            // Fastest reconnect
+    uint32_t max_ttr_ms;            // Slowest reconnect
+    uint64_t sum_ttr_ms;            // Sum of reconnect times (for the mean)
+} reconnect_stats_t;
+
+/**
+ * @brief Function that starts one reconnect attempt
+ *
+ * Runs in the esp_timer task, which is shared by every esp_timer callback
+ * and has a small stack: only start the attempt (e.g. esp_wifi_connect()),
+ * or hand heavier work such as a driver restart to a task of your own.
+ * Return an error if the attempt could not be started; a new one is
+ * scheduled with a longer delay.
+ *
+ * @param[in] arg User argument given to reconnect_backoff_init()
+ */
+typedef esp_err_t (*reconnect_fn_t)(void *arg);
+
+/**
+ * @brief Reconnect scheduler (fields are private)
+ */
+typedef struct {
+    const char *name;               // Shown in log messages
+    reconnect_fn_t fn;              // Starts an attempt
+    void *arg;                      // Argument for fn
+    esp_timer_handle_t timer;       // Fires the next attempt
+    portMUX_TYPE lock;
+    bool in_outage;                 // Waiting to get connected again
+    int64_t outage_start_us;        // When the outage started
+    uint32_t delay_ms;              // Last delay (decorrelated jitter state)
+    reconnect_cause_t cause;        // Cause of the last disconnect
+    reconnect_stats_t stats;
+} reconnect_backoff_t;
+
+/**
+ * @brief Set up a reconnect scheduler
+ *
+ * Calling it again on an initialized scheduler does nothing, so drivers can
+ * call it from their init function.
+ *
+ * @param[out] rb Scheduler to initialize
+ * @param[in] name Name for log messages and the timer
+ * @param[in] fn Function that starts a reconnect attempt
+ * @param[in] arg User argument passed to fn
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t reconnect_backoff_init(reconnect_backoff_t *rb,
+                                 const char *name,
+                                 reconnect_fn_t fn,
+                                 void *arg);
+
+/**
+ * @brief Report a disconnect and schedule the next attempt
+ *
+ * The delay is drawn with decorrelated jitter:
+ * delay = min(max, random(base, 3 * previous delay)), where base depends on
+ * the cause. The first retry after a link loss waits random(1, base) so the
+ * device comes back quickly but not in step with its neighbours.
+ *
+ * @param[in] rb Scheduler
+ * @param[in] cause Why the link went down
+ *
+ * @return Delay until the next attempt (ms)
+ */
+uint32_t reconnect_backoff_schedule(reconnect_backoff_t *rb,
+                                    reconnect_cause_t cause);
+
+/**
+ * @brief Schedule another attempt after one that failed to start
+ *
+ * Same as returning an error from the reconnect function, for drivers that
+ * run the attempt in their own task and only find out later that it failed.
+ *
+ * @param[in] rb Scheduler
+ *
+ * @return Delay until the next attempt (ms)
+ */
+uint32_t reconnect_backoff_retry(reconnect_backoff_t *rb);
+
+/**
+ * @brief Report that the connection works again (e.g. got an IP address)
+ *
+ * Ends the outage, records its duration, and resets the backoff.
+ *
+ * @param[in] rb Scheduler
+ */
+void reconnect_backoff_connected(reconnect_backoff_t *rb);
+
+/**
+ * @brief Cancel the pending attempt (e.g. the driver is being stopped)
+ *
+ * The outage stays open, so a later reconnect is still measured from the
+ * original disconnect.
+ *
+ * @param[in] rb Scheduler
+ */
+void reconnect_backoff_cancel(reconnect_backoff_t *rb);
+
+/**
+ * @brief Check whether an attempt is scheduled
+ *
+ * Lets a driver ignore manual reconnect requests while the scheduler is
+ * already handling an outage.
+ *
+ * @param[in] rb Scheduler
+ *
+ * @return true if a reconnect attempt is waiting to run
+ */
+bool reconnect_backoff_pending(reconnect_backoff_t *rb);
+
+/**
+ * @brief Get reconnection statistics
+ *
+ * @param[in] rb Scheduler
+ * @param[out] stats Statistics since init
+ */
+void reconnect_backoff_get_stats(reconnect_backoff_t *rb,
+                                 reconnect_stats_t *stats);
+
+/**
+ * @brief Get a printable name for a disconnect cause
+ *
+ * @param[in] cause Disconnect cause
+ *
+ * @return Name of the cause (e.g. "auth")
+ */
+const char *reconnect_cause_name(reconnect_cause_t cause);
+
+#endif // RECONNECT_BACKOFF_H
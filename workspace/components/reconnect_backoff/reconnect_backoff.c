@@ -0,0 +1,291 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Reconnect scheduler with exponential backoff and decorrelated jitter.
+ *
+ * Retrying on a fixed interval makes every device that lost the same access
+ * point retry at the same moment, again and again. Here each retry waits a
+ * random delay between the base and three times the previous delay, capped
+ * at a maximum (the "decorrelated jitter" scheme), so the retries of a fleet
+ * spread out while the expected delay still grows exponentially. The base
+ * delay depends on why the link went down: a dropped link is retried
+ * quickly, a rejected password slowly.
+ */
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_random.h"
+
+#include "reconnect_backoff.h"
+
+// Settings
+#define MAX_DELAY_MS        CONFIG_RECONNECT_BACKOFF_MAX_MS
+
+// Tag for debug messages
+static const char *TAG = "reconnect_backoff";
+
+// Base delay for each cause
+static const uint32_t s_base_ms[RECONNECT_CAUSE_MAX] = {
+    [RECONNECT_CAUSE_LINK_LOST] = CONFIG_RECONNECT_BACKOFF_BASE_MS,
+    [RECONNECT_CAUSE_NOT_FOUND] = CONFIG_RECONNECT_BACKOFF_NOT_FOUND_BASE_MS,
+    [RECONNECT_CAUSE_AUTH] = CONFIG_RECONNECT_BACKOFF_AUTH_BASE_MS,
+};
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static uint32_t random_between(uint32_t lo, uint32_t hi);
+static uint32_t arm(reconnect_backoff_t *rb, reconnect_cause_t cause);
+static void on_timer(void *arg);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Uniform random number in [lo, hi]
+static uint32_t random_between(uint32_t lo, uint32_t hi)
+{
+    if (hi <= lo) {
+        return lo;
+    }
+
+    return lo + (uint32_t)(((uint64_t)esp_random() * (hi - lo + 1)) >> 32);
+}
+
+// Draw the next delay and start the timer
+static uint32_t arm(reconnect_backoff_t *rb, reconnect_cause_t cause)
+{
+    uint32_t base_ms = s_base_ms[cause];
+    uint32_t hi_ms;
+    uint32_t delay_ms;
+    esp_err_t esp_ret;
+
+    taskENTER_CRITICAL(&rb->lock);
+
+    // First retry after losing a working link: random(1, base)
+    if (!rb->in_outage) {
+        rb->in_outage = true;
+        rb->outage_start_us = esp_timer_get_time();
+        rb->stats.outages++;
+        delay_ms = (cause == RECONNECT_CAUSE_LINK_LOST) ?
+                   random_between(1, base_ms) :
+                   random_between(base_ms, 3 * base_ms);
+
+    // Later retries: random(base, 3 * previous), capped
+    } else {
+        hi_ms = (rb->delay_ms > MAX_DELAY_MS / 3) ?
+                MAX_DELAY_MS :
+                3 * rb->delay_ms;
+        if (hi_ms < base_ms) {
+            hi_ms = base_ms;
+        }
+        delay_ms = random_between(base_ms, hi_ms);
+    }
+    if (delay_ms > MAX_DELAY_MS) {
+        delay_ms = MAX_DELAY_MS;
+    }
+
+    // Remember at least the base so the next draw grows from there
+    rb->delay_ms = (delay_ms < base_ms) ? base_ms : delay_ms;
+    rb->cause = cause;
+    rb->stats.next_delay_ms = delay_ms;
+    taskEXIT_CRITICAL(&rb->lock);
+
+    // Replace any pending attempt
+    esp_timer_stop(rb->timer);
+    esp_ret = esp_timer_start_once(rb->timer, (uint64_t)delay_ms * 1000);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to start reconnect timer", esp_ret);
+        return 0;
+    }
+
+    return delay_ms;
+}
+
+// Timer callback: start a reconnect attempt
+static void on_timer(void *arg)
+{
+    reconnect_backoff_t *rb = (reconnect_backoff_t *)arg;
+    esp_err_t esp_ret;
+    uint32_t delay_ms;
+
+    taskENTER_CRITICAL(&rb->lock);
+    rb->stats.attempts++;
+    rb->stats.next_delay_ms = 0;
+    taskEXIT_CRITICAL(&rb->lock);
+
+    // If the attempt can't even start, back off and try again
+    esp_ret = rb->fn(rb->arg);
+    if (esp_ret != ESP_OK) {
+        delay_ms = reconnect_backoff_retry(rb);
+        ESP_LOGW(TAG,
+                 "Error (%d): %s reconnect attempt failed, retrying in %lu ms",
+                 esp_ret,
+                 rb->name,
+                 delay_ms);
+    }
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Set up a reconnect scheduler
+esp_err_t reconnect_backoff_init(reconnect_backoff_t *rb,
+                                 const char *name,
+                                 reconnect_fn_t fn,
+                                 void *arg)
+{
+    esp_err_t esp_ret;
+
+    // Already set up (driver restarted)
+    if (rb->timer != NULL) {
+        return ESP_OK;
+    }
+
+    memset(rb, 0, sizeof(*rb));
+    rb->name = name;
+    rb->fn = fn;
+    rb->arg = arg;
+    portMUX_INITIALIZE(&rb->lock);
+    rb->stats.min_ttr_ms = UINT32_MAX;
+
+    // One-shot timer that fires each attempt
+    const esp_timer_create_args_t timer_args = {
+        .callback = on_timer,
+        .arg = rb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = name,
+    };
+    esp_ret = esp_timer_create(&timer_args, &rb->timer);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to create reconnect timer", esp_ret);
+        rb->timer = NULL;
+        return esp_ret;
+    }
+
+    return ESP_OK;
+}
+
+// Report a disconnect and schedule the next attempt
+uint32_t reconnect_backoff_schedule(reconnect_backoff_t *rb,
+                                    reconnect_cause_t cause)
+{
+    uint32_t delay_ms;
+
+    if (rb->timer == NULL) {
+        return 0;
+    }
+    if ((unsigned)cause >= RECONNECT_CAUSE_MAX) {
+        cause = RECONNECT_CAUSE_LINK_LOST;
+    }
+
+    taskENTER_CRITICAL(&rb->lock);
+    rb->stats.causes[cause]++;
+    taskEXIT_CRITICAL(&rb->lock);
+
+    delay_ms = arm(rb, cause);
+    ESP_LOGI(TAG, "%s: %s, reconnecting in %lu ms",
+             rb->name,
+             reconnect_cause_name(cause),
+             delay_ms);
+
+    return delay_ms;
+}
+
+// Schedule another attempt after one that failed to start
+uint32_t reconnect_backoff_retry(reconnect_backoff_t *rb)
+{
+    if (rb->timer == NULL) {
+        return 0;
+    }
+
+    return arm(rb, rb->cause);
+}
+
+// Report that the connection works again
+void reconnect_backoff_connected(reconnect_backoff_t *rb)
+{
+    uint32_t ttr_ms = 0;
+    bool was_out = false;
+
+    if (rb->timer == NULL) {
+        return;
+    }
+    esp_timer_stop(rb->timer);
+
+    taskENTER_CRITICAL(&rb->lock);
+    if (rb->in_outage) {
+        was_out = true;
+        ttr_ms = (uint32_t)((esp_timer_get_time() - rb->outage_start_us) / 1000);
+        rb->stats.reconnects++;
+        rb->stats.last_ttr_ms = ttr_ms;
+        rb->stats.sum_ttr_ms += ttr_ms;
+        if (ttr_ms < rb->stats.min_ttr_ms) {
+            rb->stats.min_ttr_ms = ttr_ms;
+        }
+        if (ttr_ms > rb->stats.max_ttr_ms) {
+            rb->stats.max_ttr_ms = ttr_ms;
+        }
+    }
+    rb->in_outage = false;
+    rb->delay_ms = 0;
+    rb->stats.next_delay_ms = 0;
+    taskEXIT_CRITICAL(&rb->lock);
+
+    if (was_out) {
+        ESP_LOGI(TAG, "%s: reconnected after %lu ms", rb->name, ttr_ms);
+    }
+}
+
+// Cancel the pending attempt
+void reconnect_backoff_cancel(reconnect_backoff_t *rb)
+{
+    if (rb->timer == NULL) {
+        return;
+    }
+    esp_timer_stop(rb->timer);
+
+    taskENTER_CRITICAL(&rb->lock);
+    rb->stats.next_delay_ms = 0;
+    taskEXIT_CRITICAL(&rb->lock);
+}
+
+// Check whether an attempt is scheduled
+bool reconnect_backoff_pending(reconnect_backoff_t *rb)
+{
+    if (rb->timer == NULL) {
+        return false;
+    }
+
+    return esp_timer_is_active(rb->timer);
+}
+
+// Get reconnection statistics
+void reconnect_backoff_get_stats(reconnect_backoff_t *rb,
+                                 reconnect_stats_t *stats)
+{
+    taskENTER_CRITICAL(&rb->lock);
+    memcpy(stats, &rb->stats, sizeof(*stats));
+    taskEXIT_CRITICAL(&rb->lock);
+}
+
+// Get a printable name for a disconnect cause
+const char *reconnect_cause_name(reconnect_cause_t cause)
+{
+    switch (cause) {
+        case RECONNECT_CAUSE_LINK_LOST:
+            return "link lost";
+        case RECONNECT_CAUSE_NOT_FOUND:
+            return "network not found";
+        case RECONNECT_CAUSE_AUTH:
+            return "auth";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,187 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef REPORT_FILTER_H
+#define REPORT_FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_codec.h"
+
+/**
+ * @brief Largest number of channels per filter (set from
+ *        CONFIG_REPORT_FILTER_MAX_CHANNELS in ESP-IDF builds)
+ */
+#ifndef REPORT_FILTER_MAX_CHANNELS
+# define REPORT_FILTER_MAX_CHANNELS 4
+#endif
+
+/**
+ * @brief Key of the sequence number written in delta messages
+ */
+#define REPORT_FILTER_SEQ_KEY   "seq"
+
+/**
+ * @brief Suffix added to a channel's key for its delta field
+ */
+#define REPORT_FILTER_DELTA_SUFFIX  "_d"
+
+/**
+ * @brief Why a message should (or should not) be sent
+ */
+typedef enum {
+    REPORT_FILTER_SKIP = 0,     // Nothing worth sending
+    REPORT_FILTER_CHANGE,       // A value moved out of its deadband
+    REPORT_FILTER_HEARTBEAT,    // Nothing changed, but the max interval passed
+} report_filter_reason_t;
+
+/**
+ * @brief Channel settings
+ */
+typedef struct {
+    const char *key;            // Telemetry key (up to 24 characters, kept)
+    float deadband;             // Smallest change sent (0: any change)
+    float resolution;           // Delta step (0: always send the full value)
+} report_filter_channel_config_t;
+
+/**
+ * @brief One field of the message (internal state)
+ */
+typedef struct {
+    report_filter_channel_config_t config;
+    float value;                // Latest value
+    float reported;             // Value the receiver has
+    int32_t steps;              // Latest value in resolution steps
+    int32_t reported_steps;     // Value the receiver has, in steps
+    bool valid;                 // A value has been set
+    bool changed;               // Latest value is outside the deadband
+} report_filter_channel_t;
+
+/**
+ * @brief Counters
+ */
+typedef struct {
+    uint32_t checks;            // Calls to report_filter_check()
+    uint32_t suppressed;        // Checks that returned REPORT_FILTER_SKIP
+    uint32_t reports;           // Messages encoded (keyframes and deltas)
+    uint32_t heartbeats;        // Messages sent with nothing changed
+    uint32_t keyframes;         // Messages with every field's full value
+    uint32_t deltas;            // Messages with changed fields only
+} report_filter_stats_t;
+
+/**
+ * @brief Filter for one message's worth of fields (internal state; allocate
+ *        statically or on the heap)
+ */
+typedef struct {
+    report_filter_channel_t channels[REPORT_FILTER_MAX_CHANNELS];
+    uint8_t num_channels;
+    uint32_t heartbeat_us;      // Max time between messages (0: none)
+    uint16_t keyframe_every;    // Delta messages per keyframe (0: no deltas)
+    uint16_t seq;               // Delta messages since the last keyframe
+    int64_t last_report_us;     // When the last message was encoded
+    bool need_keyframe;         // Next message must be a keyframe
+    report_filter_stats_t stats;
+} report_filter_t;
+
+/**
+ * @brief Initialize a filter with no channels
+ *
+ * @param[out] filter Filter
+ * @param[in] heartbeat_us Send a message at least this often, even when
+ *            nothing changed (0 to only send changes)
+ * @param[in] keyframe_every Delta messages allowed between keyframes (0 to
+ *            always send full values)
+ */
+void report_filter_init(report_filter_t *filter, uint32_t heartbeat_us, uint16_t keyframe_every);
+
+/**
+ * @brief Add a channel (one field of the message)
+ *
+ * @param[in] filter Filter
+ * @param[in] config Channel settings (the key string must outlive the
+ *            filter)
+ * @param[out] channel Channel index, for report_filter_set()
+ *
+ * @return
+ *  - TELEMETRY_OK on success
+ *  - TELEMETRY_ERR_INVALID if the filter is full or a setting is out of
+ *    range
+ */
+telemetry_result_t report_filter_add_channel(report_filter_t *filter,
+                                             const report_filter_channel_config_t *config,
+                                             uint8_t *channel);
+
+/**
+ * @brief Set a channel's latest value
+ *
+ * The value is compared with the one the receiver last got: it counts as a
+ * change when it is at least the deadband away (and, for delta channels, at
+ * least one step away). NaN values are ignored.
+ *
+ * @param[in] filter Filter
+ * @param[in] channel Channel index
+ * @param[in] value Latest value
+ */
+void report_filter_set(report_filter_t *filter, uint8_t channel, float value);
+
+/**
+ * @brief Decide whether a message should be sent now
+ *
+ * @param[in] filter Filter
+ * @param[in] now_us Current time
+ *
+ * @return
+ *  - REPORT_FILTER_CHANGE if a value changed, or nothing has been sent yet
+ *  - REPORT_FILTER_HEARTBEAT if the heartbeat interval has passed
+ *  - REPORT_FILTER_SKIP otherwise (or if no channel has a value)
+ */
+report_filter_reason_t report_filter_check(report_filter_t *filter, int64_t now_us);
+
+/**
+ * @brief Write the message and treat its values as received
+ *
+ * A keyframe holds every channel's full value under its own key. It is sent
+ * first, on heartbeats, after keyframe_every deltas, and after
+ * report_filter_force_keyframe(). Otherwise only changed channels are
+ * written: delta channels as <key>_d, the change in resolution steps
+ * (integer), others as their full value. Delta messages also carry "seq",
+ * counting 1, 2, ... from the last keyframe, so a receiver can tell when
+ * one went missing. The receiver's value is keyframe + sum(deltas) *
+ * resolution, with the keyframe rounded to the resolution.
+ *
+ * Call once per report_filter_check() that did not return
+ * REPORT_FILTER_SKIP, and only if the message will be published (or
+ * queued): the filter assumes it arrives.
+ *
+ * @param[in] filter Filter
+ * @param[in] enc Encoder for the message (other fields may be added before
+ *            or after)
+ * @param[in] now_us Current time
+ */
+void report_filter_encode(report_filter_t *filter, telemetry_encoder_t *enc, int64_t now_us);
+
+/**
+ * @brief Make the next message a keyframe with every value
+ *
+ * Call when messages may have been lost (e.g. after a reconnect with QoS 0)
+ * so the receiver can start over. The next report_filter_check() returns
+ * REPORT_FILTER_CHANGE.
+ *
+ * @param[in] filter Filter
+ */
+void report_filter_force_keyframe(report_filter_t *filter);
+
+/**
+ * @brief Get the counters
+ *
+ * @param[in] filter Filter
+ * @param[out] stats Counters
+ */
+void report_filter_get_stats(const report_filter_t *filter, report_filter_stats_t *stats);
+
+#endif // REPORT_FILTER_H
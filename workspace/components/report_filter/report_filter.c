@@ -0,0 +1,243 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Report-by-exception filter for telemetry.
+ *
+ * Each channel remembers the value the receiver last got. A new value only
+ * triggers a message when it leaves the deadband around that value, and a
+ * heartbeat keyframe goes out when nothing has been sent for too long, so
+ * the receiver can tell a quiet sensor from a dead one. Slowly changing
+ * readings (room temperature, battery voltage) then cost a message every
+ * few minutes instead of every few seconds.
+ *
+ * Channels with a resolution are tracked in whole steps. Between keyframes
+ * they are sent as the change in steps, which is usually a one-byte CBOR
+ * integer (or one or two JSON digits) instead of a float. Tracking steps
+ * rather than floats means the device and the receiver add up exactly the
+ * same integers, so rounding never accumulates.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "report_filter.h"
+
+// Settings
+#define KEY_MAX_LEN     32      // Longest telemetry key built by the encoder
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static int32_t to_steps(float value, float resolution);
+static void update_changed(report_filter_channel_t *ch);
+static void mark_reported(report_filter_channel_t *ch);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Round a value to whole resolution steps (saturating)
+static int32_t to_steps(float value, float resolution)
+{
+    float steps = roundf(value / resolution);
+
+    if (steps >= 2147483520.0f) {
+        return INT32_MAX;
+    }
+    if (steps <= -2147483648.0f) {
+        return INT32_MIN;
+    }
+
+    return (int32_t)steps;
+}
+
+// Compare the latest value with the one the receiver has
+static void update_changed(report_filter_channel_t *ch)
+{
+    if (fabsf(ch->value - ch->reported) < ch->config.deadband) {
+        ch->changed = false;
+    } else if (ch->config.resolution > 0.0f) {
+        ch->changed = (ch->steps != ch->reported_steps);
+    } else {
+        ch->changed = (ch->value != ch->reported);
+    }
+}
+
+// The receiver now has the latest value
+static void mark_reported(report_filter_channel_t *ch)
+{
+    if (ch->config.resolution > 0.0f) {
+        ch->reported_steps = ch->steps;
+        ch->reported = (float)ch->steps * ch->config.resolution;
+    } else {
+        ch->reported = ch->value;
+    }
+    ch->changed = false;
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Initialize a filter with no channels
+void report_filter_init(report_filter_t *filter, uint32_t heartbeat_us, uint16_t keyframe_every)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->heartbeat_us = heartbeat_us;
+    filter->keyframe_every = keyframe_every;
+    filter->need_keyframe = true;
+}
+
+// Add a channel
+telemetry_result_t report_filter_add_channel(report_filter_t *filter,
+                                             const report_filter_channel_config_t *config,
+                                             uint8_t *channel)
+{
+    report_filter_channel_t *ch;
+
+    // Check parameters
+    if ((filter->num_channels >= REPORT_FILTER_MAX_CHANNELS) ||
+        (config->key == NULL) ||
+        !(config->deadband >= 0.0f) ||
+        !(config->resolution >= 0.0f)) {
+        return TELEMETRY_ERR_INVALID;
+    }
+
+    ch = &filter->channels[filter->num_channels];
+    memset(ch, 0, sizeof(*ch));
+    ch->config = *config;
+    *channel = filter->num_channels++;
+
+    return TELEMETRY_OK;
+}
+
+// Set a channel's latest value
+void report_filter_set(report_filter_t *filter, uint8_t channel, float value)
+{
+    report_filter_channel_t *ch;
+
+    if ((channel >= filter->num_channels) || isnan(value)) {
+        return;
+    }
+    ch = &filter->channels[channel];
+
+    // A channel's first value has no base to send a delta from
+    if (!ch->valid) {
+        ch->valid = true;
+        filter->need_keyframe = true;
+    }
+
+    ch->value = value;
+    if (ch->config.resolution > 0.0f) {
+        ch->steps = to_steps(value, ch->config.resolution);
+    }
+    update_changed(ch);
+}
+
+// Decide whether a message should be sent now
+report_filter_reason_t report_filter_check(report_filter_t *filter, int64_t now_us)
+{
+    bool any_valid = false;
+
+    filter->stats.checks++;
+
+    for (uint8_t i = 0; i < filter->num_channels; i++) {
+        if (!filter->channels[i].valid) {
+            continue;
+        }
+        any_valid = true;
+        if (filter->channels[i].changed) {
+            return REPORT_FILTER_CHANGE;
+        }
+    }
+    if (any_valid && filter->need_keyframe) {
+        return REPORT_FILTER_CHANGE;
+    }
+    if (any_valid &&
+        (filter->heartbeat_us > 0) &&
+        ((now_us - filter->last_report_us) >= (int64_t)filter->heartbeat_us)) {
+        return REPORT_FILTER_HEARTBEAT;
+    }
+
+    filter->stats.suppressed++;
+
+    return REPORT_FILTER_SKIP;
+}
+
+// Write the message and treat its values as received
+void report_filter_encode(report_filter_t *filter, telemetry_encoder_t *enc, int64_t now_us)
+{
+    report_filter_channel_t *ch;
+    char key[KEY_MAX_LEN];
+    bool any_changed = false;
+    bool keyframe;
+
+    for (uint8_t i = 0; i < filter->num_channels; i++) {
+        if (filter->channels[i].valid && filter->channels[i].changed) {
+            any_changed = true;
+        }
+    }
+
+    // Heartbeats are keyframes, so a receiver that missed something catches up
+    if (!any_changed && !filter->need_keyframe) {
+        filter->stats.heartbeats++;
+    }
+    keyframe = filter->need_keyframe ||
+               !any_changed ||
+               (filter->keyframe_every == 0) ||
+               (filter->seq >= filter->keyframe_every);
+
+    if (keyframe) {
+        // Every value in full
+        for (uint8_t i = 0; i < filter->num_channels; i++) {
+            ch = &filter->channels[i];
+            if (!ch->valid) {
+                continue;
+            }
+            mark_reported(ch);
+            telemetry_encode_float(enc, ch->config.key, ch->reported);
+        }
+        filter->seq = 0;
+        filter->need_keyframe = false;
+        filter->stats.keyframes++;
+    } else {
+        // Changed values only, as steps where possible
+        filter->seq++;
+        telemetry_encode_int(enc, REPORT_FILTER_SEQ_KEY, filter->seq);
+        for (uint8_t i = 0; i < filter->num_channels; i++) {
+            ch = &filter->channels[i];
+            if (!ch->valid || !ch->changed) {
+                continue;
+            }
+            if (ch->config.resolution > 0.0f) {
+                snprintf(key, sizeof(key), "%s" REPORT_FILTER_DELTA_SUFFIX, ch->config.key);
+                telemetry_encode_int(enc, key, (int64_t)ch->steps - ch->reported_steps);
+                mark_reported(ch);
+            } else {
+                mark_reported(ch);
+                telemetry_encode_float(enc, ch->config.key, ch->reported);
+            }
+        }
+        filter->stats.deltas++;
+    }
+
+    filter->last_report_us = now_us;
+    filter->stats.reports++;
+}
+
+// Make the next message a keyframe with every value
+void report_filter_force_keyframe(report_filter_t *filter)
+{
+    filter->need_keyframe = true;
+}
+
+// Get the counters
+void report_filter_get_stats(const report_filter_t *filter, report_filter_stats_t *stats)
+{
+    *stats = filter->stats;
+}
@@ -0,0 +1,247 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef RESPONSE_SINK_H
+#define RESPONSE_SINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "mbedtls/sha256.h"
+#include "sdkconfig.h"
+
+/**
+ * @brief Content length passed to begin when the response does not give one
+ */
+#define RESPONSE_SINK_LENGTH_UNKNOWN    (-1)
+
+typedef struct response_sink response_sink_t;
+
+/**
+ * @brief Sink operations
+ *
+ * begin runs once the response headers are parsed, write runs for every body
+ * slice (the data points into the client's receive buffer and is only valid
+ * during the call), and end runs once the body is over or the transfer
+ * failed. An error from begin or write aborts the transfer.
+ */
+typedef struct {
+    const char *name;
+    esp_err_t (*begin)(response_sink_t *sink, int status, int64_t content_length);
+    esp_err_t (*write)(response_sink_t *sink, const uint8_t *data, size_t len);
+    esp_err_t (*end)(response_sink_t *sink, bool complete);
+} response_sink_ops_t;
+
+/**
+ * @brief Common sink state (first member of every sink)
+ */
+struct response_sink {
+    const response_sink_ops_t *ops;
+    uint64_t bytes;                 // Body bytes written since begin
+    int64_t begin_us;               // Time of begin
+    int64_t end_us;                 // Time of end
+};
+
+/**
+ * @brief Discard sink (counts the bytes only)
+ */
+typedef struct {
+    response_sink_t base;
+} response_sink_discard_t;
+
+/**
+ * @brief SHA-256 sink
+ */
+typedef struct {
+    response_sink_t base;
+    mbedtls_sha256_context ctx;
+    uint8_t digest[32];             // Valid after a complete end
+} response_sink_hash_t;
+
+/**
+ * @brief JSON value types reported by the JSON sink
+ */
+typedef enum {
+    RESPONSE_SINK_JSON_STRING = 0,
+    RESPONSE_SINK_JSON_NUMBER,
+    RESPONSE_SINK_JSON_BOOL,
+    RESPONSE_SINK_JSON_NULL,
+} response_sink_json_type_t;
+
+/**
+ * @brief Called for every scalar value in the document
+ *
+ * key is the member name in the enclosing object ("" inside an array or at
+ * the top level), value is the decoded string or the literal text (e.g.
+ * "12.5", "true"), and depth is the number of enclosing objects and arrays.
+ * Both strings are NUL-terminated and truncated to the token buffer size.
+ */
+typedef void (*response_sink_json_cb_t)(void *ctx,
+                                        const char *key,
+                                        const char *value,
+                                        response_sink_json_type_t type,
+                                        int depth);
+
+/**
+ * @brief JSON scanner state (internal)
+ */
+typedef enum {
+    RESPONSE_SINK_JSON_VALUE = 0,   // Expecting a value
+    RESPONSE_SINK_JSON_KEY_OR_END,  // After '{': key or '}'
+    RESPONSE_SINK_JSON_KEY_START,   // After ',' in an object: key
+    RESPONSE_SINK_JSON_COLON,       // After a key
+    RESPONSE_SINK_JSON_VALUE_OR_END,// After '[': value or ']'
+    RESPONSE_SINK_JSON_AFTER_VALUE, // Expecting ',' or a closing bracket
+    RESPONSE_SINK_JSON_IN_STRING,   // Inside a key or string value
+    RESPONSE_SINK_JSON_IN_ESCAPE,   // After '\' in a string
+    RESPONSE_SINK_JSON_IN_UNICODE,  // Inside "\uXXXX"
+    RESPONSE_SINK_JSON_IN_LITERAL,  // Inside a number, true, false, or null
+    RESPONSE_SINK_JSON_DONE,        // Top-level value complete
+    RESPONSE_SINK_JSON_ERROR,
+} response_sink_json_state_t;
+
+/**
+ * @brief Incremental JSON sink
+ *
+ * Scans the document one byte at a time, so keys, strings, and numbers may
+ * be split across any number of body slices. Nothing but the current key and
+ * value is buffered.
+ */
+typedef struct {
+    response_sink_t base;
+    response_sink_json_cb_t on_value;
+    void *ctx;
+    response_sink_json_state_t state;
+    bool in_key;                    // String being read is a member name
+    uint32_t containers;            // One bit per level: 1 = object, 0 = array
+    int depth;
+    uint16_t unicode;               // Code point being read from "\uXXXX"
+    uint8_t unicode_digits;
+    size_t key_len;
+    size_t value_len;
+    char key[CONFIG_RESPONSE_SINK_JSON_TOKEN_SIZE];
+    char value[CONFIG_RESPONSE_SINK_JSON_TOKEN_SIZE];
+    uint32_t values;                // Scalars reported
+    int max_depth;                  // Deepest nesting seen
+} response_sink_json_t;
+
+/**
+ * @brief Flash partition sink
+ *
+ * Writes the body to the start of a data partition. Sectors are erased just
+ * ahead of the data (all at once when the content length is known).
+ */
+typedef struct {
+    response_sink_t base;
+    const esp_partition_t *partition;
+    size_t erased;                  // Bytes from the start already erased
+} response_sink_flash_t;
+
+/**
+ * @brief Start a response on a sink
+ *
+ * @param[in] sink Sink
+ * @param[in] status HTTP status code
+ * @param[in] content_length Body length, or RESPONSE_SINK_LENGTH_UNKNOWN
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t response_sink_begin(response_sink_t *sink, int status, int64_t content_length);
+
+/**
+ * @brief Pass one body slice to a sink
+ *
+ * @param[in] sink Sink
+ * @param[in] data Body bytes (not copied)
+ * @param[in] len Number of bytes
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t response_sink_write(response_sink_t *sink, const uint8_t *data, size_t len);
+
+/**
+ * @brief End a response on a sink
+ *
+ * @param[in] sink Sink
+ * @param[in] complete true if the whole body was received
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t response_sink_end(response_sink_t *sink, bool complete);
+
+/**
+ * @brief Get a sink's throughput for the last response
+ *
+ * @param[in] sink Sink (after response_sink_end())
+ *
+ * @return Body bytes per second from begin to end (0 if no time passed)
+ */
+uint32_t response_sink_bytes_per_sec(const response_sink_t *sink);
+
+/**
+ * @brief Set up a discard sink
+ *
+ * @param[out] sink Sink to set up
+ *
+ * @return Generic sink handle
+ */
+response_sink_t *response_sink_discard_init(response_sink_discard_t *sink);
+
+/**
+ * @brief Set up a SHA-256 sink
+ *
+ * @param[out] sink Sink to set up
+ *
+ * @return Generic sink handle
+ */
+response_sink_t *response_sink_hash_init(response_sink_hash_t *sink);
+
+/**
+ * @brief Format a hash sink's digest as lowercase hex
+ *
+ * @param[in] sink Hash sink
+ * @param[out] buf Output buffer (at least 65 bytes)
+ * @param[in] len Size of the output buffer
+ */
+void response_sink_hash_hex(const response_sink_hash_t *sink, char *buf, size_t len);
+
+/**
+ * @brief Set up a JSON sink
+ *
+ * @param[out] sink Sink to set up
+ * @param[in] on_value Called for every scalar value (or NULL to only validate)
+ * @param[in] ctx Passed to on_value
+ *
+ * @return Generic sink handle
+ */
+response_sink_t *response_sink_json_init(response_sink_json_t *sink,
+                                         response_sink_json_cb_t on_value,
+                                         void *ctx);
+
+/**
+ * @brief Set up a flash partition sink
+ *
+ * @param[out] sink Sink to set up
+ * @param[in] label Label of a data partition in the partition table
+ * @param[out] handle Generic sink handle
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_NOT_FOUND if there is no data partition with that label
+ */
+esp_err_t response_sink_flash_init(response_sink_flash_t *sink,
+                                   const char *label,
+                                   response_sink_t **handle);
+
+#endif // RESPONSE_SINK_H
@@ -0,0 +1,292 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Response body sinks.
+ *
+ * A sink consumes a response body slice by slice, straight from the client's
+ * receive buffer, so the body never needs to fit in memory and is never
+ * copied or printed on the way. The generic wrappers count bytes and time
+ * each response so sinks can be compared on the same transfer.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "response_sink.h"
+
+// Tag for debug messages
+static const char *TAG = "response_sink";
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static esp_err_t discard_write(response_sink_t *sink, const uint8_t *data, size_t len);
+static esp_err_t hash_begin(response_sink_t *sink, int status, int64_t content_length);
+static esp_err_t hash_write(response_sink_t *sink, const uint8_t *data, size_t len);
+static esp_err_t hash_end(response_sink_t *sink, bool complete);
+static esp_err_t flash_erase_to(response_sink_flash_t *flash, size_t end);
+static esp_err_t flash_begin(response_sink_t *sink, int status, int64_t content_length);
+static esp_err_t flash_write(response_sink_t *sink, const uint8_t *data, size_t len);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Sink operation tables
+static const response_sink_ops_t s_discard_ops = {
+    .name = "discard",
+    .write = discard_write,
+};
+
+static const response_sink_ops_t s_hash_ops = {
+    .name = "sha256",
+    .begin = hash_begin,
+    .write = hash_write,
+    .end = hash_end,
+};
+
+static const response_sink_ops_t s_flash_ops = {
+    .name = "flash",
+    .begin = flash_begin,
+    .write = flash_write,
+};
+
+// Discard: nothing to do beyond the byte count kept by the wrapper
+static esp_err_t discard_write(response_sink_t *sink, const uint8_t *data, size_t len)
+{
+    return ESP_OK;
+}
+
+// Hash: start a new digest
+static esp_err_t hash_begin(response_sink_t *sink, int status, int64_t content_length)
+{
+    response_sink_hash_t *hash = (response_sink_hash_t *)sink;
+
+    mbedtls_sha256_free(&hash->ctx);
+    mbedtls_sha256_init(&hash->ctx);
+    memset(hash->digest, 0, sizeof(hash->digest));
+    if (mbedtls_sha256_starts(&hash->ctx, 0) != 0) {
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+// Hash: add a slice to the digest
+static esp_err_t hash_write(response_sink_t *sink, const uint8_t *data, size_t len)
+{
+    response_sink_hash_t *hash = (response_sink_hash_t *)sink;
+
+    if (mbedtls_sha256_update(&hash->ctx, data, len) != 0) {
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+// Hash: finish the digest (only a complete body has a meaningful one)
+static esp_err_t hash_end(response_sink_t *sink, bool complete)
+{
+    response_sink_hash_t *hash = (response_sink_hash_t *)sink;
+    esp_err_t esp_ret = ESP_OK;
+
+    if (complete && (mbedtls_sha256_finish(&hash->ctx, hash->digest) != 0)) {
+        esp_ret = ESP_FAIL;
+    }
+    mbedtls_sha256_free(&hash->ctx);
+
+    return esp_ret;
+}
+
+// Flash: erase whole sectors until [0, end) is erased
+static esp_err_t flash_erase_to(response_sink_flash_t *flash, size_t end)
+{
+    const esp_partition_t *part = flash->partition;
+    size_t size;
+    esp_err_t esp_ret;
+
+    if (end <= flash->erased) {
+        return ESP_OK;
+    }
+    if (end > part->size) {
+        ESP_LOGE(TAG, "Body does not fit in partition %s (%lu bytes)",
+                 part->label,
+                 (unsigned long)part->size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Round up to the erase size (partitions are aligned to it)
+    size = ((end - flash->erased + part->erase_size - 1) / part->erase_size) *
+           part->erase_size;
+    if (flash->erased + size > part->size) {
+        size = part->size - flash->erased;
+    }
+    esp_ret = esp_partition_erase_range(part, flash->erased, size);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to erase partition %s", esp_ret, part->label);
+        return esp_ret;
+    }
+    flash->erased += size;
+
+    return ESP_OK;
+}
+
+// Flash: erase everything up front when the length is known
+static esp_err_t flash_begin(response_sink_t *sink, int status, int64_t content_length)
+{
+    response_sink_flash_t *flash = (response_sink_flash_t *)sink;
+
+    flash->erased = 0;
+    if (content_length == RESPONSE_SINK_LENGTH_UNKNOWN) {
+        return ESP_OK;
+    }
+    if ((uint64_t)content_length > flash->partition->size) {
+        ESP_LOGE(TAG, "Body (%lld bytes) does not fit in partition %s",
+                 content_length,
+                 flash->partition->label);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    return flash_erase_to(flash, (size_t)content_length);
+}
+
+// Flash: write a slice after the previous one
+static esp_err_t flash_write(response_sink_t *sink, const uint8_t *data, size_t len)
+{
+    response_sink_flash_t *flash = (response_sink_flash_t *)sink;
+    size_t offset = (size_t)sink->bytes;
+    esp_err_t esp_ret;
+
+    esp_ret = flash_erase_to(flash, offset + len);
+    if (esp_ret != ESP_OK) {
+        return esp_ret;
+    }
+    esp_ret = esp_partition_write(flash->partition, offset, data, len);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to write partition %s",
+                 esp_ret,
+                 flash->partition->label);
+    }
+
+    return esp_ret;
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Start a response on a sink
+esp_err_t response_sink_begin(response_sink_t *sink, int status, int64_t content_length)
+{
+    sink->bytes = 0;
+    sink->begin_us = esp_timer_get_time();
+    sink->end_us = sink->begin_us;
+    if (sink->ops->begin == NULL) {
+        return ESP_OK;
+    }
+
+    return sink->ops->begin(sink, status, content_length);
+}
+
+// Pass one body slice to a sink
+esp_err_t response_sink_write(response_sink_t *sink, const uint8_t *data, size_t len)
+{
+    esp_err_t esp_ret;
+
+    if (len == 0) {
+        return ESP_OK;
+    }
+    esp_ret = sink->ops->write(sink, data, len);
+    if (esp_ret == ESP_OK) {
+        sink->bytes += len;
+    }
+
+    return esp_ret;
+}
+
+// End a response on a sink
+esp_err_t response_sink_end(response_sink_t *sink, bool complete)
+{
+    esp_err_t esp_ret = ESP_OK;
+
+    if (sink->ops->end != NULL) {
+        esp_ret = sink->ops->end(sink, complete);
+    }
+    sink->end_us = esp_timer_get_time();
+    ESP_LOGD(TAG, "%s: %llu bytes in %lld us",
+             sink->ops->name,
+             sink->bytes,
+             sink->end_us - sink->begin_us);
+
+    return esp_ret;
+}
+
+// Get a sink's throughput for the last response
+uint32_t response_sink_bytes_per_sec(const response_sink_t *sink)
+{
+    int64_t elapsed_us = sink->end_us - sink->begin_us;
+
+    if (elapsed_us <= 0) {
+        return 0;
+    }
+
+    return (uint32_t)((sink->bytes * 1000000ULL) / (uint64_t)elapsed_us);
+}
+
+// Set up a discard sink
+response_sink_t *response_sink_discard_init(response_sink_discard_t *sink)
+{
+    memset(sink, 0, sizeof(*sink));
+    sink->base.ops = &s_discard_ops;
+
+    return &sink->base;
+}
+
+// Set up a SHA-256 sink
+response_sink_t *response_sink_hash_init(response_sink_hash_t *sink)
+{
+    memset(sink, 0, sizeof(*sink));
+    sink->base.ops = &s_hash_ops;
+    mbedtls_sha256_init(&sink->ctx);
+
+    return &sink->base;
+}
+
+// Format a hash sink's digest as lowercase hex
+void response_sink_hash_hex(const response_sink_hash_t *sink, char *buf, size_t len)
+{
+    size_t pos = 0;
+
+    for (size_t i = 0; (i < sizeof(sink->digest)) && (pos + 3 <= len); i++) {
+        pos += snprintf(&buf[pos], len - pos, "%02x", sink->digest[i]);
+    }
+    if (len > 0) {
+        buf[(pos < len) ? pos : len - 1] = '\0';
+    }
+}
+
+// Set up a flash partition sink
+esp_err_t response_sink_flash_init(response_sink_flash_t *sink,
+                                   const char *label,
+                                   response_sink_t **handle)
+{
+    memset(sink, 0, sizeof(*sink));
+    sink->base.ops = &s_flash_ops;
+    sink->partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                               ESP_PARTITION_SUBTYPE_ANY,
+                                               label);
+    if (sink->partition == NULL) {
+        ESP_LOGE(TAG, "No data partition labeled %s", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+    *handle = &sink->base;
+
+    return ESP_OK;
+}
@@ -0,0 +1,422 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Incremental JSON sink.
+ *
+ * A byte-at-a-time JSON scanner: each slice is scanned where it lies, and the
+ * only state carried between slices is the current key, the current scalar,
+ * and one bit per nesting level. Every scalar is reported to the callback
+ * with the key it belongs to, so a caller can pick out the few fields it
+ * needs from a document of any size.
+ */
+
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "response_sink.h"
+
+// Settings
+#define MAX_DEPTH   CONFIG_RESPONSE_SINK_JSON_MAX_DEPTH
+
+// Tag for debug messages
+static const char *TAG = "response_sink_json";
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static esp_err_t json_begin(response_sink_t *sink, int status, int64_t content_length);
+static esp_err_t json_write(response_sink_t *sink, const uint8_t *data, size_t len);
+static esp_err_t json_end(response_sink_t *sink, bool complete);
+static void append(char *buf, size_t *len, char c);
+static void append_utf8(response_sink_json_t *json, uint16_t code);
+static bool is_space(char c);
+static bool is_literal(char c);
+static bool in_object(const response_sink_json_t *json);
+static void value_done(response_sink_json_t *json);
+static void report(response_sink_json_t *json, response_sink_json_type_t type);
+static bool finish_literal(response_sink_json_t *json);
+static bool open_container(response_sink_json_t *json, bool object);
+static bool close_container(response_sink_json_t *json, bool object);
+static bool scan(response_sink_json_t *json, char c);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Sink operation table
+static const response_sink_ops_t s_json_ops = {
+    .name = "json",
+    .begin = json_begin,
+    .write = json_write,
+    .end = json_end,
+};
+
+// Start scanning a new document
+static esp_err_t json_begin(response_sink_t *sink, int status, int64_t content_length)
+{
+    response_sink_json_t *json = (response_sink_json_t *)sink;
+
+    json->state = RESPONSE_SINK_JSON_VALUE;
+    json->in_key = false;
+    json->containers = 0;
+    json->depth = 0;
+    json->key_len = 0;
+    json->value_len = 0;
+    json->key[0] = '\0';
+    json->values = 0;
+    json->max_depth = 0;
+
+    return ESP_OK;
+}
+
+// Scan a slice
+static esp_err_t json_write(response_sink_t *sink, const uint8_t *data, size_t len)
+{
+    response_sink_json_t *json = (response_sink_json_t *)sink;
+
+    for (size_t i = 0; i < len; i++) {
+        if (!scan(json, (char)data[i])) {
+            ESP_LOGE(TAG, "Invalid JSON at byte %llu",
+                     (unsigned long long)(sink->bytes + i));
+            json->state = RESPONSE_SINK_JSON_ERROR;
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+
+    return ESP_OK;
+}
+
+// Check that a complete body held exactly one complete document
+static esp_err_t json_end(response_sink_t *sink, bool complete)
+{
+    response_sink_json_t *json = (response_sink_json_t *)sink;
+
+    if (!complete) {
+        return ESP_OK;
+    }
+
+    // A top-level number has no closing delimiter
+    if ((json->state == RESPONSE_SINK_JSON_IN_LITERAL) && (json->depth == 0)) {
+        if (!finish_literal(json)) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+    if (json->state != RESPONSE_SINK_JSON_DONE) {
+        ESP_LOGE(TAG, "JSON document is incomplete");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    return ESP_OK;
+}
+
+// Add a character to a token buffer (truncating)
+static void append(char *buf, size_t *len, char c)
+{
+    if (*len < CONFIG_RESPONSE_SINK_JSON_TOKEN_SIZE - 1) {
+        buf[(*len)++] = c;
+    }
+}
+
+// Add a "\uXXXX" code point to the current string as UTF-8
+static void append_utf8(response_sink_json_t *json, uint16_t code)
+{
+    char *buf = json->in_key ? json->key : json->value;
+    size_t *len = json->in_key ? &json->key_len : &json->value_len;
+
+    if (code < 0x80) {
+        append(buf, len, (char)code);
+    } else if (code < 0x800) {
+        append(buf, len, (char)(0xC0 | (code >> 6)));
+        append(buf, len, (char)(0x80 | (code & 0x3F)));
+    } else {
+        append(buf, len, (char)(0xE0 | (code >> 12)));
+        append(buf, len, (char)(0x80 | ((code >> 6) & 0x3F)));
+        append(buf, len, (char)(0x80 | (code & 0x3F)));
+    }
+}
+
+// JSON whitespace
+static bool is_space(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+// Characters that may appear in a number or true/false/null
+static bool is_literal(char c)
+{
+    return ((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'z')) ||
+           (c == '-') || (c == '+') || (c == '.') || (c == 'E');
+}
+
+// Innermost container is an object
+static bool in_object(const response_sink_json_t *json)
+{
+    return (json->depth > 0) && (json->containers & (1UL << (json->depth - 1)));
+}
+
+// A value (scalar or container) just ended
+static void value_done(response_sink_json_t *json)
+{
+    json->state = (json->depth == 0) ? RESPONSE_SINK_JSON_DONE :
+                                       RESPONSE_SINK_JSON_AFTER_VALUE;
+}
+
+// Hand the current scalar to the callback
+static void report(response_sink_json_t *json, response_sink_json_type_t type)
+{
+    json->value[json->value_len] = '\0';
+    json->values++;
+    if (json->on_value != NULL) {
+        json->on_value(json->ctx,
+                       in_object(json) ? json->key : "",
+                       json->value,
+                       type,
+                       json->depth);
+    }
+    json->value_len = 0;
+}
+
+// Check and report a number, true, false, or null
+static bool finish_literal(response_sink_json_t *json)
+{
+    const char *value = json->value;
+    response_sink_json_type_t type;
+
+    json->value[json->value_len] = '\0';
+    if ((strcmp(value, "true") == 0) || (strcmp(value, "false") == 0)) {
+        type = RESPONSE_SINK_JSON_BOOL;
+    } else if (strcmp(value, "null") == 0) {
+        type = RESPONSE_SINK_JSON_NULL;
+    } else if ((value[0] == '-') || ((value[0] >= '0') && (value[0] <= '9'))) {
+        type = RESPONSE_SINK_JSON_NUMBER;
+    } else {
+        return false;
+    }
+    report(json, type);
+    value_done(json);
+
+    return true;
+}
+
+// Enter an object or array
+static bool open_container(response_sink_json_t *json, bool object)
+{
+    if (json->depth >= MAX_DEPTH) {
+        ESP_LOGE(TAG, "JSON nested deeper than %d levels", MAX_DEPTH);
+        return false;
+    }
+    if (object) {
+        json->containers |= (1UL << json->depth);
+    } else {
+        json->containers &= ~(1UL << json->depth);
+    }
+    json->depth++;
+    if (json->depth > json->max_depth) {
+        json->max_depth = json->depth;
+    }
+    json->state = object ? RESPONSE_SINK_JSON_KEY_OR_END :
+                           RESPONSE_SINK_JSON_VALUE_OR_END;
+
+    return true;
+}
+
+// Leave an object or array (the bracket must match)
+static bool close_container(response_sink_json_t *json, bool object)
+{
+    if ((json->depth == 0) || (in_object(json) != object)) {
+        return false;
+    }
+    json->depth--;
+    value_done(json);
+
+    return true;
+}
+
+// Advance the scanner by one character
+static bool scan(response_sink_json_t *json, char c)
+{
+    switch (json->state) {
+
+        // Start of a value
+        case RESPONSE_SINK_JSON_VALUE_OR_END:
+            if (c == ']') {
+                return close_container(json, false);
+            }
+            // Fall through
+        case RESPONSE_SINK_JSON_VALUE:
+            if (is_space(c)) {
+                return true;
+            }
+            if ((c == '{') || (c == '[')) {
+                return open_container(json, c == '{');
+            }
+            json->value_len = 0;
+            if (c == '"') {
+                json->in_key = false;
+                json->state = RESPONSE_SINK_JSON_IN_STRING;
+                return true;
+            }
+            if (is_literal(c)) {
+                append(json->value, &json->value_len, c);
+                json->state = RESPONSE_SINK_JSON_IN_LITERAL;
+                return true;
+            }
+            return false;
+
+        // Member name
+        case RESPONSE_SINK_JSON_KEY_OR_END:
+            if (c == '}') {
+                return close_container(json, true);
+            }
+            // Fall through
+        case RESPONSE_SINK_JSON_KEY_START:
+            if (is_space(c)) {
+                return true;
+            }
+            if (c != '"') {
+                return false;
+            }
+            json->key_len = 0;
+            json->in_key = true;
+            json->state = RESPONSE_SINK_JSON_IN_STRING;
+            return true;
+
+        // Between a member name and its value
+        case RESPONSE_SINK_JSON_COLON:
+            if (is_space(c)) {
+                return true;
+            }
+            if (c != ':') {
+                return false;
+            }
+            json->state = RESPONSE_SINK_JSON_VALUE;
+            return true;
+
+        // After a value inside a container
+        case RESPONSE_SINK_JSON_AFTER_VALUE:
+            if (is_space(c)) {
+                return true;
+            }
+            if (c == ',') {
+                json->state = in_object(json) ? RESPONSE_SINK_JSON_KEY_START :
+                                                RESPONSE_SINK_JSON_VALUE;
+                return true;
+            }
+            if ((c == '}') || (c == ']')) {
+                return close_container(json, c == '}');
+            }
+            return false;
+
+        // String contents
+        case RESPONSE_SINK_JSON_IN_STRING:
+            if (c == '\\') {
+                json->state = RESPONSE_SINK_JSON_IN_ESCAPE;
+                return true;
+            }
+            if (c == '"') {
+                if (json->in_key) {
+                    json->key[json->key_len] = '\0';
+                    json->state = RESPONSE_SINK_JSON_COLON;
+                } else {
+                    report(json, RESPONSE_SINK_JSON_STRING);
+                    value_done(json);
+                }
+                return true;
+            }
+            if ((unsigned char)c < 0x20) {
+                return false;
+            }
+            if (json->in_key) {
+                append(json->key, &json->key_len, c);
+            } else {
+                append(json->value, &json->value_len, c);
+            }
+            return true;
+
+        // Escape sequence
+        case RESPONSE_SINK_JSON_IN_ESCAPE:
+            switch (c) {
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 't': c = '\t'; break;
+                case '"':
+                case '\\':
+                case '/':
+                    break;
+                case 'u':
+                    json->unicode = 0;
+                    json->unicode_digits = 0;
+                    json->state = RESPONSE_SINK_JSON_IN_UNICODE;
+                    return true;
+                default:
+                    return false;
+            }
+            if (json->in_key) {
+                append(json->key, &json->key_len, c);
+            } else {
+                append(json->value, &json->value_len, c);
+            }
+            json->state = RESPONSE_SINK_JSON_IN_STRING;
+            return true;
+
+        // Four hex digits (surrogate pairs are passed on as two code points)
+        case RESPONSE_SINK_JSON_IN_UNICODE:
+            json->unicode <<= 4;
+            if ((c >= '0') && (c <= '9')) {
+                json->unicode |= (uint16_t)(c - '0');
+            } else if ((c >= 'a') && (c <= 'f')) {
+                json->unicode |= (uint16_t)(c - 'a' + 10);
+            } else if ((c >= 'A') && (c <= 'F')) {
+                json->unicode |= (uint16_t)(c - 'A' + 10);
+            } else {
+                return false;
+            }
+            if (++json->unicode_digits == 4) {
+                append_utf8(json, json->unicode);
+                json->state = RESPONSE_SINK_JSON_IN_STRING;
+            }
+            return true;
+
+        // Number or keyword: ends at the first character that can't be in it
+        case RESPONSE_SINK_JSON_IN_LITERAL:
+            if (is_literal(c)) {
+                append(json->value, &json->value_len, c);
+                return true;
+            }
+            if (!finish_literal(json)) {
+                return false;
+            }
+            return scan(json, c);
+
+        // Only whitespace may follow the document
+        case RESPONSE_SINK_JSON_DONE:
+            return is_space(c);
+
+        default:
+            return false;
+    }
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Set up a JSON sink
+response_sink_t *response_sink_json_init(response_sink_json_t *sink,
+                                         response_sink_json_cb_t on_value,
+                                         void *ctx)
+{
+    memset(sink, 0, sizeof(*sink));
+    sink->base.ops = &s_json_ops;
+    sink->on_value = on_value;
+    sink->ctx = ctx;
+
+    return &sink->base;
+}
@@ -0,0 +1,88 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SENSOR_RING_H
+#define SENSOR_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/**
+ * @brief Largest number of data bytes in one sample
+ */
+#define SENSOR_RING_DATA_MAX    6
+
+/**
+ * @brief One timestamped sample
+ */
+typedef struct {
+    int64_t timestamp_us;           // When the bus transaction started
+    uint32_t seq;                   // Sample period number (gaps are missed samples)
+    uint32_t latency_us;            // Transaction start to done
+    esp_err_t err;                  // ESP_OK if the data is valid
+    uint8_t len;                    // Data bytes
+    uint8_t data[SENSOR_RING_DATA_MAX];
+} sensor_sample_t;
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring of samples
+ *
+ * Exactly one task (or interrupt) may push and exactly one task may pop. The
+ * indices run freely and are masked on access, so every slot is usable.
+ */
+typedef struct {
+    sensor_sample_t *slots;
+    uint32_t mask;                  // Number of slots - 1
+    _Atomic uint32_t head;          // Next slot to write (producer only)
+    _Atomic uint32_t tail;          // Next slot to read (consumer only)
+} sensor_ring_t;
+
+/**
+ * @brief Initialize an empty ring
+ *
+ * @param[out] ring Ring
+ * @param[in] slots Storage for the samples
+ * @param[in] size Number of slots (a power of two)
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_ARG if size is not a power of two
+ */
+esp_err_t sensor_ring_init(sensor_ring_t *ring, sensor_sample_t *slots, uint32_t size);
+
+/**
+ * @brief Add a sample (producer side)
+ *
+ * @param[in] ring Ring
+ * @param[in] sample Sample to copy in
+ *
+ * @return true if added, false if the ring is full
+ */
+bool sensor_ring_push(sensor_ring_t *ring, const sensor_sample_t *sample);
+
+/**
+ * @brief Take the oldest sample (consumer side)
+ *
+ * @param[in] ring Ring
+ * @param[out] sample Sample copied out
+ *
+ * @return true if a sample was taken, false if the ring is empty
+ */
+bool sensor_ring_pop(sensor_ring_t *ring, sensor_sample_t *sample);
+
+/**
+ * @brief Get the number of samples waiting
+ *
+ * @param[in] ring Ring
+ *
+ * @return Samples in the ring
+ */
+uint32_t sensor_ring_count(sensor_ring_t *ring);
+
+#endif // SENSOR_RING_H
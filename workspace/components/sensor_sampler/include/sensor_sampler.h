@@ -0,0 +1,159 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SENSOR_SAMPLER_H
+#define SENSOR_SAMPLER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "driver/gptimer.h"
+#include "driver/i2c_master.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "sensor_ring.h"
+
+/**
+ * @brief Longest register address written before each read
+ */
+#define SENSOR_SAMPLER_REG_MAX  2
+
+/**
+ * @brief What to read and how often
+ */
+typedef struct {
+    i2c_master_dev_handle_t dev;    // Device on a bus in asynchronous mode
+    uint8_t reg[SENSOR_SAMPLER_REG_MAX]; // Register address written first
+    size_t reg_len;                 // Register address bytes (0: read only)
+    size_t read_len;                // Bytes read (up to SENSOR_RING_DATA_MAX)
+    uint32_t scl_speed_hz;          // Device clock (to check the rate fits)
+    uint32_t rate_hz;               // Samples per second
+    TaskHandle_t consumer;          // Notified after each sample (or NULL)
+} sensor_sampler_config_t;
+
+/**
+ * @brief Timing and loss counters
+ *
+ * Jitter is how far each transaction started from its ideal time (start of
+ * sampling + n sample periods). Latency is the transaction's time on the bus.
+ */
+typedef struct {
+    uint32_t samples;               // Samples pushed to the ring
+    uint32_t errors;                // Samples whose transaction failed
+    uint32_t overruns;              // Periods skipped (sampler or bus late)
+    uint32_t dropped;               // Samples lost because the ring was full
+    int32_t jitter_min_us;
+    int32_t jitter_max_us;
+    int32_t jitter_mean_us;
+    uint32_t jitter_stddev_us;
+    uint32_t latency_min_us;
+    uint32_t latency_max_us;
+    uint32_t latency_mean_us;
+} sensor_sampler_stats_t;
+
+/**
+ * @brief Sampler (internal state; allocate statically or on the heap)
+ */
+typedef struct {
+    sensor_sampler_config_t config;
+    uint32_t period_us;
+    gptimer_handle_t timer;
+    TaskHandle_t task;
+    volatile bool stopping;
+    int64_t start_us;               // Time of period 0
+    volatile uint32_t ticks;        // Timer alarms so far (written by the ISR)
+    uint32_t handled_ticks;         // Alarms the task has acted on
+    bool busy;                      // Transaction in flight
+    uint32_t xfer_seq;
+    int64_t xfer_start_us;
+    volatile int64_t done_us;       // Written by the I2C ISR
+    volatile bool done_ok;
+    uint8_t rx[SENSOR_RING_DATA_MAX];
+    portMUX_TYPE stats_lock;
+    sensor_sampler_stats_t stats;
+    int64_t jitter_sum;
+    int64_t jitter_sq_sum;
+    uint64_t latency_sum;
+    uint32_t timed;                 // Samples in the sums above
+    sensor_ring_t ring;
+    sensor_sample_t slots[CONFIG_SENSOR_SAMPLER_RING_SIZE];
+} sensor_sampler_t;
+
+/**
+ * @brief Highest sample rate a bus can sustain for one register read
+ *
+ * Counts the bits on the wire (start, address, register, repeated start,
+ * address, data, acks, stop) plus CONFIG_SENSOR_SAMPLER_OVERHEAD_US.
+ *
+ * @param[in] scl_speed_hz Bus clock
+ * @param[in] reg_len Register address bytes
+ * @param[in] read_len Data bytes
+ *
+ * @return Samples per second
+ */
+uint32_t sensor_sampler_max_rate_hz(uint32_t scl_speed_hz, size_t reg_len, size_t read_len);
+
+/**
+ * @brief Start sampling
+ *
+ * Registers the transaction-done callback on the device, creates the sampler
+ * task, and starts a hardware timer with one alarm per sample period.
+ *
+ * @param[out] sampler Sampler (must stay valid until stopped)
+ * @param[in] config What to read and how often
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_ARG if the configuration is invalid or the rate is
+ *    above sensor_sampler_max_rate_hz()
+ *  - ESP_ERR_NO_MEM if the task could not be created
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t sensor_sampler_start(sensor_sampler_t *sampler,
+                               const sensor_sampler_config_t *config);
+
+/**
+ * @brief Stop sampling (waits for a transaction in flight)
+ *
+ * Samples still in the ring can be read afterwards.
+ *
+ * @param[in] sampler Sampler
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_TIMEOUT if the sampler task did not stop
+ */
+esp_err_t sensor_sampler_stop(sensor_sampler_t *sampler);
+
+/**
+ * @brief Take the oldest sample (call from one consumer task only)
+ *
+ * @param[in] sampler Sampler
+ * @param[out] sample Sample
+ *
+ * @return true if a sample was taken, false if none is waiting
+ */
+bool sensor_sampler_read(sensor_sampler_t *sampler, sensor_sample_t *sample);
+
+/**
+ * @brief Get the timing and loss counters
+ *
+ * @param[in] sampler Sampler
+ * @param[out] stats Counters
+ */
+void sensor_sampler_get_stats(sensor_sampler_t *sampler, sensor_sampler_stats_t *stats);
+
+/**
+ * @brief Reset the timing and loss counters
+ *
+ * @param[in] sampler Sampler
+ */
+void sensor_sampler_reset_stats(sensor_sampler_t *sampler);
+
+#endif // SENSOR_SAMPLER_H
@@ -0,0 +1,73 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Single-producer/single-consumer sample ring.
+ *
+ * The producer owns head and the consumer owns tail; each only reads the
+ * other's index. A slot is filled before head is published (release), and
+ * read before tail is published, so neither side ever needs a lock or a
+ * critical section.
+ */
+
+#include "sensor_ring.h"
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Initialize an empty ring
+esp_err_t sensor_ring_init(sensor_ring_t *ring, sensor_sample_t *slots, uint32_t size)
+{
+    if ((slots == NULL) || (size == 0) || ((size & (size - 1)) != 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ring->slots = slots;
+    ring->mask = size - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+
+    return ESP_OK;
+}
+
+// Add a sample (producer side)
+bool sensor_ring_push(sensor_ring_t *ring, const sensor_sample_t *sample)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if ((uint32_t)(head - tail) > ring->mask) {
+        return false;
+    }
+    ring->slots[head & ring->mask] = *sample;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    return true;
+}
+
+// Take the oldest sample (consumer side)
+bool sensor_ring_pop(sensor_ring_t *ring, sensor_sample_t *sample)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (head == tail) {
+        return false;
+    }
+    *sample = ring->slots[tail & ring->mask];
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    return true;
+}
+
+// Get the number of samples waiting
+uint32_t sensor_ring_count(sensor_ring_t *ring)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    return head - tail;
+}
@@ -0,0 +1,456 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Timer-driven I2C sensor sampler.
+ *
+ * A general-purpose timer fires once per sample period and its alarm
+ * interrupt notifies the sampler task, which starts an asynchronous I2C
+ * transaction and goes back to waiting. The transaction-done interrupt
+ * notifies the task again, which timestamps the sample and pushes it to an
+ * SPSC ring. The task never blocks on the bus, so a slow consumer or a long
+ * transaction never shifts the schedule: periods that can't be served are
+ * counted as overruns and the sample after them keeps its ideal time slot.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "sensor_sampler.h"
+
+// Settings
+#define TASK_STACK_SIZE     CONFIG_SENSOR_SAMPLER_TASK_STACK_SIZE
+#define TASK_PRIORITY       CONFIG_SENSOR_SAMPLER_TASK_PRIORITY
+#define OVERHEAD_US         CONFIG_SENSOR_SAMPLER_OVERHEAD_US
+#define TIMER_RESOLUTION_HZ 1000000     // 1 tick = 1 us
+#define STOP_TIMEOUT_MS     100
+
+// Task notification bits
+#define TICK_BIT            (1UL << 0)  // Sample period started
+#define DONE_BIT            (1UL << 1)  // Transaction finished
+#define STOP_BIT            (1UL << 2)  // Stop requested
+
+// Tag for debug messages
+static const char *TAG = "sensor_sampler";
+
+_Static_assert((CONFIG_SENSOR_SAMPLER_RING_SIZE &
+                (CONFIG_SENSOR_SAMPLER_RING_SIZE - 1)) == 0,
+               "CONFIG_SENSOR_SAMPLER_RING_SIZE must be a power of two");
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static bool on_alarm(gptimer_handle_t timer,
+                     const gptimer_alarm_event_data_t *edata,
+                     void *user_ctx);
+static bool on_trans_done(i2c_master_dev_handle_t dev,
+                          const i2c_master_event_data_t *evt_data,
+                          void *arg);
+static void record_sample(sensor_sampler_t *sampler, esp_err_t err, uint32_t latency_us);
+static void start_transfer(sensor_sampler_t *sampler);
+static void finish_transfer(sensor_sampler_t *sampler);
+static void sampler_task(void *arg);
+static void delete_timer(sensor_sampler_t *sampler);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Timer alarm (ISR): a sample period started
+static bool IRAM_ATTR on_alarm(gptimer_handle_t timer,
+                               const gptimer_alarm_event_data_t *edata,
+                               void *user_ctx)
+{
+    sensor_sampler_t *sampler = (sensor_sampler_t *)user_ctx;
+    BaseType_t woken = pdFALSE;
+
+    sampler->ticks++;
+    xTaskNotifyFromISR(sampler->task, TICK_BIT, eSetBits, &woken);
+
+    return (woken == pdTRUE);
+}
+
+// I2C transaction finished (ISR)
+static bool IRAM_ATTR on_trans_done(i2c_master_dev_handle_t dev,
+                                    const i2c_master_event_data_t *evt_data,
+                                    void *arg)
+{
+    sensor_sampler_t *sampler = (sensor_sampler_t *)arg;
+    BaseType_t woken = pdFALSE;
+
+    sampler->done_us = esp_timer_get_time();
+    sampler->done_ok = (evt_data->event == I2C_EVENT_DONE);
+    xTaskNotifyFromISR(sampler->task, DONE_BIT, eSetBits, &woken);
+
+    return (woken == pdTRUE);
+}
+
+// Push the sample for the transaction that just ended and update the stats
+static void record_sample(sensor_sampler_t *sampler, esp_err_t err, uint32_t latency_us)
+{
+    sensor_sample_t sample;
+    int32_t jitter;
+    bool pushed;
+
+    // Build the sample
+    sample.timestamp_us = sampler->xfer_start_us;
+    sample.seq = sampler->xfer_seq;
+    sample.latency_us = latency_us;
+    sample.err = err;
+    sample.len = (err == ESP_OK) ? (uint8_t)sampler->config.read_len : 0;
+    memcpy(sample.data, sampler->rx, sizeof(sample.data));
+    pushed = sensor_ring_push(&sampler->ring, &sample);
+
+    // Distance from the ideal start time of this period
+    jitter = (int32_t)(sampler->xfer_start_us -
+                       (sampler->start_us +
+                        (int64_t)sampler->xfer_seq * sampler->period_us));
+
+    // Update counters
+    taskENTER_CRITICAL(&sampler->stats_lock);
+    if (!pushed) {
+        sampler->stats.dropped++;
+    } else {
+        sampler->stats.samples++;
+    }
+    if (err != ESP_OK) {
+        sampler->stats.errors++;
+    }
+    if ((sampler->timed == 0) || (jitter < sampler->stats.jitter_min_us)) {
+        sampler->stats.jitter_min_us = jitter;
+    }
+    if ((sampler->timed == 0) || (jitter > sampler->stats.jitter_max_us)) {
+        sampler->stats.jitter_max_us = jitter;
+    }
+    if ((sampler->timed == 0) || (latency_us < sampler->stats.latency_min_us)) {
+        sampler->stats.latency_min_us = latency_us;
+    }
+    if (latency_us > sampler->stats.latency_max_us) {
+        sampler->stats.latency_max_us = latency_us;
+    }
+    sampler->jitter_sum += jitter;
+    sampler->jitter_sq_sum += (int64_t)jitter * jitter;
+    sampler->latency_sum += latency_us;
+    sampler->timed++;
+    taskEXIT_CRITICAL(&sampler->stats_lock);
+
+    // Wake the consumer
+    if (pushed && (sampler->config.consumer != NULL)) {
+        xTaskNotifyGive(sampler->config.consumer);
+    }
+}
+
+// Start the transaction for the latest period (skip it if the bus is busy)
+static void start_transfer(sensor_sampler_t *sampler)
+{
+    uint32_t ticks = sampler->ticks;
+    uint32_t missed;
+    esp_err_t esp_ret;
+
+    // Already served (the alarm fired just before the previous read of ticks)
+    if (ticks == sampler->handled_ticks) {
+        return;
+    }
+
+    // Alarms that fired while this task was late were merged into one
+    // notification: only the latest period is served
+    missed = ticks - sampler->handled_ticks - 1;
+    sampler->handled_ticks = ticks;
+    if (sampler->busy) {
+        missed++;
+    }
+    if (missed > 0) {
+        taskENTER_CRITICAL(&sampler->stats_lock);
+        sampler->stats.overruns += missed;
+        taskEXIT_CRITICAL(&sampler->stats_lock);
+    }
+    if (sampler->busy) {
+        return;
+    }
+
+    // Returns as soon as the transaction is queued (bus in asynchronous mode)
+    sampler->busy = true;
+    sampler->xfer_seq = ticks;
+    sampler->xfer_start_us = esp_timer_get_time();
+    esp_ret = i2c_master_transmit_receive(sampler->config.dev,
+                                          sampler->config.reg,
+                                          sampler->config.reg_len,
+                                          sampler->rx,
+                                          sampler->config.read_len,
+                                          -1);
+    if (esp_ret != ESP_OK) {
+        sampler->busy = false;
+        record_sample(sampler, esp_ret, 0);
+    }
+}
+
+// Complete the sample for the transaction that just finished
+static void finish_transfer(sensor_sampler_t *sampler)
+{
+    if (!sampler->busy) {
+        return;
+    }
+    sampler->busy = false;
+    record_sample(sampler,
+                  sampler->done_ok ? ESP_OK : ESP_FAIL,
+                  (uint32_t)(sampler->done_us - sampler->xfer_start_us));
+}
+
+// Sampler task: start a transaction on every alarm, finish it on done
+static void sampler_task(void *arg)
+{
+    sensor_sampler_t *sampler = (sensor_sampler_t *)arg;
+    uint32_t bits;
+
+    while (1) {
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+
+        // Finish first so a done and the next alarm in one wake-up are not
+        // counted as an overrun
+        if (bits & DONE_BIT) {
+            finish_transfer(sampler);
+        }
+
+        // Stop once no transaction is in flight (its buffer is ours)
+        if (sampler->stopping) {
+            if (!sampler->busy) {
+                break;
+            }
+            continue;
+        }
+
+        if (bits & TICK_BIT) {
+            start_transfer(sampler);
+        }
+    }
+
+    sampler->task = NULL;
+    vTaskDelete(NULL);
+}
+
+// Stop and free the timer
+static void delete_timer(sensor_sampler_t *sampler)
+{
+    if (sampler->timer == NULL) {
+        return;
+    }
+    gptimer_stop(sampler->timer);
+    gptimer_disable(sampler->timer);
+    gptimer_del_timer(sampler->timer);
+    sampler->timer = NULL;
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Highest sample rate a bus can sustain for one register read
+uint32_t sensor_sampler_max_rate_hz(uint32_t scl_speed_hz, size_t reg_len, size_t read_len)
+{
+    uint32_t bits;
+    uint32_t time_us;
+
+    if (scl_speed_hz == 0) {
+        return 0;
+    }
+
+    // Start + address, register bytes, repeated start + address, data, stop
+    bits = 1 + 9;
+    if (reg_len > 0) {
+        bits += (9 * reg_len) + 1 + 9;
+    }
+    bits += (9 * read_len) + 1;
+    time_us = (uint32_t)(((uint64_t)bits * 1000000 + scl_speed_hz - 1) / scl_speed_hz);
+    time_us += OVERHEAD_US;
+
+    return 1000000 / time_us;
+}
+
+// Start sampling
+esp_err_t sensor_sampler_start(sensor_sampler_t *sampler,
+                               const sensor_sampler_config_t *config)
+{
+    esp_err_t esp_ret;
+    BaseType_t ret;
+    uint32_t max_rate;
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = TIMER_RESOLUTION_HZ,
+    };
+    gptimer_alarm_config_t alarm_config = {
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = true,
+    };
+    gptimer_event_callbacks_t timer_cbs = {
+        .on_alarm = on_alarm,
+    };
+    i2c_master_event_callbacks_t i2c_cbs = {
+        .on_trans_done = on_trans_done,
+    };
+
+    // Check the configuration
+    if ((sampler == NULL) || (config == NULL) || (config->dev == NULL) ||
+        (config->reg_len > SENSOR_SAMPLER_REG_MAX) ||
+        (config->read_len == 0) || (config->read_len > SENSOR_RING_DATA_MAX) ||
+        (config->rate_hz == 0) || (config->rate_hz > TIMER_RESOLUTION_HZ)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    max_rate = sensor_sampler_max_rate_hz(config->scl_speed_hz,
+                                          config->reg_len,
+                                          config->read_len);
+    if (config->rate_hz > max_rate) {
+        ESP_LOGE(TAG, "%lu Hz is above the bus limit of %lu Hz at %lu Hz SCL",
+                 (unsigned long)config->rate_hz,
+                 (unsigned long)max_rate,
+                 (unsigned long)config->scl_speed_hz);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Set up state
+    memset(sampler, 0, sizeof(*sampler));
+    sampler->config = *config;
+    sampler->period_us = TIMER_RESOLUTION_HZ / config->rate_hz;
+    portMUX_INITIALIZE(&sampler->stats_lock);
+    sensor_ring_init(&sampler->ring, sampler->slots, CONFIG_SENSOR_SAMPLER_RING_SIZE);
+
+    // Completion callback (requires a bus in asynchronous mode)
+    esp_ret = i2c_master_register_event_callbacks(config->dev, &i2c_cbs, sampler);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to register I2C callback "
+                 "(bus needs trans_queue_depth > 0)", esp_ret);
+        return esp_ret;
+    }
+
+    // Sampler task (waits for the first alarm)
+    ret = xTaskCreate(sampler_task,
+                      "sensor_sampler",
+                      TASK_STACK_SIZE,
+                      sampler,
+                      TASK_PRIORITY,
+                      &sampler->task);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create sampler task");
+        esp_ret = ESP_ERR_NO_MEM;
+        goto cleanup;
+    }
+
+    // Timer with an alarm at the end of every period
+    esp_ret = gptimer_new_timer(&timer_config, &sampler->timer);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to create timer", esp_ret);
+        goto cleanup;
+    }
+    alarm_config.alarm_count = sampler->period_us;
+    esp_ret = gptimer_set_alarm_action(sampler->timer, &alarm_config);
+    if (esp_ret == ESP_OK) {
+        esp_ret = gptimer_register_event_callbacks(sampler->timer, &timer_cbs, sampler);
+    }
+    if (esp_ret == ESP_OK) {
+        esp_ret = gptimer_enable(sampler->timer);
+    }
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to set up timer", esp_ret);
+        gptimer_del_timer(sampler->timer);
+        sampler->timer = NULL;
+        goto cleanup;
+    }
+
+    // Period n ideally starts at start_us + n * period_us
+    sampler->start_us = esp_timer_get_time();
+    esp_ret = gptimer_start(sampler->timer);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to start timer", esp_ret);
+        goto cleanup;
+    }
+    ESP_LOGI(TAG, "Sampling at %lu Hz (bus limit %lu Hz)",
+             (unsigned long)config->rate_hz,
+             (unsigned long)max_rate);
+
+    return ESP_OK;
+
+cleanup:
+    sensor_sampler_stop(sampler);
+
+    return esp_ret;
+}
+
+// Stop sampling (waits for a transaction in flight)
+esp_err_t sensor_sampler_stop(sensor_sampler_t *sampler)
+{
+    i2c_master_event_callbacks_t no_cbs = { 0 };
+    TickType_t start;
+
+    // No more alarms
+    delete_timer(sampler);
+
+    // Let the task finish the transaction in flight and exit
+    if (sampler->task != NULL) {
+        sampler->stopping = true;
+        xTaskNotify(sampler->task, STOP_BIT, eSetBits);
+        start = xTaskGetTickCount();
+        while (sampler->task != NULL) {
+            if ((xTaskGetTickCount() - start) > pdMS_TO_TICKS(STOP_TIMEOUT_MS)) {
+                ESP_LOGE(TAG, "Sampler task did not stop");
+                return ESP_ERR_TIMEOUT;
+            }
+            vTaskDelay(1);
+        }
+    }
+    i2c_master_register_event_callbacks(sampler->config.dev, &no_cbs, NULL);
+
+    return ESP_OK;
+}
+
+// Take the oldest sample (call from one consumer task only)
+bool sensor_sampler_read(sensor_sampler_t *sampler, sensor_sample_t *sample)
+{
+    return sensor_ring_pop(&sampler->ring, sample);
+}
+
+// Get the timing and loss counters
+void sensor_sampler_get_stats(sensor_sampler_t *sampler, sensor_sampler_stats_t *stats)
+{
+    int64_t jitter_sum;
+    int64_t jitter_sq_sum;
+    uint64_t latency_sum;
+    uint32_t timed;
+    double mean;
+    double variance;
+
+    taskENTER_CRITICAL(&sampler->stats_lock);
+    *stats = sampler->stats;
+    jitter_sum = sampler->jitter_sum;
+    jitter_sq_sum = sampler->jitter_sq_sum;
+    latency_sum = sampler->latency_sum;
+    timed = sampler->timed;
+    taskEXIT_CRITICAL(&sampler->stats_lock);
+
+    // Mean and standard deviation from the running sums
+    if (timed > 0) {
+        mean = (double)jitter_sum / timed;
+        variance = ((double)jitter_sq_sum / timed) - (mean * mean);
+        stats->jitter_mean_us = (int32_t)lround(mean);
+        stats->jitter_stddev_us = (variance > 0.0) ? (uint32_t)lround(sqrt(variance)) : 0;
+        stats->latency_mean_us = (uint32_t)(latency_sum / timed);
+    }
+}
+
+// Reset the timing and loss counters
+void sensor_sampler_reset_stats(sensor_sampler_t *sampler)
+{
+    taskENTER_CRITICAL(&sampler->stats_lock);
+    memset(&sampler->stats, 0, sizeof(sampler->stats));
+    sampler->jitter_sum = 0;
+    sampler->jitter_sq_sum = 0;
+    sampler->latency_sum = 0;
+    sampler->timed = 0;
+    taskEXIT_CRITICAL(&sampler->stats_lock);
+}
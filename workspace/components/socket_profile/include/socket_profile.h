@@ -0,0 +1,162 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SOCKET_PROFILE_H
+#define SOCKET_PROFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "esp_err.h"
+
+/**
+ * @brief Retransmit count when the lwIP build keeps no TCP statistics
+ */
+#define SOCKET_PROFILE_NO_COUNT     UINT32_MAX
+
+/**
+ * @brief Set of socket options for one kind of traffic
+ *
+ * The TCP send buffer and window sizes are fixed when lwIP is built
+ * (CONFIG_LWIP_TCP_SND_BUF_DEFAULT, CONFIG_LWIP_TCP_WND_DEFAULT) and cannot
+ * be set per socket.
+ */
+typedef struct {
+    const char *name;
+    bool nodelay;                   // TCP_NODELAY (send small writes at once)
+    bool coalesce;                  // MSG_MORE on writes with more to follow
+    int rcvbuf;                     // SO_RCVBUF (bytes), 0 for the default
+    size_t rx_size;                 // Suggested size of each recv()
+    uint32_t timeout_ms;            // SO_SNDTIMEO/SO_RCVTIMEO, 0 to block
+    bool keepalive;                 // SO_KEEPALIVE with the timers below
+    int keep_idle_sec;              // Idle time before the first probe
+    int keep_intvl_sec;             // Time between probes
+    int keep_cnt;                   // Unanswered probes before dropping
+} socket_profile_t;
+
+/**
+ * @brief Built-in profiles
+ *
+ * - low_latency: Nagle off, small reads. For request/response traffic.
+ * - bulk: writes coalesced, large reads. For uploads and downloads.
+ * - long_lived: low_latency plus TCP keepalive. For idle connections that
+ *   must notice a dead peer (e.g. MQTT, kept-alive HTTP).
+ */
+extern const socket_profile_t SOCKET_PROFILE_LOW_LATENCY;
+extern const socket_profile_t SOCKET_PROFILE_BULK;
+extern const socket_profile_t SOCKET_PROFILE_LONG_LIVED;
+
+/**
+ * @brief Counters for one socket
+ */
+typedef struct {
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    uint32_t send_calls;            // send() system calls
+    uint32_t recv_calls;            // recv() system calls
+    uint32_t errors;                // Calls that failed (timeouts included)
+    uint32_t retransmits;           // TCP retransmits while attached (see
+                                    // socket_profile_get_stats())
+} socket_profile_stats_t;
+
+/**
+ * @brief Socket with a profile and counters
+ */
+typedef struct {
+    int sock;
+    const socket_profile_t *profile;
+    socket_profile_stats_t stats;
+    uint32_t rexmit_base;           // Stack retransmit count when attached
+} socket_profile_conn_t;
+
+/**
+ * @brief Find a built-in profile by name
+ *
+ * @param[in] name Profile name (e.g. "bulk")
+ *
+ * @return Profile, or NULL if there is none with that name
+ */
+const socket_profile_t *socket_profile_find(const char *name);
+
+/**
+ * @brief Apply a profile's options to a socket
+ *
+ * Options the lwIP build does not support (e.g. SO_RCVBUF without
+ * CONFIG_LWIP_SO_RCVBUF) are skipped.
+ *
+ * @param[in] sock Socket descriptor
+ * @param[in] profile Profile to apply
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_ARG if the socket or profile is invalid
+ *  - ESP_FAIL if setting an option failed (see errno)
+ */
+esp_err_t socket_profile_apply(int sock, const socket_profile_t *profile);
+
+/**
+ * @brief Apply a profile to a socket and start counting its traffic
+ *
+ * @param[out] conn Connection to set up
+ * @param[in] sock Connected socket descriptor
+ * @param[in] profile Profile to apply
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t socket_profile_attach(socket_profile_conn_t *conn,
+                                int sock,
+                                const socket_profile_t *profile);
+
+/**
+ * @brief Send a whole buffer
+ *
+ * Calls send() until everything is queued or an error occurs. Set more when
+ * the next write follows right away (e.g. headers before a body): with a
+ * coalescing profile, lwIP then holds the data back to fill full segments.
+ * The last write of a message must have more set to false.
+ *
+ * @param[in] conn Connection
+ * @param[in] data Data to send
+ * @param[in] len Number of bytes
+ * @param[in] more true if more data follows immediately
+ *
+ * @return Number of bytes sent, or -1 on error (see errno)
+ */
+ssize_t socket_profile_send(socket_profile_conn_t *conn,
+                            const void *data,
+                            size_t len,
+                            bool more);
+
+/**
+ * @brief Receive data (one recv() call)
+ *
+ * @param[in] conn Connection
+ * @param[out] buf Buffer
+ * @param[in] len Buffer size (see the profile's rx_size)
+ *
+ * @return Number of bytes received, 0 if the peer closed the connection, or
+ *         -1 on error (see errno)
+ */
+ssize_t socket_profile_recv(socket_profile_conn_t *conn, void *buf, size_t len);
+
+/**
+ * @brief Get a connection's counters
+ *
+ * lwIP keeps no per-socket retransmit count, so retransmits is the number
+ * of TCP segments the whole stack retransmitted since the socket was
+ * attached (exact when it is the only busy connection). It is
+ * SOCKET_PROFILE_NO_COUNT unless CONFIG_LWIP_STATS is enabled.
+ *
+ * @param[in] conn Connection
+ * @param[out] stats Counters
+ */
+void socket_profile_get_stats(const socket_profile_conn_t *conn,
+                              socket_profile_stats_t *stats);
+
+#endif // SOCKET_PROFILE_H
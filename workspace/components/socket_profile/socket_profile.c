@@ -0,0 +1,279 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Socket tuning profiles.
+ *
+ * A profile is a named set of socket options applied in one call, so each
+ * application picks latency or throughput for its traffic instead of
+ * repeating setsockopt() calls. Connections attached to a profile go through
+ * thin send()/recv() wrappers that count bytes and system calls, which shows
+ * whether a change (e.g. larger reads) actually saves calls.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include "lwip/stats.h"
+
+#include "socket_profile.h"
+
+// Settings
+#define TIMEOUT_MS          CONFIG_SOCKET_PROFILE_TIMEOUT_MS
+#define LOW_LATENCY_RX_SIZE CONFIG_SOCKET_PROFILE_LOW_LATENCY_RX_SIZE
+#define BULK_RX_SIZE        CONFIG_SOCKET_PROFILE_BULK_RX_SIZE
+#define KEEPIDLE_SEC        CONFIG_SOCKET_PROFILE_KEEPIDLE_SEC
+#define KEEPINTVL_SEC       CONFIG_SOCKET_PROFILE_KEEPINTVL_SEC
+#define KEEPCNT             CONFIG_SOCKET_PROFILE_KEEPCNT
+
+// Tag for debug messages
+static const char *TAG = "socket_profile";
+
+// Built-in profiles
+const socket_profile_t SOCKET_PROFILE_LOW_LATENCY = {
+    .name = "low_latency",
+    .nodelay = true,
+    .coalesce = false,
+    .rcvbuf = 0,
+    .rx_size = LOW_LATENCY_RX_SIZE,
+    .timeout_ms = TIMEOUT_MS,
+    .keepalive = false,
+};
+
+const socket_profile_t SOCKET_PROFILE_BULK = {
+    .name = "bulk",
+    .nodelay = false,
+    .coalesce = true,
+    .rcvbuf = 0,
+    .rx_size = BULK_RX_SIZE,
+    .timeout_ms = TIMEOUT_MS,
+    .keepalive = false,
+};
+
+const socket_profile_t SOCKET_PROFILE_LONG_LIVED = {
+    .name = "long_lived",
+    .nodelay = true,
+    .coalesce = false,
+    .rcvbuf = 0,
+    .rx_size = LOW_LATENCY_RX_SIZE,
+    .timeout_ms = TIMEOUT_MS,
+    .keepalive = true,
+    .keep_idle_sec = KEEPIDLE_SEC,
+    .keep_intvl_sec = KEEPINTVL_SEC,
+    .keep_cnt = KEEPCNT,
+};
+
+// Lookup table for socket_profile_find()
+static const socket_profile_t *const s_profiles[] = {
+    &SOCKET_PROFILE_LOW_LATENCY,
+    &SOCKET_PROFILE_BULK,
+    &SOCKET_PROFILE_LONG_LIVED,
+};
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static esp_err_t set_option(int sock,
+                            int level,
+                            int option,
+                            const void *value,
+                            socklen_t len,
+                            const char *name);
+static uint32_t stack_retransmits(void);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Set one socket option (options missing from this lwIP build are skipped)
+static esp_err_t set_option(int sock,
+                            int level,
+                            int option,
+                            const void *value,
+                            socklen_t len,
+                            const char *name)
+{
+    if (setsockopt(sock, level, option, value, len) == 0) {
+        return ESP_OK;
+    }
+    if (errno == ENOPROTOOPT) {
+        ESP_LOGD(TAG, "%s not supported by lwIP build, skipped", name);
+        return ESP_OK;
+    }
+    ESP_LOGE(TAG, "Failed to set %s (%d): %s", name, errno, strerror(errno));
+
+    return ESP_FAIL;
+}
+
+// Segments retransmitted by the whole TCP stack since boot
+static uint32_t stack_retransmits(void)
+{
+#if LWIP_STATS && TCP_STATS
+    return (uint32_t)lwip_stats.tcp.rexmit;
+#else
+    return SOCKET_PROFILE_NO_COUNT;
+#endif
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Find a built-in profile by name
+const socket_profile_t *socket_profile_find(const char *name)
+{
+    if (name == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < sizeof(s_profiles) / sizeof(s_profiles[0]); i++) {
+        if (strcmp(s_profiles[i]->name, name) == 0) {
+            return s_profiles[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Apply a profile's options to a socket
+esp_err_t socket_profile_apply(int sock, const socket_profile_t *profile)
+{
+    esp_err_t esp_ret = ESP_OK;
+    int value;
+    struct timeval tv;
+
+    if ((sock < 0) || (profile == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Nagle's algorithm holds small writes until earlier data is acked
+    value = profile->nodelay ? 1 : 0;
+    if (set_option(sock, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value),
+                   "TCP_NODELAY") != ESP_OK) {
+        esp_ret = ESP_FAIL;
+    }
+
+    // Limit on data queued for the application
+    if (profile->rcvbuf > 0) {
+        value = profile->rcvbuf;
+        if (set_option(sock, SOL_SOCKET, SO_RCVBUF, &value, sizeof(value),
+                       "SO_RCVBUF") != ESP_OK) {
+            esp_ret = ESP_FAIL;
+        }
+    }
+
+    // Timeouts
+    if (profile->timeout_ms > 0) {
+        tv.tv_sec = profile->timeout_ms / 1000;
+        tv.tv_usec = (profile->timeout_ms % 1000) * 1000;
+        if ((set_option(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv),
+                        "SO_SNDTIMEO") != ESP_OK) ||
+            (set_option(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv),
+                        "SO_RCVTIMEO") != ESP_OK)) {
+            esp_ret = ESP_FAIL;
+        }
+    }
+
+    // Keepalive probes find a dead peer on an idle connection
+    value = profile->keepalive ? 1 : 0;
+    if (set_option(sock, SOL_SOCKET, SO_KEEPALIVE, &value, sizeof(value),
+                   "SO_KEEPALIVE") != ESP_OK) {
+        esp_ret = ESP_FAIL;
+    }
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+    if (profile->keepalive) {
+        if ((set_option(sock, IPPROTO_TCP, TCP_KEEPIDLE,
+                        &profile->keep_idle_sec, sizeof(int),
+                        "TCP_KEEPIDLE") != ESP_OK) ||
+            (set_option(sock, IPPROTO_TCP, TCP_KEEPINTVL,
+                        &profile->keep_intvl_sec, sizeof(int),
+                        "TCP_KEEPINTVL") != ESP_OK) ||
+            (set_option(sock, IPPROTO_TCP, TCP_KEEPCNT,
+                        &profile->keep_cnt, sizeof(int),
+                        "TCP_KEEPCNT") != ESP_OK)) {
+            esp_ret = ESP_FAIL;
+        }
+    }
+#endif
+
+    ESP_LOGD(TAG, "Applied profile %s to socket %d", profile->name, sock);
+
+    return esp_ret;
+}
+
+// Apply a profile to a socket and start counting its traffic
+esp_err_t socket_profile_attach(socket_profile_conn_t *conn,
+                                int sock,
+                                const socket_profile_t *profile)
+{
+    if (conn == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(conn, 0, sizeof(*conn));
+    conn->sock = sock;
+    conn->profile = profile;
+    conn->rexmit_base = stack_retransmits();
+
+    return socket_profile_apply(sock, profile);
+}
+
+// Send a whole buffer
+ssize_t socket_profile_send(socket_profile_conn_t *conn,
+                            const void *data,
+                            size_t len,
+                            bool more)
+{
+    const uint8_t *ptr = (const uint8_t *)data;
+    size_t sent = 0;
+    int flags;
+    ssize_t ret;
+
+    // Let lwIP fill segments across writes
+    flags = (more && conn->profile->coalesce) ? MSG_MORE : 0;
+
+    // send() may queue only part of the buffer
+    while (sent < len) {
+        ret = send(conn->sock, &ptr[sent], len - sent, flags);
+        conn->stats.send_calls++;
+        if (ret < 0) {
+            conn->stats.errors++;
+            return -1;
+        }
+        sent += (size_t)ret;
+        conn->stats.bytes_sent += (uint64_t)ret;
+    }
+
+    return (ssize_t)sent;
+}
+
+// Receive data (one recv() call)
+ssize_t socket_profile_recv(socket_profile_conn_t *conn, void *buf, size_t len)
+{
+    ssize_t ret;
+
+    ret = recv(conn->sock, buf, len, 0);
+    conn->stats.recv_calls++;
+    if (ret < 0) {
+        conn->stats.errors++;
+    } else {
+        conn->stats.bytes_received += (uint64_t)ret;
+    }
+
+    return ret;
+}
+
+// Get a connection's counters
+void socket_profile_get_stats(const socket_profile_conn_t *conn,
+                              socket_profile_stats_t *stats)
+{
+    uint32_t rexmit = stack_retransmits();
+
+    *stats = conn->stats;
+    stats->retransmits = (rexmit == SOCKET_PROFILE_NO_COUNT) ?
+                         SOCKET_PROFILE_NO_COUNT : rexmit - conn->rexmit_base;
+}
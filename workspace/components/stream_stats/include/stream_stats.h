@@ -0,0 +1,165 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STREAM_STATS_H
+#define STREAM_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_codec.h"
+
+/**
+ * @brief Largest number of percentiles tracked per stream (set from
+ *        CONFIG_STREAM_STATS_MAX_QUANTILES in ESP-IDF builds)
+ */
+#ifndef STREAM_STATS_MAX_QUANTILES
+# define STREAM_STATS_MAX_QUANTILES 3
+#endif
+
+/**
+ * @brief Markers used by the P-square estimator
+ */
+#define STREAM_STATS_P2_MARKERS 5
+
+/**
+ * @brief P-square estimate of one quantile (internal state)
+ *
+ * Five markers track the minimum, p/2, p, (1+p)/2 quantiles, and the
+ * maximum. Their heights are nudged toward their ideal positions as values
+ * arrive, using a piecewise-parabolic fit. Until five values have been seen
+ * the markers simply hold them, sorted.
+ */
+typedef struct {
+    float p;                                    // Quantile (0 to 1)
+    float height[STREAM_STATS_P2_MARKERS];      // Marker values
+    int32_t pos[STREAM_STATS_P2_MARKERS];       // Actual marker positions
+    float desired[STREAM_STATS_P2_MARKERS];     // Ideal marker positions
+} stream_stats_p2_t;
+
+/**
+ * @brief Summary of one window
+ *
+ * Statistics are 0 when count is 0.
+ */
+typedef struct {
+    int64_t start_us;               // Window start
+    int64_t end_us;                 // Window end (exclusive)
+    uint32_t count;                 // Values in the window
+    float min;
+    float max;
+    float mean;
+    float stddev;                   // Sample standard deviation
+    uint8_t num_quantiles;
+    float quantile_p[STREAM_STATS_MAX_QUANTILES];   // Quantiles requested
+    float quantile[STREAM_STATS_MAX_QUANTILES];     // Their estimates
+} stream_stats_summary_t;
+
+/**
+ * @brief One stream of values summarized over tumbling windows (internal
+ *        state; allocate statically or on the heap)
+ */
+typedef struct {
+    uint32_t window_us;             // Window length (0: never closes on its own)
+    int64_t start_us;               // Current window start
+    uint32_t count;
+    float min;
+    float max;
+    float mean;                     // Running mean (Welford)
+    float m2;                       // Sum of squared differences from the mean
+    uint8_t num_quantiles;
+    stream_stats_p2_t p2[STREAM_STATS_MAX_QUANTILES];
+} stream_stats_t;
+
+/**
+ * @brief Initialize a stream
+ *
+ * Windows are aligned to start_us: a value at time t falls in the window
+ * starting at start_us + k * window_us.
+ *
+ * @param[out] stats Stream
+ * @param[in] window_us Window length (0 to close windows only with
+ *            stream_stats_close())
+ * @param[in] start_us Start of the first window
+ * @param[in] quantiles Percentiles to estimate, as fractions (e.g. 0.5, 0.9,
+ *            0.99), or NULL
+ * @param[in] num_quantiles Number of percentiles (up to
+ *            STREAM_STATS_MAX_QUANTILES)
+ *
+ * @return TELEMETRY_OK or TELEMETRY_ERR_INVALID
+ */
+telemetry_result_t stream_stats_init(stream_stats_t *stats,
+                                     uint32_t window_us,
+                                     int64_t start_us,
+                                     const float *quantiles,
+                                     uint8_t num_quantiles);
+
+/**
+ * @brief Close the current window if a time is past its end
+ *
+ * Call this periodically when values may stop arriving, so quiet windows
+ * are still reported. Windows with no values in them are skipped.
+ *
+ * @param[in] stats Stream
+ * @param[in] now_us Current time
+ * @param[out] summary Summary of the window that closed
+ *
+ * @return true if a window closed and summary was filled in
+ */
+bool stream_stats_poll(stream_stats_t *stats, int64_t now_us, stream_stats_summary_t *summary);
+
+/**
+ * @brief Add a value
+ *
+ * If the value's timestamp is past the end of the current window, that
+ * window is closed first (as with stream_stats_poll()) and the value starts
+ * the next one. NaN values are ignored.
+ *
+ * @param[in] stats Stream
+ * @param[in] value Value
+ * @param[in] timestamp_us When the value was measured
+ * @param[out] summary Summary of the window that closed (or NULL)
+ *
+ * @return true if a window closed and summary was filled in
+ */
+bool stream_stats_add(stream_stats_t *stats,
+                      float value,
+                      int64_t timestamp_us,
+                      stream_stats_summary_t *summary);
+
+/**
+ * @brief Summarize the current window without closing it
+ *
+ * @param[in] stats Stream
+ * @param[out] summary Summary so far
+ */
+void stream_stats_summarize(const stream_stats_t *stats, stream_stats_summary_t *summary);
+
+/**
+ * @brief Close the current window now and start the next one at end_us
+ *
+ * @param[in] stats Stream
+ * @param[in] end_us End of the current window (start of the next)
+ * @param[out] summary Summary of the window that closed (or NULL)
+ */
+void stream_stats_close(stream_stats_t *stats, int64_t end_us, stream_stats_summary_t *summary);
+
+/**
+ * @brief Add a summary to a telemetry message
+ *
+ * Writes <name>_n, <name>_min, <name>_max, <name>_mean, <name>_std, and
+ * <name>_pNN for each percentile (e.g. temp_p90, temp_p99). Nothing but the
+ * count is written for an empty window.
+ *
+ * @param[in] enc Encoder
+ * @param[in] name Field name prefix (NUL-terminated, up to 24 characters)
+ * @param[in] summary Summary
+ */
+void stream_stats_encode(telemetry_encoder_t *enc,
+                         const char *name,
+                         const stream_stats_summary_t *summary);
+
+#endif // STREAM_STATS_H
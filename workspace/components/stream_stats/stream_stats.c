@@ -0,0 +1,330 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Windowed streaming statistics.
+ *
+ * Each stream keeps a running count, min, max, mean, and sum of squared
+ * differences (Welford's method, stable in single precision), plus one
+ * P-square estimator per requested percentile (Jain and Chlamtac, 1985).
+ * Nothing grows with the number of values, so a stream costs the same few
+ * hundred bytes whether a window holds ten readings or ten thousand. When a
+ * value (or a poll) lands past the end of the window, the window is
+ * summarized and the accumulators start over.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stream_stats.h"
+
+// Settings
+#define KEY_MAX_LEN     32      // Longest telemetry key built by the encoder
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static void p2_init(stream_stats_p2_t *p2, float p);
+static void p2_add(stream_stats_p2_t *p2, float value, uint32_t count);
+static float p2_value(const stream_stats_p2_t *p2, uint32_t count);
+static void reset_window(stream_stats_t *stats, int64_t start_us);
+static void encode_field(telemetry_encoder_t *enc,
+                         const char *name,
+                         const char *suffix,
+                         float value);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Start a quantile estimate with no values
+static void p2_init(stream_stats_p2_t *p2, float p)
+{
+    memset(p2, 0, sizeof(*p2));
+    p2->p = p;
+}
+
+// Add a value (count includes it)
+static void p2_add(stream_stats_p2_t *p2, float value, uint32_t count)
+{
+    const float p = p2->p;
+    const float increment[STREAM_STATS_P2_MARKERS] = {
+        0.0f, p / 2.0f, p, (1.0f + p) / 2.0f, 1.0f
+    };
+    float *q = p2->height;
+    int32_t *n = p2->pos;
+    int k;
+    int d;
+    float delta;
+    float parabolic;
+
+    // Keep the first five values, sorted
+    if (count <= STREAM_STATS_P2_MARKERS) {
+        k = (int)count - 1;
+        while ((k > 0) && (q[k - 1] > value)) {
+            q[k] = q[k - 1];
+            k--;
+        }
+        q[k] = value;
+        if (count == STREAM_STATS_P2_MARKERS) {
+            for (int i = 0; i < STREAM_STATS_P2_MARKERS; i++) {
+                n[i] = i;
+            }
+            p2->desired[0] = 0.0f;
+            p2->desired[1] = 2.0f * p;
+            p2->desired[2] = 4.0f * p;
+            p2->desired[3] = 2.0f + 2.0f * p;
+            p2->desired[4] = 4.0f;
+        }
+        return;
+    }
+
+    // Find the cell the value falls in, stretching the extremes if needed
+    if (value < q[0]) {
+        q[0] = value;
+        k = 0;
+    } else if (value >= q[4]) {
+        q[4] = value;
+        k = 3;
+    } else {
+        k = 0;
+        while (value >= q[k + 1]) {
+            k++;
+        }
+    }
+
+    // Shift the markers above it and move every ideal position along
+    for (int i = k + 1; i < STREAM_STATS_P2_MARKERS; i++) {
+        n[i]++;
+    }
+    for (int i = 0; i < STREAM_STATS_P2_MARKERS; i++) {
+        p2->desired[i] += increment[i];
+    }
+
+    // Move the three middle markers one step toward their ideal positions
+    for (int i = 1; i < STREAM_STATS_P2_MARKERS - 1; i++) {
+        delta = p2->desired[i] - (float)n[i];
+        if (((delta >= 1.0f) && ((n[i + 1] - n[i]) > 1)) ||
+            ((delta <= -1.0f) && ((n[i - 1] - n[i]) < -1))) {
+            d = (delta > 0.0f) ? 1 : -1;
+
+            // Piecewise-parabolic prediction, linear if it would overshoot
+            parabolic = q[i] + (float)d / (float)(n[i + 1] - n[i - 1]) *
+                        ((float)(n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) /
+                             (float)(n[i + 1] - n[i]) +
+                         (float)(n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) /
+                             (float)(n[i] - n[i - 1]));
+            if ((q[i - 1] < parabolic) && (parabolic < q[i + 1])) {
+                q[i] = parabolic;
+            } else {
+                q[i] += (float)d * (q[i + d] - q[i]) / (float)(n[i + d] - n[i]);
+            }
+            n[i] += d;
+        }
+    }
+}
+
+// Current estimate (exact, interpolated, while there are five values or fewer)
+static float p2_value(const stream_stats_p2_t *p2, uint32_t count)
+{
+    float rank;
+    uint32_t i;
+
+    if (count == 0) {
+        return 0.0f;
+    }
+    if (count > STREAM_STATS_P2_MARKERS) {
+        return p2->height[2];
+    }
+
+    rank = p2->p * (float)(count - 1);
+    i = (uint32_t)rank;
+    if (i >= count - 1) {
+        return p2->height[count - 1];
+    }
+
+    return p2->height[i] + (rank - (float)i) * (p2->height[i + 1] - p2->height[i]);
+}
+
+// Clear the accumulators for a window starting at start_us
+static void reset_window(stream_stats_t *stats, int64_t start_us)
+{
+    stats->start_us = start_us;
+    stats->count = 0;
+    stats->min = 0.0f;
+    stats->max = 0.0f;
+    stats->mean = 0.0f;
+    stats->m2 = 0.0f;
+    for (uint8_t i = 0; i < stats->num_quantiles; i++) {
+        p2_init(&stats->p2[i], stats->p2[i].p);
+    }
+}
+
+// Write one <name>_<suffix> float field
+static void encode_field(telemetry_encoder_t *enc,
+                         const char *name,
+                         const char *suffix,
+                         float value)
+{
+    char key[KEY_MAX_LEN];
+
+    snprintf(key, sizeof(key), "%s_%s", name, suffix);
+    telemetry_encode_float(enc, key, value);
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Initialize a stream
+telemetry_result_t stream_stats_init(stream_stats_t *stats,
+                                     uint32_t window_us,
+                                     int64_t start_us,
+                                     const float *quantiles,
+                                     uint8_t num_quantiles)
+{
+    // Check parameters
+    if ((num_quantiles > STREAM_STATS_MAX_QUANTILES) ||
+        ((num_quantiles > 0) && (quantiles == NULL))) {
+        return TELEMETRY_ERR_INVALID;
+    }
+    for (uint8_t i = 0; i < num_quantiles; i++) {
+        if (!(quantiles[i] > 0.0f) || !(quantiles[i] < 1.0f)) {
+            return TELEMETRY_ERR_INVALID;
+        }
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->window_us = window_us;
+    stats->num_quantiles = num_quantiles;
+    for (uint8_t i = 0; i < num_quantiles; i++) {
+        p2_init(&stats->p2[i], quantiles[i]);
+    }
+    reset_window(stats, start_us);
+
+    return TELEMETRY_OK;
+}
+
+// Close the current window if a time is past its end
+bool stream_stats_poll(stream_stats_t *stats, int64_t now_us, stream_stats_summary_t *summary)
+{
+    int64_t end_us;
+    bool had_values;
+
+    if ((stats->window_us == 0) || (now_us < stats->start_us + stats->window_us)) {
+        return false;
+    }
+
+    // Report the window, then jump to the one containing now (skipping
+    // empty windows in between)
+    end_us = stats->start_us + stats->window_us;
+    had_values = (stats->count > 0);
+    if (had_values && (summary != NULL)) {
+        stream_stats_summarize(stats, summary);
+        summary->end_us = end_us;
+    }
+    reset_window(stats,
+                 stats->start_us +
+                 ((now_us - stats->start_us) / stats->window_us) * stats->window_us);
+
+    return had_values && (summary != NULL);
+}
+
+// Add a value
+bool stream_stats_add(stream_stats_t *stats,
+                      float value,
+                      int64_t timestamp_us,
+                      stream_stats_summary_t *summary)
+{
+    bool closed;
+    float delta;
+
+    closed = stream_stats_poll(stats, timestamp_us, summary);
+    if (isnan(value)) {
+        return closed;
+    }
+
+    // Count, extremes, and Welford's running mean and squared differences
+    stats->count++;
+    if ((stats->count == 1) || (value < stats->min)) {
+        stats->min = value;
+    }
+    if ((stats->count == 1) || (value > stats->max)) {
+        stats->max = value;
+    }
+    delta = value - stats->mean;
+    stats->mean += delta / (float)stats->count;
+    stats->m2 += delta * (value - stats->mean);
+
+    // Percentiles
+    for (uint8_t i = 0; i < stats->num_quantiles; i++) {
+        p2_add(&stats->p2[i], value, stats->count);
+    }
+
+    return closed;
+}
+
+// Summarize the current window without closing it
+void stream_stats_summarize(const stream_stats_t *stats, stream_stats_summary_t *summary)
+{
+    summary->start_us = stats->start_us;
+    summary->end_us = stats->start_us + stats->window_us;
+    summary->count = stats->count;
+    summary->min = stats->min;
+    summary->max = stats->max;
+    summary->mean = stats->mean;
+    summary->stddev = (stats->count > 1) ?
+                      sqrtf(fmaxf(stats->m2, 0.0f) / (float)(stats->count - 1)) : 0.0f;
+    summary->num_quantiles = stats->num_quantiles;
+    for (uint8_t i = 0; i < stats->num_quantiles; i++) {
+        summary->quantile_p[i] = stats->p2[i].p;
+        summary->quantile[i] = p2_value(&stats->p2[i], stats->count);
+    }
+}
+
+// Close the current window now and start the next one at end_us
+void stream_stats_close(stream_stats_t *stats, int64_t end_us, stream_stats_summary_t *summary)
+{
+    if (summary != NULL) {
+        stream_stats_summarize(stats, summary);
+        summary->end_us = end_us;
+    }
+    reset_window(stats, end_us);
+}
+
+// Add a summary to a telemetry message
+void stream_stats_encode(telemetry_encoder_t *enc,
+                         const char *name,
+                         const stream_stats_summary_t *summary)
+{
+    char key[KEY_MAX_LEN];
+    char suffix[8];
+    float percent;
+
+    snprintf(key, sizeof(key), "%s_n", name);
+    telemetry_encode_int(enc, key, summary->count);
+    if (summary->count == 0) {
+        return;
+    }
+
+    encode_field(enc, name, "min", summary->min);
+    encode_field(enc, name, "max", summary->max);
+    encode_field(enc, name, "mean", summary->mean);
+    encode_field(enc, name, "std", summary->stddev);
+
+    // p50, p90, p99, p99_9, ...
+    for (uint8_t i = 0; i < summary->num_quantiles; i++) {
+        percent = summary->quantile_p[i] * 100.0f;
+        if (fabsf(percent - roundf(percent)) < 0.001f) {
+            snprintf(suffix, sizeof(suffix), "p%d", (int)roundf(percent));
+        } else {
+            snprintf(suffix, sizeof(suffix), "p%d_%d",
+                     (int)percent, (int)roundf((percent - (float)(int)percent) * 10.0f));
+        }
+        encode_field(enc, name, suffix, summary->quantile[i]);
+    }
+}
@@ -0,0 +1,200 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Digits after the decimal point when writing floats as JSON
+ *        (trailing zeros are dropped)
+ */
+#ifndef TELEMETRY_FLOAT_DECIMALS
+# define TELEMETRY_FLOAT_DECIMALS 2
+#endif
+
+/**
+ * @brief Wire format
+ */
+typedef enum {
+    TELEMETRY_FORMAT_JSON = 0,  // {"key":value,...}
+    TELEMETRY_FORMAT_CBOR,      // CBOR map with text keys (RFC 8949)
+} telemetry_format_t;
+
+/**
+ * @brief Result of an encode or decode call
+ */
+typedef enum {
+    TELEMETRY_OK = 0,           // Success
+    TELEMETRY_END,              // Decoder: no more fields
+    TELEMETRY_ERR_NO_SPACE,     // Encoder: output buffer too small
+    TELEMETRY_ERR_INVALID,      // Malformed input or bad argument
+    TELEMETRY_ERR_UNSUPPORTED,  // Decoder: nested arrays/maps or tags
+} telemetry_result_t;
+
+/**
+ * @brief Type of a decoded value
+ */
+typedef enum {
+    TELEMETRY_TYPE_NULL = 0,
+    TELEMETRY_TYPE_INT,
+    TELEMETRY_TYPE_FLOAT,
+    TELEMETRY_TYPE_BOOL,
+    TELEMETRY_TYPE_STRING,
+} telemetry_type_t;
+
+typedef struct telemetry_backend telemetry_backend_t;
+
+/**
+ * @brief Encoder writing one flat key/value map into a caller buffer
+ *        (fields are private)
+ */
+typedef struct {
+    const telemetry_backend_t *backend;
+    uint8_t *buf;               // Output buffer
+    size_t size;                // Output buffer size (bytes)
+    size_t len;                 // Bytes written so far
+    uint32_t count;             // Fields written so far
+    bool overflow;              // Ran out of space (sticky)
+} telemetry_encoder_t;
+
+/**
+ * @brief One decoded field
+ *
+ * Keys and strings point into the input buffer and are not NUL-terminated.
+ * JSON escape sequences in them are left as-is.
+ */
+typedef struct {
+    const char *key;
+    size_t key_len;
+    telemetry_type_t type;
+    union {
+        int64_t i;
+        float f;
+        bool b;
+        struct {
+            const char *ptr;
+            size_t len;
+        } str;
+    } value;
+} telemetry_field_t;
+
+/**
+ * @brief Decoder reading one flat key/value map in place (fields are private)
+ */
+typedef struct {
+    const telemetry_backend_t *backend;
+    const uint8_t *data;        // Input
+    size_t len;                 // Input length (bytes)
+    size_t pos;                 // Read position
+    uint32_t count;             // Fields read so far
+    uint32_t remaining;         // CBOR: fields left (UINT32_MAX if indefinite)
+    bool done;                  // End of map reached
+} telemetry_decoder_t;
+
+/**
+ * @brief Start encoding a map into a caller-supplied buffer
+ *
+ * Nothing is allocated. Running out of space is remembered and reported by
+ * telemetry_encoder_finish(), so the field calls need no error checks.
+ *
+ * @param[out] enc Encoder to initialize
+ * @param[in] format Wire format
+ * @param[out] buf Output buffer
+ * @param[in] size Size of output buffer (bytes)
+ */
+void telemetry_encoder_init(telemetry_encoder_t *enc,
+                            telemetry_format_t format,
+                            uint8_t *buf,
+                            size_t size);
+
+/**
+ * @brief Add an integer field
+ *
+ * @param[in] enc Encoder
+ * @param[in] key Field name (NUL-terminated)
+ * @param[in] value Field value
+ */
+void telemetry_encode_int(telemetry_encoder_t *enc, const char *key, int64_t value);
+
+/**
+ * @brief Add a floating-point field
+ *
+ * JSON writes TELEMETRY_FLOAT_DECIMALS digits after the point (without
+ * trailing zeros). CBOR writes a half-precision float when that is exact,
+ * otherwise a single-precision float. NaN, infinity, and values too large
+ * to format are written as JSON null.
+ *
+ * @param[in] enc Encoder
+ * @param[in] key Field name (NUL-terminated)
+ * @param[in] value Field value
+ */
+void telemetry_encode_float(telemetry_encoder_t *enc, const char *key, float value);
+
+/**
+ * @brief Add a boolean field
+ *
+ * @param[in] enc Encoder
+ * @param[in] key Field name (NUL-terminated)
+ * @param[in] value Field value
+ */
+void telemetry_encode_bool(telemetry_encoder_t *enc, const char *key, bool value);
+
+/**
+ * @brief Add a string field
+ *
+ * @param[in] enc Encoder
+ * @param[in] key Field name (NUL-terminated)
+ * @param[in] value Field value (NUL-terminated)
+ */
+void telemetry_encode_string(telemetry_encoder_t *enc,
+                             const char *key,
+                             const char *value);
+
+/**
+ * @brief Close the map and get the encoded length
+ *
+ * JSON output is also NUL-terminated when there is room (not counted in len).
+ *
+ * @param[in] enc Encoder
+ * @param[out] len Encoded length (bytes)
+ *
+ * @return TELEMETRY_OK or TELEMETRY_ERR_NO_SPACE
+ */
+telemetry_result_t telemetry_encoder_finish(telemetry_encoder_t *enc, size_t *len);
+
+/**
+ * @brief Start decoding a map (e.g. the payload of a received message)
+ *
+ * @param[out] dec Decoder to initialize
+ * @param[in] format Wire format
+ * @param[in] data Encoded map (must outlive the decoder)
+ * @param[in] len Length of data (bytes)
+ *
+ * @return TELEMETRY_OK or TELEMETRY_ERR_INVALID if data is not a map
+ */
+telemetry_result_t telemetry_decoder_init(telemetry_decoder_t *dec,
+                                          telemetry_format_t format,
+                                          const uint8_t *data,
+                                          size_t len);
+
+/**
+ * @brief Read the next field of the map
+ *
+ * @param[in] dec Decoder
+ * @param[out] field Decoded field
+ *
+ * @return
+ *  - TELEMETRY_OK if a field was read
+ *  - TELEMETRY_END at the end of the map
+ *  - Other results on malformed or unsupported input
+ */
+telemetry_result_t telemetry_decoder_next(telemetry_decoder_t *dec,
+                                          telemetry_field_t *field);
+
+#endif // TELEMETRY_CODEC_H
@@ -0,0 +1,59 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TELEMETRY_BACKEND_H
+#define TELEMETRY_BACKEND_H
+
+#include <string.h>
+
+#include "telemetry_codec.h"
+
+/**
+ * @brief Wire format implementation (private to the component)
+ *
+ * The encoder calls key() before every value. The first field has
+ * enc->count == 0.
+ */
+struct telemetry_backend {
+    void (*begin)(telemetry_encoder_t *enc);
+    void (*key)(telemetry_encoder_t *enc, const char *key);
+    void (*put_int)(telemetry_encoder_t *enc, int64_t value);
+    void (*put_float)(telemetry_encoder_t *enc, float value);
+    void (*put_bool)(telemetry_encoder_t *enc, bool value);
+    void (*put_string)(telemetry_encoder_t *enc, const char *value);
+    void (*end)(telemetry_encoder_t *enc);
+    telemetry_result_t (*decode_begin)(telemetry_decoder_t *dec);
+    telemetry_result_t (*decode_next)(telemetry_decoder_t *dec,
+                                      telemetry_field_t *field);
+};
+
+// Available backends
+extern const telemetry_backend_t telemetry_json_backend;
+extern const telemetry_backend_t telemetry_cbor_backend;
+
+// Append bytes to the output, or remember that they did not fit
+static inline void telemetry_put(telemetry_encoder_t *enc,
+                                 const void *data,
+                                 size_t len)
+{
+    if (enc->overflow || (len > enc->size - enc->len)) {
+        enc->overflow = true;
+        return;
+    }
+    memcpy(&enc->buf[enc->len], data, len);
+    enc->len += len;
+}
+
+// Append one byte to the output
+static inline void telemetry_put_byte(telemetry_encoder_t *enc, uint8_t byte)
+{
+    if (enc->overflow || (enc->len >= enc->size)) {
+        enc->overflow = true;
+        return;
+    }
+    enc->buf[enc->len++] = byte;
+}
+
+#endif // TELEMETRY_BACKEND_H
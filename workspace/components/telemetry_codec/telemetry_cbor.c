@@ -0,0 +1,450 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * CBOR backend for the telemetry codec (RFC 8949).
+ *
+ * A map is written with a one-byte header that is patched with the field
+ * count at the end (up to 23 fields). Larger maps keep the indefinite-length
+ * header and get a break byte instead, so nothing has to be moved. Integers
+ * use the shortest encoding, and floats are written as half precision when
+ * that loses nothing, which covers most sensor readings such as 25.0 or
+ * 21.5.
+ */
+
+#include "telemetry_backend.h"
+
+// Major types
+#define CBOR_UINT           0
+#define CBOR_NEGINT         1
+#define CBOR_BYTES          2
+#define CBOR_TEXT           3
+#define CBOR_ARRAY          4
+#define CBOR_MAP            5
+#define CBOR_TAG            6
+#define CBOR_SIMPLE         7
+
+// Additional information values
+#define CBOR_AI_1BYTE       24
+#define CBOR_AI_2BYTE       25
+#define CBOR_AI_4BYTE       26
+#define CBOR_AI_8BYTE       27
+#define CBOR_AI_INDEFINITE  31
+
+// Simple values
+#define CBOR_FALSE          0xF4
+#define CBOR_TRUE           0xF5
+#define CBOR_NULL           0xF6
+#define CBOR_UNDEFINED      0xF7
+#define CBOR_HALF           0xF9
+#define CBOR_FLOAT          0xFA
+#define CBOR_DOUBLE         0xFB
+#define CBOR_BREAK          0xFF
+
+// Largest map whose size fits in the header byte
+#define MAP_SMALL_MAX       23
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static void put_head(telemetry_encoder_t *enc, uint8_t major, uint64_t value);
+static bool float_to_half(float value, uint16_t *half);
+static float half_to_float(uint16_t half);
+static void cbor_begin(telemetry_encoder_t *enc);
+static void cbor_key(telemetry_encoder_t *enc, const char *key);
+static void cbor_put_int(telemetry_encoder_t *enc, int64_t value);
+static void cbor_put_float(telemetry_encoder_t *enc, float value);
+static void cbor_put_bool(telemetry_encoder_t *enc, bool value);
+static void cbor_put_string(telemetry_encoder_t *enc, const char *value);
+static void cbor_end(telemetry_encoder_t *enc);
+static telemetry_result_t read_head(telemetry_decoder_t *dec,
+                                    uint8_t *major,
+                                    uint8_t *info,
+                                    uint64_t *value);
+static telemetry_result_t read_text(telemetry_decoder_t *dec,
+                                    uint64_t len,
+                                    const char **str,
+                                    size_t *str_len);
+static telemetry_result_t cbor_decode_begin(telemetry_decoder_t *dec);
+static telemetry_result_t cbor_decode_next(telemetry_decoder_t *dec,
+                                           telemetry_field_t *field);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Write a major type with its argument in the shortest form
+static void put_head(telemetry_encoder_t *enc, uint8_t major, uint64_t value)
+{
+    uint8_t tmp[9];
+    size_t len;
+
+    major <<= 5;
+    if (value < CBOR_AI_1BYTE) {
+        telemetry_put_byte(enc, major | (uint8_t)value);
+        return;
+    }
+    if (value <= UINT8_MAX) {
+        tmp[0] = major | CBOR_AI_1BYTE;
+        len = 1;
+    } else if (value <= UINT16_MAX) {
+        tmp[0] = major | CBOR_AI_2BYTE;
+        len = 2;
+    } else if (value <= UINT32_MAX) {
+        tmp[0] = major | CBOR_AI_4BYTE;
+        len = 4;
+    } else {
+        tmp[0] = major | CBOR_AI_8BYTE;
+        len = 8;
+    }
+
+    // Argument is big-endian
+    for (size_t i = 0; i < len; i++) {
+        tmp[len - i] = (uint8_t)(value >> (8 * i));
+    }
+    telemetry_put(enc, tmp, len + 1);
+}
+
+// Convert to half precision if no information is lost
+static bool float_to_half(float value, uint16_t *half)
+{
+    uint32_t bits;
+    uint32_t sign;
+    int32_t exp;
+    uint32_t mant;
+    uint32_t shift;
+
+    memcpy(&bits, &value, sizeof(bits));
+    sign = (bits >> 16) & 0x8000;
+    exp = (int32_t)((bits >> 23) & 0xFF);
+    mant = bits & 0x7FFFFF;
+
+    // Zero, infinity, and NaN
+    if ((exp == 0) && (mant == 0)) {
+        *half = (uint16_t)sign;
+        return true;
+    }
+    if (exp == 0xFF) {
+        *half = (uint16_t)(sign | 0x7C00 | ((mant != 0) ? 0x0200 : 0));
+        return true;
+    }
+
+    // Rebias the exponent (float bias 127, half bias 15)
+    exp = exp - 127 + 15;
+    if (exp >= 0x1F) {
+        return false;
+    }
+
+    // Normal half: the 13 low mantissa bits must be zero
+    if (exp > 0) {
+        if ((mant & 0x1FFF) != 0) {
+            return false;
+        }
+        *half = (uint16_t)(sign | ((uint32_t)exp << 10) | (mant >> 13));
+        return true;
+    }
+
+    // Subnormal half: shift in the implicit bit, nothing may fall off
+    shift = (uint32_t)(14 - exp);
+    if ((exp == -127 + 15) || (shift > 24)) {
+        return false;
+    }
+    mant |= 0x800000;
+    if ((mant & ((1UL << shift) - 1)) != 0) {
+        return false;
+    }
+    *half = (uint16_t)(sign | (mant >> shift));
+
+    return true;
+}
+
+// Convert half precision to float
+static float half_to_float(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exp = (half >> 10) & 0x1F;
+    uint32_t mant = half & 0x3FF;
+    uint32_t bits;
+    float value;
+
+    if (exp == 0x1F) {
+        bits = sign | 0x7F800000 | (mant << 13);
+    } else if (exp != 0) {
+        bits = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+    } else {
+        // Subnormal (or zero): value is mant * 2^-24
+        value = (float)mant / 16777216.0f;
+        return sign ? -value : value;
+    }
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+// Write an indefinite-length map header (patched in cbor_end())
+static void cbor_begin(telemetry_encoder_t *enc)
+{
+    telemetry_put_byte(enc, (CBOR_MAP << 5) | CBOR_AI_INDEFINITE);
+}
+
+// Write a text-string key
+static void cbor_key(telemetry_encoder_t *enc, const char *key)
+{
+    cbor_put_string(enc, key);
+}
+
+// Write an integer value
+static void cbor_put_int(telemetry_encoder_t *enc, int64_t value)
+{
+    if (value >= 0) {
+        put_head(enc, CBOR_UINT, (uint64_t)value);
+    } else {
+        put_head(enc, CBOR_NEGINT, (uint64_t)(-(value + 1)));
+    }
+}
+
+// Write a float value (half precision when exact)
+static void cbor_put_float(telemetry_encoder_t *enc, float value)
+{
+    uint8_t tmp[5];
+    uint16_t half;
+    uint32_t bits;
+
+    if (float_to_half(value, &half)) {
+        tmp[0] = CBOR_HALF;
+        tmp[1] = (uint8_t)(half >> 8);
+        tmp[2] = (uint8_t)half;
+        telemetry_put(enc, tmp, 3);
+        return;
+    }
+    memcpy(&bits, &value, sizeof(bits));
+    tmp[0] = CBOR_FLOAT;
+    tmp[1] = (uint8_t)(bits >> 24);
+    tmp[2] = (uint8_t)(bits >> 16);
+    tmp[3] = (uint8_t)(bits >> 8);
+    tmp[4] = (uint8_t)bits;
+    telemetry_put(enc, tmp, sizeof(tmp));
+}
+
+// Write a boolean value
+static void cbor_put_bool(telemetry_encoder_t *enc, bool value)
+{
+    telemetry_put_byte(enc, value ? CBOR_TRUE : CBOR_FALSE);
+}
+
+// Write a text-string value
+static void cbor_put_string(telemetry_encoder_t *enc, const char *value)
+{
+    size_t len = strlen(value);
+
+    put_head(enc, CBOR_TEXT, len);
+    telemetry_put(enc, value, len);
+}
+
+// Patch in the field count, or close an indefinite map
+static void cbor_end(telemetry_encoder_t *enc)
+{
+    if (enc->count <= MAP_SMALL_MAX) {
+        enc->buf[0] = (CBOR_MAP << 5) | (uint8_t)enc->count;
+    } else {
+        telemetry_put_byte(enc, CBOR_BREAK);
+    }
+}
+
+// Read a data item head (major type, additional info, and argument)
+static telemetry_result_t read_head(telemetry_decoder_t *dec,
+                                    uint8_t *major,
+                                    uint8_t *info,
+                                    uint64_t *value)
+{
+    size_t len;
+    uint8_t byte;
+
+    if (dec->pos >= dec->len) {
+        return TELEMETRY_ERR_INVALID;
+    }
+    byte = dec->data[dec->pos++];
+    *major = byte >> 5;
+    *info = byte & 0x1F;
+    *value = *info;
+
+    // Argument in the head byte, or indefinite length
+    if ((*info < CBOR_AI_1BYTE) || (*info == CBOR_AI_INDEFINITE)) {
+        return TELEMETRY_OK;
+    }
+    if (*info > CBOR_AI_8BYTE) {
+        return TELEMETRY_ERR_INVALID;
+    }
+
+    // Big-endian argument of 1, 2, 4, or 8 bytes
+    len = (size_t)1 << (*info - CBOR_AI_1BYTE);
+    if (dec->len - dec->pos < len) {
+        return TELEMETRY_ERR_INVALID;
+    }
+    *value = 0;
+    for (size_t i = 0; i < len; i++) {
+        *value = (*value << 8) | dec->data[dec->pos++];
+    }
+
+    return TELEMETRY_OK;
+}
+
+// Point at a definite-length string in the input
+static telemetry_result_t read_text(telemetry_decoder_t *dec,
+                                    uint64_t len,
+                                    const char **str,
+                                    size_t *str_len)
+{
+    if (len > dec->len - dec->pos) {
+        return TELEMETRY_ERR_INVALID;
+    }
+    *str = (const char *)&dec->data[dec->pos];
+    *str_len = (size_t)len;
+    dec->pos += (size_t)len;
+
+    return TELEMETRY_OK;
+}
+
+// Read the map header
+static telemetry_result_t cbor_decode_begin(telemetry_decoder_t *dec)
+{
+    telemetry_result_t ret;
+    uint8_t major;
+    uint8_t info;
+    uint64_t value;
+
+    ret = read_head(dec, &major, &info, &value);
+    if ((ret != TELEMETRY_OK) || (major != CBOR_MAP)) {
+        return TELEMETRY_ERR_INVALID;
+    }
+    if (info == CBOR_AI_INDEFINITE) {
+        dec->remaining = UINT32_MAX;
+    } else {
+        dec->remaining = (value > UINT32_MAX - 1) ? UINT32_MAX - 1 : (uint32_t)value;
+    }
+
+    return TELEMETRY_OK;
+}
+
+// Read one key/value pair (or the end of the map)
+static telemetry_result_t cbor_decode_next(telemetry_decoder_t *dec,
+                                           telemetry_field_t *field)
+{
+    telemetry_result_t ret;
+    uint8_t major;
+    uint8_t info;
+    uint64_t value;
+    uint32_t bits;
+    double dbl;
+
+    // End of a definite map, or break byte of an indefinite one
+    if (dec->remaining == 0) {
+        return TELEMETRY_END;
+    }
+    if (dec->remaining == UINT32_MAX) {
+        if (dec->pos >= dec->len) {
+            return TELEMETRY_ERR_INVALID;
+        }
+        if (dec->data[dec->pos] == CBOR_BREAK) {
+            dec->pos++;
+            return TELEMETRY_END;
+        }
+    } else {
+        dec->remaining--;
+    }
+
+    // Key must be a definite-length text string
+    ret = read_head(dec, &major, &info, &value);
+    if (ret != TELEMETRY_OK) {
+        return ret;
+    }
+    if ((major != CBOR_TEXT) || (info == CBOR_AI_INDEFINITE)) {
+        return TELEMETRY_ERR_UNSUPPORTED;
+    }
+    ret = read_text(dec, value, &field->key, &field->key_len);
+    if (ret != TELEMETRY_OK) {
+        return ret;
+    }
+
+    // Value
+    ret = read_head(dec, &major, &info, &value);
+    if (ret != TELEMETRY_OK) {
+        return ret;
+    }
+    if ((info == CBOR_AI_INDEFINITE) && (major != CBOR_SIMPLE)) {
+        return TELEMETRY_ERR_UNSUPPORTED;
+    }
+    switch (major) {
+        case CBOR_UINT:
+            if (value > (uint64_t)INT64_MAX) {
+                return TELEMETRY_ERR_UNSUPPORTED;
+            }
+            field->type = TELEMETRY_TYPE_INT;
+            field->value.i = (int64_t)value;
+            return TELEMETRY_OK;
+        case CBOR_NEGINT:
+            if (value > (uint64_t)INT64_MAX) {
+                return TELEMETRY_ERR_UNSUPPORTED;
+            }
+            field->type = TELEMETRY_TYPE_INT;
+            field->value.i = -1 - (int64_t)value;
+            return TELEMETRY_OK;
+        case CBOR_BYTES:
+        case CBOR_TEXT:
+            field->type = TELEMETRY_TYPE_STRING;
+            return read_text(dec, value, &field->value.str.ptr, &field->value.str.len);
+        case CBOR_SIMPLE:
+            break;
+        default:
+            return TELEMETRY_ERR_UNSUPPORTED;
+    }
+
+    // Simple values and floats
+    switch (info) {
+        case CBOR_FALSE & 0x1F:
+        case CBOR_TRUE & 0x1F:
+            field->type = TELEMETRY_TYPE_BOOL;
+            field->value.b = (info == (CBOR_TRUE & 0x1F));
+            return TELEMETRY_OK;
+        case CBOR_NULL & 0x1F:
+        case CBOR_UNDEFINED & 0x1F:
+            field->type = TELEMETRY_TYPE_NULL;
+            return TELEMETRY_OK;
+        case CBOR_AI_2BYTE:
+            field->type = TELEMETRY_TYPE_FLOAT;
+            field->value.f = half_to_float((uint16_t)value);
+            return TELEMETRY_OK;
+        case CBOR_AI_4BYTE:
+            bits = (uint32_t)value;
+            field->type = TELEMETRY_TYPE_FLOAT;
+            memcpy(&field->value.f, &bits, sizeof(bits));
+            return TELEMETRY_OK;
+        case CBOR_AI_8BYTE:
+            memcpy(&dbl, &value, sizeof(dbl));
+            field->type = TELEMETRY_TYPE_FLOAT;
+            field->value.f = (float)dbl;
+            return TELEMETRY_OK;
+        default:
+            return TELEMETRY_ERR_INVALID;
+    }
+}
+
+/*******************************************************************************
+ * Public data
+ */
+
+// CBOR backend
+const telemetry_backend_t telemetry_cbor_backend = {
+    .begin = cbor_begin,
+    .key = cbor_key,
+    .put_int = cbor_put_int,
+    .put_float = cbor_put_float,
+    .put_bool = cbor_put_bool,
+    .put_string = cbor_put_string,
+    .end = cbor_end,
+    .decode_begin = cbor_decode_begin,
+    .decode_next = cbor_decode_next,
+};
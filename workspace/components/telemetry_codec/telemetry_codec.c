@@ -0,0 +1,168 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Telemetry payload encoder/decoder.
+ *
+ * Applications build a flat map of named values through one API, and the
+ * selected backend (telemetry_json.c or telemetry_cbor.c) writes it in its
+ * wire format directly into the caller's buffer. The decoder walks a
+ * received map in place and returns one typed field at a time.
+ */
+
+#include "telemetry_backend.h"
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static const telemetry_backend_t *get_backend(telemetry_format_t format);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Look up the backend for a wire format
+static const telemetry_backend_t *get_backend(telemetry_format_t format)
+{
+    switch (format) {
+        case TELEMETRY_FORMAT_JSON:
+            return &telemetry_json_backend;
+        case TELEMETRY_FORMAT_CBOR:
+            return &telemetry_cbor_backend;
+        default:
+            return NULL;
+    }
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Start encoding a map into a caller-supplied buffer
+void telemetry_encoder_init(telemetry_encoder_t *enc,
+                            telemetry_format_t format,
+                            uint8_t *buf,
+                            size_t size)
+{
+    enc->backend = get_backend(format);
+    enc->buf = buf;
+    enc->size = size;
+    enc->len = 0;
+    enc->count = 0;
+    enc->overflow = (enc->backend == NULL);
+    if (enc->backend != NULL) {
+        enc->backend->begin(enc);
+    }
+}
+
+// Add an integer field
+void telemetry_encode_int(telemetry_encoder_t *enc, const char *key, int64_t value)
+{
+    if (enc->overflow) {
+        return;
+    }
+    enc->backend->key(enc, key);
+    enc->backend->put_int(enc, value);
+    enc->count++;
+}
+
+// Add a floating-point field
+void telemetry_encode_float(telemetry_encoder_t *enc, const char *key, float value)
+{
+    if (enc->overflow) {
+        return;
+    }
+    enc->backend->key(enc, key);
+    enc->backend->put_float(enc, value);
+    enc->count++;
+}
+
+// Add a boolean field
+void telemetry_encode_bool(telemetry_encoder_t *enc, const char *key, bool value)
+{
+    if (enc->overflow) {
+        return;
+    }
+    enc->backend->key(enc, key);
+    enc->backend->put_bool(enc, value);
+    enc->count++;
+}
+
+// Add a string field
+void telemetry_encode_string(telemetry_encoder_t *enc,
+                             const char *key,
+                             const char *value)
+{
+    if (enc->overflow) {
+        return;
+    }
+    enc->backend->key(enc, key);
+    enc->backend->put_string(enc, value);
+    enc->count++;
+}
+
+// Close the map and get the encoded length
+telemetry_result_t telemetry_encoder_finish(telemetry_encoder_t *enc, size_t *len)
+{
+    if (!enc->overflow) {
+        enc->backend->end(enc);
+    }
+    if (enc->overflow) {
+        *len = 0;
+        return TELEMETRY_ERR_NO_SPACE;
+    }
+    *len = enc->len;
+
+    return TELEMETRY_OK;
+}
+
+// Start decoding a map
+telemetry_result_t telemetry_decoder_init(telemetry_decoder_t *dec,
+                                          telemetry_format_t format,
+                                          const uint8_t *data,
+                                          size_t len)
+{
+    telemetry_result_t ret;
+
+    dec->backend = get_backend(format);
+    dec->data = data;
+    dec->len = len;
+    dec->pos = 0;
+    dec->count = 0;
+    dec->remaining = 0;
+    dec->done = true;
+    if ((dec->backend == NULL) || (data == NULL)) {
+        return TELEMETRY_ERR_INVALID;
+    }
+    dec->done = false;
+
+    // Read the map header (an empty map is done right away)
+    ret = dec->backend->decode_begin(dec);
+    if (ret != TELEMETRY_OK) {
+        dec->done = true;
+    }
+
+    return ret;
+}
+
+// Read the next field of the map
+telemetry_result_t telemetry_decoder_next(telemetry_decoder_t *dec,
+                                          telemetry_field_t *field)
+{
+    telemetry_result_t ret;
+
+    if (dec->done) {
+        return TELEMETRY_END;
+    }
+    ret = dec->backend->decode_next(dec, field);
+    if (ret == TELEMETRY_OK) {
+        dec->count++;
+    } else {
+        dec->done = true;
+    }
+
+    return ret;
+}
@@ -0,0 +1,434 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * JSON backend for the telemetry codec.
+ *
+ * Numbers are formatted with integer arithmetic instead of printf, which is
+ * much faster on targets without double-precision hardware and pulls in no
+ * float printf support. Floats are rounded to a fixed number of decimals.
+ * The decoder accepts one flat object of strings, numbers, booleans, and
+ * nulls.
+ */
+
+#include <math.h>
+
+#include "telemetry_backend.h"
+
+// Powers of ten used for formatting and parsing
+static const float s_pow10[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f,
+};
+#define POW10_MAX       10
+
+// Largest scaled float that still fits in an int64_t
+#define FIXED_MAX       9.2e18f
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static void put_digits(telemetry_encoder_t *enc,
+                       int64_t value,
+                       unsigned int decimals);
+static void put_quoted(telemetry_encoder_t *enc, const char *str);
+static void json_begin(telemetry_encoder_t *enc);
+static void json_key(telemetry_encoder_t *enc, const char *key);
+static void json_put_int(telemetry_encoder_t *enc, int64_t value);
+static void json_put_float(telemetry_encoder_t *enc, float value);
+static void json_put_bool(telemetry_encoder_t *enc, bool value);
+static void json_put_string(telemetry_encoder_t *enc, const char *value);
+static void json_end(telemetry_encoder_t *enc);
+static int skip_space(telemetry_decoder_t *dec);
+static telemetry_result_t read_string(telemetry_decoder_t *dec,
+                                      const char **str,
+                                      size_t *len);
+static telemetry_result_t read_literal(telemetry_decoder_t *dec,
+                                       const char *literal,
+                                       size_t len);
+static telemetry_result_t read_number(telemetry_decoder_t *dec,
+                                      telemetry_field_t *field);
+static telemetry_result_t json_decode_begin(telemetry_decoder_t *dec);
+static telemetry_result_t json_decode_next(telemetry_decoder_t *dec,
+                                           telemetry_field_t *field);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Write a fixed-point number: value / 10^decimals
+static void put_digits(telemetry_encoder_t *enc,
+                       int64_t value,
+                       unsigned int decimals)
+{
+    char tmp[24];
+    char *p = &tmp[sizeof(tmp)];
+    bool neg = (value < 0);
+    uint64_t mag = neg ? (0 - (uint64_t)value) : (uint64_t)value;
+    uint32_t mag32;
+
+    // Fraction digits (least significant first)
+    for (unsigned int i = 0; i < decimals; i++) {
+        *--p = (char)('0' + (mag % 10));
+        mag /= 10;
+    }
+    if (decimals > 0) {
+        *--p = '.';
+    }
+
+    // Integer digits (32-bit division is much cheaper on 32-bit targets)
+    while (mag > UINT32_MAX) {
+        *--p = (char)('0' + (mag % 10));
+        mag /= 10;
+    }
+    mag32 = (uint32_t)mag;
+    do {
+        *--p = (char)('0' + (mag32 % 10));
+        mag32 /= 10;
+    } while (mag32 > 0);
+    if (neg) {
+        *--p = '-';
+    }
+
+    telemetry_put(enc, p, (size_t)(&tmp[sizeof(tmp)] - p));
+}
+
+// Write a string in quotes, escaping only what JSON requires
+static void put_quoted(telemetry_encoder_t *enc, const char *str)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *run = str;
+    char esc[6] = {'\\', 'u', '0', '0', '0', '0'};
+    uint8_t c;
+
+    telemetry_put_byte(enc, '"');
+    for (; *str != '\0'; str++) {
+        c = (uint8_t)*str;
+        if ((c >= 0x20) && (c != '"') && (c != '\\')) {
+            continue;
+        }
+
+        // Copy the run of plain characters, then the escape
+        telemetry_put(enc, run, (size_t)(str - run));
+        if (c >= 0x20) {
+            esc[1] = (char)c;
+            telemetry_put(enc, esc, 2);
+            esc[1] = 'u';
+        } else {
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 0x0F];
+            telemetry_put(enc, esc, sizeof(esc));
+        }
+        run = str + 1;
+    }
+    telemetry_put(enc, run, (size_t)(str - run));
+    telemetry_put_byte(enc, '"');
+}
+
+// Open the object
+static void json_begin(telemetry_encoder_t *enc)
+{
+    telemetry_put_byte(enc, '{');
+}
+
+// Write "key": (with a separator after the first field)
+static void json_key(telemetry_encoder_t *enc, const char *key)
+{
+    if (enc->count > 0) {
+        telemetry_put_byte(enc, ',');
+    }
+    put_quoted(enc, key);
+    telemetry_put_byte(enc, ':');
+}
+
+// Write an integer value
+static void json_put_int(telemetry_encoder_t *enc, int64_t value)
+{
+    put_digits(enc, value, 0);
+}
+
+// Write a float value rounded to TELEMETRY_FLOAT_DECIMALS
+static void json_put_float(telemetry_encoder_t *enc, float value)
+{
+    unsigned int decimals = TELEMETRY_FLOAT_DECIMALS;
+    float scaled;
+    int64_t fixed;
+
+    // JSON has no NaN or infinity
+    scaled = value * s_pow10[decimals];
+    if (!isfinite(scaled) || (fabsf(scaled) >= FIXED_MAX)) {
+        telemetry_put(enc, "null", 4);
+        return;
+    }
+
+    // Round to fixed point and drop trailing zeros
+    fixed = (int64_t)(scaled + ((scaled < 0.0f) ? -0.5f : 0.5f));
+    while ((decimals > 0) && ((fixed % 10) == 0)) {
+        fixed /= 10;
+        decimals--;
+    }
+
+    put_digits(enc, fixed, decimals);
+}
+
+// Write a boolean value
+static void json_put_bool(telemetry_encoder_t *enc, bool value)
+{
+    if (value) {
+        telemetry_put(enc, "true", 4);
+    } else {
+        telemetry_put(enc, "false", 5);
+    }
+}
+
+// Write a string value
+static void json_put_string(telemetry_encoder_t *enc, const char *value)
+{
+    put_quoted(enc, value);
+}
+
+// Close the object and NUL-terminate if there is room
+static void json_end(telemetry_encoder_t *enc)
+{
+    telemetry_put_byte(enc, '}');
+    if (!enc->overflow && (enc->len < enc->size)) {
+        enc->buf[enc->len] = '\0';
+    }
+}
+
+// Skip whitespace and return the next character (-1 at end of input)
+static int skip_space(telemetry_decoder_t *dec)
+{
+    uint8_t c;
+
+    while (dec->pos < dec->len) {
+        c = dec->data[dec->pos];
+        if ((c != ' ') && (c != '\t') && (c != '\r') && (c != '\n')) {
+            return c;
+        }
+        dec->pos++;
+    }
+
+    return -1;
+}
+
+// Read a quoted string in place (escapes are kept, not decoded)
+static telemetry_result_t read_string(telemetry_decoder_t *dec,
+                                      const char **str,
+                                      size_t *len)
+{
+    size_t start;
+    uint8_t c;
+
+    if ((dec->pos >= dec->len) || (dec->data[dec->pos] != '"')) {
+        return TELEMETRY_ERR_INVALID;
+    }
+    start = ++dec->pos;
+
+    // Find the closing quote, stepping over escaped characters
+    while (dec->pos < dec->len) {
+        c = dec->data[dec->pos];
+        if (c == '"') {
+            *str = (const char *)&dec->data[start];
+            *len = dec->pos - start;
+            dec->pos++;
+            return TELEMETRY_OK;
+        }
+        if (c < 0x20) {
+            return TELEMETRY_ERR_INVALID;
+        }
+        dec->pos += (c == '\\') ? 2 : 1;
+    }
+
+    return TELEMETRY_ERR_INVALID;
+}
+
+// Match true, false, or null
+static telemetry_result_t read_literal(telemetry_decoder_t *dec,
+                                       const char *literal,
+                                       size_t len)
+{
+    if ((dec->len - dec->pos < len) ||
+        (memcmp(&dec->data[dec->pos], literal, len) != 0)) {
+        return TELEMETRY_ERR_INVALID;
+    }
+    dec->pos += len;
+
+    return TELEMETRY_OK;
+}
+
+// Read a number as an integer, or as a float if it has a fraction/exponent
+static telemetry_result_t read_number(telemetry_decoder_t *dec,
+                                      telemetry_field_t *field)
+{
+    uint64_t mant = 0;
+    int exp10 = 0;
+    int exp_val = 0;
+    bool neg = false;
+    bool exp_neg = false;
+    bool is_float = false;
+    unsigned int digits = 0;
+    float value;
+    uint8_t c;
+
+    // Sign
+    if ((dec->pos < dec->len) && (dec->data[dec->pos] == '-')) {
+        neg = true;
+        dec->pos++;
+    }
+
+    // Integer and fraction digits (keep 19 significant digits)
+    while (dec->pos < dec->len) {
+        c = dec->data[dec->pos];
+        if ((c >= '0') && (c <= '9')) {
+            if (mant < 1000000000000000000ULL) {
+                mant = (mant * 10) + (c - '0');
+                exp10 -= is_float ? 1 : 0;
+            } else {
+                exp10 += is_float ? 0 : 1;
+            }
+            digits++;
+        } else if ((c == '.') && !is_float) {
+            is_float = true;
+        } else {
+            break;
+        }
+        dec->pos++;
+    }
+    if (digits == 0) {
+        return TELEMETRY_ERR_INVALID;
+    }
+
+    // Exponent
+    if ((dec->pos < dec->len) &&
+        ((dec->data[dec->pos] == 'e') || (dec->data[dec->pos] == 'E'))) {
+        is_float = true;
+        dec->pos++;
+        if ((dec->pos < dec->len) &&
+            ((dec->data[dec->pos] == '+') || (dec->data[dec->pos] == '-'))) {
+            exp_neg = (dec->data[dec->pos] == '-');
+            dec->pos++;
+        }
+        digits = 0;
+        while ((dec->pos < dec->len) &&
+               (dec->data[dec->pos] >= '0') && (dec->data[dec->pos] <= '9')) {
+            if (exp_val < 1000) {
+                exp_val = (exp_val * 10) + (dec->data[dec->pos] - '0');
+            }
+            digits++;
+            dec->pos++;
+        }
+        if (digits == 0) {
+            return TELEMETRY_ERR_INVALID;
+        }
+        exp10 += exp_neg ? -exp_val : exp_val;
+    }
+
+    // Integer that fits
+    if (!is_float && (exp10 == 0) && (mant <= (uint64_t)INT64_MAX + neg)) {
+        field->type = TELEMETRY_TYPE_INT;
+        field->value.i = neg ? -(int64_t)(mant - 1) - 1 : (int64_t)mant;
+        return TELEMETRY_OK;
+    }
+
+    // Scale the mantissa by the decimal exponent
+    value = (float)mant;
+    while ((exp10 > 0) && (value != 0.0f) && isfinite(value)) {
+        value *= s_pow10[(exp10 > POW10_MAX) ? POW10_MAX : exp10];
+        exp10 -= (exp10 > POW10_MAX) ? POW10_MAX : exp10;
+    }
+    while ((exp10 < 0) && (value != 0.0f)) {
+        value /= s_pow10[(-exp10 > POW10_MAX) ? POW10_MAX : -exp10];
+        exp10 += (-exp10 > POW10_MAX) ? POW10_MAX : -exp10;
+    }
+    field->type = TELEMETRY_TYPE_FLOAT;
+    field->value.f = neg ? -value : value;
+
+    return TELEMETRY_OK;
+}
+
+// Expect the opening brace
+static telemetry_result_t json_decode_begin(telemetry_decoder_t *dec)
+{
+    if (skip_space(dec) != '{') {
+        return TELEMETRY_ERR_INVALID;
+    }
+    dec->pos++;
+
+    return TELEMETRY_OK;
+}
+
+// Read "key": value (or the closing brace)
+static telemetry_result_t json_decode_next(telemetry_decoder_t *dec,
+                                           telemetry_field_t *field)
+{
+    telemetry_result_t ret;
+    int c;
+
+    // End of object, or separator before every field but the first
+    c = skip_space(dec);
+    if (c == '}') {
+        dec->pos++;
+        return TELEMETRY_END;
+    }
+    if (dec->count > 0) {
+        if (c != ',') {
+            return TELEMETRY_ERR_INVALID;
+        }
+        dec->pos++;
+        skip_space(dec);
+    }
+
+    // Key
+    ret = read_string(dec, &field->key, &field->key_len);
+    if (ret != TELEMETRY_OK) {
+        return ret;
+    }
+    if (skip_space(dec) != ':') {
+        return TELEMETRY_ERR_INVALID;
+    }
+    dec->pos++;
+
+    // Value
+    c = skip_space(dec);
+    switch (c) {
+        case '"':
+            field->type = TELEMETRY_TYPE_STRING;
+            return read_string(dec, &field->value.str.ptr, &field->value.str.len);
+        case 't':
+            field->type = TELEMETRY_TYPE_BOOL;
+            field->value.b = true;
+            return read_literal(dec, "true", 4);
+        case 'f':
+            field->type = TELEMETRY_TYPE_BOOL;
+            field->value.b = false;
+            return read_literal(dec, "false", 5);
+        case 'n':
+            field->type = TELEMETRY_TYPE_NULL;
+            return read_literal(dec, "null", 4);
+        case '{':
+        case '[':
+            return TELEMETRY_ERR_UNSUPPORTED;
+        default:
+            return read_number(dec, field);
+    }
+}
+
+/*******************************************************************************
+ * Public data
+ */
+
+// JSON backend
+const telemetry_backend_t telemetry_json_backend = {
+    .begin = json_begin,
+    .key = json_key,
+    .put_int = json_put_int,
+    .put_float = json_put_float,
+    .put_bool = json_put_bool,
+    .put_string = json_put_string,
+    .end = json_end,
+    .decode_begin = json_decode_begin,
+    .decode_next = json_decode_next,
+};
@@ -0,0 +1,96 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TLS_CLIENT_PROFILE_H
+#define TLS_CLIENT_PROFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+
+/**
+ * @brief Long-lived TLS client state shared by all connections
+ *
+ * Holds everything that does not change between connections: the TLS
+ * configuration, the seeded random number generator, and the trust store.
+ * The profile must outlive every TLS context set up from it.
+ */
+typedef struct {
+    mbedtls_ssl_config conf;            // TLS configuration
+    mbedtls_entropy_context entropy;    // Entropy source for the DRBG
+    mbedtls_ctr_drbg_context ctr_drbg;  // Cryptographically secure PRNG
+    mbedtls_x509_crt ca_cert;           // Root CA certificates
+    bool initialized;
+} tls_client_profile_t;
+
+/**
+ * @brief Build a TLS client profile (call once at boot)
+ *
+ * Seeds the CTR-DRBG, attaches the ESP-IDF certificate bundle, and sets up a
+ * client configuration that requires server certificate verification.
+ *
+ * @param[out] profile Profile to initialize
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t tls_client_profile_init(tls_client_profile_t *profile);
+
+/**
+ * @brief Free all resources held by a TLS client profile
+ *
+ * @param[in] profile Profile to free
+ */
+void tls_client_profile_deinit(tls_client_profile_t *profile);
+
+/**
+ * @brief Set up a per-connection TLS context from the profile
+ *
+ * Initializes the TLS context, binds it to the profile's configuration, sets
+ * the expected server hostname, and sets the socket I/O callbacks. Free the
+ * context with mbedtls_ssl_free() when the session is over.
+ *
+ * @param[in] profile Initialized profile
+ * @param[out] ssl TLS context to set up
+ * @param[in] net Socket context used for I/O
+ * @param[in] hostname Server hostname (must match server certificate)
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t tls_client_profile_ssl_setup(tls_client_profile_t *profile,
+                                       mbedtls_ssl_context *ssl,
+                                       mbedtls_net_context *net,
+                                       const char *hostname);
+
+/**
+ * @brief Trust an extra root CA (e.g. a private CA for a local server)
+ *
+ * Certificates that chain to this CA are accepted in addition to those in the
+ * ESP-IDF certificate bundle. Call before connecting.
+ *
+ * @param[in] profile Initialized profile
+ * @param[in] pem PEM certificate, NUL-terminated
+ * @param[in] len Length of the PEM data including the NUL
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_STATE if the profile is not initialized
+ *  - ESP_FAIL if the certificate could not be parsed
+ */
+esp_err_t tls_client_profile_add_ca(tls_client_profile_t *profile,
+                                    const uint8_t *pem,
+                                    size_t len);
+
+#endif // TLS_CLIENT_PROFILE_H
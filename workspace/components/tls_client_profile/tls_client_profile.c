@@ -0,0 +1,188 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include "mbedtls/esp_debug.h"
+#include "mbedtls/ssl.h"
+#ifdef CONFIG_MBEDTLS_SSL_PROTO_TLS1_3
+# include "psa/crypto.h"
+#endif
+
+#include "tls_client_profile.h"
+
+// Tag for debug messages
+static const char *TAG = "tls_client_profile";
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Build a TLS client profile (call once at boot)
+esp_err_t tls_client_profile_init(tls_client_profile_t *profile)
+{
+    esp_err_t esp_ret = ESP_FAIL;
+    esp_err_t bundle_ret;
+    int tls_ret;
+
+#ifdef CONFIG_MBEDTLS_SSL_PROTO_TLS1_3
+    psa_status_t psa_status;
+
+    // Initialize Platform Security Architecture (PSA) Crypto for Mbed TLS
+    psa_status = psa_crypto_init();
+    if (psa_status != PSA_SUCCESS) {
+        ESP_LOGE(TAG, "Error (%d): Failed to initialize PSA crypto", (int)psa_status);
+        return ESP_FAIL;
+    }
+#endif
+
+    // Log that we are building the profile
+    ESP_LOGI(TAG, "Initializing TLS client profile...");
+
+    // Initialize contexts
+    memset(profile, 0, sizeof(*profile));
+    mbedtls_ssl_config_init(&profile->conf);        // TLS configuration
+    mbedtls_x509_crt_init(&profile->ca_cert);       // Root CA certificates
+    mbedtls_ctr_drbg_init(&profile->ctr_drbg);      // Secure PRNG
+    mbedtls_entropy_init(&profile->entropy);        // Entropy context
+    profile->initialized = true;
+
+    // Seed pseudorandom number generator
+    tls_ret = mbedtls_ctr_drbg_seed(&profile->ctr_drbg,
+                                    mbedtls_entropy_func,
+                                    &profile->entropy,
+                                    NULL,
+                                    0);
+    if (tls_ret != 0) {
+        ESP_LOGE(TAG, "Error (%d): Failed to seed CTR-DRBG RNG", tls_ret);
+        goto cleanup;
+    }
+
+#ifdef CONFIG_MBEDTLS_DEBUG
+    // Enable Mbed TLS debug output
+    mbedtls_esp_enable_debug_log(&profile->conf, CONFIG_MBEDTLS_DEBUG_LEVEL);
+#endif
+
+    // Attach default ESP-IDF trust store (CA certificates) to SSL configuration
+    bundle_ret = esp_crt_bundle_attach(&profile->conf);
+    if (bundle_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to attach CA certificates", bundle_ret);
+        goto cleanup;
+    }
+
+    // Configure TLS for client
+    tls_ret = mbedtls_ssl_config_defaults(&profile->conf,
+                                          MBEDTLS_SSL_IS_CLIENT,        // Client mode
+                                          MBEDTLS_SSL_TRANSPORT_STREAM, // TLS (not DTLS)
+                                          MBEDTLS_SSL_PRESET_DEFAULT);  // Default security settings
+    if (tls_ret != 0) {
+        ESP_LOGE(TAG, "Error (%d): Failed to set TLS configuration", tls_ret);
+        goto cleanup;
+    }
+
+    // Require authentication (server must present a certificate)
+    mbedtls_ssl_conf_authmode(&profile->conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+
+    // Set up certificate authority (CA) chain (with no revocation list)
+    mbedtls_ssl_conf_ca_chain(&profile->conf, &profile->ca_cert, NULL);
+
+    // Set random number generator (RNG) callback function
+    mbedtls_ssl_conf_rng(&profile->conf,
+                         mbedtls_ctr_drbg_random,
+                         &profile->ctr_drbg);
+
+    // Set success return value
+    esp_ret = ESP_OK;
+
+cleanup:
+    // Free everything if not successful
+    if (esp_ret != ESP_OK) {
+        tls_client_profile_deinit(profile);
+    }
+
+    return esp_ret;
+}
+
+// Free all resources held by a TLS client profile
+void tls_client_profile_deinit(tls_client_profile_t *profile)
+{
+    if (!profile->initialized) {
+        return;
+    }
+
+    esp_crt_bundle_detach(&profile->conf);
+    mbedtls_ssl_config_free(&profile->conf);
+    mbedtls_x509_crt_free(&profile->ca_cert);
+    mbedtls_ctr_drbg_free(&profile->ctr_drbg);
+    mbedtls_entropy_free(&profile->entropy);
+    profile->initialized = false;
+}
+
+// Set up a per-connection TLS context from the profile
+esp_err_t tls_client_profile_ssl_setup(tls_client_profile_t *profile,
+                                       mbedtls_ssl_context *ssl,
+                                       mbedtls_net_context *net,
+                                       const char *hostname)
+{
+    int tls_ret;
+
+    // Make sure the profile was built
+    if (!profile->initialized) {
+        ESP_LOGE(TAG, "TLS client profile is not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Initialize the per-connection context (holds TLS session state and data)
+    mbedtls_ssl_init(ssl);
+
+    // Bind context to the shared configuration
+    tls_ret = mbedtls_ssl_setup(ssl, &profile->conf);
+    if (tls_ret != 0) {
+        ESP_LOGE(TAG, "Error (%d): Failed to set up TLS context", tls_ret);
+        goto cleanup;
+    }
+
+    // Hostname should match Common Name (CN) in server certificate
+    tls_ret = mbedtls_ssl_set_hostname(ssl, hostname);
+    if (tls_ret != 0) {
+        ESP_LOGE(TAG, "Error (%d): Failed to set hostname for TLS session", tls_ret);
+        goto cleanup;
+    }
+
+    // Set send and receive callback functions basic I/O operations
+    mbedtls_ssl_set_bio(ssl, net, mbedtls_net_send, mbedtls_net_recv, NULL);
+
+    return ESP_OK;
+
+cleanup:
+    mbedtls_ssl_free(ssl);
+
+    return ESP_FAIL;
+}
+
+// Trust an extra root CA (e.g. a private CA for a local server)
+esp_err_t tls_client_profile_add_ca(tls_client_profile_t *profile,
+                                    const uint8_t *pem,
+                                    size_t len)
+{
+    int tls_ret;
+
+    // Make sure the profile was built
+    if (!profile->initialized) {
+        ESP_LOGE(TAG, "TLS client profile is not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Add to the chain already set with mbedtls_ssl_conf_ca_chain()
+    tls_ret = mbedtls_x509_crt_parse(&profile->ca_cert, pem, len);
+    if (tls_ret != 0) {
+        ESP_LOGE(TAG, "Error (%d): Failed to parse CA certificate", tls_ret);
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
@@ -0,0 +1,92 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TLS_SESSION_CACHE_H
+#define TLS_SESSION_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "mbedtls/ssl.h"
+
+/**
+ * @brief Handshake timing counters (full vs. resumed)
+ */
+typedef struct {
+    uint32_t full_count;        // Number of full handshakes
+    uint32_t resumed_count;     // Number of resumed handshakes
+    uint64_t full_total_us;     // Sum of full handshake durations (us)
+    uint64_t resumed_total_us;  // Sum of resumed handshake durations (us)
+    uint32_t last_us;           // Duration of the most recent handshake (us)
+    bool last_resumed;          // True if the most recent handshake resumed
+} tls_session_cache_stats_t;
+
+/**
+ * @brief Offer a cached session for the given host
+ *
+ * Call after mbedtls_ssl_setup() or mbedtls_ssl_session_reset() and before
+ * mbedtls_ssl_handshake(). If CONFIG_TLS_SESSION_CACHE_NVS is enabled and the
+ * session is not in RAM, it is loaded from NVS first.
+ *
+ * @param[in] ssl TLS context that will perform the next handshake
+ * @param[in] host Hostname used as the cache key
+ *
+ * @return
+ *  - ESP_OK if a cached session was offered
+ *  - ESP_ERR_NOT_FOUND if there is no cached session for the host
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t tls_session_cache_load(mbedtls_ssl_context *ssl, const char *host);
+
+/**
+ * @brief Save the current session for the given host
+ *
+ * Call after a successful handshake (TLS 1.2) or when mbedtls_ssl_read()
+ * returns MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET (TLS 1.3).
+ *
+ * @param[in] ssl TLS context with an established session
+ * @param[in] host Hostname used as the cache key
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t tls_session_cache_save(mbedtls_ssl_context *ssl, const char *host);
+
+/**
+ * @brief Drop the cached session for the given host (RAM and NVS)
+ *
+ * @param[in] host Hostname used as the cache key
+ */
+void tls_session_cache_clear(const char *host);
+
+/**
+ * @brief Mark the start of a handshake (for timing)
+ */
+void tls_session_cache_handshake_start(void);
+
+/**
+ * @brief Mark the end of a successful handshake and update timing counters
+ *
+ * Must be called before tls_session_cache_save() so the new session can be
+ * compared against the one that was offered.
+ *
+ * @param[in] ssl TLS context that completed the handshake
+ * @param[in] host Hostname used as the cache key
+ *
+ * @return true if the server resumed the offered session, false otherwise
+ */
+bool tls_session_cache_handshake_done(mbedtls_ssl_context *ssl,
+                                      const char *host);
+
+/**
+ * @brief Copy the handshake timing counters
+ *
+ * @param[out] stats Destination for the counters
+ */
+void tls_session_cache_get_stats(tls_session_cache_stats_t *stats);
+
+#endif // TLS_SESSION_CACHE_H
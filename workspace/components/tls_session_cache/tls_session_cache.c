@@ -0,0 +1,391 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Small fixed-size cache of TLS sessions keyed by hostname.
+ *
+ * A full TLS handshake costs several round trips plus an asymmetric key
+ * exchange and certificate chain verification. If the client offers a session
+ * from a previous connection (session ID or ticket in TLS 1.2, PSK ticket in
+ * TLS 1.3) and the server accepts it, the handshake is abbreviated to one
+ * round trip with only symmetric crypto.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "mbedtls/ssl.h"
+#if CONFIG_TLS_SESSION_CACHE_NVS
+# include "nvs.h"
+#endif
+
+#include "tls_session_cache.h"
+
+// NVS namespace for serialized sessions
+#define NVS_NAMESPACE "tls_sess"
+
+// Tag for debug messages
+static const char *TAG = "tls_session_cache";
+
+// One cached session
+typedef struct {
+    bool valid;                     // Slot holds a session
+    bool offered;                   // Session offered in current handshake
+    uint32_t key;                   // Hash of the hostname
+    uint32_t age;                   // Save counter value (for replacement)
+    mbedtls_ssl_session session;    // Copy of the negotiated session
+} cache_slot_t;
+
+// Static global variables
+static cache_slot_t s_slots[CONFIG_TLS_SESSION_CACHE_SLOTS];
+static uint32_t s_save_counter = 0;
+static int64_t s_handshake_start_us = 0;
+static tls_session_cache_stats_t s_stats = {0};
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static uint32_t host_hash(const char *host);
+static cache_slot_t *find_slot(uint32_t key);
+static cache_slot_t *alloc_slot(uint32_t key);
+static void free_slot(cache_slot_t *slot);
+#if CONFIG_TLS_SESSION_CACHE_NVS
+static void nvs_key_from_hash(uint32_t key, char *nvs_key, size_t len);
+static esp_err_t nvs_load_session(uint32_t key, cache_slot_t *slot);
+static esp_err_t nvs_save_session(const cache_slot_t *slot);
+static void nvs_erase_session(uint32_t key);
+#endif
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// FNV-1a hash of the hostname (used as cache and NVS key)
+static uint32_t host_hash(const char *host)
+{
+    uint32_t hash = 2166136261u;
+
+    while (*host != '\0') {
+        hash ^= (uint8_t)*host++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+// Find the slot holding a session for the given key
+static cache_slot_t *find_slot(uint32_t key)
+{
+    for (int i = 0; i < CONFIG_TLS_SESSION_CACHE_SLOTS; i++) {
+        if (s_slots[i].valid && s_slots[i].key == key) {
+            return &s_slots[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Get an empty slot, replacing the oldest one if the cache is full
+static cache_slot_t *alloc_slot(uint32_t key)
+{
+    cache_slot_t *slot = find_slot(key);
+
+    // Reuse slot for the same host
+    if (slot != NULL) {
+        return slot;
+    }
+
+    // Pick a free slot or the least recently saved one
+    slot = &s_slots[0];
+    for (int i = 0; i < CONFIG_TLS_SESSION_CACHE_SLOTS; i++) {
+        if (!s_slots[i].valid) {
+            slot = &s_slots[i];
+            break;
+        }
+        if (s_slots[i].age < slot->age) {
+            slot = &s_slots[i];
+        }
+    }
+    free_slot(slot);
+
+    return slot;
+}
+
+// Release the session held by a slot
+static void free_slot(cache_slot_t *slot)
+{
+    if (slot->valid) {
+        mbedtls_ssl_session_free(&slot->session);
+    }
+    memset(slot, 0, sizeof(*slot));
+}
+
+#if CONFIG_TLS_SESSION_CACHE_NVS
+// NVS keys are limited to 15 characters, so use the hash of the hostname
+static void nvs_key_from_hash(uint32_t key, char *nvs_key, size_t len)
+{
+    snprintf(nvs_key, len, "s%08lx", (unsigned long)key);
+}
+
+// Deserialize a session from NVS into the given slot
+static esp_err_t nvs_load_session(uint32_t key, cache_slot_t *slot)
+{
+    esp_err_t esp_ret;
+    nvs_handle_t nvs;
+    char nvs_key[16];
+    unsigned char *buf = NULL;
+    size_t len = 0;
+    int tls_ret;
+
+    esp_ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (esp_ret != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Get the size of the stored blob
+    nvs_key_from_hash(key, nvs_key, sizeof(nvs_key));
+    esp_ret = nvs_get_blob(nvs, nvs_key, NULL, &len);
+    if (esp_ret != ESP_OK || len == 0) {
+        esp_ret = ESP_ERR_NOT_FOUND;
+        goto cleanup;
+    }
+
+    // Read the blob
+    buf = malloc(len);
+    if (buf == NULL) {
+        esp_ret = ESP_ERR_NO_MEM;
+        goto cleanup;
+    }
+    esp_ret = nvs_get_blob(nvs, nvs_key, buf, &len);
+    if (esp_ret != ESP_OK) {
+        goto cleanup;
+    }
+
+    // Rebuild the session
+    mbedtls_ssl_session_init(&slot->session);
+    tls_ret = mbedtls_ssl_session_load(&slot->session, buf, len);
+    if (tls_ret != 0) {
+        ESP_LOGW(TAG, "Error (%d): Stored session is invalid", tls_ret);
+        mbedtls_ssl_session_free(&slot->session);
+        esp_ret = ESP_ERR_INVALID_STATE;
+        goto cleanup;
+    }
+    slot->valid = true;
+    slot->key = key;
+    slot->age = ++s_save_counter;
+    ESP_LOGD(TAG, "Loaded %u byte session from NVS", (unsigned)len);
+
+cleanup:
+    free(buf);
+    nvs_close(nvs);
+
+    return esp_ret;
+}
+
+// Serialize the session held by a slot to NVS
+static esp_err_t nvs_save_session(const cache_slot_t *slot)
+{
+    esp_err_t esp_ret;
+    nvs_handle_t nvs;
+    char nvs_key[16];
+    unsigned char *buf;
+    size_t len = 0;
+    int tls_ret;
+
+    // Serialize the session
+    buf = malloc(CONFIG_TLS_SESSION_CACHE_NVS_MAX_SIZE);
+    if (buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    tls_ret = mbedtls_ssl_session_save(&slot->session,
+                                       buf,
+                                       CONFIG_TLS_SESSION_CACHE_NVS_MAX_SIZE,
+                                       &len);
+    if (tls_ret != 0) {
+        ESP_LOGW(TAG, "Error (%d): Could not serialize session", tls_ret);
+        free(buf);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Write the blob
+    esp_ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (esp_ret != ESP_OK) {
+        free(buf);
+        return esp_ret;
+    }
+    nvs_key_from_hash(slot->key, nvs_key, sizeof(nvs_key));
+    esp_ret = nvs_set_blob(nvs, nvs_key, buf, len);
+    if (esp_ret == ESP_OK) {
+        esp_ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    free(buf);
+
+    return esp_ret;
+}
+
+// Remove a stored session from NVS
+static void nvs_erase_session(uint32_t key)
+{
+    nvs_handle_t nvs;
+    char nvs_key[16];
+
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    nvs_key_from_hash(key, nvs_key, sizeof(nvs_key));
+    if (nvs_erase_key(nvs, nvs_key) == ESP_OK) {
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+}
+#endif
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Offer a cached session for the given host
+esp_err_t tls_session_cache_load(mbedtls_ssl_context *ssl, const char *host)
+{
+    uint32_t key = host_hash(host);
+    cache_slot_t *slot;
+    int tls_ret;
+
+    // Look for the session in RAM, then in NVS
+    slot = find_slot(key);
+#if CONFIG_TLS_SESSION_CACHE_NVS
+    if (slot == NULL) {
+        cache_slot_t loaded = {0};
+        if (nvs_load_session(key, &loaded) != ESP_OK) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        slot = alloc_slot(key);
+        *slot = loaded;
+    }
+#endif
+    if (slot == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Offer the session to the server in the next ClientHello
+    tls_ret = mbedtls_ssl_set_session(ssl, &slot->session);
+    if (tls_ret != 0) {
+        ESP_LOGW(TAG, "Error (%d): Could not set cached session", tls_ret);
+        tls_session_cache_clear(host);
+        return ESP_FAIL;
+    }
+    slot->offered = true;
+    ESP_LOGD(TAG, "Offering cached session for %s", host);
+
+    return ESP_OK;
+}
+
+// Save the current session for the given host
+esp_err_t tls_session_cache_save(mbedtls_ssl_context *ssl, const char *host)
+{
+    uint32_t key = host_hash(host);
+    mbedtls_ssl_session session;
+    cache_slot_t *slot;
+    int tls_ret;
+
+    // Export the session (each session/ticket can only be exported once)
+    mbedtls_ssl_session_init(&session);
+    tls_ret = mbedtls_ssl_get_session(ssl, &session);
+    if (tls_ret != 0) {
+        ESP_LOGD(TAG, "Error (%d): No session to save", tls_ret);
+        mbedtls_ssl_session_free(&session);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Move the session into its slot
+    slot = alloc_slot(key);
+    if (slot->valid) {
+        mbedtls_ssl_session_free(&slot->session);
+    }
+    slot->session = session;
+    slot->valid = true;
+    slot->offered = false;
+    slot->key = key;
+    slot->age = ++s_save_counter;
+    ESP_LOGD(TAG, "Saved session for %s", host);
+
+#if CONFIG_TLS_SESSION_CACHE_NVS
+    esp_err_t esp_ret = nvs_save_session(slot);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGW(TAG, "Error (%d): Could not persist session", esp_ret);
+    }
+#endif
+
+    return ESP_OK;
+}
+
+// Drop the cached session for the given host
+void tls_session_cache_clear(const char *host)
+{
+    uint32_t key = host_hash(host);
+    cache_slot_t *slot = find_slot(key);
+
+    if (slot != NULL) {
+        free_slot(slot);
+    }
+#if CONFIG_TLS_SESSION_CACHE_NVS
+    nvs_erase_session(key);
+#endif
+}
+
+// Mark the start of a handshake
+void tls_session_cache_handshake_start(void)
+{
+    s_handshake_start_us = esp_timer_get_time();
+}
+
+// Mark the end of a successful handshake and update timing counters
+bool tls_session_cache_handshake_done(mbedtls_ssl_context *ssl,
+                                      const char *host)
+{
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() -
+                                     s_handshake_start_us);
+    cache_slot_t *slot = find_slot(host_hash(host));
+    bool resumed = false;
+
+    // A resumed session keeps the start time of the original full handshake,
+    // while a full handshake stamps a new one
+    if (slot != NULL && slot->offered) {
+#if defined(MBEDTLS_HAVE_TIME)
+        const mbedtls_ssl_session *session =
+            mbedtls_ssl_get_session_pointer(ssl);
+        resumed = (session != NULL) &&
+                  (session->MBEDTLS_PRIVATE(start) ==
+                   slot->session.MBEDTLS_PRIVATE(start));
+#else
+        resumed = true;
+#endif
+        slot->offered = false;
+    }
+
+    // Update counters
+    if (resumed) {
+        s_stats.resumed_count++;
+        s_stats.resumed_total_us += elapsed_us;
+    } else {
+        s_stats.full_count++;
+        s_stats.full_total_us += elapsed_us;
+    }
+    s_stats.last_us = elapsed_us;
+    s_stats.last_resumed = resumed;
+
+    return resumed;
+}
+
+// Copy the handshake timing counters
+void tls_session_cache_get_stats(tls_session_cache_stats_t *stats)
+{
+    *stats = s_stats;
+}
@@ -0,0 +1,157 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TMP10X_H
+#define TMP10X_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "driver/i2c_master.h"
+#include "esp_err.h"
+
+/**
+ * @brief Fractional bits in a fixed-point temperature (1 LSB = 0.0625 deg C)
+ *
+ * Temperatures are signed Q11.4 values in an int16_t: the register value
+ * itself, so conversion is a shift and loses nothing.
+ */
+#define TMP10X_Q_FRAC_BITS      4
+
+/**
+ * @brief Register addresses (pointer register values)
+ */
+#define TMP10X_REG_TEMP         0x00
+#define TMP10X_REG_CONFIG       0x01
+#define TMP10X_REG_TLOW         0x02
+#define TMP10X_REG_THIGH        0x03
+
+/**
+ * @brief Continuous conversion rate
+ */
+typedef enum {
+    TMP10X_RATE_0_25HZ = 0,
+    TMP10X_RATE_1HZ,
+    TMP10X_RATE_4HZ,            // Power-on default
+    TMP10X_RATE_8HZ,
+} tmp10x_rate_t;
+
+/**
+ * @brief Sensor settings
+ */
+typedef struct {
+    tmp10x_rate_t rate;         // Ignored in shutdown mode
+    bool extended;              // 13-bit mode (range up to 150 deg C)
+    bool shutdown;              // Convert only on tmp10x_start_one_shot()
+} tmp10x_config_t;
+
+/**
+ * @brief Sensor (internal state)
+ */
+typedef struct {
+    i2c_master_dev_handle_t dev;
+    uint8_t config[2];          // Config register as last written
+    uint8_t pointer;            // Register the device will read next
+} tmp10x_t;
+
+/**
+ * @brief Convert the two temperature register bytes to fixed point
+ *
+ * Handles both 12-bit and 13-bit (extended) layouts, told apart by the
+ * extended-mode flag in bit 0 of the second byte.
+ *
+ * @param[in] data Register bytes (MSB first)
+ *
+ * @return Temperature in 1/16 deg C (Q11.4)
+ */
+int16_t tmp10x_decode(const uint8_t data[2]);
+
+/**
+ * @brief Convert a fixed-point temperature to thousandths of a degree
+ *
+ * @param[in] temp Temperature in 1/16 deg C (Q11.4)
+ *
+ * @return Temperature in m deg C (rounded toward zero)
+ */
+int32_t tmp10x_to_milli_c(int16_t temp);
+
+/**
+ * @brief Write the sensor settings
+ *
+ * @param[out] tmp Sensor
+ * @param[in] dev Device on a synchronous bus (trans_queue_depth = 0)
+ * @param[in] config Settings
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t tmp10x_init(tmp10x_t *tmp, i2c_master_dev_handle_t dev, const tmp10x_config_t *config);
+
+/**
+ * @brief Read the latest conversion
+ *
+ * When the device is already pointing at the temperature register (as after
+ * a previous read), only the two data bytes are read and the register
+ * address is not sent again.
+ *
+ * @param[in] tmp Sensor
+ * @param[out] temp Temperature in 1/16 deg C (Q11.4)
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t tmp10x_read(tmp10x_t *tmp, int16_t *temp);
+
+/**
+ * @brief Start a single conversion (shutdown mode only)
+ *
+ * The device converts once and returns to shutdown.
+ *
+ * @param[in] tmp Sensor
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_STATE if the sensor is not in shutdown mode
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t tmp10x_start_one_shot(tmp10x_t *tmp);
+
+/**
+ * @brief Wait for a one-shot conversion to finish
+ *
+ * Sleeps for the typical conversion time first, then polls the one-shot
+ * bit once per tick, so the bus is idle for most of the wait.
+ *
+ * @param[in] tmp Sensor
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_TIMEOUT if the conversion did not finish in
+ *    CONFIG_TMP10X_CONVERSION_TIMEOUT_MS
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t tmp10x_wait_ready(tmp10x_t *tmp);
+
+/**
+ * @brief Take one reading from each sensor (shutdown mode only)
+ *
+ * Starts a conversion on every sensor, waits once for all of them, then
+ * reads them, so N sensors cost one conversion time instead of N.
+ *
+ * @param[in] tmps Sensors
+ * @param[in] count Number of sensors
+ * @param[out] temps Temperatures in 1/16 deg C (Q11.4), one per sensor
+ *
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_STATE if a sensor is not in shutdown mode
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t tmp10x_read_one_shot(tmp10x_t *tmps, size_t count, int16_t *temps);
+
+#endif // TMP10X_H
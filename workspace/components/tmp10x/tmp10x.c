@@ -0,0 +1,220 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * TMP102 temperature sensor driver.
+ *
+ * Temperatures stay in the register's own fixed-point format (1/16 deg C),
+ * so no floating point is needed and no precision is lost. The driver
+ * remembers which register the device's pointer is set to: repeated
+ * temperature (or ready) reads skip the register address write and only
+ * clock in the two data bytes.
+ *
+ * For low-power sampling the sensor sits in shutdown and converts once per
+ * tmp10x_start_one_shot(). The wait for the result sleeps through the
+ * typical conversion time before polling, and several sensors can share
+ * one wait.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "tmp10x.h"
+
+// Settings
+#define TIMEOUT_MS              CONFIG_TMP10X_TIMEOUT_MS
+#define CONVERSION_TIMEOUT_MS   CONFIG_TMP10X_CONVERSION_TIMEOUT_MS
+#define CONVERSION_TYP_MS       26      // Datasheet typical conversion time
+#define CONVERSION_TYP_TICKS    ((CONVERSION_TYP_MS + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS)
+
+// Config register, first byte
+#define CONFIG_OS               0x80    // One-shot start / conversion done
+#define CONFIG_RES              0x60    // Converter resolution (read-only, 12-bit)
+#define CONFIG_SD               0x01    // Shutdown
+
+// Config register, second byte
+#define CONFIG_CR_SHIFT         6       // Conversion rate
+#define CONFIG_EM               0x10    // Extended (13-bit) mode
+
+// Temperature register, second byte
+#define TEMP_EM                 0x01    // Set when the reading is 13-bit
+
+// Tag for debug messages
+static const char *TAG = "tmp10x";
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static esp_err_t read_register(tmp10x_t *tmp, uint8_t reg, uint8_t data[2]);
+static esp_err_t write_config(tmp10x_t *tmp, uint8_t first);
+static esp_err_t poll_ready(tmp10x_t *tmp, TickType_t start);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Read a 16-bit register, sending its address only if the pointer moved
+static esp_err_t read_register(tmp10x_t *tmp, uint8_t reg, uint8_t data[2])
+{
+    esp_err_t esp_ret;
+
+    if (tmp->pointer == reg) {
+        return i2c_master_receive(tmp->dev, data, 2, TIMEOUT_MS);
+    }
+
+    esp_ret = i2c_master_transmit_receive(tmp->dev, &reg, 1, data, 2, TIMEOUT_MS);
+    if (esp_ret == ESP_OK) {
+        tmp->pointer = reg;
+    }
+
+    return esp_ret;
+}
+
+// Write the config register (first byte given, second byte as stored)
+static esp_err_t write_config(tmp10x_t *tmp, uint8_t first)
+{
+    esp_err_t esp_ret;
+    uint8_t tx[3] = { TMP10X_REG_CONFIG, first, tmp->config[1] };
+
+    esp_ret = i2c_master_transmit(tmp->dev, tx, sizeof(tx), TIMEOUT_MS);
+    if (esp_ret == ESP_OK) {
+        tmp->pointer = TMP10X_REG_CONFIG;
+    }
+
+    return esp_ret;
+}
+
+// Poll the one-shot bit once per tick until the conversion is done
+static esp_err_t poll_ready(tmp10x_t *tmp, TickType_t start)
+{
+    esp_err_t esp_ret;
+    uint8_t config[2];
+
+    while (1) {
+        esp_ret = read_register(tmp, TMP10X_REG_CONFIG, config);
+        if (esp_ret != ESP_OK) {
+            return esp_ret;
+        }
+        if (config[0] & CONFIG_OS) {
+            return ESP_OK;
+        }
+        if ((xTaskGetTickCount() - start) > pdMS_TO_TICKS(CONVERSION_TIMEOUT_MS)) {
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(1);
+    }
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Convert the two temperature register bytes to fixed point
+int16_t tmp10x_decode(const uint8_t data[2])
+{
+    int16_t raw = (int16_t)((data[0] << 8) | data[1]);
+
+    // Drop the unused low bits (arithmetic shift keeps the sign)
+    if (data[1] & TEMP_EM) {
+        return raw >> 3;
+    }
+
+    return raw >> 4;
+}
+
+// Convert a fixed-point temperature to thousandths of a degree
+int32_t tmp10x_to_milli_c(int16_t temp)
+{
+    return ((int32_t)temp * 1000) / (1 << TMP10X_Q_FRAC_BITS);
+}
+
+// Write the sensor settings
+esp_err_t tmp10x_init(tmp10x_t *tmp, i2c_master_dev_handle_t dev, const tmp10x_config_t *config)
+{
+    esp_err_t esp_ret;
+
+    tmp->dev = dev;
+    tmp->pointer = 0xFF;
+    tmp->config[0] = CONFIG_RES | (config->shutdown ? CONFIG_SD : 0);
+    tmp->config[1] = (uint8_t)((config->rate & 0x03) << CONFIG_CR_SHIFT) |
+                     (config->extended ? CONFIG_EM : 0);
+
+    esp_ret = write_config(tmp, tmp->config[0]);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to write config", esp_ret);
+    }
+
+    return esp_ret;
+}
+
+// Read the latest conversion
+esp_err_t tmp10x_read(tmp10x_t *tmp, int16_t *temp)
+{
+    esp_err_t esp_ret;
+    uint8_t data[2];
+
+    esp_ret = read_register(tmp, TMP10X_REG_TEMP, data);
+    if (esp_ret != ESP_OK) {
+        return esp_ret;
+    }
+    *temp = tmp10x_decode(data);
+
+    return ESP_OK;
+}
+
+// Start a single conversion (shutdown mode only)
+esp_err_t tmp10x_start_one_shot(tmp10x_t *tmp)
+{
+    if (!(tmp->config[0] & CONFIG_SD)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return write_config(tmp, tmp->config[0] | CONFIG_OS);
+}
+
+// Wait for a one-shot conversion to finish
+esp_err_t tmp10x_wait_ready(tmp10x_t *tmp)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    vTaskDelay(CONVERSION_TYP_TICKS);
+
+    return poll_ready(tmp, start);
+}
+
+// Take one reading from each sensor (shutdown mode only)
+esp_err_t tmp10x_read_one_shot(tmp10x_t *tmps, size_t count, int16_t *temps)
+{
+    esp_err_t esp_ret;
+    TickType_t start;
+
+    // Start every conversion
+    for (size_t i = 0; i < count; i++) {
+        esp_ret = tmp10x_start_one_shot(&tmps[i]);
+        if (esp_ret != ESP_OK) {
+            return esp_ret;
+        }
+    }
+    start = xTaskGetTickCount();
+
+    // Sleep once for all of them
+    vTaskDelay(CONVERSION_TYP_TICKS);
+
+    // Collect the results
+    for (size_t i = 0; i < count; i++) {
+        esp_ret = poll_ready(&tmps[i], start);
+        if (esp_ret != ESP_OK) {
+            return esp_ret;
+        }
+        esp_ret = tmp10x_read(&tmps[i], &temps[i]);
+        if (esp_ret != ESP_OK) {
+            return esp_ret;
+        }
+    }
+
+    return ESP_OK;
+}
@@ -6,7 +6,11 @@
 #ifndef WIFI_STA_H
 #define WIFI_STA_H
 
+#include <stdint.h>
+
 #include "esp_err.h"
+#include "esp_netif.h"
+#include "reconnect_backoff.h"
 
 /**
  * @brief Event group bits for WiFi events
@@ -51,4 +55,37 @@ esp_err_t wifi_sta_stop(void);
  */
 esp_err_t wifi_sta_reconnect(void);
 
-#endif // WIFI_STA_H
\ No newline at end of file
+/**
+ * @brief Get automatic reconnection statistics
+ * 
+ * Includes the time it took to reconnect after each outage.
+ * 
+ * @param[out] stats Statistics since boot
+ * 
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_NOT_SUPPORTED if WIFI_STA_AUTO_RECONNECT is disabled
+ */
+esp_err_t wifi_sta_get_reconnect_stats(reconnect_stats_t *stats);
+
+/**
+ * @brief Get the signal strength of the access point
+ * 
+ * @param[out] rssi Received signal strength (dBm)
+ * 
+ * @return
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_STATE if the driver is not running
+ *  - ESP_ERR_WIFI_NOT_CONNECT if not associated with an access point
+ *  - Other errors on failure. See esp_err.h for error codes.
+ */
+esp_err_t wifi_sta_get_rssi(int8_t *rssi);
+
+/**
+ * @brief Get the WiFi network interface
+ * 
+ * @return Interface handle, or NULL if the driver is not running
+ */
+esp_netif_t *wifi_sta_get_netif(void);
+
+#endif // WIFI_STA_H
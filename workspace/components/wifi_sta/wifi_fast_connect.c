@@ -0,0 +1,388 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Fast WiFi connect: skip the channel scan and the full DHCP exchange.
+ *
+ * After a successful connection, the access point's BSSID and channel and
+ * the DHCP lease are saved in NVS. On the next connection the driver is sent
+ * straight to that access point on that channel. DHCP INIT-REBOOT (asking
+ * the server to confirm the previous address instead of discovering a new
+ * one) is done by lwIP with LWIP_DHCP_RESTORE_LAST_IP. If the server does
+ * not answer in time and the saved lease has not expired, the saved address
+ * is applied statically. If the cached access point can't be reached, the
+ * driver falls back to a full scan right away. After a disconnect, the
+ * first reconnect still goes to the cached access point; if that fails too,
+ * the driver falls back to a full scan for good.
+ *
+ * The saved lease can only be checked for expiry once the clock is set
+ * (e.g. by SNTP, or kept by an RTC across a deep sleep). After a cold boot
+ * without a valid clock, there is no static fallback and DHCP has to
+ * answer.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "esp_log.h"
+#include "esp_netif_net_stack.h"
+#include "esp_timer.h"
+#include "lwip/dhcp.h"
+#include "nvs.h"
+
+#include "net_timeline.h"
+#include "wifi_fast_connect.h"
+
+// Settings
+#define NVS_NAMESPACE       "wifi_fast"
+#define NVS_KEY             "cache"
+#define CACHE_VERSION       1
+#define DHCP_TIMEOUT_US     ((uint64_t)CONFIG_WIFI_STA_FAST_CONNECT_DHCP_TIMEOUT_MS * 1000)
+#define LEASE_MARGIN_S      60          // Don't reuse a lease this close to expiry
+#define CLOCK_VALID_S       1577836800  // 2020-01-01: earlier means clock not set
+
+// Saved connection (IPv4 addresses in network byte order)
+typedef struct {
+    uint32_t version;
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;
+    uint32_t netmask;
+    uint32_t gw;
+    uint32_t dns;
+    int64_t lease_expiry;       // Unix time, 0 if unknown
+} fast_cache_t;
+
+// Tag for debug messages
+static const char *TAG = "wifi_fast_connect";
+
+// Static global variables
+static fast_cache_t s_cache;            // Current connection
+static fast_cache_t s_saved;            // What is in NVS
+static bool s_pinned = false;           // Driver config names the cached AP
+static bool s_fast_attempt = false;     // Connecting to the cached AP
+static bool s_static_ip = false;        // Using the saved lease without DHCP
+static esp_netif_t *s_netif = NULL;
+static esp_timer_handle_t s_dhcp_timer = NULL;
+
+/*******************************************************************************
+ * Private function prototypes
+ */
+
+static bool load_cache(void);
+static void save_cache(void);
+static bool lease_valid(void);
+static void on_dhcp_timeout(void *arg);
+static esp_err_t read_lease(void *ctx);
+
+/*******************************************************************************
+ * Private function definitions
+ */
+
+// Read the saved connection from NVS
+static bool load_cache(void)
+{
+    nvs_handle_t nvs;
+    size_t len = sizeof(s_saved);
+    esp_err_t esp_ret;
+
+    esp_ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (esp_ret != ESP_OK) {
+        return false;
+    }
+    esp_ret = nvs_get_blob(nvs, NVS_KEY, &s_saved, &len);
+    nvs_close(nvs);
+    if ((esp_ret != ESP_OK) ||
+        (len != sizeof(s_saved)) ||
+        (s_saved.version != CACHE_VERSION)) {
+        memset(&s_saved, 0, sizeof(s_saved));
+        return false;
+    }
+    memcpy(&s_cache, &s_saved, sizeof(s_cache));
+
+    return true;
+}
+
+// Write the current connection to NVS (only if it changed, to spare flash)
+static void save_cache(void)
+{
+    nvs_handle_t nvs;
+    esp_err_t esp_ret;
+
+    s_cache.version = CACHE_VERSION;
+    if (memcmp(&s_cache, &s_saved, sizeof(s_cache)) == 0) {
+        return;
+    }
+
+    esp_ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to open NVS", esp_ret);
+        return;
+    }
+    esp_ret = nvs_set_blob(nvs, NVS_KEY, &s_cache, sizeof(s_cache));
+    if (esp_ret == ESP_OK) {
+        esp_ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to save connection", esp_ret);
+        return;
+    }
+    memcpy(&s_saved, &s_cache, sizeof(s_saved));
+}
+
+// Check that the saved lease can still be used
+static bool lease_valid(void)
+{
+    time_t now = time(NULL);
+
+    // Without a set clock there is no way to tell if the lease expired
+    if ((s_cache.ip == 0) ||
+        (s_cache.lease_expiry == 0) ||
+        (now < CLOCK_VALID_S)) {
+        return false;
+    }
+
+    return ((int64_t)now + LEASE_MARGIN_S) < s_cache.lease_expiry;
+}
+
+// Timer callback: DHCP did not answer, apply the saved lease
+static void on_dhcp_timeout(void *arg)
+{
+    esp_netif_ip_info_t ip_info;
+    esp_netif_dns_info_t dns_info;
+    esp_err_t esp_ret;
+
+    // DHCP may have answered while the timer was firing
+    if ((s_netif == NULL) ||
+        (esp_netif_get_ip_info(s_netif, &ip_info) != ESP_OK) ||
+        (ip_info.ip.addr != 0)) {
+        return;
+    }
+
+    ESP_LOGW(TAG, "No DHCP reply, using saved lease " IPSTR,
+             IP2STR((esp_ip4_addr_t *)&s_cache.ip));
+
+    // The address is ours until the lease expires
+    esp_ret = esp_netif_dhcpc_stop(s_netif);
+    if ((esp_ret != ESP_OK) &&
+        (esp_ret != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED)) {
+        ESP_LOGE(TAG, "Error (%d): Failed to stop DHCP client", esp_ret);
+        return;
+    }
+    s_static_ip = true;
+
+    // Set DNS server first: setting the address posts IP_EVENT_STA_GOT_IP
+    if (s_cache.dns != 0) {
+        memset(&dns_info, 0, sizeof(dns_info));
+        dns_info.ip.type = ESP_IPADDR_TYPE_V4;
+        dns_info.ip.u_addr.ip4.addr = s_cache.dns;
+        esp_netif_set_dns_info(s_netif, ESP_NETIF_DNS_MAIN, &dns_info);
+    }
+    ip_info.ip.addr = s_cache.ip;
+    ip_info.netmask.addr = s_cache.netmask;
+    ip_info.gw.addr = s_cache.gw;
+    esp_ret = esp_netif_set_ip_info(s_netif, &ip_info);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to set saved address", esp_ret);
+        s_static_ip = false;
+        esp_netif_dhcpc_start(s_netif);
+    }
+}
+
+// TCP/IP task callback: get the lease time from the DHCP ACK (lwIP's DHCP
+// state may only be read from the TCP/IP context)
+static esp_err_t read_lease(void *ctx)
+{
+    uint32_t *lease_s = (uint32_t *)ctx;
+    struct netif *lwip_netif;
+    struct dhcp *dhcp;
+
+    lwip_netif = esp_netif_get_netif_impl(s_netif);
+    dhcp = (lwip_netif != NULL) ? netif_dhcp_data(lwip_netif) : NULL;
+    *lease_s = (dhcp != NULL) ? dhcp->offered_t0_lease : 0;
+
+    return ESP_OK;
+}
+
+/*******************************************************************************
+ * Public function definitions
+ */
+
+// Point the WiFi configuration at the last good access point
+bool wifi_fast_connect_apply(wifi_config_t *wifi_config)
+{
+    s_fast_attempt = false;
+    s_pinned = false;
+
+    // Only reuse an access point of the configured network
+    if (!load_cache() ||
+        (s_cache.channel == 0) ||
+        (strncmp(s_cache.ssid, CONFIG_WIFI_STA_SSID, sizeof(s_cache.ssid)) != 0)) {
+        ESP_LOGI(TAG, "No saved access point, doing a full scan");
+        return false;
+    }
+
+    memcpy(wifi_config->sta.bssid, s_cache.bssid, sizeof(s_cache.bssid));
+    wifi_config->sta.bssid_set = true;
+    wifi_config->sta.channel = s_cache.channel;
+    wifi_config->sta.scan_method = WIFI_FAST_SCAN;
+    s_pinned = true;
+    s_fast_attempt = true;
+    ESP_LOGI(TAG, "Connecting to saved access point " MACSTR " on channel %u",
+             MAC2STR(s_cache.bssid),
+             s_cache.channel);
+
+    return true;
+}
+
+// Save the access point and start the DHCP fallback timer
+void wifi_fast_connect_on_connected(esp_netif_t *netif,
+                                    const wifi_event_sta_connected_t *event)
+{
+    bool same_ap;
+    esp_err_t esp_ret;
+
+    s_netif = netif;
+    s_fast_attempt = false;
+
+    // A saved lease is only trusted on the access point it came from
+    same_ap = (memcmp(s_cache.bssid, event->bssid, sizeof(s_cache.bssid)) == 0);
+    if (!same_ap) {
+        s_cache.ip = 0;
+        s_cache.lease_expiry = 0;
+    }
+    strncpy(s_cache.ssid, CONFIG_WIFI_STA_SSID, sizeof(s_cache.ssid) - 1);
+    s_cache.ssid[sizeof(s_cache.ssid) - 1] = '\0';
+    memcpy(s_cache.bssid, event->bssid, sizeof(s_cache.bssid));
+    s_cache.channel = event->channel;
+    save_cache();
+
+    // Give DHCP a chance first
+    if (!lease_valid()) {
+        return;
+    }
+    if (s_dhcp_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = on_dhcp_timeout,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "wifi_fast_dhcp",
+        };
+        esp_ret = esp_timer_create(&timer_args, &s_dhcp_timer);
+        if (esp_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error (%d): Failed to create DHCP timer", esp_ret);
+            s_dhcp_timer = NULL;
+            return;
+        }
+    }
+    esp_timer_stop(s_dhcp_timer);
+    esp_timer_start_once(s_dhcp_timer, DHCP_TIMEOUT_US);
+}
+
+// Stop the DHCP fallback timer and save the lease
+void wifi_fast_connect_on_got_ip(esp_netif_t *netif,
+                                 const esp_netif_ip_info_t *ip_info)
+{
+    esp_netif_dns_info_t dns_info;
+    uint32_t lease_s = 0;
+    time_t now;
+
+    if (s_dhcp_timer != NULL) {
+        esp_timer_stop(s_dhcp_timer);
+    }
+
+    // The saved lease was applied: nothing new to store
+    if (s_static_ip) {
+        return;
+    }
+
+    // Lease time from the DHCP ACK
+    s_netif = netif;
+    if (esp_netif_tcpip_exec(read_lease, &lease_s) != ESP_OK) {
+        lease_s = 0;
+    }
+    now = time(NULL);
+
+    s_cache.ip = ip_info->ip.addr;
+    s_cache.netmask = ip_info->netmask.addr;
+    s_cache.gw = ip_info->gw.addr;
+    s_cache.dns = 0;
+    if ((esp_netif_get_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns_info) == ESP_OK) &&
+        (dns_info.ip.type == ESP_IPADDR_TYPE_V4)) {
+        s_cache.dns = dns_info.ip.u_addr.ip4.addr;
+    }
+    s_cache.lease_expiry = ((lease_s != 0) && (now >= CLOCK_VALID_S)) ?
+                           (int64_t)now + lease_s : 0;
+    save_cache();
+}
+
+// Fall back to a full scan if the cached access point could not be reached
+bool wifi_fast_connect_on_disconnected(esp_netif_t *netif)
+{
+    wifi_config_t wifi_config;
+    esp_err_t esp_ret;
+
+    if (s_dhcp_timer != NULL) {
+        esp_timer_stop(s_dhcp_timer);
+    }
+
+    // Get the next address from DHCP again
+    if (s_static_ip && (netif != NULL)) {
+        esp_netif_dhcpc_start(netif);
+    }
+    s_static_ip = false;
+
+    // The driver is already scanning all channels
+    if (!s_pinned) {
+        return false;
+    }
+
+    // Lost a working connection: let the next attempt try the cached AP once
+    if (!s_fast_attempt) {
+        s_fast_attempt = true;
+        return false;
+    }
+    s_fast_attempt = false;
+
+    // Forget the access point and channel until the driver is restarted
+    ESP_LOGW(TAG, "Saved access point not reachable, doing a full scan");
+    esp_ret = esp_wifi_get_config(WIFI_IF_STA, &wifi_config);
+    if (esp_ret != ESP_OK) {
+        return false;
+    }
+    wifi_config.sta.bssid_set = false;
+    wifi_config.sta.channel = 0;
+    wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    esp_ret = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to clear saved access point", esp_ret);
+        return false;
+    }
+    s_pinned = false;
+
+    // Retry now: the AP may simply have moved to another channel
+    net_timeline_record(NET_TIMELINE_CONNECT, 0);
+    esp_ret = esp_wifi_connect();
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to start full scan", esp_ret);
+        return false;
+    }
+
+    return true;
+}
+
+// Cancel the DHCP fallback timer
+void wifi_fast_connect_stop(void)
+{
+    if (s_dhcp_timer != NULL) {
+        esp_timer_stop(s_dhcp_timer);
+    }
+    s_fast_attempt = false;
+    s_pinned = false;
+    s_static_ip = false;
+    s_netif = NULL;
+}
@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Shawn Hymel
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Private interface between wifi_sta.c and the fast connect module. Not part
+ * of the component's public API.
+ */
+
+#ifndef WIFI_FAST_CONNECT_H
+#define WIFI_FAST_CONNECT_H
+
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+
+/**
+ * @brief Point the WiFi configuration at the last good access point
+ *
+ * Loads the cached BSSID and channel from NVS. If they were saved for the
+ * configured SSID, sets them in the configuration so the driver skips the
+ * full scan.
+ *
+ * @param[in,out] wifi_config Configuration about to be passed to the driver
+ *
+ * @return true if the cached access point is used
+ */
+bool wifi_fast_connect_apply(wifi_config_t *wifi_config);
+
+/**
+ * @brief Call on WIFI_EVENT_STA_CONNECTED
+ *
+ * Saves the access point and starts the DHCP fallback timer.
+ *
+ * @param[in] netif WiFi network interface
+ * @param[in] event Event data
+ */
+void wifi_fast_connect_on_connected(esp_netif_t *netif,
+                                    const wifi_event_sta_connected_t *event);
+
+/**
+ * @brief Call on IP_EVENT_STA_GOT_IP
+ *
+ * Stops the DHCP fallback timer and saves the lease.
+ *
+ * @param[in] netif WiFi network interface
+ * @param[in] ip_info Address, netmask, and gateway that were assigned
+ */
+void wifi_fast_connect_on_got_ip(esp_netif_t *netif,
+                                 const esp_netif_ip_info_t *ip_info);
+
+/**
+ * @brief Call on WIFI_EVENT_STA_DISCONNECTED
+ *
+ * If the cached access point could not be reached, switches the driver
+ * back to a full scan and starts a new attempt right away. After a working
+ * connection is lost, the next attempt still uses the cached access point
+ * and only a second disconnect falls back.
+ *
+ * @param[in] netif WiFi network interface
+ *
+ * @return true if a full scan attempt was started
+ */
+bool wifi_fast_connect_on_disconnected(esp_netif_t *netif);
+
+/**
+ * @brief Cancel the DHCP fallback timer (driver is stopping)
+ */
+void wifi_fast_connect_stop(void);
+
+#endif // WIFI_FAST_CONNECT_H
@@ -15,10 +15,18 @@
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_private/wifi.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 #include "esp_wifi_netif.h"
+#if CONFIG_DNS_CACHE
+# include "dns_cache.h"
+#endif
 
+#include "net_timeline.h"
 #include "wifi_sta.h"
+#if CONFIG_WIFI_STA_FAST_CONNECT
+# include "wifi_fast_connect.h"
+#endif
 
 // Tag for debug messages
 static const char *TAG = "wifi_sta";
@@ -27,6 +35,9 @@ static const char *TAG = "wifi_sta";
 static esp_netif_t *s_wifi_netif = NULL;
 static EventGroupHandle_t s_wifi_event_group = NULL;
 static wifi_netif_driver_t s_wifi_driver = NULL;
+#if CONFIG_WIFI_STA_AUTO_RECONNECT
+static reconnect_backoff_t s_backoff;
+#endif
 
 /*******************************************************************************
  * Private function prototypes
@@ -47,6 +58,11 @@ static void wifi_start(void *esp_netif,
                        int32_t event_id, 
                        void *data);
 
+#if CONFIG_WIFI_STA_AUTO_RECONNECT
+static reconnect_cause_t classify_reason(uint8_t reason);
+static esp_err_t reconnect_attempt(void *arg);
+#endif
+
 /*******************************************************************************
  * Private function definitions
  */
@@ -95,6 +111,13 @@ static void on_wifi_event(void *arg,
             ESP_LOGI(TAG, "  Channel: %d", event_sta_connected->channel);
             ESP_LOGI(TAG, "  Auth mode: %d", event_sta_connected->authmode);
             ESP_LOGI(TAG, "  AID: %d", event_sta_connected->aid);
+            net_timeline_record(NET_TIMELINE_LINK_UP, 
+                                event_sta_connected->channel);
+
+#if CONFIG_WIFI_STA_FAST_CONNECT
+            // Remember this access point for the next connection
+            wifi_fast_connect_on_connected(s_wifi_netif, event_sta_connected);
+#endif
 
             // (s4.2) Register interface receive callback
             wifi_netif_driver_t driver = esp_netif_get_io_driver(s_wifi_netif);
@@ -135,10 +158,22 @@ static void on_wifi_event(void *arg,
                                               event_data);
             }
             xEventGroupClearBits(s_wifi_event_group, WIFI_STA_CONNECTED_BIT);
-            ESP_LOGI(TAG, "WiFi disconnected");
+            wifi_event_sta_disconnected_t *event_sta_disconnected = 
+                (wifi_event_sta_disconnected_t *)event_data;
+            ESP_LOGI(TAG, "WiFi disconnected (reason %d)", 
+                     event_sta_disconnected->reason);
+            net_timeline_record(NET_TIMELINE_LINK_DOWN, 
+                                event_sta_disconnected->reason);
+#if CONFIG_WIFI_STA_FAST_CONNECT
+            // Saved access point not found: full scan started right away
+            if (wifi_fast_connect_on_disconnected(s_wifi_netif)) {
+                break;
+            }
+#endif
 #if CONFIG_WIFI_STA_AUTO_RECONNECT
-            ESP_LOGI(TAG, "Attempting to reconnect...");
-            wifi_sta_reconnect();
+            // Retry after a randomized, growing delay
+            reconnect_backoff_schedule(&s_backoff, 
+                classify_reason(event_sta_disconnected->reason));
 #endif
             break;
 
@@ -179,6 +214,10 @@ static void on_ip_event(void *arg,
 
             // Set connected bit
             xEventGroupSetBits(s_wifi_event_group, WIFI_STA_IPV4_OBTAINED_BIT);
+            net_timeline_record(NET_TIMELINE_GOT_IP, 0);
+#if CONFIG_WIFI_STA_AUTO_RECONNECT
+            reconnect_backoff_connected(&s_backoff);
+#endif
 
             // Print IP address
             ip_event_got_ip_t *event_ip = (ip_event_got_ip_t *)event_data;
@@ -187,6 +226,13 @@ static void on_ip_event(void *arg,
             ESP_LOGI(TAG, "  IP address: " IPSTR, IP2STR(&ip_info->ip));
             ESP_LOGI(TAG, "  Netmask: " IPSTR, IP2STR(&ip_info->netmask));
             ESP_LOGI(TAG, "  Gateway: " IPSTR, IP2STR(&ip_info->gw));
+            ESP_LOGI(TAG, "  Time since boot: %lld ms", 
+                     esp_timer_get_time() / 1000);
+
+#if CONFIG_WIFI_STA_FAST_CONNECT
+            // Remember the lease for the next connection
+            wifi_fast_connect_on_got_ip(s_wifi_netif, ip_info);
+#endif
 
             break;
 #endif
@@ -201,6 +247,11 @@ static void on_ip_event(void *arg,
                 return;
             }
 
+            // IPv6 events are shared by all interfaces: ignore the others
+            if (((ip_event_got_ip6_t *)event_data)->esp_netif != s_wifi_netif) {
+                return;
+            }
+
             // Notify the WiFi driver that we got an IP address
             esp_ret = esp_wifi_internal_set_sta_ip();
             if (esp_ret != ESP_OK) {
@@ -209,6 +260,10 @@ static void on_ip_event(void *arg,
 
             // Set connected bit
             xEventGroupSetBits(s_wifi_event_group, WIFI_STA_IPV6_OBTAINED_BIT);
+            net_timeline_record(NET_TIMELINE_GOT_IP6, 0);
+#if CONFIG_WIFI_STA_AUTO_RECONNECT
+            reconnect_backoff_connected(&s_backoff);
+#endif
 
             // Print IPv6 address
             ip_event_got_ip6_t *event_ipv6 = (ip_event_got_ip6_t *)event_data;
@@ -224,6 +279,11 @@ static void on_ip_event(void *arg,
             xEventGroupClearBits(s_wifi_event_group, WIFI_STA_IPV4_OBTAINED_BIT);
             xEventGroupClearBits(s_wifi_event_group, WIFI_STA_IPV6_OBTAINED_BIT);
             ESP_LOGI(TAG, "WiFi lost IP address");
+            net_timeline_record(NET_TIMELINE_IP_LOST, 0);
+#if CONFIG_DNS_CACHE
+            // Cached addresses may not be valid on the next network
+            dns_cache_invalidate(NULL);
+#endif
             break;
 
         // Default case: do nothing
@@ -240,6 +300,8 @@ static void wifi_start(void *esp_netif,
                        void *data)
 {
     uint8_t mac_addr[6] = {0};
+    wifi_config_t wifi_config;
+    bool cached_ap;
     esp_err_t esp_ret;
 
     // (s1.3) Get esp-netif driver handle
@@ -285,12 +347,52 @@ static void wifi_start(void *esp_netif,
 
     // (s3.3) Connect to WiFi
     ESP_LOGI(TAG, "Connecting to %s...", CONFIG_WIFI_STA_SSID);
+    cached_ap = (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) == ESP_OK) &&
+                wifi_config.sta.bssid_set;
+    net_timeline_record(NET_TIMELINE_CONNECT, cached_ap ? 1 : 0);
     esp_ret = esp_wifi_connect();
     if (esp_ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to connect to WiFi");
     }
 }
 
+#if CONFIG_WIFI_STA_AUTO_RECONNECT
+// Map a disconnect reason code to a retry strategy
+static reconnect_cause_t classify_reason(uint8_t reason)
+{
+    switch (reason) {
+
+        // Wrong password or security settings: retrying soon won't help
+        case WIFI_REASON_AUTH_FAIL:
+        case WIFI_REASON_MIC_FAILURE:
+        case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+        case WIFI_REASON_HANDSHAKE_TIMEOUT:
+        case WIFI_REASON_802_1X_AUTH_FAILED:
+        case WIFI_REASON_NO_AP_FOUND_W_COMPATIBLE_SECURITY:
+        case WIFI_REASON_NO_AP_FOUND_IN_AUTHMODE_THRESHOLD:
+            return RECONNECT_CAUSE_AUTH;
+
+        // AP is gone for now (e.g. rebooting)
+        case WIFI_REASON_NO_AP_FOUND:
+        case WIFI_REASON_NO_AP_FOUND_IN_RSSI_THRESHOLD:
+            return RECONNECT_CAUSE_NOT_FOUND;
+
+        // Beacon timeout, AP kicked us, etc.: the AP is probably still there
+        default:
+            return RECONNECT_CAUSE_LINK_LOST;
+    }
+}
+
+// Start one reconnect attempt (called by the reconnect scheduler)
+static esp_err_t reconnect_attempt(void *arg)
+{
+    ESP_LOGI(TAG, "Reconnecting to %s...", CONFIG_WIFI_STA_SSID);
+    net_timeline_record(NET_TIMELINE_CONNECT, 0);
+
+    return esp_wifi_connect();
+}
+#endif
+
 /*******************************************************************************
  * Public function definitions
  */
@@ -302,6 +404,7 @@ esp_err_t wifi_sta_init(EventGroupHandle_t event_group)
 
     // Print message
     ESP_LOGI(TAG, "Starting WiFi in station mode...");
+    net_timeline_record(NET_TIMELINE_DRIVER_START, 0);
 
     // Save the event group handle
     if (event_group != NULL) {
@@ -312,6 +415,18 @@ esp_err_t wifi_sta_init(EventGroupHandle_t event_group)
         return ESP_FAIL;
     }
 
+#if CONFIG_WIFI_STA_AUTO_RECONNECT
+    // Set up the reconnect scheduler (kept across restarts)
+    esp_ret = reconnect_backoff_init(&s_backoff, 
+                                     "wifi_sta", 
+                                     reconnect_attempt, 
+                                     NULL);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize reconnect scheduler");
+        return ESP_FAIL;
+    }
+#endif
+
     // (s1.3) Create default WiFi network interface
     esp_netif_config_t netif_cfg = ESP_NETIF_DEFAULT_WIFI_STA();
     s_wifi_netif = esp_netif_new(&netif_cfg);
@@ -398,6 +513,16 @@ esp_err_t wifi_sta_init(EventGroupHandle_t event_group)
     }
 #endif
 
+    // (s1.3) Register IP event: station lost IP address
+    esp_ret = esp_event_handler_register(IP_EVENT, 
+                                         IP_EVENT_STA_LOST_IP,
+                                         &on_ip_event, 
+                                         NULL);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register lost IP event handler");
+        return ESP_FAIL;
+    }
+
     // (s1.3) Register shutdown handler
     esp_ret = esp_register_shutdown_handler((shutdown_handler_t)esp_wifi_stop);
     if (esp_ret != ESP_OK) {
@@ -464,6 +589,10 @@ esp_err_t wifi_sta_init(EventGroupHandle_t event_group)
             .sae_h2e_identifier = CONFIG_WIFI_STA_WPA3_PASSWORD_ID,
         },
     };
+#if CONFIG_WIFI_STA_FAST_CONNECT
+    // Go straight to the last good access point (skips the full scan)
+    wifi_fast_connect_apply(&wifi_config);
+#endif
     esp_ret = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
     if (esp_ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to set WiFi configuration");
@@ -488,6 +617,14 @@ esp_err_t wifi_sta_stop(void)
     // Print message
     ESP_LOGI(TAG, "Stopping WiFi...");
 
+#if CONFIG_WIFI_STA_AUTO_RECONNECT
+    // Don't let a scheduled attempt run while the driver is down
+    reconnect_backoff_cancel(&s_backoff);
+#endif
+#if CONFIG_WIFI_STA_FAST_CONNECT
+    wifi_fast_connect_stop();
+#endif
+
     // Unregister event: station start
     esp_ret = esp_event_handler_unregister(WIFI_EVENT, 
                                           WIFI_EVENT_STA_START, 
@@ -547,6 +684,15 @@ esp_err_t wifi_sta_stop(void)
     }
 #endif
 
+    // Unregister event: station lost IP address
+    esp_ret = esp_event_handler_unregister(IP_EVENT, 
+                                          IP_EVENT_STA_LOST_IP, 
+                                          &on_ip_event);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to unregister lost IP event handler");
+        return ESP_FAIL;
+    }
+
     // Unregister shutdown handler
     esp_ret = esp_unregister_shutdown_handler(
         (shutdown_handler_t)esp_wifi_stop);
@@ -616,6 +762,14 @@ esp_err_t wifi_sta_reconnect(void)
 {
     esp_err_t esp_ret;
 
+#if CONFIG_WIFI_STA_AUTO_RECONNECT
+    // Leave it to the scheduler so the retries stay spread out
+    if (reconnect_backoff_pending(&s_backoff)) {
+        ESP_LOGI(TAG, "Reconnect already scheduled");
+        return ESP_OK;
+    }
+#endif
+
     // Stop WiFi
     esp_ret = wifi_sta_stop();
     if (esp_ret != ESP_OK) {
@@ -631,4 +785,39 @@ esp_err_t wifi_sta_reconnect(void)
     }
 
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+// Get reconnection statistics
+esp_err_t wifi_sta_get_reconnect_stats(reconnect_stats_t *stats)
+{
+#if CONFIG_WIFI_STA_AUTO_RECONNECT
+    reconnect_backoff_get_stats(&s_backoff, stats);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+// Get the signal strength of the access point
+esp_err_t wifi_sta_get_rssi(int8_t *rssi)
+{
+    wifi_ap_record_t ap_info;
+    esp_err_t esp_ret;
+
+    if (s_wifi_netif == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_ret = esp_wifi_sta_get_ap_info(&ap_info);
+    if (esp_ret != ESP_OK) {
+        return esp_ret;
+    }
+    *rssi = ap_info.rssi;
+
+    return ESP_OK;
+}
+
+// Get the WiFi network interface
+esp_netif_t *wifi_sta_get_netif(void)
+{
+    return s_wifi_netif;
+}